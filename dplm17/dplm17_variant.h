@@ -383,7 +383,7 @@ struct __any_backup_storage_required<variant<_Types...> > {
 template <typename... _Types>
 union __variant_data;
 
-template <typename _Type, bool = std::is_literal_type<_Type>::value>
+template <typename _Type, bool = std::is_trivially_destructible<_Type>::value>
 struct __variant_storage {
     typedef _Type __type;
 
@@ -0,0 +1,125 @@
+#include <dplm20_overload.h>
+
+#include <dplm17_variant.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// These benchmarks visit a variant of 40 message types, as a protocol's
+// message variant would be, using a visitor built with 'dplm20::overload'
+// and, for comparison, a hand-written visitor class. The visitor's size is
+// reported as the 'sizeof' counter.
+
+namespace {
+const std::size_t k_NUM_ALTERNATIVES = 40;
+
+template <std::size_t I>
+struct Message {
+    int d_value;
+};
+
+template <typename Indices>
+struct MessageVariantImp;
+
+template <std::size_t... I>
+struct MessageVariantImp<std::index_sequence<I...> > {
+    using type = dplm17::variant<Message<I>...>;
+};
+
+using MessageVariant = typename MessageVariantImp<
+    std::make_index_sequence<k_NUM_ALTERNATIVES> >::type;
+
+template <std::size_t... I>
+std::vector<MessageVariant> makeMessages(std::index_sequence<I...>)
+{
+    std::vector<MessageVariant> result;
+    for (int i = 0; i < 64; ++i)
+        (result.push_back(MessageVariant(Message<I>{i})), ...);
+    return result;
+}
+
+template <std::size_t... I>
+auto makeEmptyHandlers(std::index_sequence<I...>)
+{
+    return dplm20::overload([](const Message<I>& m) {
+        return m.d_value + static_cast<int>(I);
+    }...);
+}
+
+template <std::size_t... I>
+auto makeStatefulHandlers(int *counter, std::index_sequence<I...>)
+{
+    return dplm20::overload([counter](const Message<I>& m) {
+        ++*counter;
+        return m.d_value + static_cast<int>(I);
+    }...);
+}
+
+struct HandWrittenHandler {
+    template <std::size_t I>
+    int operator()(const Message<I>& m) const
+    {
+        return m.d_value + static_cast<int>(I);
+    }
+};
+
+template <typename Visitor>
+void visitAll(benchmark::State& state, Visitor visitor)
+{
+    const std::vector<MessageVariant> messages =
+        makeMessages(std::make_index_sequence<k_NUM_ALTERNATIVES>());
+
+    for (auto _ : state) {
+        int sum = 0;
+        for (const MessageVariant& message : messages)
+            sum += dplm17::visit(visitor, message);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * messages.size());
+    state.counters["sizeof"] = sizeof(Visitor);
+}
+}
+
+static void BM_VisitEmptyOverload(benchmark::State& state)
+{
+    visitAll(state,
+             makeEmptyHandlers(std::make_index_sequence<k_NUM_ALTERNATIVES>()));
+}
+BENCHMARK(BM_VisitEmptyOverload);
+
+static void BM_VisitStatefulOverload(benchmark::State& state)
+{
+    int counter = 0;
+    visitAll(state,
+             makeStatefulHandlers(
+                 &counter, std::make_index_sequence<k_NUM_ALTERNATIVES>()));
+    benchmark::DoNotOptimize(counter);
+}
+BENCHMARK(BM_VisitStatefulOverload);
+
+static void BM_VisitHandWritten(benchmark::State& state)
+{
+    visitAll(state, HandWrittenHandler());
+}
+BENCHMARK(BM_VisitHandWritten);
+
+BENCHMARK_MAIN();
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -10,8 +10,11 @@
 #ifndef INCLUDED_DPLM20_OVERLOAD
 #define INCLUDED_DPLM20_OVERLOAD
 
-#if __cplusplus >= 201402L
+#if __cplusplus < 201703L
+#error "dplm20_overload requires C++17"
+#endif
 
+#include <cstddef>
 #include <functional>
 #include <type_traits>
 #include <utility>
@@ -21,7 +24,8 @@ namespace detail {
 template <class F>
 struct wrap_call {
     using type = F;
-    type f;
+    /* An empty final class takes up no space, like an empty base */
+    [[no_unique_address]] type f;
 
     /* Perfect forwardign constructor */
     template <
@@ -214,38 +218,63 @@ struct overload_storage
 template <typename F>
 using overload_storage_t = typename overload_storage<F>::type;
 
-template <class F, class... Fs>
-class overloader;
+/* The storage of the I'th callable. The index keeps the bases of an
+   overloader distinct even if the same callable type is passed twice, in
+   which case only the calls that both copies accept are ambiguous. */
+template <std::size_t I, typename F>
+struct overload_element : overload_storage_t<F> {
+    template <
+        typename U,
+        /* Make sure that it does not act as copy constructor */
+        std::enable_if_t<
+            !std::is_base_of<overload_element, std::decay_t<U> >::value,
+            bool> = true>
+    constexpr explicit overload_element(U&& fct)
+    : overload_storage_t<F>(std::forward<U>(fct))
+    {
+    }
 
-template <typename F1>
-class overloader<F1> : overload_storage_t<F1> {
-    using base1 = overload_storage_t<F1>;
+    using overload_storage_t<F>::operator();
+};
 
-  public:
-    template <typename U1>
-    constexpr explicit overloader(U1&& fct1)
-    : base1(std::forward<U1>(fct1))
+template <class Indices, class... Fs>
+struct overload_elements;
+
+/* All the callables are direct bases of a single class, and the 'using'
+   declarations are a single pack expansion, so an overload set of N callables
+   is not a chain of N nested classes. Since the bases are distinct types,
+   empty ones (e.g. captureless lambdas) share an address and add nothing to
+   the size of the overloader. */
+template <std::size_t... Is, class... Fs>
+struct overload_elements<std::index_sequence<Is...>, Fs...>
+    : overload_element<Is, Fs>... {
+    template <typename... Us>
+    constexpr explicit overload_elements(Us&&... fcts)
+    : overload_element<Is, Fs>(std::forward<Us>(fcts))...
     {
     }
 
-    using base1::operator();
+    using overload_element<Is, Fs>::operator()...;
 };
-template <typename F1, typename F2, class... Fs>
-class overloader<F1, F2, Fs...> : overload_storage_t<F1>,
-                                  overloader<F2, Fs...> {
-    using base1 = overload_storage_t<F1>;
-    using bases = overloader<F2, Fs...>;
-
-  public:
-    template <typename U1, typename U2, typename... Us>
-    constexpr explicit overloader(U1&& fct1, U2&& fct2, Us&&... fcts)
-    : base1(std::forward<U1>(fct1))
-    , bases(std::forward<U2>(fct2), std::forward<Us>(fcts)...)
+
+template <class... Fs>
+struct overloader
+    : overload_elements<std::index_sequence_for<Fs...>, Fs...> {
+    using base = overload_elements<std::index_sequence_for<Fs...>, Fs...>;
+
+    template <typename... Us,
+              /* Make sure that it does not act as copy constructor */
+              std::enable_if_t<sizeof...(Us) == sizeof...(Fs) &&
+                                   !(std::is_base_of<overloader,
+                                                     std::decay_t<Us> >::value
+                                     || ...),
+                               bool> = true>
+    constexpr explicit overloader(Us&&... fcts)
+    : base(std::forward<Us>(fcts)...)
     {
     }
 
-    using base1::operator();
-    using bases::operator();
+    using base::operator();
 };
 
 template <class R, class... Fs>
@@ -276,5 +305,4 @@ constexpr auto overload(F1&& f1, Fs&&... fcts)
 }
 }
 
-#endif
 #endif  // header
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include <string>
+#include <type_traits>
 
 namespace {
 int test1(std::string)
@@ -13,6 +14,18 @@ int test2(int i)
 {
     return i;
 }
+
+struct Tag {
+};
+
+struct Final final {
+    int operator()(Tag) const { return -1; }
+};
+
+struct Member {
+    int d_value;
+    int get() const { return d_value; }
+};
 }
 
 TEST(dplm20_overload, basic)
@@ -22,6 +35,82 @@ TEST(dplm20_overload, basic)
     EXPECT_EQ(test(3), 3) << "The wrong overload was selected.";
 }
 
+TEST(dplm20_overload, lambdas)
+{
+    int  calls = 0;
+    auto test  = dplm20::overload([](int i) { return i; },
+                                 [&calls](const std::string&) {
+                                     ++calls;
+                                     return -1;
+                                 },
+                                 [](double) { return -2; });
+    EXPECT_EQ(test(3), 3) << "The wrong overload was selected.";
+    EXPECT_EQ(test(std::string("a")), -1)
+        << "The wrong overload was selected.";
+    EXPECT_EQ(test(1.5), -2) << "The wrong overload was selected.";
+    EXPECT_EQ(calls, 1);
+
+    auto copy = test;
+    EXPECT_EQ(copy(4), 4) << "Copying didn't preserve the overload set.";
+    EXPECT_EQ(copy(std::string("a")), -1);
+    EXPECT_EQ(calls, 2) << "Copy doesn't refer to the same state.";
+}
+
+TEST(dplm20_overload, empty_lambdas)
+{
+    // Captureless lambdas occupy no space in the overloader.
+    auto test = dplm20::overload([](int) { return 0; },
+                                 [](char) { return 1; },
+                                 [](double) { return 2; },
+                                 [](const std::string&) { return 3; });
+    static_assert(sizeof(test) == 1, "Empty callables take up space.");
+    static_assert(std::is_empty<decltype(test)>::value, "");
+    EXPECT_EQ(test('a'), 1);
+
+    int  i         = 0;
+    auto withState = dplm20::overload([](char) { return 1; },
+                                      [&i](int) { return i; },
+                                      [](double) { return 2; });
+    static_assert(sizeof(withState) == sizeof(&i),
+                  "Empty callables take up space next to a stateful one.");
+    EXPECT_EQ(withState(1.0), 2);
+}
+
+TEST(dplm20_overload, wrapped_callables)
+{
+    // Function pointers, member function pointers, and final classes cannot
+    // be bases and are wrapped. Each wrapper is exactly as large as what it
+    // holds.
+    auto test = dplm20::overload(test1, test2, Final(), &Member::get);
+    static_assert(sizeof(test) == 2 * sizeof(&test1) + sizeof(&Member::get),
+                  "Wrapped callables take up extra space.");
+
+    EXPECT_EQ(test("hello"), 0);
+    EXPECT_EQ(test(3), 3);
+    EXPECT_EQ(test(Tag()), -1);
+    EXPECT_EQ(test(Member{7}), 7);
+
+    auto explicitTest = dplm20::overload<long>(test1, test2);
+    static_assert(
+        std::is_same<decltype(explicitTest)::result_type, long>::value, "");
+    EXPECT_EQ(explicitTest(5), 5);
+}
+
+TEST(dplm20_overload, duplicate_types)
+{
+    // A callable type may be passed more than once. Calls that only the
+    // copies of it accept are ambiguous, and the others resolve as usual.
+    auto twice = [](int i) { return i; };
+    auto test  = dplm20::overload(
+        twice, [](const std::string&) { return -1; }, twice);
+    static_assert(!std::is_invocable<decltype(test), int>::value,
+                  "Call accepted by both copies isn't ambiguous.");
+    EXPECT_EQ(test(std::string("a")), -1);
+
+    auto pointers = dplm20::overload(test2, test1, test2);
+    EXPECT_EQ(pointers("hello"), 0);
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
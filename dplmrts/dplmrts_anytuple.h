@@ -25,7 +25,7 @@
 // First, we declare the signature for the non-tuple overload:
 //..
 //  template<Container C>
-//  requires !dplmrts::AnyTuple<typename C::value_type>
+//  requires(!dplmrts::AnyTuple<typename C::value_type>)
 //  int f(C c);
 //..
 // Finally, we declare the signature for the tuple overload:
@@ -39,10 +39,20 @@
 
 namespace dplmrts {
 
+struct AnyTuple_Imp {
+    // This class provides a function whose template arguments can be deduced
+    // from any 'std::tuple'. It is declared but never defined.
+
+    template <typename... Types>
+    static void deduce(std::tuple<Types...>);
+};
+
 template <typename T>
-concept bool AnyTuple =
+concept AnyTuple =
     // This concept is satisified by `std::tuple` template instantiations.
-    requires(T t){{t}->std::tuple<auto...>};
+    // Like the Concepts TS form '{t}->std::tuple<auto...>', it holds when the
+    // tuple's element types can be deduced from an lvalue of type 'T'.
+    requires(T t) { dplmrts::AnyTuple_Imp::deduce(t); };
 }
 
 #endif
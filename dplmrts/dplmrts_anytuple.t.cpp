@@ -16,10 +16,10 @@ TEST(dplmrts_anytuple, basic)
 
 namespace {
 template <typename T>
-concept bool Container = true;
+concept Container = true;
 
-template <Container                                     C>
-requires !dplmrts::AnyTuple<typename C::value_type> int f(C c)
+template <Container C>
+requires(!dplmrts::AnyTuple<typename C::value_type>) int f(C c)
 {
     return 0;
 }
@@ -44,12 +44,12 @@
 // Finally, we define the invocable overload:
 //..
 //  template<dplmrts::Invocable F>
-//  requires std::experimental::is_same_v<std::result_of_t<F()>, int>
+//  requires std::is_same_v<std::invoke_result_t<F>, int>
 //  void foo(F f) {
 //    std::cout << std::invoke(f) << std::endl;
 //  }
 //..
-// Note that we're using `is_same_v` and `result_of_t` to verify that the
+// Note that we're using `is_same_v` and `invoke_result_t` to verify that the
 // result of `F` has type `int`.
 
 #include <functional>  // std::invoke
@@ -57,7 +57,7 @@
 namespace dplmrts {
 
 template <typename F, typename... Types>
-concept bool Invocable =
+concept Invocable =
     // This concept is satisified by types that meet the requirements of
     // `std::invoke`.
     requires(F f, Types... t)
@@ -2,9 +2,8 @@
 
 #include <gtest/gtest.h>
 
-#include <experimental/type_traits>  // std::experimental::is_same_v
-#include <functional>                // std::invoke
-#include <type_traits>               // std::result_of_t
+#include <functional>   // std::invoke
+#include <type_traits>  // std::invoke_result_t, std::is_same_v
 #include <vector>
 
 namespace {
@@ -16,7 +15,7 @@ int foo(int i)
 }
 
 template <dplmrts::Invocable F>
-requires std::experimental::is_same_v<std::result_of_t<F()>, int> int foo(F f)
+requires std::is_same_v<std::invoke_result_t<F>, int> int foo(F f)
 {
     return std::invoke(f);
 }
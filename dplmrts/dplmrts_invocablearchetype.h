@@ -35,7 +35,7 @@
 // Finally, we define the invocable of invocable overload.
 // ..
 //   inline int foo(
-//       dplmrts::Invocable<dplmrts::InvocableArchetype<int>> invocable);
+//       dplmrts::Invocable<dplmrts::InvocableArchetype<int>> auto invocable);
 // ..
 // If we call 'foo' with an argument of type 'std::function<void
 // (std::function<void (int)> )>', the second overload will be selected.
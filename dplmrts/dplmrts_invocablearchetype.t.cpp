@@ -31,7 +31,7 @@ int foo(auto value)
 }
 
 inline
-int foo(dplmrts::Invocable<dplmrts::InvocableArchetype<int> > invocable)
+int foo(dplmrts::Invocable<dplmrts::InvocableArchetype<int> > auto invocable)
 {
     return 1;
 }
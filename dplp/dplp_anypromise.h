@@ -27,7 +27,7 @@
 // First, we declare the signature for the non-tuple overload:
 //..
 //  template<Container C>
-//  requires !dplp::AnyPromise<typename C::value_type>
+//  requires(!dplp::AnyPromise<typename C::value_type>)
 //  int f(C c);
 //..
 // Finally, we declare the signature for the tuple overload:
@@ -41,10 +41,20 @@ namespace dplp {
 template <typename... Types>
 class Promise;
 
+struct AnyPromise_Imp {
+    // This class provides a function whose template arguments can be deduced
+    // from any 'dplp::Promise'. It is declared but never defined.
+
+    template <typename... Types>
+    static void deduce(Promise<Types...>);
+};
+
 template <typename T>
-concept bool AnyPromise =
+concept AnyPromise =
     // This concept is satisified by `dplp::Promise` template instantiations.
-    requires(T t){{t}->Promise<auto...>};
+    // Like the Concepts TS form '{t}->Promise<auto...>', it holds when the
+    // promise's value types can be deduced from an lvalue of type 'T'.
+    requires(T t) { dplp::AnyPromise_Imp::deduce(t); };
 }
 
 #endif
@@ -17,10 +17,10 @@ TEST(dplp_anypromise, basic)
 
 namespace {
 template <typename T>
-concept bool Container = true;
+concept Container = true;
 
-template <Container                                    C>
-requires !dplp::AnyPromise<typename C::value_type> int f(C c)
+template <Container C>
+requires(!dplp::AnyPromise<typename C::value_type>) int f(C c)
 {
     return 0;
 }
@@ -0,0 +1,64 @@
+#include <dplp_anypromisehandle.h>
+
+#include <atomic>  // std::atomic
+#include <memory>  // std::make_shared
+
+namespace dplp {
+
+void AnyPromiseHandle::wait() const
+{
+    if (isResolved())
+        return;
+
+    // The flag is shared with the continuations since they may still be
+    // notifying it when this function returns.
+    const auto resolved = std::make_shared<std::atomic<bool> >(false);
+    const auto notify   = [resolved] {
+        resolved->store(true);
+        resolved->notify_all();
+    };
+    d_vtable_p->d_postContinuations(
+        d_state_sp.get(), notify, [notify](std::exception_ptr) { notify(); });
+    resolved->wait(false);
+}
+
+void AnyPromiseHandle::then(
+                   std::function<void()>                   fulfilledCont,
+                   std::function<void(std::exception_ptr)> rejectedCont) const
+{
+    if (!hasState()) {
+        if (d_error)
+            rejectedCont(d_error);
+        else
+            fulfilledCont();
+        return;
+    }
+    d_vtable_p->d_postContinuations(
+        d_state_sp.get(), std::move(fulfilledCont), std::move(rejectedCont));
+}
+
+void AnyPromiseHandle::notify(Callback *callback, void *context) const
+{
+    if (!hasState()) {
+        callback(context, d_error);
+        return;
+    }
+    d_vtable_p->d_postCallback(d_state_sp.get(), callback, context);
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,352 @@
+#ifndef INCLUDED_DPLP_ANYPROMISEHANDLE
+#define INCLUDED_DPLP_ANYPROMISEHANDLE
+
+//@PURPOSE: Provide a type-erased handle to a promise of any type.
+//
+//@CLASSES:
+//  dplp::AnyPromiseHandle: handle to a 'dplp::Promise' of any type
+//  dplp::AnyPromiseHandle_VTable: operations on an erased promise state
+//
+//@SEE_ALSO: dplp_anypromise, dplp_promise
+//
+//@DESCRIPTION: This component provides a value-semantic class,
+// 'dplp::AnyPromiseHandle', that refers to a 'dplp::Promise' of any type.
+// Where 'dplp::AnyPromise' is a compile-time concept, 'AnyPromiseHandle' is a
+// runtime type, so schedulers, tracing tools, and leak registries can hold
+// promises of different types in one container without being templates.
+//
+// A handle shares the promise's state; it does not copy values, allocate, or
+// attach anything when it is created. It consists of that state and a pointer
+// to a table of functions, one per promise type, that know the state's type.
+// Only the creation of a handle, which selects the table, depends on the
+// promise's type. The operations, which ignore the promise's values, are:
+//
+//: o 'isResolved', which checks whether the promise is fulfilled or rejected
+//:   without blocking,
+//: o 'wait', which blocks until the promise is fulfilled or rejected, and
+//: o 'then', which attaches a 'void()' continuation called on fulfillment and
+//:   a 'void(std::exception_ptr)' continuation called on rejection, and
+//: o 'notify', which attaches a function pointer and a context pointer, both
+//:   stored in the state's entry for the continuations, so that, unlike the
+//:   'std::function' objects given to 'then', they never allocate.
+//
+// Two handles compare equal if they refer to the same promise state, i.e. to
+// the same promise or copies of it. Note that a promise created already
+// resolved may hold its result inline and have no state (see 'dplp_promise').
+// Such a promise is a plain value with no identity of its own. A handle to it
+// holds its outcome, the error if it is rejected, in place of the state, and
+// selects a table recording that it has no state. Handles to stateless
+// promises compare equal if the promises have the same type and outcome:
+// both are fulfilled, or both are rejected with the same error. Since a
+// handle ignores the promise's values, those are not compared.
+//
+// A handle is three words: the table pointer and either the state's
+// 'std::shared_ptr' or the inline rejection's 'std::exception_ptr'.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Wait for a heterogeneous batch
+///- - - - - - - - - - - - - - - - - - - - -
+// Suppose that a request handler starts several operations of different
+// result types and must wait for all of them before releasing a resource.
+//..
+//  dplp::Promise<int>         count = countP();
+//  dplp::Promise<std::string> name  = nameP();
+//  dplp::Promise<>            flush = flushP();
+//
+//  std::vector<dplp::AnyPromiseHandle> batch{count, name, flush};
+//  for (const dplp::AnyPromiseHandle& handle : batch)
+//      handle.wait();
+//..
+
+#include <dplp_promise.h>
+
+#include <exception>   // std::exception_ptr
+#include <functional>  // std::function
+#include <memory>      // std::shared_ptr
+#include <new>         // placement new
+#include <utility>     // std::move
+
+namespace dplp {
+
+struct AnyPromiseHandle_VTable {
+    // This struct holds the operations of 'AnyPromiseHandle' for one type of
+    // promise state, which they receive as a 'void' pointer.
+
+    bool d_hasState;
+        // 'true' if the handle holds a state, and 'false' if it holds the
+        // outcome of a promise resolved inline, in which case the operations
+        // are null.
+
+    bool (*d_isResolved)(void *state);
+        // Return 'true' if 'state' is fulfilled or rejected.
+
+    void (*d_postContinuations)(
+                      void                                     *state,
+                      std::function<void()>&&                   fulfilledCont,
+                      std::function<void(std::exception_ptr)>&& rejectedCont);
+        // Post 'fulfilledCont' and 'rejectedCont' to 'state'.
+
+    void (*d_postCallback)(void  *state,
+                           void (*callback)(void *, std::exception_ptr),
+                           void  *context);
+        // Post continuations calling 'callback' with 'context' to 'state'.
+};
+
+template <typename... Types>
+struct AnyPromiseHandle_VTableImp {
+    // This struct provides the 'AnyPromiseHandle_VTable' for
+    // 'PromiseState<Types...>'.
+
+    static bool isResolved(void *state);
+
+    static void postContinuations(
+                      void                                     *state,
+                      std::function<void()>&&                   fulfilledCont,
+                      std::function<void(std::exception_ptr)>&& rejectedCont);
+
+    static void postCallback(void  *state,
+                             void (*callback)(void *, std::exception_ptr),
+                             void  *context);
+
+    static constexpr AnyPromiseHandle_VTable k_VTABLE = {
+        true, &isResolved, &postContinuations, &postCallback};
+
+    static constexpr AnyPromiseHandle_VTable k_RESOLVED_VTABLE = {
+        false, nullptr, nullptr, nullptr};
+};
+
+class AnyPromiseHandle {
+    // This class implements a handle to a promise whose type is erased.
+
+    const AnyPromiseHandle_VTable *d_vtable_p;
+    union {
+        std::shared_ptr<void> d_state_sp;  // if 'd_vtable_p->d_hasState'
+        std::exception_ptr    d_error;     // otherwise, null if fulfilled
+    };
+
+    bool hasState() const;
+        // Return 'true' if this handle holds a promise state, and 'false' if
+        // it holds the outcome of a promise resolved inline.
+
+  public:
+    typedef void Callback(void *context, std::exception_ptr error);
+        // The type of a function given to 'notify'.
+
+    template <typename... Types>
+    AnyPromiseHandle(const dplp::Promise<Types...>& promise);
+        // Create an 'AnyPromiseHandle' object referring to the specified
+        // 'promise'. Note that this conversion is implicit.
+
+    AnyPromiseHandle(const AnyPromiseHandle& original);
+    AnyPromiseHandle(AnyPromiseHandle&& original) noexcept;
+        // Create an 'AnyPromiseHandle' object referring to the same promise
+        // as the specified 'original'. 'original' is left in a valid but
+        // unspecified state when it is moved from.
+
+    ~AnyPromiseHandle();
+        // Destroy this object.
+
+    AnyPromiseHandle& operator=(const AnyPromiseHandle& rhs);
+    AnyPromiseHandle& operator=(AnyPromiseHandle&& rhs) noexcept;
+        // Make this handle refer to the same promise as the specified 'rhs'
+        // and return a reference to it. 'rhs' is left in a valid but
+        // unspecified state when it is moved from.
+
+    bool isResolved() const;
+        // Return 'true' if the promise is fulfilled or rejected, and 'false'
+        // otherwise.
+
+    void wait() const;
+        // Block until the promise is fulfilled or rejected.
+
+    void then(std::function<void()>                   fulfilledCont,
+              std::function<void(std::exception_ptr)> rejectedCont) const;
+        // Call the specified 'fulfilledCont' when the promise is fulfilled,
+        // or the specified 'rejectedCont' with the error when it is
+        // rejected. If the promise is already resolved, the call happens
+        // before this function returns.
+
+    void notify(Callback *callback, void *context) const;
+        // Call the specified 'callback' with the specified 'context' and a
+        // null error when the promise is fulfilled, or with the error when it
+        // is rejected. If the promise is already resolved, the call happens
+        // before this function returns. Note that, unlike 'then', this
+        // function allocates nothing beyond the state's entry for the
+        // continuations.
+
+    const void *state() const;
+        // Return the address of the promise's state, or a null pointer if
+        // the promise was created resolved and holds its result inline.
+
+    friend bool operator==(const AnyPromiseHandle& lhs,
+                           const AnyPromiseHandle& rhs);
+    friend bool operator!=(const AnyPromiseHandle& lhs,
+                           const AnyPromiseHandle& rhs);
+        // Return 'true' if the specified 'lhs' and 'rhs' refer (do not
+        // refer) to the same promise state or, if neither has a state, to
+        // promises of the same type with (without) the same outcome.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+template <typename... Types>
+bool AnyPromiseHandle_VTableImp<Types...>::isResolved(void *state)
+{
+    return static_cast<dplp::PromiseState<Types...> *>(state)->isResolved();
+}
+
+template <typename... Types>
+void AnyPromiseHandle_VTableImp<Types...>::postContinuations(
+                       void                                     *state,
+                       std::function<void()>&&                   fulfilledCont,
+                       std::function<void(std::exception_ptr)>&& rejectedCont)
+{
+    static_cast<dplp::PromiseState<Types...> *>(state)->postContinuations(
+        [fulfilledCont = std::move(fulfilledCont)](const Types&...) {
+            fulfilledCont();
+        },
+        std::move(rejectedCont));
+}
+
+template <typename... Types>
+void AnyPromiseHandle_VTableImp<Types...>::postCallback(
+                               void  *state,
+                               void (*callback)(void *, std::exception_ptr),
+                               void  *context)
+{
+    // Each continuation holds two pointers, which 'std::function' stores
+    // without allocating.
+    static_cast<dplp::PromiseState<Types...> *>(state)->postContinuations(
+        [callback, context](const Types&...) { callback(context, nullptr); },
+        [callback, context](std::exception_ptr error) {
+            callback(context, std::move(error));
+        });
+}
+
+template <typename... Types>
+AnyPromiseHandle::AnyPromiseHandle(const dplp::Promise<Types...>& promise)
+{
+    using P   = dplp::Promise<Types...>;
+    using Imp = AnyPromiseHandle_VTableImp<Types...>;
+
+    if (promise.d_data_sp) {
+        d_vtable_p = &Imp::k_VTABLE;
+        ::new (&d_state_sp) std::shared_ptr<void>(promise.d_data_sp);
+    }
+    else {
+        d_vtable_p = &Imp::k_RESOLVED_VTABLE;
+        ::new (&d_error) std::exception_ptr(
+            promise.d_ready.index() == P::k_REJECTED
+                ? dplm17::get<P::k_REJECTED>(promise.d_ready)
+                : nullptr);
+    }
+}
+
+inline
+AnyPromiseHandle::AnyPromiseHandle(const AnyPromiseHandle& original)
+: d_vtable_p(original.d_vtable_p)
+{
+    if (hasState())
+        ::new (&d_state_sp) std::shared_ptr<void>(original.d_state_sp);
+    else
+        ::new (&d_error) std::exception_ptr(original.d_error);
+}
+
+inline
+AnyPromiseHandle::AnyPromiseHandle(AnyPromiseHandle&& original) noexcept
+: d_vtable_p(original.d_vtable_p)
+{
+    if (hasState())
+        ::new (&d_state_sp) std::shared_ptr<void>(
+                                              std::move(original.d_state_sp));
+    else
+        ::new (&d_error) std::exception_ptr(std::move(original.d_error));
+}
+
+inline
+AnyPromiseHandle::~AnyPromiseHandle()
+{
+    if (hasState())
+        d_state_sp.~shared_ptr();
+    else
+        d_error.~exception_ptr();
+}
+
+inline
+AnyPromiseHandle& AnyPromiseHandle::operator=(const AnyPromiseHandle& rhs)
+{
+    // Copying either member does not throw.
+    if (this != &rhs) {
+        this->~AnyPromiseHandle();
+        ::new (this) AnyPromiseHandle(rhs);
+    }
+    return *this;
+}
+
+inline
+AnyPromiseHandle& AnyPromiseHandle::operator=(AnyPromiseHandle&& rhs) noexcept
+{
+    if (this != &rhs) {
+        this->~AnyPromiseHandle();
+        ::new (this) AnyPromiseHandle(std::move(rhs));
+    }
+    return *this;
+}
+
+inline
+bool AnyPromiseHandle::hasState() const
+{
+    return d_vtable_p->d_hasState;
+}
+
+inline
+bool AnyPromiseHandle::isResolved() const
+{
+    return !hasState() || d_vtable_p->d_isResolved(d_state_sp.get());
+}
+
+inline
+const void *AnyPromiseHandle::state() const
+{
+    return hasState() ? d_state_sp.get() : nullptr;
+}
+
+inline
+bool operator==(const AnyPromiseHandle& lhs, const AnyPromiseHandle& rhs)
+{
+    // Equal tables hold the same member.
+    if (lhs.d_vtable_p != rhs.d_vtable_p)
+        return false;
+    return lhs.hasState() ? lhs.d_state_sp == rhs.d_state_sp
+                          : lhs.d_error == rhs.d_error;
+}
+
+inline
+bool operator!=(const AnyPromiseHandle& lhs, const AnyPromiseHandle& rhs)
+{
+    return !(lhs == rhs);
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
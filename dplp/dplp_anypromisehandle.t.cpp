@@ -0,0 +1,227 @@
+#include <dplp_anypromisehandle.h>
+
+#include <dplp_promise.h>
+#include <gtest/gtest.h>
+
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(dplp_anypromisehandle, heterogeneous)
+{
+    std::function<void(int)>         fulfillInt;
+    std::function<void(std::string)> fulfillString;
+
+    std::vector<dplp::AnyPromiseHandle> handles{
+        dplp::Promise<int>([&](auto f, auto) { fulfillInt = f; }),
+        dplp::Promise<std::string>([&](auto f, auto) { fulfillString = f; }),
+        dplp::makeFulfilledPromise(),
+        dplp::makeRejectedPromise<double, char>(
+            std::make_exception_ptr(std::runtime_error("error")))};
+
+    EXPECT_FALSE(handles[0].isResolved());
+    EXPECT_FALSE(handles[1].isResolved());
+    EXPECT_TRUE(handles[2].isResolved());
+    EXPECT_TRUE(handles[3].isResolved()) << "Rejected isn't resolved.";
+
+    fulfillInt(1);
+    EXPECT_TRUE(handles[0].isResolved());
+    EXPECT_FALSE(handles[1].isResolved());
+    fulfillString("a");
+    EXPECT_TRUE(handles[1].isResolved());
+}
+
+TEST(dplp_anypromisehandle, then)
+{
+    std::function<void(int, std::string)> fulfill;
+    std::function<void(std::exception_ptr)> reject;
+    dplp::AnyPromiseHandle handle = dplp::Promise<int, std::string>(
+        [&](auto f, auto r) {
+            fulfill = f;
+            reject  = r;
+        });
+
+    int numFulfilled = 0;
+    int numRejected  = 0;
+    handle.then([&] { ++numFulfilled; },
+                [&](std::exception_ptr) { ++numRejected; });
+    EXPECT_EQ(numFulfilled, 0);
+
+    fulfill(1, "a");
+    EXPECT_EQ(numFulfilled, 1);
+    EXPECT_EQ(numRejected, 0);
+
+    // Already resolved.
+    handle.then([&] { ++numFulfilled; },
+                [&](std::exception_ptr) { ++numRejected; });
+    EXPECT_EQ(numFulfilled, 2);
+
+    dplp::AnyPromiseHandle rejected = dplp::makeRejectedPromise<int>(
+        std::make_exception_ptr(std::runtime_error("error")));
+    std::exception_ptr error;
+    rejected.then([&] { ++numFulfilled; },
+                  [&](std::exception_ptr e) { error = e; });
+    EXPECT_TRUE(error);
+    EXPECT_EQ(numFulfilled, 2);
+}
+
+TEST(dplp_anypromisehandle, notify)
+{
+    struct Outcome {
+        int                d_numCalls = 0;
+        std::exception_ptr d_error;
+
+        static void record(void *context, std::exception_ptr error)
+        {
+            Outcome *const outcome = static_cast<Outcome *>(context);
+            ++outcome->d_numCalls;
+            outcome->d_error = std::move(error);
+        }
+    };
+
+    std::function<void(int)> fulfill;
+    dplp::AnyPromiseHandle   handle =
+        dplp::Promise<int>([&](auto f, auto) { fulfill = f; });
+
+    Outcome outcome;
+    handle.notify(&Outcome::record, &outcome);
+    EXPECT_EQ(outcome.d_numCalls, 0);
+    fulfill(1);
+    EXPECT_EQ(outcome.d_numCalls, 1);
+    EXPECT_FALSE(outcome.d_error);
+
+    // Already resolved, inline.
+    dplp::AnyPromiseHandle rejected = dplp::makeRejectedPromise<int>(
+        std::make_exception_ptr(std::runtime_error("error")));
+    rejected.notify(&Outcome::record, &outcome);
+    EXPECT_EQ(outcome.d_numCalls, 2);
+    EXPECT_TRUE(outcome.d_error);
+}
+
+TEST(dplp_anypromisehandle, wait)
+{
+    std::function<void(int)> fulfill;
+    dplp::Promise<int>       p([&](auto f, auto) { fulfill = f; });
+    dplp::AnyPromiseHandle   handle = p;
+
+    std::thread resolver([&] { fulfill(3); });
+    handle.wait();
+    EXPECT_TRUE(handle.isResolved());
+    resolver.join();
+
+    // Waiting on a resolved promise returns immediately.
+    handle.wait();
+
+    dplp::AnyPromiseHandle rejected = dplp::makeRejectedPromise<>(
+        std::make_exception_ptr(std::runtime_error("error")));
+    rejected.wait();
+}
+
+TEST(dplp_anypromisehandle, equality)
+{
+    const auto resolver = [](auto fulfill, auto) { fulfill(1); };
+
+    dplp::Promise<int> p(resolver);
+    dplp::Promise<int> copy = p;
+    dplp::Promise<int> other(resolver);
+
+    EXPECT_EQ(dplp::AnyPromiseHandle(p), dplp::AnyPromiseHandle(copy));
+    EXPECT_NE(dplp::AnyPromiseHandle(p), dplp::AnyPromiseHandle(other));
+
+    // Promises created resolved have no state, and their handles compare
+    // equal if the promises have the same type and outcome.
+    const std::exception_ptr error =
+        std::make_exception_ptr(std::runtime_error("error"));
+    const std::exception_ptr otherError =
+        std::make_exception_ptr(std::runtime_error("error"));
+    const dplp::Promise<int>  one     = dplp::makeFulfilledPromise(1);
+    const dplp::Promise<int>  oneCopy = one;
+    const dplp::Promise<char> letter  = dplp::makeFulfilledPromise('a');
+    const dplp::Promise<int>  failed  = dplp::makeRejectedPromise<int>(error);
+    const dplp::Promise<>     failed2 = dplp::makeRejectedPromise<>(error);
+
+    const dplp::AnyPromiseHandle handle(one);
+    const dplp::AnyPromiseHandle handleCopy = handle;
+    EXPECT_EQ(handle, handleCopy);
+    EXPECT_EQ(handle, dplp::AnyPromiseHandle(one));
+    EXPECT_EQ(handle, dplp::AnyPromiseHandle(oneCopy));
+    EXPECT_EQ(handle, dplp::AnyPromiseHandle(dplp::makeFulfilledPromise(2)))
+        << "The values of fulfilled promises are not compared.";
+    EXPECT_NE(handle, dplp::AnyPromiseHandle(letter));
+    EXPECT_EQ(dplp::AnyPromiseHandle(failed), dplp::AnyPromiseHandle(failed));
+    EXPECT_NE(dplp::AnyPromiseHandle(failed),
+              dplp::AnyPromiseHandle(dplp::makeRejectedPromise<int>(
+                  otherError)));
+    EXPECT_NE(dplp::AnyPromiseHandle(failed),
+              dplp::AnyPromiseHandle(failed2));
+    EXPECT_NE(handle, dplp::AnyPromiseHandle(failed));
+    EXPECT_NE(handle, dplp::AnyPromiseHandle(p));
+}
+
+TEST(dplp_anypromisehandle, value_semantics)
+{
+    static_assert(sizeof(dplp::AnyPromiseHandle) == 3 * sizeof(void *), "");
+
+    std::function<void(int)> fulfill;
+    const dplp::Promise<int> waiting([&](auto f, auto) { fulfill = f; });
+    const std::exception_ptr error =
+        std::make_exception_ptr(std::runtime_error("error"));
+
+    // Copies and moves between handles with and without a state.
+    std::vector<dplp::AnyPromiseHandle> handles{
+        waiting,
+        dplp::makeFulfilledPromise(1),
+        dplp::makeRejectedPromise<int>(error)};
+    const std::vector<dplp::AnyPromiseHandle> copies = handles;
+    EXPECT_EQ(copies, handles);
+
+    dplp::AnyPromiseHandle handle = handles[1];
+    handle                        = handles[0];
+    EXPECT_EQ(handle, copies[0]);
+    handle = std::move(handles[2]);
+    EXPECT_EQ(handle, copies[2]);
+    handle = handles[1];
+    EXPECT_EQ(handle, copies[1]);
+
+    dplp::AnyPromiseHandle moved = std::move(handles[0]);
+    EXPECT_EQ(moved, copies[0]);
+    EXPECT_FALSE(moved.isResolved());
+    fulfill(1);
+    EXPECT_TRUE(moved.isResolved());
+}
+
+TEST(dplp_anypromisehandle, state)
+{
+    dplp::Promise<int> p([](auto, auto) {});
+    dplp::Promise<int> copy = p;
+    EXPECT_NE(dplp::AnyPromiseHandle(p).state(), nullptr);
+    EXPECT_EQ(dplp::AnyPromiseHandle(p).state(),
+              dplp::AnyPromiseHandle(copy).state());
+    EXPECT_EQ(dplp::AnyPromiseHandle(dplp::makeFulfilledPromise(1)).state(),
+              nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
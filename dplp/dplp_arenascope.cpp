@@ -0,0 +1,125 @@
+#include <dplp_arenascope.h>
+
+#include <cassert>  // assert
+#include <cstddef>  // std::max_align_t
+#include <memory>   // std::align
+
+namespace dplp {
+
+struct ArenaScope_Resource::Chunk {
+    Chunk       *d_next_p;
+    std::size_t  d_size;  // including this header
+};
+
+void *ArenaScope_Resource::do_allocate(std::size_t bytes,
+                                       std::size_t alignment)
+{
+    void       *result = d_current_p;
+    std::size_t space  = d_end_p - d_current_p;
+    if (!d_current_p || !std::align(alignment, bytes, result, space)) {
+        std::size_t size = d_nextChunkSize;
+        while (size < sizeof(Chunk) + alignment + bytes)
+            size *= 2;
+        d_nextChunkSize = size * 2;
+
+        Chunk *const chunk = static_cast<Chunk *>(
+            d_upstream_p->allocate(size, alignof(std::max_align_t)));
+        chunk->d_next_p = d_chunks_p;
+        chunk->d_size   = size;
+        d_chunks_p      = chunk;
+
+        d_current_p = reinterpret_cast<char *>(chunk + 1);
+        d_end_p     = reinterpret_cast<char *>(chunk) + size;
+
+        result = d_current_p;
+        space  = d_end_p - d_current_p;
+        std::align(alignment, bytes, result, space);
+    }
+    d_current_p = static_cast<char *>(result) + bytes;
+
+#ifndef NDEBUG
+    d_numLive.fetch_add(1, std::memory_order_relaxed);
+#endif
+    return result;
+}
+
+void ArenaScope_Resource::do_deallocate(void *, std::size_t, std::size_t)
+{
+    // Memory is only reclaimed when the arena is destroyed.
+#ifndef NDEBUG
+    d_numLive.fetch_sub(1, std::memory_order_relaxed);
+#endif
+}
+
+bool ArenaScope_Resource::do_is_equal(
+                               const std::pmr::memory_resource& other) const
+                                                                       noexcept
+{
+    return this == &other;
+}
+
+ArenaScope_Resource::ArenaScope_Resource(
+                                  void                      *buffer,
+                                  std::size_t                size,
+                                  std::size_t                nextChunkSize,
+                                  std::pmr::memory_resource *upstream)
+: d_upstream_p(upstream)
+, d_chunks_p(nullptr)
+, d_current_p(static_cast<char *>(buffer))
+, d_end_p(static_cast<char *>(buffer) + size)
+, d_nextChunkSize(nextChunkSize ? nextChunkSize : 1)
+, d_numLive(0)
+{
+}
+
+ArenaScope_Resource::~ArenaScope_Resource()
+{
+    while (Chunk *const chunk = d_chunks_p) {
+        d_chunks_p = chunk->d_next_p;
+        d_upstream_p->deallocate(chunk,
+                                 chunk->d_size,
+                                 alignof(std::max_align_t));
+    }
+}
+
+std::size_t ArenaScope_Resource::numLiveAllocations() const
+{
+    return d_numLive.load(std::memory_order_relaxed);
+}
+
+ArenaScope::ArenaScope(std::size_t initialChunkSize)
+: d_arena(nullptr, 0, initialChunkSize, DefaultResource::get())
+, d_guard(&d_arena)
+{
+}
+
+ArenaScope::ArenaScope(void *buffer, std::size_t size)
+: d_arena(buffer, size, k_DEFAULT_CHUNK_SIZE, DefaultResource::get())
+, d_guard(&d_arena)
+{
+}
+
+ArenaScope::~ArenaScope()
+{
+    // Note that 'd_guard' is destroyed after this body runs, but nothing
+    // allocates from the arena in between.
+    assert(d_arena.numLiveAllocations() == 0 &&
+           "promise state outlived its 'dplp::ArenaScope'");
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
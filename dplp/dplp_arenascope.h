@@ -0,0 +1,195 @@
+#ifndef INCLUDED_DPLP_ARENASCOPE
+#define INCLUDED_DPLP_ARENASCOPE
+
+//@PURPOSE: Provide a scope whose promises are allocated from a bump arena.
+//
+//@CLASSES:
+//  dplp::ArenaScope: installs a bump arena as the default resource
+//  dplp::ArenaScope_Resource: the bump arena itself
+//
+//@SEE_ALSO: dplp_defaultresource, dplp_recyclingresource
+//
+//@DESCRIPTION: This component provides a guard class, 'dplp::ArenaScope',
+// that owns a bump (monotonic) arena and installs it as the current thread's
+// 'dplp::DefaultResource' for its lifetime. Every promise state and every
+// list of waiting continuations created on that thread while the scope is
+// active, including by 'dplp::Promise::then', is carved out of the arena.
+//
+// Allocation is a pointer increment and deallocation does nothing. The arena
+// obtains its memory in geometrically growing chunks from the resource that
+// was the default when the scope was created, or uses a caller-supplied
+// buffer first. All of it is released at once when the scope ends, which is a
+// single deallocation if the first chunk sufficed and none if the buffer did.
+//
+// The arena can also be passed explicitly, using 'resource()', for example
+// to a 'dplp::DefaultResourceGuard' in a continuation that runs on another
+// thread. Note, however, that the arena does not synchronize allocations, so
+// only one thread at a time may create promises from it. That includes
+// calling 'then' on a waiting promise with values whose state came from the
+// arena: its list of continuations grows from the resource that was current
+// when the state was created, i.e. the arena, whatever thread calls 'then'
+// and whatever resource is current there. (A 'dplp::Promise<>' allocates its
+// waiting continuations from the caller's 'dplp::DefaultResource' instead.)
+// Releasing promises, on the other hand, is safe on any thread.
+//
+// Continuation closures are not always carved out of the arena. A
+// continuation posted to a 'dplp::Promise<>' is stored, closure and all, in an
+// arena allocation, but a promise with values keeps its continuations in
+// 'std::function' objects, whose closures come from the global heap unless
+// they fit in the 'std::function' itself (two pointers in common
+// implementations). So do the tasks 'dplp::Trampoline' queues on deep chains.
+// Keeping captures small, e.g. capturing only a pointer to a request object
+// that itself lives in the arena, avoids those allocations.
+//
+// Every promise allocated from the arena must be destroyed before the scope
+// ends. Unless 'NDEBUG' is defined when this component's implementation is
+// compiled, the arena counts its live allocations and the scope's destructor
+// asserts that none remain. See 'numLiveAllocations'.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Allocate a request's promises from an arena
+///- - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Suppose a handler builds a chain of promises that all die once the request
+// is answered. A stack buffer usually suffices, so handling a request
+// allocates nothing.
+//..
+//  void handle(const Request& request)
+//  {
+//      char             buffer[4096];
+//      dplp::ArenaScope scope(buffer, sizeof buffer);
+//
+//      parseP(request)
+//          .then([](const Query& q) { return lookupP(q); })
+//          .then([&](const Row& r) { respond(request, r); });
+//
+//      runUntilIdle();  // all the promises above are released here
+//  }
+//..
+
+#include <dplp_defaultresource.h>
+
+#include <atomic>           // std::atomic
+#include <cstddef>          // std::size_t
+#include <memory_resource>  // std::pmr::memory_resource
+
+namespace dplp {
+
+class ArenaScope_Resource : public std::pmr::memory_resource {
+    // This class implements a memory resource that allocates by incrementing
+    // a pointer and releases everything at once. This is an implementation
+    // detail of 'ArenaScope'.
+
+    struct Chunk;
+        // The header of a chunk obtained from upstream.
+
+    std::pmr::memory_resource *d_upstream_p;
+    Chunk                     *d_chunks_p;     // most recent first
+    char                      *d_current_p;
+    char                      *d_end_p;
+    std::size_t                d_nextChunkSize;
+    std::atomic<std::size_t>   d_numLive;      // maintained unless 'NDEBUG'
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void  do_deallocate(void        *p,
+                        std::size_t  bytes,
+                        std::size_t  alignment) override;
+    bool  do_is_equal(const std::pmr::memory_resource& other) const
+                                                             noexcept override;
+
+  public:
+    ArenaScope_Resource(void                      *buffer,
+                        std::size_t                size,
+                        std::size_t                nextChunkSize,
+                        std::pmr::memory_resource *upstream);
+        // Create an arena allocating first from the specified 'buffer' of the
+        // specified 'size' and then from chunks, the first of the specified
+        // 'nextChunkSize' bytes, obtained from the specified 'upstream'.
+        // 'buffer' may be null if 'size' is 0.
+
+    ArenaScope_Resource(const ArenaScope_Resource&) = delete;
+    ArenaScope_Resource& operator=(const ArenaScope_Resource&) = delete;
+
+    ~ArenaScope_Resource();
+        // Return all the chunks to upstream.
+
+    std::size_t numLiveAllocations() const;
+        // Return the number of allocations not yet deallocated, or 0 if
+        // 'NDEBUG' is defined.
+};
+
+class ArenaScope {
+    // This class implements a guard that owns a bump arena and installs it as
+    // the current thread's default resource.
+
+    ArenaScope_Resource  d_arena;
+    DefaultResourceGuard d_guard;
+
+  public:
+    static constexpr std::size_t k_DEFAULT_CHUNK_SIZE = 4096;
+
+    explicit ArenaScope(std::size_t initialChunkSize = k_DEFAULT_CHUNK_SIZE);
+        // Create an 'ArenaScope' object whose arena obtains chunks, the first
+        // of the optionally specified 'initialChunkSize' bytes, from the
+        // current 'dplp::DefaultResource', and install the arena.
+
+    ArenaScope(void *buffer, std::size_t size);
+        // Create an 'ArenaScope' object whose arena allocates from the
+        // specified 'buffer' of the specified 'size' before obtaining chunks
+        // from the current 'dplp::DefaultResource', and install the arena.
+        // The behavior is undefined unless 'buffer' outlives this object.
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    ~ArenaScope();
+        // Restore the previous default resource and release all of the
+        // arena's memory. Unless 'NDEBUG' is defined, assert that no promise
+        // state allocated from the arena still exists.
+
+    std::pmr::memory_resource *resource();
+        // Return the arena, e.g. to install it with 'DefaultResourceGuard' on
+        // another thread.
+
+    std::size_t numLiveAllocations() const;
+        // Return the number of arena allocations, i.e. promise states and
+        // continuation lists, that have not been released yet, or 0 if
+        // 'NDEBUG' is defined.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+std::pmr::memory_resource *ArenaScope::resource()
+{
+    return &d_arena;
+}
+
+inline
+std::size_t ArenaScope::numLiveAllocations() const
+{
+    return d_arena.numLiveAllocations();
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
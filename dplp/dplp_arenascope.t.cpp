@@ -0,0 +1,141 @@
+#include <dplp_arenascope.h>
+
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <vector>
+
+TEST(dplp_arenascope, installs_arena)
+{
+    std::pmr::memory_resource *const original = dplp::DefaultResource::get();
+    {
+        dplp::ArenaScope scope;
+        EXPECT_EQ(dplp::DefaultResource::get(), scope.resource())
+            << "Scope didn't install its arena.";
+    }
+    EXPECT_EQ(dplp::DefaultResource::get(), original)
+        << "Scope didn't restore the previous resource.";
+}
+
+TEST(dplp_arenascope, buffer)
+{
+    dplp::TestUtil::CountingResource upstream;
+    dplp::DefaultResourceGuard       upstreamGuard(&upstream);
+    {
+        alignas(std::max_align_t) char buffer[4096];
+        dplp::ArenaScope                scope(buffer, sizeof buffer);
+
+        std::function<void(int)> fulfill;
+        int                      result = 0;
+        {
+            dplp::Promise<int> p =
+                dplp::Promise<int>([&](auto f, auto) { fulfill = f; })
+                    .then([](int i) { return i + 1; });
+            p.then([&](int i) { result = i; });
+#ifndef NDEBUG
+            EXPECT_GT(scope.numLiveAllocations(), 0u);
+#endif
+        }
+        fulfill(1);
+        fulfill = nullptr;
+        EXPECT_EQ(result, 2);
+        EXPECT_EQ(scope.numLiveAllocations(), 0u)
+            << "Promise state wasn't released.";
+    }
+    EXPECT_EQ(upstream.numAllocations(), 0)
+        << "The buffer wasn't used.";
+}
+
+TEST(dplp_arenascope, chunks)
+{
+    dplp::TestUtil::CountingResource upstream;
+    dplp::DefaultResourceGuard       upstreamGuard(&upstream);
+    {
+        dplp::ArenaScope scope(256);
+
+        std::vector<dplp::Promise<int> > promises;
+        for (int i = 0; i < 200; ++i)
+            promises.push_back(dplp::Promise<int>([i](auto fulfill, auto) {
+                                   fulfill(i);
+                               }).then([](int v) { return v * 2; }));
+
+        // Note that the vector itself is allocated from the global
+        // allocator, not the upstream resource.
+        EXPECT_GT(upstream.numAllocations(), 1);
+        EXPECT_LT(upstream.numAllocations(), 10)
+            << "Chunks aren't growing geometrically.";
+
+        for (std::size_t i = 0; i < promises.size(); ++i) {
+            int value = 0;
+            promises[i].then([&](int v) { value = v; });
+            EXPECT_EQ(value, static_cast<int>(2 * i));
+        }
+        promises.clear();
+        EXPECT_EQ(upstream.numDeallocations(), 0)
+            << "Arena memory was released early.";
+    }
+    EXPECT_EQ(upstream.numDeallocations(), upstream.numAllocations())
+        << "Chunks weren't released.";
+}
+
+TEST(dplp_arenascope, alignment)
+{
+    dplp::ArenaScope                 scope;
+    std::pmr::memory_resource *const arena = scope.resource();
+
+    void *const c = arena->allocate(1, 1);
+    void *const p = arena->allocate(8, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % 64, 0u);
+    arena->deallocate(p, 8, 64);
+    arena->deallocate(c, 1, 1);
+
+    // An allocation larger than a chunk gets its own chunk.
+    const std::size_t size = 3 * dplp::ArenaScope::k_DEFAULT_CHUNK_SIZE;
+    void *const       q    = arena->allocate(size);
+    arena->deallocate(q, size);
+}
+
+#ifndef NDEBUG
+TEST(dplp_arenascope, outliving_state)
+{
+    EXPECT_DEATH(
+        {
+            dplp::Promise<int> *leaked;
+            {
+                dplp::ArenaScope scope;
+                leaked = new dplp::Promise<int>(
+                    [](auto fulfill, auto) { fulfill(1); });
+            }
+            delete leaked;
+        },
+        "outlived");
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,170 @@
+#include <dplp_asyncscope.h>
+
+#include <dplp_trampoline.h>
+
+namespace dplp {
+
+AsyncScope::AsyncScope(std::size_t maxConcurrency)
+: d_maxConcurrency(maxConcurrency)
+, d_numChildren(0)
+, d_stopRequested(false)
+, d_numRunning(0)
+, d_queueHead_p(nullptr)
+, d_queueTail_p(nullptr)
+{
+}
+
+AsyncScope::~AsyncScope()
+{
+}
+
+void AsyncScope::complete(std::exception_ptr error)
+{
+    AsyncScope_Task *next = nullptr;
+    if (error || d_maxConcurrency != k_UNLIMITED) {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        if (error && !d_error)
+            d_error = std::move(error);
+
+        if (d_maxConcurrency != k_UNLIMITED) {
+            // The next queued function takes over the completed child's slot.
+            next = d_queueHead_p;
+            if (next) {
+                d_queueHead_p = next->d_next_p;
+                if (!d_queueHead_p)
+                    d_queueTail_p = nullptr;
+            }
+            else {
+                --d_numRunning;
+            }
+        }
+    }
+
+    // Starting the next function here, on the thread of the completed child,
+    // may complete it synchronously in turn, so the trampoline bounds the
+    // recursion through a long queue.
+    if (next)
+        dplp::Trampoline::run([this, next] { next->start(this); });
+
+    uncount(1);
+}
+
+void AsyncScope::completeChild(void *scope, std::exception_ptr error)
+{
+    static_cast<AsyncScope *>(scope)->complete(std::move(error));
+}
+
+bool AsyncScope::acquireSlot()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    if (d_numRunning >= d_maxConcurrency)
+        return false;
+
+    ++d_numRunning;
+    return true;
+}
+
+bool AsyncScope::enqueue(dplp::AsyncScope_Task *task)
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        if (!isStopRequested()) {
+            // A slot may have been freed since 'acquireSlot' failed.
+            if (d_numRunning < d_maxConcurrency) {
+                ++d_numRunning;
+                return false;
+            }
+
+            task->d_next_p = nullptr;
+            if (d_queueTail_p)
+                d_queueTail_p->d_next_p = task;
+            else
+                d_queueHead_p = task;
+            d_queueTail_p = task;
+            return true;
+        }
+    }
+
+    task->discard();
+    uncount(1);
+    return true;
+}
+
+void AsyncScope::uncount(std::size_t numChildren)
+{
+    if (numChildren == 0 ||
+        d_numChildren.fetch_sub(numChildren, std::memory_order_acq_rel) !=
+            numChildren)
+        return;
+
+    std::vector<Joiner> joiners;
+    std::exception_ptr  error;
+    {
+        // A child spawned since the count dropped to zero is awaited by the
+        // current joiners too; the last child to complete resolves them.
+        std::lock_guard<std::mutex> lock(d_mutex);
+        if (d_numChildren.load(std::memory_order_acquire) != 0)
+            return;
+        joiners.swap(d_joiners);
+        error = d_error;
+    }
+
+    for (Joiner& joiner : joiners) {
+        if (error)
+            joiner.d_reject(error);
+        else
+            joiner.d_fulfill();
+    }
+}
+
+dplp::Promise<> AsyncScope::join()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    if (d_numChildren.load(std::memory_order_acquire) == 0) {
+        if (d_error)
+            return dplp::makeRejectedPromise<>(d_error);
+        return dplp::makeFulfilledPromise();
+    }
+
+    return dplp::Promise<>([this](auto fulfill, auto reject) {
+        d_joiners.push_back(Joiner{fulfill, reject});
+    });
+}
+
+void AsyncScope::requestStop()
+{
+    AsyncScope_Task *queue = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_stopRequested.store(true, std::memory_order_release);
+        queue         = d_queueHead_p;
+        d_queueHead_p = nullptr;
+        d_queueTail_p = nullptr;
+    }
+
+    std::size_t numDiscarded = 0;
+    while (queue) {
+        AsyncScope_Task *const next = queue->d_next_p;
+        queue->discard();
+        queue = next;
+        ++numDiscarded;
+    }
+    uncount(numDiscarded);
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
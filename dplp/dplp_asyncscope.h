@@ -0,0 +1,357 @@
+#ifndef INCLUDED_DPLP_ASYNCSCOPE
+#define INCLUDED_DPLP_ASYNCSCOPE
+
+//@PURPOSE: Provide a scope that tracks, limits, and joins spawned promises.
+//
+//@CLASSES:
+//  dplp::AsyncScope: owner of spawned asynchronous work
+//  dplp::AsyncScope_Task: spawned function waiting for a concurrency slot
+//
+//@SEE_ALSO: dplp_anypromisehandle, dplp_promise
+//
+//@DESCRIPTION: This component provides a class, 'dplp::AsyncScope', that
+// keeps track of asynchronous work whose promise would otherwise be dropped,
+// such as the 'then' chain of a server loop, so that the work can be waited
+// for, capped, and told to stop.
+//
+// Work is added to a scope with 'spawn', either as a promise or as a function
+// returning a promise (or 'void'), which the scope calls. Each child counts
+// in an atomic counter until its promise is resolved. 'join' returns a
+// 'dplp::Promise<>' that is fulfilled once the counter drops to zero, or
+// rejected with the error of the first child that was rejected or threw.
+//
+// The scope learns of a child's resolution with 'dplp::AnyPromiseHandle's
+// 'notify', which posts a function pointer and the scope's address to the
+// child's state; no promise is created per child. A child that is already
+// resolved when it is spawned is observed without allocating. Observing a
+// pending child costs only the state's entry for the continuations: an
+// element of its list, which holds the two pointers without allocating, or
+// for a 'dplp::Promise<>' a node from 'dplp::DefaultResource'.
+//
+// In a scope constructed with a limit, at most that many spawned functions
+// run at once. A function spawned when the limit is reached is kept in a
+// node, allocated from 'dplp::DefaultResource', linked into a FIFO queue.
+// When a child completes, the first queued function is called in its place.
+// Promises spawned directly are already running, so they count toward the
+// limit but are never queued.
+//
+///Stopping
+///--------
+// Promises have no cancellation operation, so stopping is cooperative.
+// 'requestStop' discards the queued functions without calling them, makes
+// later calls of 'spawn' with a function do nothing, and makes
+// 'isStopRequested' return 'true', which running children may poll to finish
+// early. 'join' is still needed to wait for the running children.
+//
+///Lifetime
+///--------
+// The behavior is undefined if a scope is destroyed while it has children,
+// since their continuations refer to it. Typically, the owner of a scope
+// calls 'requestStop' and waits for 'join' during shutdown.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Shut down a server cleanly
+///- - - - - - - - - - - - - - - - - - -
+// Suppose a server handles each connection with a chain of promises and
+// nothing holds on to those chains. At most 100 connections should be served
+// at a time, and shutdown should wait for the ones in progress.
+//..
+//  dplp::AsyncScope scope(100);
+//
+//  void onAccept(Connection connection)
+//  {
+//      scope.spawn([connection] {
+//          return readRequestP(connection).then(
+//              [connection](Request r) { return respondP(connection, r); });
+//      });
+//  }
+//
+//  dplp::Promise<> shutdown()
+//  {
+//      scope.requestStop();
+//      return scope.join();
+//  }
+//..
+
+#include <dplp_anypromise.h>
+#include <dplp_anypromisehandle.h>
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+
+#include <atomic>       // std::atomic
+#include <concepts>     // std::invocable
+#include <cstddef>      // std::size_t
+#include <exception>    // std::exception_ptr
+#include <functional>   // std::function, std::invoke
+#include <mutex>        // std::mutex
+#include <type_traits>  // std::decay_t, std::invoke_result_t
+#include <utility>      // std::forward, std::move
+#include <vector>
+
+namespace dplp {
+
+class AsyncScope;
+
+class AsyncScope_Task {
+    // This class is the base of the nodes of the queue of spawned functions
+    // waiting for a concurrency slot.
+
+  public:
+    AsyncScope_Task *d_next_p = nullptr;
+
+    virtual void start(dplp::AsyncScope *scope) = 0;
+        // Destroy this object and call its function as a child of the
+        // specified 'scope'.
+
+    virtual void discard() = 0;
+        // Destroy this object without calling its function.
+
+  protected:
+    ~AsyncScope_Task() = default;
+};
+
+template <typename F>
+class AsyncScope_TaskImp
+: public AsyncScope_Task
+, public dplp::DefaultResourceNode<AsyncScope_TaskImp<F> > {
+    // This class implements a queued function of type 'F', allocated from
+    // the default resource by 'create'.
+
+    F d_function;
+
+    friend class dplp::DefaultResourceNode<AsyncScope_TaskImp>;
+
+    template <typename G>
+    explicit AsyncScope_TaskImp(G&& function);
+
+  public:
+    void start(dplp::AsyncScope *scope) override;
+
+    void discard() override;
+};
+
+class AsyncScope {
+    // This class implements a scope owning spawned asynchronous work.
+
+  public:
+    static constexpr std::size_t k_UNLIMITED = static_cast<std::size_t>(-1);
+        // A concurrency limit meaning "no limit".
+
+  private:
+    struct Joiner {
+        std::function<void()>                   d_fulfill;
+        std::function<void(std::exception_ptr)> d_reject;
+    };
+
+    const std::size_t        d_maxConcurrency;
+    std::atomic<std::size_t> d_numChildren;    // running and queued
+    std::atomic<bool>        d_stopRequested;
+
+    std::mutex          d_mutex;        // protects the members below
+    std::size_t         d_numRunning;   // used only if limited
+    AsyncScope_Task    *d_queueHead_p;
+    AsyncScope_Task    *d_queueTail_p;
+    std::exception_ptr  d_error;        // of the first failed child
+    std::vector<Joiner> d_joiners;
+
+    template <typename F>
+    friend class AsyncScope_TaskImp;
+
+    template <typename F>
+    void invoke(F&& function);
+        // Call the specified 'function' as a child, which is already counted,
+        // and track the promise it returns.
+
+    template <typename P>
+    void track(const P& promise);
+        // Call 'complete' when the specified 'promise', which is a counted
+        // child, is resolved.
+
+    static void completeChild(void *scope, std::exception_ptr error);
+        // Call 'complete' with the specified 'error' on the specified
+        // 'scope'. This is the callback 'track' posts.
+
+    void complete(std::exception_ptr error);
+        // Uncount a child that completed, with the specified 'error' if it
+        // failed, start the next queued function in its place, and resolve
+        // the joiners if it was the last child.
+
+    bool acquireSlot();
+        // Return 'true' and count a running child if this scope is below its
+        // concurrency limit, and 'false' otherwise.
+
+    bool enqueue(dplp::AsyncScope_Task *task);
+        // Queue the specified 'task', a counted child, or discard it if a
+        // stop was requested, and return 'true'. Return 'false' without
+        // queuing it, and count it as running, if there is a free slot.
+
+    void uncount(std::size_t numChildren);
+        // Uncount the specified 'numChildren' children and resolve the
+        // joiners if none are left.
+
+  public:
+    explicit AsyncScope(std::size_t maxConcurrency = k_UNLIMITED);
+        // Create a scope in which at most the specified 'maxConcurrency'
+        // spawned functions run at once. The behavior is undefined unless
+        // '0 < maxConcurrency'.
+
+    AsyncScope(const AsyncScope&) = delete;
+    AsyncScope& operator=(const AsyncScope&) = delete;
+
+    ~AsyncScope();
+        // Destroy this object. The behavior is undefined unless it has no
+        // children.
+
+    template <typename P>
+    requires dplp::AnyPromise<P> void spawn(const P& promise);
+        // Track the specified 'promise' as a child of this scope until it is
+        // resolved.
+
+    template <typename F>
+    requires std::invocable<std::decay_t<F>&> && (!dplp::AnyPromise<F>)
+    void spawn(F&& function);
+        // Call the specified 'function', now or, if this scope is at its
+        // concurrency limit, when a child completes, and track the promise
+        // it returns as a child of this scope. 'function' must return a
+        // 'dplp::Promise' or 'void'. If it throws, the child fails with the
+        // exception. Do nothing if a stop was requested.
+
+    dplp::Promise<> join();
+        // Return a promise fulfilled when this scope has no children, or
+        // rejected with the error of the first child that failed.
+
+    void requestStop();
+        // Discard the queued functions and ignore functions spawned later.
+
+    bool isStopRequested() const;
+        // Return 'true' if 'requestStop' was called, and 'false' otherwise.
+
+    std::size_t numChildren() const;
+        // Return the number of running and queued children.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+template <typename F>
+template <typename G>
+AsyncScope_TaskImp<F>::AsyncScope_TaskImp(G&& function)
+: d_function(std::forward<G>(function))
+{
+}
+
+template <typename F>
+void AsyncScope_TaskImp<F>::start(dplp::AsyncScope *scope)
+{
+    scope->invoke(this->take(&AsyncScope_TaskImp::d_function));
+}
+
+template <typename F>
+void AsyncScope_TaskImp<F>::discard()
+{
+    this->destroy();
+}
+
+template <typename F>
+void AsyncScope::invoke(F&& function)
+{
+    using Result = std::invoke_result_t<std::decay_t<F>&>;
+    static_assert(std::is_void_v<Result> || dplp::AnyPromise<Result>,
+                  "A spawned function must return a promise or 'void'");
+
+    try {
+        if constexpr (std::is_void_v<Result>) {
+            std::invoke(function);
+            complete(nullptr);
+        }
+        else {
+            track(std::invoke(function));
+        }
+    }
+    catch (...) {
+        complete(std::current_exception());
+    }
+}
+
+template <typename P>
+void AsyncScope::track(const P& promise)
+{
+    dplp::AnyPromiseHandle(promise).notify(&completeChild, this);
+}
+
+template <typename P>
+requires dplp::AnyPromise<P> void AsyncScope::spawn(const P& promise)
+{
+    d_numChildren.fetch_add(1, std::memory_order_relaxed);
+    if (d_maxConcurrency != k_UNLIMITED) {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        ++d_numRunning;
+    }
+    try {
+        track(promise);
+    }
+    catch (...) {
+        complete(std::current_exception());
+    }
+}
+
+template <typename F>
+requires std::invocable<std::decay_t<F>&> && (!dplp::AnyPromise<F>)
+void AsyncScope::spawn(F&& function)
+{
+    if (isStopRequested())
+        return;
+
+    d_numChildren.fetch_add(1, std::memory_order_relaxed);
+    if (d_maxConcurrency == k_UNLIMITED || acquireSlot()) {
+        invoke(std::forward<F>(function));
+        return;
+    }
+
+    AsyncScope_Task *task;
+    try {
+        task = AsyncScope_TaskImp<std::decay_t<F> >::create(
+            std::forward<F>(function));
+    }
+    catch (...) {
+        uncount(1);
+        throw;
+    }
+    if (!enqueue(task))
+        task->start(this);
+}
+
+inline
+bool AsyncScope::isStopRequested() const
+{
+    return d_stopRequested.load(std::memory_order_acquire);
+}
+
+inline
+std::size_t AsyncScope::numChildren() const
+{
+    return d_numChildren.load(std::memory_order_acquire);
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,215 @@
+#include <dplp_asyncscope.h>
+
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+typedef dplp::TestUtil::Pending<> Pending;
+}
+
+TEST(dplp_asyncscope, join)
+{
+    dplp::AsyncScope scope;
+    EXPECT_TRUE(dplp::TestUtil::isResolved(scope.join())) << "empty scope";
+
+    Pending a;
+    Pending b;
+    scope.spawn(a.d_promise);
+    scope.spawn([&] { return b.d_promise; });
+    scope.spawn([] {});
+    EXPECT_EQ(scope.numChildren(), 2u);
+
+    const dplp::Promise<> joined = scope.join();
+    EXPECT_FALSE(dplp::TestUtil::isResolved(joined));
+    a.d_fulfill();
+    EXPECT_FALSE(dplp::TestUtil::isResolved(joined));
+    b.d_fulfill();
+    EXPECT_TRUE(dplp::TestUtil::isResolved(joined));
+    EXPECT_EQ(scope.numChildren(), 0u);
+}
+
+TEST(dplp_asyncscope, errors)
+{
+    dplp::AsyncScope scope;
+
+    Pending a;
+    scope.spawn(a.d_promise);
+    scope.spawn([]() -> dplp::Promise<int> {
+        throw std::runtime_error("first");
+    });
+    a.d_reject(std::make_exception_ptr(std::runtime_error("second")));
+    EXPECT_EQ(scope.numChildren(), 0u);
+
+    // The first error is reported, after every child completed.
+    std::string message;
+    scope.join().then([] {},
+                      [&](std::exception_ptr error) {
+                          try {
+                              std::rethrow_exception(error);
+                          }
+                          catch (const std::runtime_error& e) {
+                              message = e.what();
+                          }
+                      });
+    EXPECT_EQ(message, "first");
+}
+
+TEST(dplp_asyncscope, concurrency_limit)
+{
+    dplp::AsyncScope scope(2);
+
+    std::vector<Pending> pending(5);
+    int                  numStarted = 0;
+    for (Pending& p : pending) {
+        scope.spawn([&] {
+            ++numStarted;
+            return p.d_promise;
+        });
+    }
+    EXPECT_EQ(numStarted, 2);
+    EXPECT_EQ(scope.numChildren(), 5u);
+
+    // Each completion starts the next queued function, in order.
+    pending[1].d_fulfill();
+    EXPECT_EQ(numStarted, 3);
+    pending[0].d_fulfill();
+    EXPECT_EQ(numStarted, 4);
+    pending[2].d_fulfill();
+    pending[3].d_fulfill();
+    EXPECT_EQ(numStarted, 5);
+
+    const dplp::Promise<> joined = scope.join();
+    EXPECT_FALSE(dplp::TestUtil::isResolved(joined));
+    pending[4].d_fulfill();
+    EXPECT_TRUE(dplp::TestUtil::isResolved(joined));
+}
+
+TEST(dplp_asyncscope, long_queue)
+{
+    // Functions completing synchronously drain the queue without nesting a
+    // call per queued function.
+    dplp::AsyncScope scope(1);
+    Pending          first;
+    scope.spawn([&] { return first.d_promise; });
+
+    int numCalled = 0;
+    for (int i = 0; i < 100000; ++i)
+        scope.spawn([&] { ++numCalled; });
+    first.d_fulfill();
+    EXPECT_EQ(numCalled, 100000);
+    EXPECT_TRUE(dplp::TestUtil::isResolved(scope.join()));
+}
+
+TEST(dplp_asyncscope, stop)
+{
+    dplp::AsyncScope scope(1);
+    EXPECT_FALSE(scope.isStopRequested());
+
+    Pending running;
+    int     numStarted = 0;
+    scope.spawn([&] {
+        ++numStarted;
+        return running.d_promise;
+    });
+    scope.spawn([&] { ++numStarted; });
+    scope.spawn([&] { ++numStarted; });
+    EXPECT_EQ(scope.numChildren(), 3u);
+
+    scope.requestStop();
+    EXPECT_TRUE(scope.isStopRequested());
+    EXPECT_EQ(scope.numChildren(), 1u);
+
+    scope.spawn([&] { ++numStarted; });
+    EXPECT_EQ(scope.numChildren(), 1u);
+
+    const dplp::Promise<> joined = scope.join();
+    running.d_fulfill();
+    EXPECT_TRUE(dplp::TestUtil::isResolved(joined));
+    EXPECT_EQ(numStarted, 1);
+}
+
+TEST(dplp_asyncscope, child_allocations)
+{
+    // Tracking a child allocates one entry in its list of continuations, from
+    // the default resource, and no 'std::function' or other node of its own.
+    dplp::TestUtil::CountingResource resource;
+    dplp::DefaultResourceGuard       guard(&resource);
+
+    std::function<void(int)> fulfill;
+    const dplp::Promise<int> child(
+        [&](auto fulfillChild, auto) { fulfill = fulfillChild; });
+
+    dplp::AsyncScope scope;
+    const int        before = resource.numAllocations();
+    scope.spawn(child);
+    EXPECT_EQ(resource.numAllocations(), before + 1);
+    EXPECT_EQ(scope.numChildren(), 1u);
+
+    fulfill(1);
+    EXPECT_EQ(scope.numChildren(), 0u);
+}
+
+TEST(dplp_asyncscope, threads)
+{
+    const int        k_NUM_THREADS = 4;
+    const int        k_NUM_SPAWNS  = 1000;
+    dplp::AsyncScope scope(8);
+    std::atomic<int> numCalled(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < k_NUM_THREADS; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < k_NUM_SPAWNS; ++i) {
+                scope.spawn([&] {
+                    return dplp::Promise<>([&](auto fulfill, auto) {
+                        std::thread([&numCalled, fulfill] {
+                            ++numCalled;
+                            fulfill();
+                        }).detach();
+                    });
+                });
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::atomic<bool> joined(false);
+    scope.join().then([&] { joined = true; });
+    while (!joined)
+        std::this_thread::yield();
+    EXPECT_EQ(numCalled, k_NUM_THREADS * k_NUM_SPAWNS);
+    EXPECT_EQ(scope.numChildren(), 0u);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
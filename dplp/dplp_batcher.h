@@ -0,0 +1,320 @@
+#ifndef INCLUDED_DPLP_BATCHER
+#define INCLUDED_DPLP_BATCHER
+
+//@PURPOSE: Provide a loader that coalesces single-key lookups into batches.
+//
+//@CLASSES:
+//  dplp::Batcher: loader of values by key that batches its requests
+//
+//@SEE_ALSO: dplp_promise, dplp_rpc
+//
+//@DESCRIPTION: This component provides a class template,
+// 'dplp::Batcher<K, V>', that turns many independent single-key lookups,
+// e.g. ones issued by separate continuations in the same event loop tick,
+// into one call to a batch function, in the manner of a "data loader".
+//
+// 'load(key)' returns a 'dplp::Promise<V>' and adds 'key' to the pending
+// batch. When the batch is dispatched, the batch function is called with
+// its keys and returns a 'dplp::Promise<std::vector<V> >' whose values are
+// in the order of the keys. Each value is then used to fulfill the promises
+// returned by 'load' for its key. If the batch function throws, its promise
+// is rejected, or it returns the wrong number of values, the promises of
+// every key in the batch are rejected with that error.
+//
+// A key that is loaded again while it is in the pending batch is not added
+// twice; the second 'load' returns the same promise as the first. Keys are
+// compared with the optionally specified 'Hash' and 'Equal' types, which
+// default to 'std::hash<K>' and 'std::equal_to<K>'. Results are not cached
+// across batches.
+//
+///Batch Windows
+///-------------
+// The pending batch is dispatched at the first of:
+//: o 'dispatch' being called,
+//: o the batch reaching the maximum batch size given at construction, or
+//: o a task passed to the optional scheduler given at construction being
+//:   run.
+// When a key starts a new batch, the batcher passes a task that dispatches
+// that batch to the scheduler, which is any function that runs it later.
+// A scheduler that posts the task to the back of an event loop's queue
+// dispatches the keys requested within one tick; one that arms a timer
+// bounds the delay added to each key. A task whose batch was already
+// dispatched, or that runs after the batcher was destroyed, does nothing.
+//
+// The batch function is called without a lock held, on the thread that
+// dispatched the batch. A batcher may be used from several threads at once.
+// Destroying a batcher dispatches its pending batch.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Batch user lookups within an event loop tick
+///- - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Suppose a backend offers a call fetching many users at once, and an event
+// loop offers 'post' to run a function after the currently queued ones.
+//..
+//  dplp::Batcher<UserId, User> users(
+//      [&](const std::vector<UserId>& ids) { return fetchUsersP(ids); },
+//      100,
+//      [&](std::function<void()> task) { loop.post(std::move(task)); });
+//
+//  // Both lookups are made with one call to 'fetchUsersP'.
+//  users.load(order.buyer()).then([](const User& u) { /* ... */ });
+//  users.load(order.seller()).then([](const User& u) { /* ... */ });
+//..
+
+#include <dplp_promise.h>
+
+#include <cstddef>        // std::size_t
+#include <cstdint>        // std::uint64_t
+#include <exception>      // std::exception_ptr
+#include <functional>     // std::function, std::hash, std::equal_to
+#include <memory>         // std::shared_ptr, std::weak_ptr, std::unique_ptr
+#include <mutex>          // std::mutex, std::lock_guard, std::unique_lock
+#include <stdexcept>      // std::length_error
+#include <unordered_map>
+#include <utility>        // std::move
+#include <vector>
+
+namespace dplp {
+
+template <typename K,
+          typename V,
+          typename Hash  = std::hash<K>,
+          typename Equal = std::equal_to<K> >
+class Batcher {
+    // This class implements a loader of 'V' values by 'K' key that coalesces
+    // the keys requested within a window into one call to a batch function.
+
+  public:
+    typedef std::function<dplp::Promise<std::vector<V> >(
+        const std::vector<K>&)>
+        BatchFunction;
+        // The type of the function loading the values of a batch of keys.
+
+    typedef std::function<void(std::function<void()>)> Scheduler;
+        // The type of the function arranging for a task to be run later.
+
+    static constexpr std::size_t k_UNLIMITED = static_cast<std::size_t>(-1);
+        // A maximum batch size meaning "no maximum".
+
+  private:
+    struct Batch {
+        // This struct holds the keys of a batch and the functions resolving
+        // their promises, in the same order.
+
+        std::vector<K>                                        d_keys;
+        std::vector<std::function<void(const V&)> >           d_fulfills;
+        std::vector<std::function<void(std::exception_ptr)> > d_rejects;
+        std::vector<dplp::Promise<V> >                        d_promises;
+        std::unordered_map<K, std::size_t, Hash, Equal>       d_indices;
+    };
+
+    struct State {
+        // This struct holds the state shared with the tasks passed to the
+        // scheduler.
+
+        BatchFunction          d_batchFunction;
+        std::size_t            d_maxBatchSize;
+        Scheduler              d_scheduler;
+        std::mutex             d_mutex;  // protects the below
+        std::unique_ptr<Batch> d_batch_p;  // pending, or null
+        std::uint64_t          d_generation;  // number of batches started
+    };
+
+    std::shared_ptr<State> d_state_sp;
+
+    static std::unique_ptr<Batch> take(State         *state,
+                                       std::uint64_t  generation);
+        // Return the pending batch of the specified 'state' if it is the one
+        // started as the specified 'generation', and null otherwise.
+
+    static void dispatch(const BatchFunction&   batchFunction,
+                         std::unique_ptr<Batch> batch);
+        // Call the specified 'batchFunction' with the keys of the specified
+        // 'batch' and resolve the batch's promises with its result.
+
+  public:
+    explicit Batcher(BatchFunction batchFunction,
+                     std::size_t   maxBatchSize = k_UNLIMITED,
+                     Scheduler     scheduler    = Scheduler());
+        // Create a 'Batcher' object that loads values with the specified
+        // 'batchFunction', in batches of at most the optionally specified
+        // 'maxBatchSize' keys, and passes the task dispatching each new batch
+        // to the optionally specified 'scheduler'. The behavior is undefined
+        // unless '0 < maxBatchSize'.
+
+    Batcher(const Batcher&) = delete;
+    Batcher& operator=(const Batcher&) = delete;
+
+    ~Batcher();
+        // Dispatch the pending batch, if any, and destroy this object.
+
+    dplp::Promise<V> load(const K& key);
+        // Return a promise fulfilled with the value of the specified 'key'
+        // once the batch containing it is loaded, or rejected if that fails.
+        // Dispatch the batch if this makes it reach the maximum batch size.
+
+    void dispatch();
+        // Call the batch function with the pending batch, if any.
+
+    std::size_t numPending() const;
+        // Return the number of distinct keys in the pending batch.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+template <typename K, typename V, typename Hash, typename Equal>
+std::unique_ptr<typename Batcher<K, V, Hash, Equal>::Batch>
+Batcher<K, V, Hash, Equal>::take(State *state, std::uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(state->d_mutex);
+    if (state->d_generation != generation)
+        return nullptr;
+    return std::move(state->d_batch_p);
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+void Batcher<K, V, Hash, Equal>::dispatch(const BatchFunction&   batchFunction,
+                                          std::unique_ptr<Batch> batch)
+{
+    // The continuations own the resolvers; the keys and the promises, which
+    // only served to deduplicate the keys, are no longer needed after the
+    // call.
+    std::shared_ptr<Batch> resolvers(std::move(batch));
+
+    const auto call = [&]() -> dplp::Promise<std::vector<V> > {
+        try {
+            return batchFunction(resolvers->d_keys);
+        }
+        catch (...) {
+            return dplp::makeRejectedPromise<std::vector<V> >(
+                std::current_exception());
+        }
+    };
+    const dplp::Promise<std::vector<V> > values = call();
+    resolvers->d_promises.clear();
+    resolvers->d_indices.clear();
+
+    const auto rejectAll = [resolvers](std::exception_ptr error) {
+        for (const auto& reject : resolvers->d_rejects)
+            reject(error);
+    };
+    values.then(
+        [resolvers, rejectAll](const std::vector<V>& results) {
+            if (results.size() != resolvers->d_fulfills.size()) {
+                rejectAll(std::make_exception_ptr(std::length_error(
+                    "dplp::Batcher batch function returned the wrong number "
+                    "of values")));
+                return;
+            }
+            for (std::size_t i = 0; i < results.size(); ++i)
+                resolvers->d_fulfills[i](results[i]);
+        },
+        rejectAll);
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+Batcher<K, V, Hash, Equal>::Batcher(BatchFunction batchFunction,
+                                    std::size_t   maxBatchSize,
+                                    Scheduler     scheduler)
+: d_state_sp(std::make_shared<State>())
+{
+    d_state_sp->d_batchFunction = std::move(batchFunction);
+    d_state_sp->d_maxBatchSize  = maxBatchSize;
+    d_state_sp->d_scheduler     = std::move(scheduler);
+    d_state_sp->d_generation    = 0;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+Batcher<K, V, Hash, Equal>::~Batcher()
+{
+    dispatch();
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+dplp::Promise<V> Batcher<K, V, Hash, Equal>::load(const K& key)
+{
+    State *const                 state = d_state_sp.get();
+    std::unique_lock<std::mutex> lock(state->d_mutex);
+
+    std::uint64_t started = 0;
+    if (!state->d_batch_p) {
+        state->d_batch_p.reset(new Batch());
+        started = ++state->d_generation;
+    }
+
+    Batch&     batch = *state->d_batch_p;
+    const auto found = batch.d_indices.find(key);
+    if (found != batch.d_indices.end())
+        return batch.d_promises[found->second];
+
+    batch.d_indices.emplace(key, batch.d_keys.size());
+    batch.d_keys.push_back(key);
+    const dplp::Promise<V> result([&batch](auto fulfill, auto reject) {
+        batch.d_fulfills.push_back(fulfill);
+        batch.d_rejects.push_back(reject);
+    });
+    batch.d_promises.push_back(result);
+
+    std::unique_ptr<Batch> full;
+    if (batch.d_keys.size() >= state->d_maxBatchSize)
+        full = std::move(state->d_batch_p);
+    lock.unlock();
+
+    // A batch that is already full needs no task.
+    if (full) {
+        dispatch(state->d_batchFunction, std::move(full));
+    }
+    else if (started != 0 && state->d_scheduler) {
+        std::weak_ptr<State> weak(d_state_sp);
+        state->d_scheduler([weak, started] {
+            if (const std::shared_ptr<State> state = weak.lock()) {
+                if (std::unique_ptr<Batch> batch = take(state.get(), started))
+                    dispatch(state->d_batchFunction, std::move(batch));
+            }
+        });
+    }
+    return result;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+void Batcher<K, V, Hash, Equal>::dispatch()
+{
+    std::unique_ptr<Batch> batch;
+    {
+        std::lock_guard<std::mutex> lock(d_state_sp->d_mutex);
+        batch = std::move(d_state_sp->d_batch_p);
+    }
+    if (batch)
+        dispatch(d_state_sp->d_batchFunction, std::move(batch));
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+std::size_t Batcher<K, V, Hash, Equal>::numPending() const
+{
+    std::lock_guard<std::mutex> lock(d_state_sp->d_mutex);
+    return d_state_sp->d_batch_p ? d_state_sp->d_batch_p->d_keys.size() : 0;
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,222 @@
+#include <dplp_batcher.h>
+
+#include <dplp_anypromisehandle.h>
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+struct Backend {
+    // A batch function returning each key's length, recording its calls.
+
+    std::vector<std::vector<std::string> > d_calls;
+
+    dplp::Promise<std::vector<int> > operator()(
+                                         const std::vector<std::string>& keys)
+    {
+        d_calls.push_back(keys);
+        std::vector<int> values;
+        for (const std::string& key : keys)
+            values.push_back(static_cast<int>(key.size()));
+        return dplp::makeFulfilledPromise(values);
+    }
+};
+
+int valueOf(const dplp::Promise<int>& p)
+    // Return the value of the specified 'p', or -1 if it is not fulfilled.
+{
+    int result = -1;
+    if (dplp::AnyPromiseHandle(p).isResolved())
+        p.then([&](int value) { result = value; });
+    return result;
+}
+
+}
+
+TEST(dplp_batcher, dispatch)
+{
+    Backend                         backend;
+    dplp::Batcher<std::string, int> batcher(std::ref(backend));
+
+    const dplp::Promise<int> a  = batcher.load("a");
+    const dplp::Promise<int> bb = batcher.load("bb");
+    const dplp::Promise<int> a2 = batcher.load("a");
+    EXPECT_EQ(batcher.numPending(), 2u);
+    EXPECT_FALSE(dplp::AnyPromiseHandle(a).isResolved());
+
+    batcher.dispatch();
+    EXPECT_EQ(batcher.numPending(), 0u);
+    ASSERT_EQ(backend.d_calls.size(), 1u);
+    EXPECT_EQ(backend.d_calls[0], (std::vector<std::string>{"a", "bb"}));
+    EXPECT_EQ(valueOf(a), 1);
+    EXPECT_EQ(valueOf(bb), 2);
+    EXPECT_EQ(valueOf(a2), 1);
+
+    // Dispatching nothing does not call the batch function, and keys are
+    // loaded again in later batches.
+    batcher.dispatch();
+    EXPECT_EQ(backend.d_calls.size(), 1u);
+    EXPECT_EQ(valueOf(batcher.load("a")), -1);
+    batcher.dispatch();
+    EXPECT_EQ(backend.d_calls.size(), 2u);
+}
+
+TEST(dplp_batcher, max_batch_size)
+{
+    Backend                         backend;
+    dplp::Batcher<std::string, int> batcher(std::ref(backend), 2);
+
+    const dplp::Promise<int> a = batcher.load("a");
+    EXPECT_TRUE(backend.d_calls.empty());
+    EXPECT_EQ(valueOf(batcher.load("a")), -1) << "duplicates do not count";
+    const dplp::Promise<int> b = batcher.load("bbb");
+    ASSERT_EQ(backend.d_calls.size(), 1u);
+    EXPECT_EQ(valueOf(a), 1);
+    EXPECT_EQ(valueOf(b), 3);
+
+    batcher.load("c");
+    EXPECT_EQ(batcher.numPending(), 1u);
+}
+
+TEST(dplp_batcher, scheduler)
+{
+    // A scheduler posting to a queue that is drained at the end of a "tick".
+    Backend                            backend;
+    std::vector<std::function<void()>> tasks;
+    dplp::Batcher<std::string, int>    batcher(
+        std::ref(backend), 2, [&](std::function<void()> task) {
+            tasks.push_back(std::move(task));
+        });
+
+    const dplp::Promise<int> a = batcher.load("a");
+    const dplp::Promise<int> b = batcher.load("bb");  // dispatches
+    const dplp::Promise<int> c = batcher.load("ccc");
+    EXPECT_EQ(tasks.size(), 2u);
+    EXPECT_EQ(backend.d_calls.size(), 1u);
+
+    // The first task's batch was already dispatched.
+    for (const std::function<void()>& task : tasks)
+        task();
+    ASSERT_EQ(backend.d_calls.size(), 2u);
+    EXPECT_EQ(backend.d_calls[1], (std::vector<std::string>{"ccc"}));
+    EXPECT_EQ(valueOf(c), 3);
+
+    // A task outliving the batcher does nothing.
+    tasks.clear();
+    {
+        dplp::Batcher<std::string, int> scoped(
+            std::ref(backend), 10, [&](std::function<void()> task) {
+                tasks.push_back(std::move(task));
+            });
+        EXPECT_EQ(valueOf(scoped.load("dddd")), -1);
+    }
+    EXPECT_EQ(backend.d_calls.size(), 3u) << "destruction dispatches";
+    tasks.at(0)();
+    EXPECT_EQ(backend.d_calls.size(), 3u);
+}
+
+TEST(dplp_batcher, errors)
+{
+    dplp::Batcher<std::string, int> throwing(
+        [](const std::vector<std::string>&)
+            -> dplp::Promise<std::vector<int> > {
+            throw std::runtime_error("unavailable");
+        });
+    const dplp::Promise<int> a = throwing.load("a");
+    const dplp::Promise<int> b = throwing.load("b");
+    throwing.dispatch();
+    EXPECT_EQ(dplp::TestUtil::errorOf(a), "unavailable");
+    EXPECT_EQ(dplp::TestUtil::errorOf(b), "unavailable");
+
+    dplp::Batcher<std::string, int> rejecting(
+        [](const std::vector<std::string>&) {
+            return dplp::makeRejectedPromise<std::vector<int> >(
+                std::make_exception_ptr(std::runtime_error("rejected")));
+        });
+    const dplp::Promise<int> c = rejecting.load("c");
+    rejecting.dispatch();
+    EXPECT_EQ(dplp::TestUtil::errorOf(c), "rejected");
+
+    dplp::Batcher<std::string, int> shortResult(
+        [](const std::vector<std::string>&) {
+            return dplp::makeFulfilledPromise(std::vector<int>{1});
+        });
+    const dplp::Promise<int> d = shortResult.load("d");
+    const dplp::Promise<int> e = shortResult.load("e");
+    shortResult.dispatch();
+    EXPECT_FALSE(dplp::TestUtil::errorOf(d).empty());
+    EXPECT_FALSE(dplp::TestUtil::errorOf(e).empty());
+}
+
+TEST(dplp_batcher, delay)
+{
+    // A scheduler arming a timer bounds the time a key waits, and the batch
+    // function may resolve its promise on another thread.
+    std::atomic<int>        numCalls(0);
+    dplp::Batcher<int, int> batcher(
+        [&](const std::vector<int>& keys) {
+            ++numCalls;
+            return dplp::Promise<std::vector<int> >(
+                [keys](auto fulfill, auto) {
+                    std::thread([keys, fulfill] {
+                        std::vector<int> values;
+                        for (int key : keys)
+                            values.push_back(key * 2);
+                        fulfill(values);
+                    }).detach();
+                });
+        },
+        dplp::Batcher<int, int>::k_UNLIMITED,
+        [](std::function<void()> task) {
+            std::thread([task] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                task();
+            }).detach();
+        });
+
+    const int        k_NUM_KEYS = 100;
+    std::atomic<int> sum(0);
+    std::atomic<int> numDone(0);
+    for (int i = 0; i < k_NUM_KEYS; ++i) {
+        batcher.load(i).then([&](int value) {
+            sum += value;
+            ++numDone;
+        });
+    }
+    while (numDone != k_NUM_KEYS)
+        std::this_thread::yield();
+    EXPECT_EQ(sum, k_NUM_KEYS * (k_NUM_KEYS - 1));
+    EXPECT_GE(numCalls, 1);
+    EXPECT_LT(numCalls, k_NUM_KEYS);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,296 @@
+#include <dplp_circuitbreaker.h>
+
+namespace dplp {
+namespace {
+
+// The fields of a bucket of the sliding window.
+const int           k_ROUND_SHIFT    = 48;
+const int           k_CALLS_SHIFT    = 32;
+const int           k_FAILURES_SHIFT = 16;
+const int           k_SLOW_SHIFT     = 0;
+const std::uint64_t k_ROUND_MASK =
+    (std::uint64_t(1) << CircuitBreaker_Bucket::k_ROUND_BITS) - 1;
+const std::uint64_t k_COUNTS_MASK = (std::uint64_t(1) << k_ROUND_SHIFT) - 1;
+const std::uint64_t k_HALF_MASK   = 0x7FFF7FFF7FFF;  // counts shifted right
+
+// After a sweep, the rounds of the buckets are at most one behind the swept
+// one, so they can't be mistaken for the current one for the next
+// '2^k_ROUND_BITS - 2' rounds. The window is swept halfway through those.
+const std::uint64_t k_SWEEP_ROUNDS     = k_ROUND_MASK / 2 + 1;
+const std::uint64_t k_MAX_SWEEP_ROUNDS = k_ROUND_MASK - 1;
+
+std::uint64_t field(std::uint64_t bucket, int shift)
+{
+    return (bucket >> shift) & CircuitBreaker_Bucket::k_MAX_COUNT;
+}
+}
+
+                        // ---------------------------
+                        // class CircuitBreaker_Bucket
+                        // ---------------------------
+
+std::uint64_t CircuitBreaker_Bucket::make(std::uint64_t round)
+{
+    return (round & k_ROUND_MASK) << k_ROUND_SHIFT;
+}
+
+std::uint64_t CircuitBreaker_Bucket::round(std::uint64_t slice,
+                                           std::size_t   index,
+                                           std::size_t   numBuckets)
+{
+    // The bucket counted the current round's slice if it is not ahead of the
+    // current one, and the previous round's otherwise.
+    const std::uint64_t current = slice / numBuckets;
+    return (index <= slice % numBuckets ? current : current - 1) &
+           k_ROUND_MASK;
+}
+
+std::uint64_t CircuitBreaker_Bucket::roundOf(std::uint64_t bucket)
+{
+    return bucket >> k_ROUND_SHIFT;
+}
+
+std::uint64_t CircuitBreaker_Bucket::numCalls(std::uint64_t bucket)
+{
+    return field(bucket, k_CALLS_SHIFT);
+}
+
+std::uint64_t CircuitBreaker_Bucket::numFailures(std::uint64_t bucket)
+{
+    return field(bucket, k_FAILURES_SHIFT);
+}
+
+std::uint64_t CircuitBreaker_Bucket::numSlow(std::uint64_t bucket)
+{
+    return field(bucket, k_SLOW_SHIFT);
+}
+
+std::uint64_t CircuitBreaker_Bucket::increment(bool failed, bool slow)
+{
+    return (std::uint64_t(1) << k_CALLS_SHIFT) |
+           (std::uint64_t(failed) << k_FAILURES_SHIFT) |
+           (std::uint64_t(slow) << k_SLOW_SHIFT);
+}
+
+std::uint64_t CircuitBreaker_Bucket::halve(std::uint64_t bucket)
+{
+    const std::uint64_t counts = bucket & k_COUNTS_MASK;
+    return (bucket - counts) | ((counts >> 1) & k_HALF_MASK);
+}
+
+                           // --------------------
+                           // class CircuitBreaker
+                           // --------------------
+
+CircuitBreaker::CircuitBreaker()
+: CircuitBreaker(Options())
+{
+}
+
+CircuitBreaker::CircuitBreaker(const Options& options)
+: d_options(options)
+, d_bucketNs(options.d_window.count() /
+             static_cast<std::int64_t>(options.d_numBuckets))
+, d_openError(std::make_exception_ptr(
+      dplp::CircuitBreakerError("dplp::CircuitBreaker open")))
+, d_overloadError(std::make_exception_ptr(
+      dplp::CircuitBreakerError("dplp::CircuitBreaker overloaded")))
+, d_buckets(new std::atomic<std::uint64_t>[options.d_numBuckets])
+, d_sweptAt(0)
+, d_state(e_CLOSED)
+, d_openedAt(0)
+, d_numProbes(0)
+, d_numInFlight(0)
+{
+    clearWindow(now());
+}
+
+CircuitBreaker::Admission CircuitBreaker::admit()
+{
+    State state = d_state.load(std::memory_order_acquire);
+    if (state == e_OPEN) {
+        if (now() - d_openedAt.load(std::memory_order_relaxed) <
+            d_options.d_openDuration.count())
+            return e_SHED_OPEN;
+
+        // Only one caller moves the breaker to half-open, but every caller
+        // then competes for the probes.
+        if (d_state.compare_exchange_strong(state, e_HALF_OPEN))
+            state = e_HALF_OPEN;
+    }
+
+    if (d_numInFlight.fetch_add(1, std::memory_order_relaxed) >=
+        d_options.d_maxInFlight) {
+        d_numInFlight.fetch_sub(1, std::memory_order_relaxed);
+        return e_SHED_OVERLOAD;
+    }
+
+    if (state == e_HALF_OPEN) {
+        if (d_numProbes.fetch_add(1, std::memory_order_relaxed) >=
+            d_options.d_maxProbes) {
+            d_numInFlight.fetch_sub(1, std::memory_order_relaxed);
+            return e_SHED_OPEN;
+        }
+        return e_PROBE;
+    }
+    return e_ADMIT;
+}
+
+void CircuitBreaker::complete(bool probe, bool failed, std::int64_t startedAt)
+{
+    d_numInFlight.fetch_sub(1, std::memory_order_relaxed);
+    const std::int64_t current = now();
+
+    if (probe) {
+        if (failed) {
+            open(current);
+        }
+        else {
+            clearWindow(current);
+            State expected = e_HALF_OPEN;
+            d_state.compare_exchange_strong(expected, e_CLOSED);
+        }
+        return;
+    }
+
+    // The outcomes of calls admitted before the breaker opened are stale.
+    if (d_state.load(std::memory_order_relaxed) != e_CLOSED)
+        return;
+
+    const bool slow =
+        current - startedAt >= d_options.d_slowCallDuration.count();
+    record(current, failed, slow);
+    if ((failed || slow) && shouldOpen(current))
+        open(current);
+}
+
+void CircuitBreaker::record(std::int64_t current, bool failed, bool slow)
+{
+    typedef dplp::CircuitBreaker_Bucket Bucket;
+
+    const std::uint64_t slice = static_cast<std::uint64_t>(current /
+                                                           d_bucketNs);
+    const std::size_t   index = slice % d_options.d_numBuckets;
+    const std::uint64_t round =
+        Bucket::round(slice, index, d_options.d_numBuckets);
+    std::atomic<std::uint64_t>& bucket = d_buckets[index];
+
+    // Only the thread that moves 'd_sweptAt' forward sweeps. A thread whose
+    // slice is behind it, having read the clock earlier, does not.
+    std::uint64_t sweptAt = d_sweptAt.load(std::memory_order_relaxed);
+    if (slice > sweptAt &&
+        slice / d_options.d_numBuckets - sweptAt / d_options.d_numBuckets >=
+            k_SWEEP_ROUNDS &&
+        d_sweptAt.compare_exchange_strong(
+            sweptAt, slice, std::memory_order_relaxed)) {
+        sweep(current, sweptAt);
+    }
+
+    std::uint64_t old = bucket.load(std::memory_order_relaxed);
+    std::uint64_t next;
+    do {
+        // A bucket left from an earlier round is reset by the same swap.
+        std::uint64_t base =
+            Bucket::roundOf(old) == round ? old : Bucket::make(round);
+        if (Bucket::numCalls(base) == Bucket::k_MAX_COUNT)
+            base = Bucket::halve(base);
+        next = base + Bucket::increment(failed, slow);
+    } while (!bucket.compare_exchange_weak(
+        old, next, std::memory_order_relaxed));
+}
+
+void CircuitBreaker::sweep(std::int64_t current, std::uint64_t sweptAt)
+{
+    typedef dplp::CircuitBreaker_Bucket Bucket;
+
+    const std::uint64_t slice = static_cast<std::uint64_t>(current /
+                                                           d_bucketNs);
+    if (slice / d_options.d_numBuckets - sweptAt / d_options.d_numBuckets >
+        k_MAX_SWEEP_ROUNDS) {
+        // A bucket last written over 2^k_ROUND_BITS - 2 rounds ago may look
+        // current, so none can be trusted. This loses the calls, if any,
+        // recorded since the window went idle.
+        clearWindow(current);
+        return;
+    }
+
+    for (std::size_t i = 0; i < d_options.d_numBuckets; ++i) {
+        const std::uint64_t round =
+            Bucket::round(slice, i, d_options.d_numBuckets);
+        std::uint64_t bucket = d_buckets[i].load(std::memory_order_relaxed);
+
+        // A bucket a concurrent call makes current is left alone.
+        while (Bucket::roundOf(bucket) != round &&
+               !d_buckets[i].compare_exchange_weak(
+                   bucket, Bucket::make(round - 1),
+                   std::memory_order_relaxed)) {
+        }
+    }
+}
+
+bool CircuitBreaker::shouldOpen(std::int64_t current) const
+{
+    typedef dplp::CircuitBreaker_Bucket Bucket;
+
+    const std::uint64_t slice = static_cast<std::uint64_t>(current /
+                                                           d_bucketNs);
+
+    std::uint64_t numCalls    = 0;
+    std::uint64_t numFailures = 0;
+    std::uint64_t numSlow     = 0;
+    for (std::size_t i = 0; i < d_options.d_numBuckets; ++i) {
+        const std::uint64_t bucket =
+            d_buckets[i].load(std::memory_order_relaxed);
+        if (Bucket::roundOf(bucket) ==
+            Bucket::round(slice, i, d_options.d_numBuckets)) {
+            numCalls += Bucket::numCalls(bucket);
+            numFailures += Bucket::numFailures(bucket);
+            numSlow += Bucket::numSlow(bucket);
+        }
+    }
+
+    return numCalls != 0 && numCalls >= d_options.d_minCalls &&
+           (numFailures >= d_options.d_failureRate * numCalls ||
+            numSlow >= d_options.d_slowCallRate * numCalls);
+}
+
+void CircuitBreaker::open(std::int64_t current)
+{
+    // The time and probe count are set before the state is published.
+    d_openedAt.store(current, std::memory_order_relaxed);
+    d_numProbes.store(0, std::memory_order_relaxed);
+    d_state.store(e_OPEN, std::memory_order_release);
+}
+
+void CircuitBreaker::clearWindow(std::int64_t current)
+{
+    typedef dplp::CircuitBreaker_Bucket Bucket;
+
+    // A bucket is stale when its round is not the one it would count now,
+    // and stays so as the rounds advance.
+    const std::uint64_t slice = static_cast<std::uint64_t>(current /
+                                                           d_bucketNs);
+    for (std::size_t i = 0; i < d_options.d_numBuckets; ++i) {
+        d_buckets[i].store(
+            Bucket::make(Bucket::round(slice, i, d_options.d_numBuckets) - 1),
+            std::memory_order_relaxed);
+    }
+    d_sweptAt.store(slice, std::memory_order_relaxed);
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
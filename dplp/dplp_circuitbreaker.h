@@ -0,0 +1,347 @@
+#ifndef INCLUDED_DPLP_CIRCUITBREAKER
+#define INCLUDED_DPLP_CIRCUITBREAKER
+
+//@PURPOSE: Provide a circuit breaker that sheds calls to a failing backend.
+//
+//@CLASSES:
+//  dplp::CircuitBreaker: wrapper failing calls fast while a backend is down
+//  dplp::CircuitBreakerError: exception for a call that was shed
+//  dplp::CircuitBreaker_Bucket: functions on a bucket of the sliding window
+//
+//@SEE_ALSO: dplp_promise, dplp_anypromisehandle, dplp_ratelimiter
+//
+//@DESCRIPTION: This component provides a class, 'dplp::CircuitBreaker', that
+// wraps calls to functions returning promises, e.g. calls to a backend, and
+// stops making them while they mostly fail or are slow, so that requests do
+// not pile up promise chains waiting for timeouts.
+//
+// 'call(f)' returns the promise returned by 'f()' if the call is admitted.
+// Otherwise it returns a promise of the same type rejected with a
+// 'dplp::CircuitBreakerError', without calling 'f'. A shed call takes no
+// lock and allocates nothing: it reads a few atomic words and returns a
+// promise holding a rejection created when the breaker was.
+//
+///States
+///------
+// A breaker is in one of three states:
+//
+//: o Closed: calls are admitted. The outcome and latency of each completed
+//:   call are recorded in a sliding window. When the window holds at least a
+//:   minimum number of calls and the rate of rejected calls, or the rate of
+//:   calls slower than a threshold, reaches its limit, the breaker opens.
+//:
+//: o Open: calls are shed. After a configured duration, the next call moves
+//:   the breaker to half-open.
+//:
+//: o Half-open: up to a configured number of calls are admitted as probes,
+//:   and the others are shed. The first probe to be fulfilled closes the
+//:   breaker, with an empty window, and a rejected one opens it again.
+//
+// Independently of the state, calls are shed as overload when a configured
+// number of admitted calls are still in progress.
+//
+///Sliding Window
+///--------------
+// The window is a ring of buckets, each counting the calls, rejected calls,
+// and slow calls completed during an equal slice of the window's duration.
+// Each bucket is one 64-bit atomic word, 'dplp::CircuitBreaker_Bucket',
+// holding the three 16-bit counts and the low 16 bits of the round of its
+// slice, i.e. of the number of whole windows before it, so recording a call,
+// including reusing a bucket whose slice has passed, is a single
+// compare-and-swap. A bucket that has counted 65535 calls halves its three
+// counts and goes on counting, so the rates still reflect the whole slice.
+//
+// A bucket left stale for a multiple of 2^16 windows would look current
+// again. To rule that out, the first call recorded after 2^15 windows without
+// a sweep sweeps the window, marking its stale buckets as stale for another
+// 2^16 windows, and the first one recorded after nearly 2^16 windows empties
+// the window instead, since its stale buckets can then no longer be told
+// from current ones.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Protect a backend
+///- - - - - - - - - - - - - - -
+// Suppose calls to a pricing service should stop for ten seconds whenever
+// half of them fail or take more than 200ms, and at most 500 may be in
+// progress.
+//..
+//  dplp::CircuitBreaker::Options options;
+//  options.d_slowCallDuration = std::chrono::milliseconds(200);
+//  options.d_slowCallRate     = 0.5;
+//  options.d_openDuration     = std::chrono::seconds(10);
+//  options.d_maxInFlight      = 500;
+//  dplp::CircuitBreaker breaker(options);
+//
+//  dplp::Promise<Price> priceP(const Item& item)
+//  {
+//      return breaker.call([&] { return fetchPriceP(item); });
+//  }
+//..
+
+#include <dplp_anypromisehandle.h>
+#include <dplp_promise.h>
+
+#include <atomic>       // std::atomic
+#include <chrono>       // std::chrono::steady_clock
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::int64_t, std::uint64_t
+#include <exception>    // std::exception_ptr
+#include <functional>   // std::invoke
+#include <memory>       // std::unique_ptr
+#include <stdexcept>    // std::runtime_error
+#include <type_traits>  // std::invoke_result_t
+
+namespace dplp {
+
+struct CircuitBreaker_Bucket {
+    // This struct provides functions on a bucket of the sliding window of a
+    // 'CircuitBreaker', a 64-bit word holding the counts of the calls, the
+    // rejected calls, and the slow calls completed during a slice of time,
+    // and the round of that slice. The slice of index 's' in a ring of 'n'
+    // buckets is counted in the bucket of index 's % n', and its round is
+    // 's / n' truncated to 'k_ROUND_BITS' bits.
+
+    static constexpr int           k_ROUND_BITS = 16;
+    static constexpr std::uint64_t k_MAX_COUNT  = 0xFFFF;
+
+    static std::uint64_t make(std::uint64_t round);
+        // Return a bucket of the specified 'round' counting no calls.
+
+    static std::uint64_t round(std::uint64_t slice,
+                               std::size_t   index,
+                               std::size_t   numBuckets);
+        // Return the round of the latest slice, no later than the slice of
+        // the specified 'slice' index, that is counted by the bucket of the
+        // specified 'index' in a ring of the specified 'numBuckets'. The
+        // behavior is undefined unless 'index < numBuckets'.
+
+    static std::uint64_t roundOf(std::uint64_t bucket);
+    static std::uint64_t numCalls(std::uint64_t bucket);
+    static std::uint64_t numFailures(std::uint64_t bucket);
+    static std::uint64_t numSlow(std::uint64_t bucket);
+        // Return the round of the specified 'bucket', or the number of calls,
+        // rejected calls, or slow calls it counts.
+
+    static std::uint64_t increment(bool failed, bool slow);
+        // Return the value to add to a bucket to count a call, rejected if
+        // the specified 'failed' is 'true' and slow if the specified 'slow'
+        // is 'true'.
+
+    static std::uint64_t halve(std::uint64_t bucket);
+        // Return the specified 'bucket' with each of its counts halved,
+        // rounding down.
+};
+
+class CircuitBreakerError : public std::runtime_error {
+    // This class is the exception with which a call that was shed, because
+    // the breaker was open or overloaded, is rejected.
+
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+class CircuitBreaker {
+    // This class implements a circuit breaker that admits or sheds calls
+    // returning promises based on the outcomes of recent calls.
+
+  public:
+    static constexpr std::size_t k_UNLIMITED = static_cast<std::size_t>(-1);
+        // A maximum number of calls in progress meaning "no maximum".
+
+    struct Options {
+        // This struct holds the configuration of a circuit breaker.
+
+        std::chrono::nanoseconds d_window = std::chrono::seconds(10);
+        std::size_t              d_numBuckets = 10;
+        std::size_t              d_minCalls   = 20;
+            // the duration of the sliding window, the number of buckets it is
+            // divided into, and the number of calls it must hold before the
+            // breaker may open
+
+        double d_failureRate = 0.5;
+            // the rate of rejected calls at which the breaker opens
+
+        std::chrono::nanoseconds d_slowCallDuration = std::chrono::seconds(1);
+        double                   d_slowCallRate     = 1.01;
+            // the latency from which a call is slow, and the rate of slow
+            // calls at which the breaker opens, which by default it never does
+
+        std::chrono::nanoseconds d_openDuration = std::chrono::seconds(5);
+        std::size_t              d_maxProbes    = 1;
+            // how long the breaker stays open, and the number of calls it
+            // admits while half-open
+
+        std::size_t d_maxInFlight = k_UNLIMITED;
+            // the number of admitted calls in progress from which calls are
+            // shed as overload
+    };
+
+    enum State { e_CLOSED, e_OPEN, e_HALF_OPEN };
+
+  private:
+    enum Admission { e_SHED_OPEN, e_SHED_OVERLOAD, e_ADMIT, e_PROBE };
+
+    const Options                                 d_options;
+    const std::int64_t                            d_bucketNs;
+    const std::exception_ptr                      d_openError;
+    const std::exception_ptr                      d_overloadError;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> d_buckets;
+
+    std::atomic<std::uint64_t> d_sweptAt;  // slice of the last sweep
+
+    std::atomic<State>        d_state;
+    std::atomic<std::int64_t> d_openedAt;  // nanoseconds of the steady clock
+    std::atomic<std::size_t>  d_numProbes;  // admitted since half-open
+    std::atomic<std::size_t>  d_numInFlight;
+
+    static std::int64_t now();
+        // Return the current time of the steady clock in nanoseconds.
+
+    Admission admit();
+        // Return whether to shed the next call, and why, or to admit it, as a
+        // probe if this breaker is half-open. Count an admitted call as in
+        // progress.
+
+    void complete(bool probe, bool failed, std::int64_t startedAt);
+        // Record the completion of an admitted call, which was a probe if
+        // the specified 'probe' is 'true', was rejected if the specified
+        // 'failed' is 'true', and was started at the specified 'startedAt',
+        // and change the state of this breaker accordingly.
+
+    void record(std::int64_t current, bool failed, bool slow);
+        // Count a call completed at the specified 'current' time, which is
+        // rejected if the specified 'failed' is 'true' and slow if the
+        // specified 'slow' is 'true', in the sliding window.
+
+    void sweep(std::int64_t current, std::uint64_t sweptAt);
+        // Mark the buckets that are stale as of the specified 'current' time
+        // as stale for another '2^k_ROUND_BITS - 1' rounds or, if too many
+        // rounds have passed since the slice of the specified 'sweptAt' index
+        // for their rounds to be told apart, empty the sliding window.
+
+    bool shouldOpen(std::int64_t current) const;
+        // Return 'true' if the sliding window as of the specified 'current'
+        // time calls for opening this breaker, and 'false' otherwise.
+
+    void open(std::int64_t current);
+        // Open this breaker as of the specified 'current' time.
+
+    void clearWindow(std::int64_t current);
+        // Empty the sliding window as of the specified 'current' time.
+
+    template <typename... Types>
+    static dplp::Promise<Types...> rejected(const dplp::Promise<Types...> *,
+                                            const std::exception_ptr& error);
+        // Return a promise of the type pointed to by the unused first argument
+        // rejected with the specified 'error'.
+
+  public:
+    CircuitBreaker();
+    explicit CircuitBreaker(const Options& options);
+        // Create a closed 'CircuitBreaker' object with the optionally
+        // specified 'options'. The behavior is undefined unless
+        // '0 < options.d_numBuckets' and 'options.d_window' is at least
+        // 'options.d_numBuckets' nanoseconds.
+
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    template <typename F>
+    std::invoke_result_t<F&> call(F&& function);
+        // Return the promise returned by the specified 'function' if the call
+        // is admitted, and a promise rejected with a
+        // 'dplp::CircuitBreakerError' otherwise. If 'function' throws, return
+        // a promise rejected with the exception. 'function' must return a
+        // 'dplp::Promise'. The behavior is undefined if this object is
+        // destroyed before the promises of the admitted calls are resolved.
+
+    State state() const;
+        // Return the state of this breaker. Note that an open breaker whose
+        // open duration has passed is reported as open until the next call.
+
+    std::size_t numInFlight() const;
+        // Return the number of admitted calls in progress.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+std::int64_t CircuitBreaker::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+template <typename... Types>
+dplp::Promise<Types...> CircuitBreaker::rejected(
+                                         const dplp::Promise<Types...> *,
+                                         const std::exception_ptr&      error)
+{
+    return dplp::makeRejectedPromise<Types...>(error);
+}
+
+template <typename F>
+std::invoke_result_t<F&> CircuitBreaker::call(F&& function)
+{
+    using Result = std::invoke_result_t<F&>;
+    const Result *const tag = nullptr;
+
+    const Admission admission = admit();
+    if (admission == e_SHED_OPEN)
+        return rejected(tag, d_openError);
+    if (admission == e_SHED_OVERLOAD)
+        return rejected(tag, d_overloadError);
+
+    const bool         probe     = admission == e_PROBE;
+    const std::int64_t startedAt = now();
+    try {
+        Result result = std::invoke(function);
+        dplp::AnyPromiseHandle(result).then(
+            [this, probe, startedAt] { complete(probe, false, startedAt); },
+            [this, probe, startedAt](std::exception_ptr) {
+                complete(probe, true, startedAt);
+            });
+        return result;
+    }
+    catch (...) {
+        complete(probe, true, startedAt);
+        return rejected(tag, std::current_exception());
+    }
+}
+
+inline
+CircuitBreaker::State CircuitBreaker::state() const
+{
+    return d_state.load(std::memory_order_acquire);
+}
+
+inline
+std::size_t CircuitBreaker::numInFlight() const
+{
+    return d_numInFlight.load(std::memory_order_relaxed);
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
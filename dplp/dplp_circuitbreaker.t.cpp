@@ -0,0 +1,289 @@
+#include <dplp_circuitbreaker.h>
+
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+typedef dplp::TestUtil::Pending<int> Pending;
+
+dplp::Promise<int> succeed()
+{
+    return dplp::makeFulfilledPromise(1);
+}
+
+dplp::Promise<int> fail()
+{
+    return dplp::makeRejectedPromise<int>(
+        std::make_exception_ptr(std::runtime_error("backend failed")));
+}
+
+dplp::CircuitBreaker::Options testOptions()
+{
+    dplp::CircuitBreaker::Options options;
+    options.d_minCalls     = 4;
+    options.d_openDuration = std::chrono::milliseconds(1);
+    return options;
+}
+}
+
+TEST(dplp_circuitbreaker, open)
+{
+    dplp::CircuitBreaker::Options options = testOptions();
+    options.d_openDuration                = std::chrono::seconds(60);
+    dplp::CircuitBreaker breaker(options);
+
+    // Failures below the minimum number of calls do not open it.
+    EXPECT_EQ(dplp::TestUtil::errorOf(breaker.call(fail)), "backend failed");
+    EXPECT_EQ(dplp::TestUtil::errorOf(breaker.call(fail)), "backend failed");
+    EXPECT_EQ(dplp::TestUtil::errorOf(breaker.call(succeed)), "");
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_CLOSED);
+    EXPECT_EQ(dplp::TestUtil::errorOf(breaker.call(succeed)), "");
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_CLOSED);
+
+    // Three failures out of five reach the rate.
+    breaker.call(fail);
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_OPEN);
+
+    int numCalled = 0;
+    const dplp::Promise<int> shed = breaker.call([&] {
+        ++numCalled;
+        return succeed();
+    });
+    EXPECT_EQ(dplp::TestUtil::errorOf(shed), "dplp::CircuitBreaker open");
+    EXPECT_EQ(numCalled, 0);
+}
+
+TEST(dplp_circuitbreaker, shed_without_allocating)
+{
+    dplp::CircuitBreaker::Options options = testOptions();
+    options.d_openDuration                = std::chrono::seconds(60);
+    dplp::CircuitBreaker breaker(options);
+    for (int i = 0; i < 4; ++i)
+        breaker.call(fail);
+    ASSERT_EQ(breaker.state(), dplp::CircuitBreaker::e_OPEN);
+
+    dplp::TestUtil::CountingResource resource;
+    dplp::DefaultResourceGuard       guard(&resource);
+    for (int i = 0; i < 100; ++i)
+        breaker.call(succeed);
+    EXPECT_EQ(resource.numAllocations(), 0);
+}
+
+TEST(dplp_circuitbreaker, half_open)
+{
+    dplp::CircuitBreaker breaker(testOptions());
+    for (int i = 0; i < 4; ++i)
+        breaker.call(fail);
+    ASSERT_EQ(breaker.state(), dplp::CircuitBreaker::e_OPEN);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+    // One probe is admitted; other calls are shed while it is in progress.
+    Pending                  probe;
+    const dplp::Promise<int> result =
+        breaker.call([&] { return probe.d_promise; });
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_HALF_OPEN);
+    EXPECT_EQ(dplp::TestUtil::errorOf(breaker.call(succeed)),
+              "dplp::CircuitBreaker open");
+
+    // A failed probe opens the breaker again.
+    probe.d_reject(std::make_exception_ptr(std::runtime_error("down")));
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_OPEN);
+    EXPECT_EQ(dplp::TestUtil::errorOf(result), "down");
+
+    // A successful probe closes it with an empty window.
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_EQ(dplp::TestUtil::errorOf(breaker.call(succeed)), "");
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_CLOSED);
+    for (int i = 0; i < 3; ++i)
+        breaker.call(fail);
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_CLOSED);
+}
+
+TEST(dplp_circuitbreaker, overload)
+{
+    dplp::CircuitBreaker::Options options;
+    options.d_maxInFlight = 2;
+    dplp::CircuitBreaker breaker(options);
+
+    Pending a;
+    Pending b;
+    breaker.call([&] { return a.d_promise; });
+    breaker.call([&] { return b.d_promise; });
+    EXPECT_EQ(breaker.numInFlight(), 2u);
+    EXPECT_EQ(dplp::TestUtil::errorOf(breaker.call(succeed)),
+              "dplp::CircuitBreaker overloaded");
+
+    a.d_fulfill(1);
+    EXPECT_EQ(breaker.numInFlight(), 1u);
+    EXPECT_EQ(dplp::TestUtil::errorOf(breaker.call(succeed)), "");
+    b.d_fulfill(2);
+    EXPECT_EQ(breaker.numInFlight(), 0u);
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_CLOSED);
+}
+
+TEST(dplp_circuitbreaker, slow_calls)
+{
+    dplp::CircuitBreaker::Options options = testOptions();
+    options.d_minCalls                    = 2;
+    options.d_slowCallDuration            = std::chrono::milliseconds(1);
+    options.d_slowCallRate                = 0.5;
+    dplp::CircuitBreaker breaker(options);
+
+    for (int i = 0; i < 2; ++i) {
+        Pending pending;
+        breaker.call([&] { return pending.d_promise; });
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        pending.d_fulfill(i);
+    }
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_OPEN);
+}
+
+TEST(dplp_circuitbreaker, throwing_function)
+{
+    dplp::CircuitBreaker breaker(testOptions());
+    for (int i = 0; i < 4; ++i) {
+        const dplp::Promise<int> result =
+            breaker.call([]() -> dplp::Promise<int> {
+                throw std::runtime_error("thrown");
+            });
+        EXPECT_EQ(dplp::TestUtil::errorOf(result), "thrown");
+    }
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_OPEN);
+    EXPECT_EQ(breaker.numInFlight(), 0u);
+}
+
+TEST(dplp_circuitbreaker, bucket_rounds)
+{
+    typedef dplp::CircuitBreaker_Bucket Bucket;
+    const std::size_t numBuckets = 10;
+
+    // A call in slice 13 is counted by bucket 3 in round 1, which the bucket
+    // counts until slice 23 starts its next round.
+    const std::uint64_t bucket =
+        Bucket::make(Bucket::round(13, 3, numBuckets)) +
+        Bucket::increment(true, false);
+    EXPECT_EQ(Bucket::numCalls(bucket), 1u);
+    EXPECT_EQ(Bucket::numFailures(bucket), 1u);
+    EXPECT_EQ(Bucket::numSlow(bucket), 0u);
+    for (std::uint64_t slice = 13; slice < 23; ++slice) {
+        EXPECT_EQ(Bucket::roundOf(bucket),
+                  Bucket::round(slice, 3, numBuckets));
+    }
+    EXPECT_NE(Bucket::roundOf(bucket), Bucket::round(23, 3, numBuckets));
+
+    // The bucket stays stale for fewer than 2^16 windows, and looks current
+    // again after exactly that many, which the breaker's sweeps rule out.
+    const std::uint64_t numRounds = std::uint64_t(1)
+                                    << Bucket::k_ROUND_BITS;
+    EXPECT_NE(Bucket::roundOf(bucket),
+              Bucket::round(13 + numBuckets * (numRounds - 1),
+                            3,
+                            numBuckets));
+    EXPECT_EQ(Bucket::roundOf(bucket),
+              Bucket::round(13 + numBuckets * numRounds, 3, numBuckets));
+}
+
+TEST(dplp_circuitbreaker, bucket_saturation)
+{
+    typedef dplp::CircuitBreaker_Bucket Bucket;
+
+    std::uint64_t bucket = Bucket::make(7);
+    for (int i = 0; i < 5; ++i)
+        bucket += Bucket::increment(i < 3, i < 1);
+    bucket = Bucket::halve(bucket);
+    EXPECT_EQ(Bucket::roundOf(bucket), 7u);
+    EXPECT_EQ(Bucket::numCalls(bucket), 2u);
+    EXPECT_EQ(Bucket::numFailures(bucket), 1u);
+    EXPECT_EQ(Bucket::numSlow(bucket), 0u);
+
+    // Counts stay within their fields when halved at their maximum.
+    bucket = Bucket::make(Bucket::round(0, 0, 1) - 1);
+    for (std::uint64_t i = 0; i < Bucket::k_MAX_COUNT; ++i)
+        bucket += Bucket::increment(true, true);
+    bucket = Bucket::halve(bucket);
+    EXPECT_EQ(Bucket::roundOf(bucket), Bucket::k_MAX_COUNT);
+    EXPECT_EQ(Bucket::numCalls(bucket), Bucket::k_MAX_COUNT / 2);
+    EXPECT_EQ(Bucket::numFailures(bucket), Bucket::k_MAX_COUNT / 2);
+    EXPECT_EQ(Bucket::numSlow(bucket), Bucket::k_MAX_COUNT / 2);
+}
+
+TEST(dplp_circuitbreaker, many_calls)
+{
+    // Every call of a busy slice is counted: 2000 successes take 2000
+    // failures to reach a rate of one half.
+    dplp::CircuitBreaker::Options options = testOptions();
+    options.d_window                      = std::chrono::seconds(60);
+    options.d_numBuckets                  = 2;
+    dplp::CircuitBreaker breaker(options);
+
+    for (int i = 0; i < 2000; ++i)
+        breaker.call(succeed);
+    for (int i = 0; i < 1999; ++i)
+        breaker.call(fail);
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_CLOSED);
+    breaker.call(fail);
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_OPEN);
+
+    // A slice busier than a bucket can count still yields its rate.
+    dplp::CircuitBreaker busy(options);
+    for (int i = 0; i < 100000; ++i)
+        busy.call(succeed);
+    for (int i = 0; i < 30000; ++i)
+        busy.call(fail);
+    EXPECT_EQ(busy.state(), dplp::CircuitBreaker::e_CLOSED);
+    for (int i = 0; i < 50000; ++i)
+        busy.call(fail);
+    EXPECT_EQ(busy.state(), dplp::CircuitBreaker::e_OPEN);
+}
+
+TEST(dplp_circuitbreaker, threads)
+{
+    dplp::CircuitBreaker::Options options = testOptions();
+    options.d_minCalls                    = 100;
+    dplp::CircuitBreaker breaker(options);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10000; ++i)
+                breaker.call(i % 10 ? succeed : fail);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    EXPECT_EQ(breaker.state(), dplp::CircuitBreaker::e_CLOSED);
+    EXPECT_EQ(breaker.numInFlight(), 0u);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,220 @@
+#include <dplp_dataflow.h>
+
+#include <dplp_anypromisehandle.h>
+#include <dplp_trampoline.h>
+
+#include <algorithm>  // std::max, std::push_heap, std::pop_heap
+#include <stdexcept>  // std::invalid_argument
+#include <utility>    // std::move
+
+namespace dplp {
+
+Dataflow::Dataflow()
+: d_maxConcurrency(k_UNLIMITED)
+, d_numRunning(0)
+, d_numCompleted(0)
+{
+}
+
+Dataflow::NodeId Dataflow::addNode(Function function, double weight)
+{
+    d_functions.push_back(std::move(function));
+    d_weights.push_back(weight);
+    return d_functions.size() - 1;
+}
+
+void Dataflow::addEdge(NodeId from, NodeId to)
+{
+    d_edges.emplace_back(from, to);
+}
+
+void Dataflow::build()
+{
+    const std::size_t n = numNodes();
+
+    // Lay the successor lists out contiguously, in edge order.
+    d_offsets.assign(n + 1, 0);
+    for (const std::pair<NodeId, NodeId>& edge : d_edges)
+        ++d_offsets[edge.first + 1];
+    for (std::size_t i = 0; i < n; ++i)
+        d_offsets[i + 1] += d_offsets[i];
+
+    std::vector<std::uint32_t> inDegrees(n, 0);
+    std::vector<std::size_t>   next(d_offsets.begin(), d_offsets.end() - 1);
+    d_successors.resize(d_edges.size());
+    for (const std::pair<NodeId, NodeId>& edge : d_edges) {
+        d_successors[next[edge.first]++] = edge.second;
+        ++inDegrees[edge.second];
+    }
+
+    // Sort the nodes topologically, which fails if there is a cycle, and
+    // compute the longest remaining paths in reverse order.
+    std::vector<NodeId>        order;
+    std::vector<std::uint32_t> remaining(inDegrees);
+    order.reserve(n);
+    for (NodeId node = 0; node < n; ++node)
+        if (remaining[node] == 0)
+            order.push_back(node);
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        const NodeId node = order[i];
+        for (std::size_t j = d_offsets[node]; j < d_offsets[node + 1]; ++j)
+            if (--remaining[d_successors[j]] == 0)
+                order.push_back(d_successors[j]);
+    }
+    if (order.size() != n)
+        throw std::invalid_argument("dplp::Dataflow graph has a cycle");
+
+    d_priorities.assign(n, 0);
+    for (std::size_t i = n; i-- > 0;) {
+        const NodeId node    = order[i];
+        double       longest = 0;
+        for (std::size_t j = d_offsets[node]; j < d_offsets[node + 1]; ++j)
+            longest = std::max(longest, d_priorities[d_successors[j]]);
+        d_priorities[node] = d_weights[node] + longest;
+    }
+
+    d_countdowns.reset(new std::atomic<std::uint32_t>[n]);
+    for (NodeId node = 0; node < n; ++node)
+        d_countdowns[node].store(inDegrees[node], std::memory_order_relaxed);
+}
+
+void Dataflow::start(NodeId node)
+{
+    Dataflow_Timing& timing = d_timings[node];
+    timing.d_ran     = true;
+    timing.d_started = std::chrono::steady_clock::now() - d_runStart;
+
+    try {
+        dplp::AnyPromiseHandle(d_functions[node]())
+            .then([this, node] { complete(node, nullptr); },
+                  [this, node](std::exception_ptr error) {
+                      complete(node, std::move(error));
+                  });
+    }
+    catch (...) {
+        complete(node, std::current_exception());
+    }
+}
+
+void Dataflow::complete(NodeId node, std::exception_ptr error)
+{
+    d_timings[node].d_completed =
+        std::chrono::steady_clock::now() - d_runStart;
+
+    std::vector<NodeId> ready;
+    if (!error) {
+        for (std::size_t j = d_offsets[node]; j < d_offsets[node + 1]; ++j) {
+            const NodeId successor = d_successors[j];
+            if (d_countdowns[successor].fetch_sub(
+                    1, std::memory_order_acq_rel) == 1)
+                ready.push_back(successor);
+        }
+    }
+    schedule(ready, true, std::move(error));
+}
+
+void Dataflow::schedule(const std::vector<NodeId>& ready,
+                        bool                       completed,
+                        std::exception_ptr         error)
+{
+    const auto lowerPriority = [this](NodeId lhs, NodeId rhs) {
+        return d_priorities[lhs] < d_priorities[rhs];
+    };
+
+    std::vector<NodeId>                     toStart;
+    std::function<void()>                   fulfill;
+    std::function<void(std::exception_ptr)> reject;
+    std::exception_ptr                      runError;
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        if (completed) {
+            --d_numRunning;
+            ++d_numCompleted;
+        }
+        if (error && !d_error)
+            d_error = std::move(error);
+
+        if (!d_error) {
+            for (NodeId node : ready) {
+                d_ready.push_back(node);
+                std::push_heap(d_ready.begin(), d_ready.end(), lowerPriority);
+            }
+            while (!d_ready.empty() && d_numRunning < d_maxConcurrency) {
+                std::pop_heap(d_ready.begin(), d_ready.end(), lowerPriority);
+                toStart.push_back(d_ready.back());
+                d_ready.pop_back();
+                ++d_numRunning;
+            }
+        }
+
+        // The run is over when nothing is running and either a node failed
+        // or all of them completed. Only one caller sees this with the
+        // resolvers still set.
+        if (d_numRunning == 0 &&
+            (d_error || d_numCompleted == numNodes()) && d_fulfill) {
+            fulfill  = std::move(d_fulfill);
+            reject   = std::move(d_reject);
+            runError = d_error;
+            d_fulfill = nullptr;
+            d_reject  = nullptr;
+        }
+    }
+
+    // Resolving the run may destroy this object, so it is the last use.
+    if (fulfill) {
+        if (runError)
+            reject(runError);
+        else
+            fulfill();
+        return;
+    }
+
+    for (NodeId node : toStart)
+        dplp::Trampoline::run([this, node] { start(node); });
+}
+
+dplp::Promise<> Dataflow::run(std::size_t maxConcurrency)
+{
+    build();
+
+    const std::size_t n = numNodes();
+    d_timings.assign(n, Dataflow_Timing{});
+    d_runStart       = std::chrono::steady_clock::now();
+    d_maxConcurrency = maxConcurrency;
+    d_ready.clear();
+    d_numRunning   = 0;
+    d_numCompleted = 0;
+    d_error        = nullptr;
+
+    if (n == 0)
+        return dplp::makeFulfilledPromise();
+
+    dplp::Promise<> result([this](auto fulfill, auto reject) {
+        d_fulfill = fulfill;
+        d_reject  = reject;
+    });
+
+    std::vector<NodeId> roots;
+    for (NodeId node = 0; node < n; ++node)
+        if (d_countdowns[node].load(std::memory_order_relaxed) == 0)
+            roots.push_back(node);
+    schedule(roots, false, nullptr);
+    return result;
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,258 @@
+#ifndef INCLUDED_DPLP_DATAFLOW
+#define INCLUDED_DPLP_DATAFLOW
+
+//@PURPOSE: Provide a dataflow graph of promise-returning functions.
+//
+//@CLASSES:
+//  dplp::Dataflow: graph that runs each node once its inputs completed
+//  dplp::Dataflow_Timing: when a node started and completed in a run
+//
+//@SEE_ALSO: dplp_promise, dplp_asyncscope
+//
+//@DESCRIPTION: This component provides a class, 'dplp::Dataflow', which runs
+// a directed acyclic graph of asynchronous steps, such as a request plan of
+// dependent backend calls and transforms, without hand-written nesting of
+// 'then' calls and join logic.
+//
+// A node is a function returning a 'dplp::Promise<>'; data flows between
+// nodes through whatever the functions capture. An edge from node 'a' to node
+// 'b' means 'b' is started only after the promise returned by 'a' is
+// fulfilled. 'run' starts every node without inputs and returns a promise
+// that is fulfilled when all nodes completed.
+//
+// Each node has a single atomic countdown of its unfinished inputs, set when
+// a run starts. When a node completes, the countdowns of its successors are
+// decremented, and the ones reaching zero become ready; no promise is created
+// per edge. The scheduler learns of a node's completion by posting
+// continuations to its promise through 'dplp::AnyPromiseHandle'.
+//
+///Scheduling
+///----------
+// 'run' takes an optional limit on the number of nodes in progress at once.
+// When more nodes are ready than the limit allows, the node with the longest
+// remaining path, i.e. the largest sum of node weights along a path from it
+// to the end of the graph, is started first, so that the critical path is
+// not delayed by work that has slack. Node weights are given when the nodes
+// are added and default to 1; the estimated duration of a node is a good
+// weight. Without a limit, ready nodes are started immediately.
+//
+// Nodes are started from the thread that completed their last input, through
+// 'dplp::Trampoline', so a long chain of synchronously completing nodes does
+// not exhaust the stack.
+//
+///Errors
+///------
+// If a node's promise is rejected or its function throws, no further nodes
+// are started. Once the nodes in progress complete, the promise returned by
+// 'run' is rejected with the first error. 'run' throws 'std::invalid_argument'
+// if the graph has a cycle.
+//
+///Timings
+///-------
+// A run records, for each node, when it was started and completed, relative
+// to the start of the run (see 'timing'). These can be exported to find the
+// nodes that dominate a plan's latency.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Fetch, transform, and combine
+///- - - - - - - - - - - - - - - - - - - - -
+// Suppose a response needs a user's profile and their recent orders, and the
+// orders must be priced, which depends on the profile's region.
+//..
+//  Profile             profile;
+//  std::vector<Order>  orders;
+//  dplp::Dataflow      plan;
+//
+//  const auto fetchProfile = plan.addNode([&] {
+//      return fetchProfileP(userId).then([&](Profile p) { profile = p; });
+//  }, 5);
+//  const auto fetchOrders = plan.addNode([&] {
+//      return fetchOrdersP(userId).then([&](auto o) { orders = o; });
+//  }, 20);
+//  const auto price = plan.addNode([&] {
+//      priceOrders(&orders, profile.region());
+//      return dplp::makeFulfilledPromise();
+//  });
+//  plan.addEdge(fetchProfile, price);
+//  plan.addEdge(fetchOrders, price);
+//
+//  plan.run().then([&] { respond(profile, orders); });
+//..
+
+#include <dplp_promise.h>
+
+#include <atomic>      // std::atomic
+#include <chrono>      // std::chrono::steady_clock
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::uint32_t
+#include <exception>   // std::exception_ptr
+#include <functional>  // std::function
+#include <memory>      // std::unique_ptr
+#include <mutex>       // std::mutex
+#include <utility>     // std::pair
+#include <vector>
+
+namespace dplp {
+
+struct Dataflow_Timing {
+    // This struct holds when a node started and completed in a run, relative
+    // to the start of the run.
+
+    std::chrono::steady_clock::duration d_started;
+    std::chrono::steady_clock::duration d_completed;
+    bool                                d_ran;  // 'false' if not started
+};
+
+class Dataflow {
+    // This class implements a directed acyclic graph of promise-returning
+    // functions, each run once its predecessors' promises are fulfilled.
+
+  public:
+    typedef std::size_t NodeId;
+        // The identifier of a node, which is its index in the order nodes
+        // were added.
+
+    typedef std::function<dplp::Promise<>()> Function;
+        // The type of a node's function.
+
+    static constexpr std::size_t k_UNLIMITED = static_cast<std::size_t>(-1);
+        // A concurrency limit meaning "no limit".
+
+  private:
+    // GRAPH
+    std::vector<Function>                   d_functions;
+    std::vector<double>                     d_weights;
+    std::vector<std::pair<NodeId, NodeId> > d_edges;
+
+    // The successors of node 'i' are 'd_successors[d_offsets[i]]' up to
+    // 'd_successors[d_offsets[i + 1]]', built from 'd_edges' by 'run'.
+    std::vector<std::size_t> d_offsets;
+    std::vector<NodeId>      d_successors;
+    std::vector<double>      d_priorities;  // longest remaining path
+
+    // RUN STATE
+    std::unique_ptr<std::atomic<std::uint32_t>[]> d_countdowns;
+    std::vector<dplp::Dataflow_Timing>            d_timings;
+    std::chrono::steady_clock::time_point         d_runStart;
+    std::size_t                                   d_maxConcurrency;
+
+    std::mutex                              d_mutex;  // protects the below
+    std::vector<NodeId>                     d_ready;  // a heap by priority
+    std::size_t                             d_numRunning;
+    std::size_t                             d_numCompleted;
+    std::exception_ptr                      d_error;  // of the first failure
+    std::function<void()>                   d_fulfill;
+    std::function<void(std::exception_ptr)> d_reject;
+
+    void build();
+        // Build the successor lists, in-degrees, and priorities from the
+        // nodes and edges. Throw 'std::invalid_argument' if there is a cycle.
+
+    void start(NodeId node);
+        // Call the function of the specified 'node' and arrange for
+        // 'complete' to be called when its promise is resolved.
+
+    void complete(NodeId node, std::exception_ptr error);
+        // Record the completion of the specified 'node', with the specified
+        // 'error' if it failed, and start the nodes that became ready.
+
+    void schedule(const std::vector<NodeId>& ready,
+                  bool                       completed,
+                  std::exception_ptr         error);
+        // Add the specified 'ready' nodes to the ready nodes, uncount a
+        // running node if the specified 'completed' is 'true', record the
+        // specified 'error' if it is the first, start as many ready nodes as
+        // the concurrency limit allows, and resolve the run if there is
+        // nothing left to do.
+
+  public:
+    Dataflow();
+        // Create an empty graph.
+
+    Dataflow(const Dataflow&) = delete;
+    Dataflow& operator=(const Dataflow&) = delete;
+
+    NodeId addNode(Function function, double weight = 1);
+        // Add a node that calls the specified 'function' and whose
+        // optionally specified 'weight' is its estimated cost, and return its
+        // identifier.
+
+    void addEdge(NodeId from, NodeId to);
+        // Make the node 'to' start only after the promise of the node 'from'
+        // is fulfilled. The behavior is undefined unless both nodes were
+        // added to this graph.
+
+    dplp::Promise<> run(std::size_t maxConcurrency = k_UNLIMITED);
+        // Run the nodes of this graph, at most the optionally specified
+        // 'maxConcurrency' at once, and return a promise fulfilled when all
+        // of them completed, or rejected with the first error. Throw
+        // 'std::invalid_argument' if the graph has a cycle. The behavior is
+        // undefined unless '0 < maxConcurrency', and unless this object is
+        // neither modified nor run again, nor destroyed, until the returned
+        // promise is resolved.
+
+    std::size_t numNodes() const;
+        // Return the number of nodes of this graph.
+
+    std::size_t numEdges() const;
+        // Return the number of edges of this graph.
+
+    double priority(NodeId node) const;
+        // Return the length of the longest path from the specified 'node' to
+        // the end of the graph, counting node weights and 'node' itself, as
+        // of the last run.
+
+    const dplp::Dataflow_Timing& timing(NodeId node) const;
+        // Return when the specified 'node' started and completed in the last
+        // run. The behavior is undefined unless that run's promise resolved.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+std::size_t Dataflow::numNodes() const
+{
+    return d_functions.size();
+}
+
+inline
+std::size_t Dataflow::numEdges() const
+{
+    return d_edges.size();
+}
+
+inline
+double Dataflow::priority(NodeId node) const
+{
+    return d_priorities[node];
+}
+
+inline
+const dplp::Dataflow_Timing& Dataflow::timing(NodeId node) const
+{
+    return d_timings[node];
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
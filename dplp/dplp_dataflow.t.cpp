@@ -0,0 +1,262 @@
+#include <dplp_dataflow.h>
+
+#include <dplp_anypromisehandle.h>
+#include <dplp_promise.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+bool isFulfilled(const dplp::Promise<>& p)
+{
+    bool result = false;
+    if (dplp::AnyPromiseHandle(p).isResolved())
+        p.then([&] { result = true; });
+    return result;
+}
+
+dplp::Promise<> fulfilledLater()
+    // Return a promise fulfilled by another thread.
+{
+    return dplp::Promise<>([](auto fulfill, auto) {
+        std::thread([fulfill] { fulfill(); }).detach();
+    });
+}
+}
+
+TEST(dplp_dataflow, diamond)
+{
+    dplp::Dataflow      graph;
+    std::vector<char>   order;
+    const auto          node = [&](char name) {
+        return graph.addNode([&order, name] {
+            order.push_back(name);
+            return dplp::makeFulfilledPromise();
+        });
+    };
+
+    const dplp::Dataflow::NodeId a = node('a');
+    const dplp::Dataflow::NodeId b = node('b');
+    const dplp::Dataflow::NodeId c = node('c');
+    const dplp::Dataflow::NodeId d = node('d');
+    graph.addEdge(a, b);
+    graph.addEdge(a, c);
+    graph.addEdge(b, d);
+    graph.addEdge(c, d);
+    EXPECT_EQ(graph.numNodes(), 4u);
+    EXPECT_EQ(graph.numEdges(), 4u);
+
+    EXPECT_TRUE(isFulfilled(graph.run()));
+    ASSERT_EQ(order.size(), 4u);
+    EXPECT_EQ(order.front(), 'a');
+    EXPECT_EQ(order.back(), 'd');
+
+    EXPECT_EQ(graph.priority(a), 3);
+    EXPECT_EQ(graph.priority(d), 1);
+    for (dplp::Dataflow::NodeId n : {a, b, c, d}) {
+        EXPECT_TRUE(graph.timing(n).d_ran);
+        EXPECT_LE(graph.timing(n).d_started, graph.timing(n).d_completed);
+    }
+    EXPECT_LE(graph.timing(a).d_completed, graph.timing(d).d_started);
+
+    // A graph can be run again.
+    order.clear();
+    EXPECT_TRUE(isFulfilled(graph.run()));
+    EXPECT_EQ(order.size(), 4u);
+}
+
+TEST(dplp_dataflow, critical_path_first)
+{
+    // With one node at a time, the root of the long chain goes first even
+    // though the short one was added first, and heavy nodes go before light
+    // ones.
+    dplp::Dataflow   graph;
+    std::vector<int> order;
+    const auto       node = [&](int name, double weight) {
+        return graph.addNode(
+            [&order, name] {
+                order.push_back(name);
+                return dplp::makeFulfilledPromise();
+            },
+            weight);
+    };
+
+    const dplp::Dataflow::NodeId shortRoot = node(0, 1);
+    const dplp::Dataflow::NodeId longRoot  = node(1, 1);
+    const dplp::Dataflow::NodeId chain1    = node(2, 1);
+    const dplp::Dataflow::NodeId chain2    = node(3, 1);
+    const dplp::Dataflow::NodeId light     = node(4, 0.5);
+    const dplp::Dataflow::NodeId heavy     = node(5, 10);
+    graph.addEdge(longRoot, chain1);
+    graph.addEdge(chain1, chain2);
+    graph.addEdge(shortRoot, light);
+    graph.addEdge(shortRoot, heavy);
+
+    EXPECT_TRUE(isFulfilled(graph.run(1)));
+    EXPECT_EQ(graph.priority(shortRoot), 11);
+    EXPECT_EQ(order, (std::vector<int>{0, 5, 1, 2, 3, 4}));
+}
+
+TEST(dplp_dataflow, errors)
+{
+    dplp::Dataflow graph;
+    int            numCalled = 0;
+
+    const dplp::Dataflow::NodeId fail =
+        graph.addNode([]() -> dplp::Promise<> {
+            throw std::runtime_error("failed");
+        });
+    const dplp::Dataflow::NodeId after = graph.addNode([&] {
+        ++numCalled;
+        return dplp::makeFulfilledPromise();
+    });
+    graph.addEdge(fail, after);
+
+    std::string message;
+    graph.run().then([] {},
+                     [&](std::exception_ptr error) {
+                         try {
+                             std::rethrow_exception(error);
+                         }
+                         catch (const std::runtime_error& e) {
+                             message = e.what();
+                         }
+                     });
+    EXPECT_EQ(message, "failed");
+    EXPECT_EQ(numCalled, 0);
+    EXPECT_FALSE(graph.timing(after).d_ran);
+
+    // A rejected promise fails the node too.
+    dplp::Dataflow rejected;
+    rejected.addNode([] {
+        return dplp::makeRejectedPromise<>(
+            std::make_exception_ptr(std::runtime_error("rejected")));
+    });
+    EXPECT_FALSE(isFulfilled(rejected.run()));
+    EXPECT_TRUE(dplp::AnyPromiseHandle(rejected.run()).isResolved());
+}
+
+TEST(dplp_dataflow, cycle)
+{
+    const auto f = [] { return dplp::makeFulfilledPromise(); };
+
+    dplp::Dataflow               graph;
+    const dplp::Dataflow::NodeId a = graph.addNode(f);
+    const dplp::Dataflow::NodeId b = graph.addNode(f);
+    graph.addEdge(a, b);
+    graph.addEdge(b, a);
+    EXPECT_THROW(graph.run(), std::invalid_argument);
+
+    dplp::Dataflow empty;
+    EXPECT_TRUE(isFulfilled(empty.run()));
+}
+
+TEST(dplp_dataflow, long_chain)
+{
+    const std::size_t k_NUM_NODES = 100000;
+    dplp::Dataflow    graph;
+    std::size_t       numCalled = 0;
+    for (std::size_t i = 0; i < k_NUM_NODES; ++i) {
+        graph.addNode([&] {
+            ++numCalled;
+            return dplp::makeFulfilledPromise();
+        });
+        if (i != 0)
+            graph.addEdge(i - 1, i);
+    }
+    EXPECT_TRUE(isFulfilled(graph.run()));
+    EXPECT_EQ(numCalled, k_NUM_NODES);
+    EXPECT_EQ(graph.priority(0), static_cast<double>(k_NUM_NODES));
+}
+
+TEST(dplp_dataflow, synthetic)
+{
+    // A random layered graph of 10^5 nodes, each depending on up to three
+    // nodes of the previous layer. Each node checks that its inputs ran.
+    const std::size_t k_NUM_NODES = 100000;
+    const std::size_t k_WIDTH     = 100;
+
+    std::mt19937                           random(42);
+    dplp::Dataflow                         graph;
+    std::vector<std::atomic<int> >         done(k_NUM_NODES);
+    std::vector<std::vector<std::size_t> > inputs(k_NUM_NODES);
+    std::atomic<bool>                      inOrder(true);
+
+    for (std::size_t i = 0; i < k_NUM_NODES; ++i) {
+        graph.addNode([&, i] {
+            for (std::size_t input : inputs[i])
+                if (!done[input].load())
+                    inOrder = false;
+            done[i] = 1;
+            return dplp::makeFulfilledPromise();
+        });
+        if (i >= k_WIDTH) {
+            const std::size_t layerStart = (i / k_WIDTH - 1) * k_WIDTH;
+            for (int e = 0; e < 3; ++e) {
+                const std::size_t input = layerStart + random() % k_WIDTH;
+                inputs[i].push_back(input);
+                graph.addEdge(input, i);
+            }
+        }
+    }
+
+    for (std::size_t limit : {dplp::Dataflow::k_UNLIMITED, std::size_t(4)}) {
+        for (std::atomic<int>& d : done)
+            d = 0;
+        EXPECT_TRUE(isFulfilled(graph.run(limit)));
+        EXPECT_TRUE(inOrder);
+        for (std::size_t i = 0; i < k_NUM_NODES; ++i)
+            ASSERT_EQ(done[i].load(), 1) << i;
+    }
+}
+
+TEST(dplp_dataflow, asynchronous)
+{
+    const std::size_t k_NUM_NODES = 1000;
+    dplp::Dataflow    graph;
+    std::atomic<int>  numCalled(0);
+    for (std::size_t i = 0; i < k_NUM_NODES; ++i) {
+        graph.addNode([&] {
+            ++numCalled;
+            return fulfilledLater();
+        });
+        if (i >= 10)
+            graph.addEdge(i - 10, i);
+    }
+
+    std::atomic<bool> finished(false);
+    graph.run(8).then([&] { finished = true; });
+    while (!finished)
+        std::this_thread::yield();
+    EXPECT_EQ(numCalled, static_cast<int>(k_NUM_NODES));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,38 @@
+#include <dplp_defaultresource.h>
+
+namespace dplp {
+namespace {
+
+thread_local std::pmr::memory_resource *currentResource =
+    std::pmr::new_delete_resource();
+}
+
+std::pmr::memory_resource *DefaultResource::get()
+{
+    return currentResource;
+}
+
+std::pmr::memory_resource *DefaultResource::set(
+                                           std::pmr::memory_resource *resource)
+{
+    std::pmr::memory_resource *const previous = currentResource;
+    currentResource                           = resource;
+    return previous;
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
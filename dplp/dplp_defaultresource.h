@@ -0,0 +1,213 @@
+#ifndef INCLUDED_DPLP_DEFAULTRESOURCE
+#define INCLUDED_DPLP_DEFAULTRESOURCE
+
+//@PURPOSE: Provide the per-thread memory resource used for promise state.
+//
+//@CLASSES:
+//  dplp::DefaultResource: access to the current thread's resource
+//  dplp::DefaultResourceGuard: scoped installation of a resource
+//  dplp::DefaultResourceNode: base of nodes allocated from the resource
+//
+//@DESCRIPTION: This component provides a utility class,
+// 'dplp::DefaultResource', through which the shared state of every
+// 'dplp::Promise' is allocated, and a guard class,
+// 'dplp::DefaultResourceGuard', which installs a different resource for the
+// current thread for the duration of a scope.
+//
+// The resource is looked up when a promise is created, which includes the
+// promises created by 'dplp::Promise::then'. The resource is remembered by the
+// allocation, so the state is returned to the same resource no matter which
+// thread releases the last reference to it.
+//
+// Each thread starts out using 'std::pmr::new_delete_resource()'.
+//
+// This component also provides a class template, 'dplp::DefaultResourceNode',
+// which is a base of the intrusive nodes, such as queued continuations and
+// waiters, that components allocate from the default resource. Its 'create'
+// function allocates and constructs a node, and remembers the resource in it.
+// Its 'destroy' function destroys the node and returns the memory to that
+// resource. Its 'take' function moves a member, typically a function, out of
+// the node and destroys the node. The node is released before the function
+// is called because the call may resolve a promise, release the last
+// reference to the object holding the node, or queue another node.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Allocate promises from a pool
+///- - - - - - - - - - - - - - - - - - - - -
+// Suppose a worker thread creates many short-lived promises and we'd like
+// their state to come from a pool private to that thread.
+//..
+//  std::pmr::unsynchronized_pool_resource pool;
+//  dplp::DefaultResourceGuard             guard(&pool);
+//
+//  dplp::Promise<int> p = receiveIntP();  // state allocated from 'pool'
+//..
+// Note that 'pool' must outlive the promises allocated from it.
+//
+///Example 2: Queue a callback
+///- - - - - - - - - - - - - -
+// Suppose a component queues callbacks of any type behind a common base.
+//..
+//  struct Task {
+//      Task *d_next_p = nullptr;
+//      virtual void run() = 0;
+//  };
+//
+//  template <typename F>
+//  class TaskImp : public Task,
+//                  public dplp::DefaultResourceNode<TaskImp<F> > {
+//      F d_function;
+//
+//      friend class dplp::DefaultResourceNode<TaskImp>;
+//
+//      explicit TaskImp(F function) : d_function(std::move(function)) {}
+//
+//    public:
+//      void run() override { std::invoke(this->take(&TaskImp::d_function)); }
+//  };
+//
+//  Task *task = TaskImp<F>::create(std::move(function));
+//..
+
+#include <memory_resource>  // std::pmr::memory_resource
+#include <new>              // placement new
+#include <utility>          // std::forward, std::move
+
+namespace dplp {
+
+struct DefaultResource {
+    // This utility provides access to the memory resource promise state is
+    // allocated from on the current thread.
+
+    static std::pmr::memory_resource *get();
+        // Return the memory resource promise state is allocated from on the
+        // current thread.
+
+    static std::pmr::memory_resource *set(std::pmr::memory_resource *resource);
+        // Make the specified 'resource' the memory resource promise state is
+        // allocated from on the current thread and return the previous one.
+        // The behavior is undefined unless 'resource' is not null.
+};
+
+class DefaultResourceGuard {
+    // This class implements a guard that installs a memory resource for the
+    // current thread on construction and restores the previous one on
+    // destruction.
+
+    std::pmr::memory_resource *d_previous_p;
+
+  public:
+    explicit DefaultResourceGuard(std::pmr::memory_resource *resource);
+        // Install the specified 'resource' as the memory resource promise
+        // state is allocated from on the current thread.
+
+    DefaultResourceGuard(const DefaultResourceGuard&) = delete;
+    DefaultResourceGuard& operator=(const DefaultResourceGuard&) = delete;
+
+    ~DefaultResourceGuard();
+        // Restore the memory resource that was installed when this object was
+        // created.
+};
+
+template <typename Node>
+class DefaultResourceNode {
+    // This class template is a base of the class 'Node', whose objects are
+    // allocated from the default resource by 'create' and returned to it by
+    // 'destroy'. 'Node' must befriend this class if its constructors are not
+    // public.
+
+    std::pmr::memory_resource *d_resource_p;  // set by 'create'
+
+  protected:
+    DefaultResourceNode() = default;
+    ~DefaultResourceNode() = default;
+
+    void destroy();
+        // Destroy this node and return its memory to the resource it was
+        // allocated from.
+
+    template <typename T>
+    T take(T Node::*member);
+        // Destroy this node, after moving the specified 'member' out of it,
+        // and return the member.
+
+  public:
+    template <typename... Args>
+    static Node *create(Args&&... args);
+        // Return a new 'Node' constructed from the specified 'args' and
+        // allocated from 'dplp::DefaultResource::get()'.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+DefaultResourceGuard::DefaultResourceGuard(std::pmr::memory_resource *resource)
+: d_previous_p(DefaultResource::set(resource))
+{
+}
+
+inline
+DefaultResourceGuard::~DefaultResourceGuard()
+{
+    DefaultResource::set(d_previous_p);
+}
+
+template <typename Node>
+void DefaultResourceNode<Node>::destroy()
+{
+    Node *const                      node     = static_cast<Node *>(this);
+    std::pmr::memory_resource *const resource = d_resource_p;
+    node->~Node();
+    resource->deallocate(node, sizeof(Node), alignof(Node));
+}
+
+template <typename Node>
+template <typename T>
+T DefaultResourceNode<Node>::take(T Node::*member)
+{
+    T result(std::move(static_cast<Node *>(this)->*member));
+    destroy();
+    return result;
+}
+
+template <typename Node>
+template <typename... Args>
+Node *DefaultResourceNode<Node>::create(Args&&... args)
+{
+    std::pmr::memory_resource *const resource = DefaultResource::get();
+    void *const memory = resource->allocate(sizeof(Node), alignof(Node));
+    Node       *node;
+    try {
+        node = ::new (memory) Node(std::forward<Args>(args)...);
+    }
+    catch (...) {
+        resource->deallocate(memory, sizeof(Node), alignof(Node));
+        throw;
+    }
+    node->DefaultResourceNode::d_resource_p = resource;
+    return node;
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,217 @@
+#include <dplp_defaultresource.h>
+
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <exception>
+#include <functional>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace {
+class Node : public dplp::DefaultResourceNode<Node> {
+    // A node holding a function, which throws from its constructor if it is
+    // given a null function.
+
+    std::function<void(int)> d_function;
+
+    friend class dplp::DefaultResourceNode<Node>;
+
+    explicit Node(std::function<void(int)> function)
+    : d_function(std::move(function))
+    {
+        if (!d_function)
+            throw std::invalid_argument("null function");
+    }
+
+  public:
+    void run(int value)
+    {
+        take(&Node::d_function)(value);
+    }
+
+    void discard()
+    {
+        destroy();
+    }
+};
+}
+
+TEST(dplp_defaultresource, guard)
+{
+    std::pmr::memory_resource *const original = dplp::DefaultResource::get();
+    EXPECT_EQ(original, std::pmr::new_delete_resource())
+        << "Unexpected initial resource.";
+
+    dplp::TestUtil::CountingResource resource;
+    {
+        dplp::DefaultResourceGuard guard(&resource);
+        EXPECT_EQ(dplp::DefaultResource::get(), &resource)
+            << "Guard didn't install the resource.";
+    }
+    EXPECT_EQ(dplp::DefaultResource::get(), original)
+        << "Guard didn't restore the resource.";
+}
+
+TEST(dplp_defaultresource, promise_state)
+{
+    dplp::TestUtil::CountingResource resource;
+    {
+        dplp::Promise<int> p = [&] {
+            dplp::DefaultResourceGuard guard(&resource);
+            const dplp::Promise<int>   source(
+                [](auto fulfill, auto) { fulfill(3); });
+            return source.then([](int i) { return i + 1; });
+        }();
+        EXPECT_EQ(resource.numAllocations(), 2)
+            << "Promise state wasn't allocated from the resource.";
+
+        // The state is returned to the resource even though it is no longer
+        // installed.
+    }
+    EXPECT_EQ(resource.numDeallocations(), 2)
+        << "Promise state wasn't returned to the resource.";
+}
+
+TEST(dplp_defaultresource, continuation_list)
+{
+    dplp::TestUtil::CountingResource resource;
+    {
+        std::function<void(int)> fulfill;
+
+        dplp::Promise<int> p = [&] {
+            dplp::DefaultResourceGuard guard(&resource);
+            return dplp::Promise<int>([&](auto f, auto) { fulfill = f; });
+        }();
+        EXPECT_EQ(resource.numAllocations(), 1);
+
+        // Waiting continuations are stored in a list allocated from the
+        // resource that was installed when the state was created, even though
+        // the promise 'then' returns isn't.
+        p.then([](int) {});
+        EXPECT_EQ(resource.numAllocations(), 2)
+            << "Continuation list wasn't allocated from the resource.";
+
+        fulfill(3);
+        EXPECT_EQ(resource.numDeallocations(), 1)
+            << "Continuation list wasn't released on fulfillment.";
+    }
+    EXPECT_EQ(resource.numDeallocations(), 2);
+}
+
+TEST(dplp_defaultresource, inline_results)
+{
+    dplp::TestUtil::CountingResource resource;
+    dplp::DefaultResourceGuard       guard(&resource);
+
+    // Promises created resolved with small values, and synchronous
+    // continuations on them, don't allocate.
+    int result = 0;
+    dplp::makeFulfilledPromise(3)
+        .then([](int i) { return i + 1; })
+        .then([](int i) { return std::make_tuple(i, 2.0); })
+        .then([&](int i, double) { result = i; });
+    EXPECT_EQ(result, 4);
+    dplp::makeRejectedPromise<int>(nullptr).then([](int i) { return i; });
+    EXPECT_EQ(resource.numAllocations(), 0);
+
+    // Large values are held in a state.
+    dplp::makeFulfilledPromise(std::string("a"));
+    EXPECT_EQ(resource.numAllocations(), 1);
+}
+
+TEST(dplp_defaultresource, state_reuse)
+{
+    dplp::TestUtil::CountingResource resource;
+    dplp::DefaultResourceGuard       guard(&resource);
+
+    // Same-typed continuations on the last reference to a resolved state
+    // reuse that state.
+    std::string                result;
+    dplp::Promise<std::string> p =
+        dplp::makeFulfilledPromise(std::string("a"))
+        .then([](std::string s) { return s + "b"; })
+        .then([](std::string s) -> std::string { throw s + "c"; })
+        .then([](std::string s) { return s + "d"; })
+        .then([](std::string s) { return s; },
+              [](std::exception_ptr e) {
+                  try {
+                      std::rethrow_exception(e);
+                  }
+                  catch (const std::string& s) {
+                      return s;
+                  }
+              });
+    EXPECT_EQ(resource.numAllocations(), 1);
+    p.then([&](std::string s) { result = s; });
+    EXPECT_EQ(result, "abc");
+
+    // A state that is referred to elsewhere is not reused.
+    const dplp::Promise<std::string> shared =
+        dplp::makeFulfilledPromise(std::string("a"));
+    dplp::Promise<std::string>(shared).then([](std::string s) {
+        return s + "b";
+    });
+    shared.then([&](std::string s) { result = s; });
+    EXPECT_EQ(result, "a");
+}
+
+TEST(dplp_defaultresource, node)
+{
+    dplp::TestUtil::CountingResource resource;
+    dplp::TestUtil::CountingResource other;
+
+    int   value         = 0;
+    int   numLiveInCall = -1;
+    Node *node;
+    {
+        dplp::DefaultResourceGuard guard(&resource);
+        node = Node::create([&](int i) {
+            value         = i;
+            numLiveInCall = resource.numLive();
+        });
+    }
+    EXPECT_EQ(resource.numLive(), 1);
+
+    // The node is returned to the resource it came from, whichever resource
+    // is current, before its function is called.
+    dplp::DefaultResourceGuard guard(&other);
+    node->run(3);
+    EXPECT_EQ(value, 3);
+    EXPECT_EQ(numLiveInCall, 0);
+    EXPECT_EQ(other.numAllocations(), 0);
+
+    Node::create([](int) {})->discard();
+    EXPECT_EQ(other.numAllocations(), 1);
+    EXPECT_EQ(other.numLive(), 0);
+
+    // A node whose constructor throws is deallocated.
+    EXPECT_THROW(Node::create(nullptr), std::invalid_argument);
+    EXPECT_EQ(other.numAllocations(), 2);
+    EXPECT_EQ(other.numLive(), 0);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
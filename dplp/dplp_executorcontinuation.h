@@ -0,0 +1,210 @@
+#ifndef INCLUDED_DPLP_EXECUTORCONTINUATION
+#define INCLUDED_DPLP_EXECUTORCONTINUATION
+
+//@PURPOSE: Provide a continuation adapter that runs a function on an executor.
+//
+//@CLASSES:
+//  dplp::ExecutorContinuation: continuation that posts to an executor
+//  dplp::ExecutorContinuation_PromiseOf: promise type for a return type
+//
+//@SEE_ALSO: dplp_priorityexecutor, dplp_numaexecutor
+//
+//@DESCRIPTION: This component provides a class template,
+// 'dplp::ExecutorContinuation', which adapts a function so that, when it is
+// passed as a continuation to 'dplp::Promise::then', it is called from a task
+// posted to an executor instead of being called inline.
+//
+// An 'ExecutorContinuation<F, Poster>' is invocable with whatever arguments
+// 'F' is invocable with. When called, it creates a promise, passes a task
+// calling 'F' to its 'Poster' and returns the promise. Because the adapted
+// continuation returns a promise, 'then' chains on it (case #3 in
+// 'dplp_promise'). The task resolves the returned promise according to the
+// same rules 'then' applies to the return type of a continuation: 'void'
+// results in 'dplp::Promise<>', 'std::tuple<T...>' results in
+// 'dplp::Promise<T...>', 'dplp::Promise<T...>' is chained, and any other 'T'
+// results in 'dplp::Promise<T>'. If 'F' throws, the promise is rejected.
+//
+// 'Poster' is a copyable invocable taking a 'std::function<void()>' that is
+// expected to eventually run its argument, typically on another thread.
+// Executors, such as 'dplp::PriorityExecutor', define a 'Poster' type that
+// carries any per-continuation scheduling information and return an
+// 'ExecutorContinuation' from a 'schedule' member function.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Run continuations on a detached thread
+///- - - - - - - - - - - - - - - - - - - - - - - - -
+// The simplest possible executor starts a new thread for every task.
+//..
+//  struct ThreadPoster {
+//      void operator()(std::function<void()> task) const
+//      {
+//          std::thread(std::move(task)).detach();
+//      }
+//  };
+//
+//  template <typename F>
+//  dplp::ExecutorContinuation<F, ThreadPoster> onNewThread(F f)
+//  {
+//      return dplp::ExecutorContinuation<F, ThreadPoster>(std::move(f),
+//                                                          ThreadPoster());
+//  }
+//..
+// A continuation wrapped with 'onNewThread' runs on its own thread.
+//..
+//  dplp::Promise<int> p = receiveIntP().then(onNewThread([](int i) {
+//      return expensiveComputation(i);
+//  }));
+//..
+
+#include <dplmrts_anytuple.h>
+#include <dplp_anypromise.h>
+#include <dplp_promise.h>
+
+#include <exception>    // std::exception_ptr, std::current_exception
+#include <functional>   // std::function, std::invoke
+#include <tuple>        // std::apply, std::make_tuple, std::tuple
+#include <type_traits>  // std::invoke_result_t, std::is_void
+#include <utility>      // std::move
+
+namespace dplp {
+
+template <typename T>
+struct ExecutorContinuation_PromiseOf {
+    // This metafunction computes the type of promise 'dplp::Promise::then'
+    // returns for a continuation with return type 'T' (case #4).
+    using type = dplp::Promise<T>;
+};
+template <>
+struct ExecutorContinuation_PromiseOf<void> {
+    // Case #1, 'void' continuations
+    using type = dplp::Promise<>;
+};
+template <typename... T>
+struct ExecutorContinuation_PromiseOf<std::tuple<T...> > {
+    // Case #2, 'std::tuple' continuations
+    using type = dplp::Promise<T...>;
+};
+template <typename... T>
+struct ExecutorContinuation_PromiseOf<dplp::Promise<T...> > {
+    // Case #3, 'dplp::Promise' continuations
+    using type = dplp::Promise<T...>;
+};
+
+template <typename F, typename Poster>
+class ExecutorContinuation {
+    // This class implements a continuation function that calls an 'F' object
+    // from a task given to a 'Poster' object.
+
+    F      d_function;
+    Poster d_poster;
+
+    template <typename Fulfill, typename Reject, typename... Args>
+    static void deliver(F&       function,
+                        Fulfill& fulfill,
+                        Reject&  reject,
+                        Args&... args);
+        // Call the specified 'function' with the specified 'args' and resolve
+        // the promise associated with the specified 'fulfill' and 'reject'
+        // functions with the result.
+
+  public:
+    ExecutorContinuation(F function, Poster poster);
+        // Create an 'ExecutorContinuation' object that calls the specified
+        // 'function' from tasks given to the specified 'poster'.
+
+    template <typename... Args>
+    auto operator()(Args... args) const ->
+        typename ExecutorContinuation_PromiseOf<
+            std::invoke_result_t<F&, Args&...> >::type;
+        // Give a task calling the wrapped function with the specified 'args'
+        // to the poster and return a promise for the task's result.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+template <typename F, typename Poster>
+ExecutorContinuation<F, Poster>::ExecutorContinuation(F function, Poster poster)
+: d_function(std::move(function))
+, d_poster(std::move(poster))
+{
+}
+
+template <typename F, typename Poster>
+template <typename Fulfill, typename Reject, typename... Args>
+void ExecutorContinuation<F, Poster>::deliver(F&       function,
+                                              Fulfill& fulfill,
+                                              Reject&  reject,
+                                              Args&... args)
+{
+    using R = std::invoke_result_t<F&, Args&...>;
+
+    try {
+        if constexpr (std::is_void<R>::value) {
+            std::invoke(function, args...);
+            fulfill();
+        }
+        else if constexpr (dplmrts::AnyTuple<R>) {
+            std::apply(fulfill, std::invoke(function, args...));
+        }
+        else if constexpr (dplp::AnyPromise<R>) {
+            std::invoke(function, args...)
+                .then([fulfill](auto&&... values) mutable {
+                    fulfill(values...);
+                },
+                      [reject](std::exception_ptr e) mutable { reject(e); });
+        }
+        else {
+            fulfill(std::invoke(function, args...));
+        }
+    }
+    catch (...) {
+        reject(std::current_exception());
+    }
+}
+
+template <typename F, typename Poster>
+template <typename... Args>
+auto ExecutorContinuation<F, Poster>::operator()(Args... args) const ->
+    typename ExecutorContinuation_PromiseOf<
+        std::invoke_result_t<F&, Args&...> >::type
+{
+    using Result = typename ExecutorContinuation_PromiseOf<
+        std::invoke_result_t<F&, Args&...> >::type;
+
+    return Result([&](auto fulfill, auto reject) {
+        d_poster(std::function<void()>([
+            function  = d_function,
+            fulfill,
+            reject,
+            arguments = std::make_tuple(std::move(args)...)
+        ]() mutable {
+            std::apply(
+                [&](auto&... a) { deliver(function, fulfill, reject, a...); },
+                arguments);
+        }));
+    });
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
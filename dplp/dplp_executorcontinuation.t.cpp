@@ -0,0 +1,119 @@
+#include <dplp_executorcontinuation.h>
+
+#include <dplp_promise.h>
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+struct QueuePoster {
+    // A poster that appends tasks to a queue that the test runs explicitly.
+    std::vector<std::function<void()> > *d_queue_p;
+
+    void operator()(std::function<void()> task) const
+    {
+        d_queue_p->push_back(std::move(task));
+    }
+};
+
+template <typename F>
+dplp::ExecutorContinuation<F, QueuePoster> queued(
+                                     std::vector<std::function<void()> > *queue,
+                                     F                                    f)
+{
+    return dplp::ExecutorContinuation<F, QueuePoster>(std::move(f),
+                                                      QueuePoster{queue});
+}
+
+void runAll(std::vector<std::function<void()> > *queue)
+{
+    while (!queue->empty()) {
+        std::function<void()> task = std::move(queue->front());
+        queue->erase(queue->begin());
+        task();
+    }
+}
+}
+
+TEST(dplp_executorcontinuation, deferred)
+{
+    std::vector<std::function<void()> > queue;
+
+    int              result = 0;
+    dplp::Promise<>  p      = dplp::makeFulfilledPromise(3)
+                            .then(queued(&queue, [](int i) { return i + 1; }))
+                            .then([&](int i) { result = i; });
+    EXPECT_EQ(result, 0) << "Continuation wasn't deferred.";
+    EXPECT_EQ(queue.size(), 1u) << "Continuation wasn't posted.";
+    runAll(&queue);
+    EXPECT_EQ(result, 4) << "Unexpected value in fulfilled promise.";
+}
+
+TEST(dplp_executorcontinuation, result_types)
+{
+    std::vector<std::function<void()> > queue;
+    dplp::Promise<> p = dplp::makeFulfilledPromise();
+
+    bool            voidCalled = false;
+    dplp::Promise<> v = p.then(queued(&queue, [&] { voidCalled = true; }));
+
+    dplp::Promise<int, std::string> t = p.then(queued(
+        &queue, [] { return std::make_tuple(3, std::string("test")); }));
+
+    dplp::Promise<int> c = p.then(
+        queued(&queue, [] { return dplp::makeFulfilledPromise(5); }));
+
+    runAll(&queue);
+
+    EXPECT_TRUE(voidCalled) << "Continuation wasn't called.";
+
+    bool fulfilled = false;
+    t.then([&](int i, const std::string& s) {
+        fulfilled = i == 3 && s == "test";
+    });
+    EXPECT_TRUE(fulfilled) << "Tuple result wasn't unpacked.";
+
+    fulfilled = false;
+    c.then([&](int i) { fulfilled = i == 5; });
+    EXPECT_TRUE(fulfilled) << "Promise result wasn't chained.";
+}
+
+TEST(dplp_executorcontinuation, reject)
+{
+    std::vector<std::function<void()> > queue;
+
+    bool rejected = false;
+    dplp::makeFulfilledPromise()
+        .then(queued(&queue,
+                     []() -> int { throw std::runtime_error("error"); }))
+        .then([](int) { ADD_FAILURE() << "Unexpected fulfillment."; },
+              [&](std::exception_ptr) { rejected = true; });
+    runAll(&queue);
+    EXPECT_TRUE(rejected) << "Exception didn't reject the promise.";
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,306 @@
+#include <dplp_numaexecutor.h>
+
+#include <dplp_defaultresource.h>
+
+#include <condition_variable>  // std::condition_variable
+#include <cstdint>             // std::uintptr_t
+#include <deque>
+#include <map>
+#include <mutex>               // std::mutex, std::lock_guard
+#include <new>                 // std::bad_alloc
+#include <thread>              // std::thread
+
+#ifdef __linux__
+#include <pthread.h>      // pthread_setaffinity_np
+#include <sched.h>        // cpu_set_t
+#include <sys/mman.h>     // mmap, munmap
+#include <sys/syscall.h>  // SYS_mbind
+#include <unistd.h>       // syscall
+#endif
+
+namespace dplp {
+namespace {
+
+class NodeMemoryResource : public std::pmr::memory_resource {
+    // This class implements a memory resource that hands out whole pages
+    // bound to a particular NUMA node, and remembers which memory it handed
+    // out. It is intended as the upstream of a pool, which carves the pages
+    // into promise states.
+
+    int  d_osNode;
+    bool d_bind;  // 'false' for simulated nodes
+
+    mutable std::mutex                    d_mutex;
+    std::map<std::uintptr_t, std::size_t> d_regions;  // address to size
+
+    void *allocateRegion(std::size_t bytes, std::size_t alignment)
+    {
+#ifdef __linux__
+        if (d_bind) {
+            void *const result = mmap(nullptr,
+                                      bytes,
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS,
+                                      -1,
+                                      0);
+            if (result == MAP_FAILED)
+                throw std::bad_alloc();
+
+            // Prefer, rather than require, the node so that allocation still
+            // succeeds when the node's memory is exhausted. Failure to bind
+            // is not an error; the memory is merely remote.
+            const int     k_MPOL_PREFERRED = 1;
+            unsigned long nodeMask[16]     = {};
+            const int     k_BITS = 8 * sizeof(unsigned long);
+            if (d_osNode < 16 * k_BITS) {
+                nodeMask[d_osNode / k_BITS] = 1UL << (d_osNode % k_BITS);
+                syscall(SYS_mbind,
+                        result,
+                        bytes,
+                        k_MPOL_PREFERRED,
+                        nodeMask,
+                        16 * k_BITS,
+                        0);
+            }
+            return result;
+        }
+#endif
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void deallocateRegion(void *p, std::size_t bytes, std::size_t alignment)
+    {
+#ifdef __linux__
+        if (d_bind) {
+            munmap(p, bytes);
+            return;
+        }
+#endif
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void *const result = allocateRegion(bytes, alignment);
+        try {
+            const std::lock_guard<std::mutex> lock(d_mutex);
+            d_regions.emplace(reinterpret_cast<std::uintptr_t>(result), bytes);
+        }
+        catch (...) {
+            deallocateRegion(result, bytes, alignment);
+            throw;
+        }
+        return result;
+    }
+
+    void do_deallocate(void        *p,
+                       std::size_t  bytes,
+                       std::size_t  alignment) override
+    {
+        {
+            const std::lock_guard<std::mutex> lock(d_mutex);
+            d_regions.erase(reinterpret_cast<std::uintptr_t>(p));
+        }
+        deallocateRegion(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const
+                                                            noexcept override
+    {
+        return this == &other;
+    }
+
+  public:
+    NodeMemoryResource(int osNode, bool bind)
+    : d_osNode(osNode)
+    , d_bind(bind)
+    {
+    }
+
+    bool contains(const void *address) const
+        // Return 'true' if the specified 'address' is in memory allocated
+        // from this resource and not yet deallocated.
+    {
+        const std::uintptr_t value = reinterpret_cast<std::uintptr_t>(address);
+        const std::lock_guard<std::mutex> lock(d_mutex);
+        auto it = d_regions.upper_bound(value);
+        if (it == d_regions.begin())
+            return false;
+        --it;
+        return value - it->first < it->second;
+    }
+};
+
+void pinCurrentThread(const std::vector<int>& cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        if (0 <= cpu && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+
+    // Failure (e.g. due to a restricted cpuset) leaves the thread unpinned,
+    // which costs locality but not correctness.
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpus;
+#endif
+}
+}
+
+struct NumaExecutor::Node {
+    NodeMemoryResource                   d_upstream;
+    std::pmr::synchronized_pool_resource d_arena;
+
+    std::mutex                         d_mutex;
+    std::condition_variable            d_wakeup;
+    std::deque<std::function<void()> > d_queue;
+
+    std::vector<std::thread> d_threads;
+
+    Node(int osNode, bool bind)
+    : d_upstream(osNode, bind)
+    , d_arena(&d_upstream)
+    {
+    }
+};
+
+void NumaExecutor::workerMain(std::size_t node)
+{
+    Node& self = *d_nodes[node];
+
+    if (!d_topology.isSimulated())
+        pinCurrentThread(d_topology.cpusOfNode(node));
+
+    const dplp::DefaultResourceGuard guard(&self.d_arena);
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(self.d_mutex);
+            self.d_wakeup.wait(lock, [&] {
+                return !self.d_queue.empty() ||
+                       (d_stopping && d_pending == 0);
+            });
+            if (self.d_queue.empty())
+                return;
+            task = std::move(self.d_queue.front());
+            self.d_queue.pop_front();
+        }
+        task();
+        task = nullptr;
+
+        if (--d_pending == 0 && d_stopping)
+            wakeAll();
+    }
+}
+
+void NumaExecutor::wakeAll()
+{
+    // Note that each node's mutex must be acquired before notifying, or a
+    // worker could evaluate its wait predicate and then go to sleep after the
+    // notification.
+    for (auto& node : d_nodes) {
+        {
+            const std::lock_guard<std::mutex> lock(node->d_mutex);
+        }
+        node->d_wakeup.notify_all();
+    }
+}
+
+NumaExecutor::NumaExecutor(const NumaTopology& topology,
+                           std::size_t         threadsPerNode)
+: d_topology(topology)
+, d_nextNode(0)
+, d_pending(0)
+, d_stopping(false)
+{
+    for (std::size_t node = 0; node < d_topology.numNodes(); ++node)
+        d_nodes.emplace_back(new Node(d_topology.osNode(node),
+                                      !d_topology.isSimulated()));
+
+    for (std::size_t node = 0; node < d_topology.numNodes(); ++node) {
+        const std::size_t numThreads =
+            threadsPerNode ? threadsPerNode
+                           : d_topology.cpusOfNode(node).size();
+        for (std::size_t i = 0; i < numThreads; ++i)
+            d_nodes[node]->d_threads.emplace_back(
+                [this, node] { workerMain(node); });
+    }
+}
+
+NumaExecutor::~NumaExecutor()
+{
+    // Note that a task running on one node may post to another node, so no
+    // worker may exit until no tasks are pending on any node.
+    d_stopping = true;
+    wakeAll();
+    for (auto& node : d_nodes)
+        for (std::thread& thread : node->d_threads)
+            thread.join();
+}
+
+void NumaExecutor::post(std::function<void()> task, std::size_t node)
+{
+    if (node == k_ANY_NODE)
+        node = ownerNode();
+    if (node == k_ANY_NODE)
+        node = d_nextNode.fetch_add(1, std::memory_order_relaxed) %
+               d_nodes.size();
+
+    ++d_pending;
+
+    Node& target = *d_nodes[node];
+    {
+        const std::lock_guard<std::mutex> lock(target.d_mutex);
+        target.d_queue.push_back(std::move(task));
+    }
+    target.d_wakeup.notify_one();
+}
+
+std::pmr::memory_resource *NumaExecutor::arena(std::size_t node)
+{
+    return &d_nodes[node]->d_arena;
+}
+
+std::size_t NumaExecutor::nodeOf(const dplp::AnyPromiseHandle& promise) const
+{
+    if (const void *const state = promise.state()) {
+        for (std::size_t node = 0; node < d_nodes.size(); ++node)
+            if (d_nodes[node]->d_upstream.contains(state))
+                return node;
+    }
+    return k_ANY_NODE;
+}
+
+std::size_t NumaExecutor::ownerNode() const
+{
+    std::pmr::memory_resource *const current = dplp::DefaultResource::get();
+    for (std::size_t node = 0; node < d_nodes.size(); ++node)
+        if (current == &d_nodes[node]->d_arena)
+            return node;
+    return k_ANY_NODE;
+}
+
+std::size_t NumaExecutor::numNodes() const
+{
+    return d_nodes.size();
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,251 @@
+#ifndef INCLUDED_DPLP_NUMAEXECUTOR
+#define INCLUDED_DPLP_NUMAEXECUTOR
+
+//@PURPOSE: Provide an executor that keeps promise state and work node-local.
+//
+//@CLASSES:
+//  dplp::NumaExecutor: thread pool with a worker group per NUMA node
+//
+//@SEE_ALSO: dplp_numatopology, dplp_defaultresource, dplp_priorityexecutor
+//
+//@DESCRIPTION: This component provides a single class, 'dplp::NumaExecutor',
+// which is a thread pool that groups its workers by NUMA node so that promise
+// state is allocated, locked, and read by threads on a single node.
+//
+// For each node of its 'dplp::NumaTopology', the executor creates a group of
+// worker threads, a task queue shared by that group, and a memory resource
+// (the node's arena) whose memory is bound to the node. Each worker is pinned
+// to the CPUs of its node and installs its node's arena as the
+// 'dplp::DefaultResource' for its thread, so every promise created by code
+// running on a worker, including the promises created by 'then', has its
+// state allocated node-locally.
+//
+// The 'schedule' member function adapts a continuation so that it runs on the
+// node that owns promise state. Given the promise being continued, it looks up
+// the node whose arena holds that promise's state (see 'nodeOf'), so the
+// continuation runs, and the promises it creates are allocated, on the node
+// the state is on, whichever thread resolves it. Without a promise,
+// or if the promise's state is in none of the arenas, the node is the one
+// whose arena is the 'dplp::DefaultResource' of the thread calling 'schedule',
+// i.e. evaluating the 'then' expression. If that thread allocates from none of
+// them either, the node is chosen when the continuation is called in the same
+// way, and failing that, round-robin.
+//
+// If the topology is simulated (see 'dplp::NumaTopology::isSimulated'),
+// threads are not pinned and the arenas are not bound to a node, but tasks
+// and allocations are still grouped per simulated node.
+//
+// Note that the arenas are owned by the executor, so the executor must outlive
+// all the promises whose state was allocated on its workers.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Process requests on the node that received them
+///- - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Suppose each request is parsed on some worker and then goes through several
+// further stages. We want all the stages to stay on the parsing worker's node.
+//..
+//  dplp::NumaExecutor executor(dplp::NumaTopology::system());
+//
+//  executor.post([&] {
+//      // Running on some node 'N'. 'p''s state is allocated on 'N'.
+//      dplp::Promise<Request> p = parseRequestP();
+//
+//      // The continuation runs on a worker of node 'N' and the resulting
+//      // promise's state is also allocated on 'N'.
+//      p.then(executor.schedule([](const Request& r) { return handle(r); }));
+//  });
+//..
+// A promise created elsewhere, e.g. by a thread reading from the network, is
+// continued on the node its state was allocated on by passing it to
+// 'schedule'.
+//..
+//  dplp::Promise<Request> request = receiveRequestP();
+//  request.then(executor.schedule(request, [](const Request& r) {
+//      return handle(r);
+//  }));
+//..
+
+#include <dplp_anypromisehandle.h>
+#include <dplp_executorcontinuation.h>
+#include <dplp_numatopology.h>
+
+#include <atomic>           // std::atomic
+#include <cstddef>          // std::size_t
+#include <functional>       // std::function
+#include <memory>           // std::unique_ptr
+#include <memory_resource>  // std::pmr::memory_resource
+#include <type_traits>      // std::decay_t
+#include <utility>          // std::forward, std::move
+#include <vector>
+
+namespace dplp {
+
+class NumaExecutor {
+    // This class implements a thread pool with a group of workers, a FIFO task
+    // queue, and a memory arena per NUMA node.
+
+  public:
+    static constexpr std::size_t k_ANY_NODE = static_cast<std::size_t>(-1);
+        // A node argument meaning "any node".
+
+  private:
+    class Poster {
+        // This class posts tasks to a particular node of a 'NumaExecutor'.
+
+        NumaExecutor *d_executor_p;
+        std::size_t   d_node;
+
+      public:
+        Poster(NumaExecutor *executor, std::size_t node);
+            // Create a 'Poster' object that posts to the specified 'node' of
+            // the specified 'executor'.
+
+        void operator()(std::function<void()> task) const;
+            // Post the specified 'task'.
+    };
+
+    struct Node;
+        // The queue, arena, and threads of a node.
+
+    NumaTopology                        d_topology;
+    std::vector<std::unique_ptr<Node> > d_nodes;
+    std::atomic<std::size_t>            d_nextNode;
+
+    // 'd_pending' is the number of tasks that are queued or running on any
+    // node. Once 'd_stopping' is set, workers exit when it drops to 0.
+    std::atomic<std::size_t>            d_pending;
+    std::atomic<bool>                   d_stopping;
+
+    void wakeAll();
+        // Wake all the workers of all the nodes.
+
+    void workerMain(std::size_t node);
+        // Run tasks from the queue of the specified 'node' on the current
+        // thread until the executor is stopping and no task is queued or
+        // running on any node.
+
+  public:
+    explicit NumaExecutor(const NumaTopology& topology,
+                          std::size_t         threadsPerNode = 0);
+        // Create a 'NumaExecutor' object for the specified 'topology' with,
+        // for each node, the optionally specified 'threadsPerNode' worker
+        // threads or, if 'threadsPerNode' is 0, one worker per CPU of the
+        // node.
+
+    NumaExecutor(const NumaExecutor&) = delete;
+    NumaExecutor& operator=(const NumaExecutor&) = delete;
+
+    ~NumaExecutor();
+        // Run all the posted tasks, including tasks posted while doing so,
+        // and then join the worker threads. The behavior is undefined if this
+        // is called from one of the worker threads or if any promise state
+        // allocated from an arena of this executor still exists.
+
+    void post(std::function<void()> task, std::size_t node = k_ANY_NODE);
+        // Run the specified 'task' on a worker of the optionally specified
+        // 'node'. If 'node' is 'k_ANY_NODE', use 'ownerNode()' or, if that is
+        // also 'k_ANY_NODE', the next node in round-robin order. The behavior
+        // is undefined unless 'node < numNodes()' or 'node == k_ANY_NODE'.
+
+    template <typename F>
+    dplp::ExecutorContinuation<std::decay_t<F>, Poster> schedule(
+                                               F&&         f,
+                                               std::size_t node = k_ANY_NODE);
+        // Return a continuation function that, when called with arguments
+        // 'args...', posts a task calling the specified 'f' with 'args...' to
+        // the optionally specified 'node', and returns a promise for the
+        // result of that call. If 'node' is 'k_ANY_NODE', use 'ownerNode()'
+        // as evaluated by this call. See 'dplp_executorcontinuation' for
+        // details.
+
+    template <typename F>
+    dplp::ExecutorContinuation<std::decay_t<F>, Poster> schedule(
+                                        const dplp::AnyPromiseHandle& promise,
+                                        F&&                           f);
+        // Return 'schedule(f, nodeOf(promise))', i.e. a continuation of the
+        // specified 'promise' that posts a task calling the specified 'f' to
+        // the node whose arena holds the state of 'promise' or, if there is
+        // none, to 'ownerNode()' as evaluated by this call.
+
+    std::pmr::memory_resource *arena(std::size_t node);
+        // Return the memory resource that workers of the specified 'node'
+        // allocate promise state from. The behavior is undefined unless
+        // 'node < numNodes()'.
+
+    std::size_t nodeOf(const dplp::AnyPromiseHandle& promise) const;
+        // Return the node whose arena holds the state of the specified
+        // 'promise', or 'k_ANY_NODE' if it has no state or its state was
+        // allocated elsewhere.
+
+    std::size_t ownerNode() const;
+        // Return the node whose arena is the current thread's
+        // 'dplp::DefaultResource' or 'k_ANY_NODE' if there is none. Note that
+        // on a worker thread this is the worker's node.
+
+    std::size_t numNodes() const;
+        // Return the number of nodes.
+
+    const NumaTopology& topology() const;
+        // Return the topology this executor was created with.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+NumaExecutor::Poster::Poster(NumaExecutor *executor, std::size_t node)
+: d_executor_p(executor)
+, d_node(node)
+{
+}
+
+inline
+void NumaExecutor::Poster::operator()(std::function<void()> task) const
+{
+    d_executor_p->post(std::move(task), d_node);
+}
+
+template <typename F>
+dplp::ExecutorContinuation<std::decay_t<F>, NumaExecutor::Poster>
+NumaExecutor::schedule(F&& f, std::size_t node)
+{
+    return dplp::ExecutorContinuation<std::decay_t<F>, Poster>(
+        std::forward<F>(f),
+        Poster(this, node == k_ANY_NODE ? ownerNode() : node));
+}
+
+template <typename F>
+dplp::ExecutorContinuation<std::decay_t<F>, NumaExecutor::Poster>
+NumaExecutor::schedule(const dplp::AnyPromiseHandle& promise, F&& f)
+{
+    return schedule(std::forward<F>(f), nodeOf(promise));
+}
+
+inline
+const NumaTopology& NumaExecutor::topology() const
+{
+    return d_topology;
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,158 @@
+#include <dplp_numaexecutor.h>
+
+#include <dplp_defaultresource.h>
+#include <dplp_numatopology.h>
+#include <dplp_promise.h>
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+
+namespace {
+class Waiter {
+    // A helper that blocks until 'notify' is called 'count' times.
+    std::mutex              d_mutex;
+    std::condition_variable d_cv;
+    int                     d_count;
+
+  public:
+    explicit Waiter(int count)
+    : d_count(count)
+    {
+    }
+    void notify()
+    {
+        const std::lock_guard<std::mutex> lock(d_mutex);
+        if (--d_count == 0)
+            d_cv.notify_all();
+    }
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(d_mutex);
+        d_cv.wait(lock, [this] { return d_count == 0; });
+    }
+};
+}
+
+TEST(dplp_numaexecutor, post_to_node)
+{
+    dplp::NumaExecutor executor(dplp::NumaTopology({{0}, {1}}), 1);
+    ASSERT_EQ(executor.numNodes(), 2u);
+
+    std::size_t nodes[2] = {dplp::NumaExecutor::k_ANY_NODE,
+                            dplp::NumaExecutor::k_ANY_NODE};
+    std::pmr::memory_resource *resources[2] = {nullptr, nullptr};
+    Waiter                     waiter(2);
+    for (std::size_t node = 0; node < 2; ++node)
+        executor.post(
+            [&, node] {
+                nodes[node]     = executor.ownerNode();
+                resources[node] = dplp::DefaultResource::get();
+                waiter.notify();
+            },
+            node);
+    waiter.wait();
+
+    for (std::size_t node = 0; node < 2; ++node) {
+        EXPECT_EQ(nodes[node], node) << "Task ran on the wrong node.";
+        EXPECT_EQ(resources[node], executor.arena(node))
+            << "Worker doesn't allocate from its node's arena.";
+    }
+    EXPECT_EQ(executor.ownerNode(), dplp::NumaExecutor::k_ANY_NODE)
+        << "Non-worker thread has an owner node.";
+}
+
+TEST(dplp_numaexecutor, schedule_on_owner_node)
+{
+    dplp::NumaExecutor executor(dplp::NumaTopology({{0}, {1}}), 2);
+
+    // Build a chain on node 1. Its continuation must also run on node 1 even
+    // though the promise is fulfilled from a thread that is not a worker.
+    std::function<void(int)> fulfillLater;
+    std::size_t              ranOn = dplp::NumaExecutor::k_ANY_NODE;
+    Waiter                   built(1);
+    Waiter                   ran(1);
+    executor.post(
+        [&] {
+            dplp::Promise<int>([&](auto fulfill, auto) {
+                fulfillLater = fulfill;
+            })
+                .then(executor.schedule([&](int i) {
+                    ranOn = executor.ownerNode();
+                    return i;
+                }))
+                .then([&](int) { ran.notify(); });
+            built.notify();
+        },
+        1);
+    built.wait();
+
+    fulfillLater(3);
+    ran.wait();
+    EXPECT_EQ(ranOn, 1u) << "Continuation didn't run on the owner node.";
+}
+
+TEST(dplp_numaexecutor, schedule_on_state_node)
+{
+    dplp::NumaExecutor executor(dplp::NumaTopology({{0}, {1}}), 1);
+
+    // Create a promise on node 1 and continue it from a thread that is not a
+    // worker. The continuation must run on the node holding its state.
+    std::function<void(int)>            fulfillLater;
+    std::optional<dplp::Promise<int> > p;
+    Waiter                              built(1);
+    executor.post(
+        [&] {
+            p.emplace([&](auto fulfill, auto) { fulfillLater = fulfill; });
+            built.notify();
+        },
+        1);
+    built.wait();
+    EXPECT_EQ(executor.nodeOf(*p), 1u);
+    EXPECT_EQ(executor.nodeOf(dplp::Promise<int>([](auto, auto) {})),
+              dplp::NumaExecutor::k_ANY_NODE)
+        << "State allocated outside the arenas has a node.";
+    EXPECT_EQ(executor.nodeOf(dplp::makeFulfilledPromise(1)),
+              dplp::NumaExecutor::k_ANY_NODE);
+
+    std::size_t ranOn = dplp::NumaExecutor::k_ANY_NODE;
+    Waiter      ran(1);
+    const dplp::Promise<int> result =
+        p->then(executor.schedule(*p, [&](int i) {
+            ranOn = executor.ownerNode();
+            return i;
+        }));
+    result.then([&](int) { ran.notify(); });
+
+    fulfillLater(3);
+    ran.wait();
+    EXPECT_EQ(ranOn, 1u) << "Continuation didn't run on the state's node.";
+
+    fulfillLater = nullptr;
+    p.reset();
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
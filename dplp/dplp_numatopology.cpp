@@ -0,0 +1,160 @@
+#include <dplp_numatopology.h>
+
+#include <algorithm>  // std::find
+#include <cctype>     // std::isdigit
+#include <fstream>    // std::ifstream
+#include <thread>     // std::thread::hardware_concurrency
+#include <utility>    // std::move
+
+namespace dplp {
+namespace {
+
+bool readFirstLine(const std::string& path, std::string *line)
+{
+    std::ifstream file(path);
+    return file && std::getline(file, *line);
+}
+
+bool parseInt(const std::string& text, std::size_t *pos, int *result)
+{
+    const std::size_t begin = *pos;
+    int               value = 0;
+    while (*pos < text.size() &&
+           std::isdigit(static_cast<unsigned char>(text[*pos]))) {
+        value = value * 10 + (text[*pos] - '0');
+        ++*pos;
+    }
+    *result = value;
+    return *pos != begin;
+}
+}
+
+NumaTopology NumaTopology::system()
+{
+    std::vector<std::vector<int> > cpusPerNode;
+    std::vector<int>               osNodes;
+
+    // Node numbers may have gaps, e.g. after a node is taken offline, so the
+    // nodes are taken from the mask of online nodes, which has the same
+    // format as a CPU list. If it can't be read, the list stays empty.
+    std::string nodeList;
+    readFirstLine("/sys/devices/system/node/online", &nodeList);
+
+    for (int node : parseCpuList(nodeList)) {
+        std::string cpuList;
+        if (!readFirstLine("/sys/devices/system/node/node" +
+                               std::to_string(node) + "/cpulist",
+                           &cpuList))
+            continue;
+        std::vector<int> cpus = parseCpuList(cpuList);
+        if (cpus.empty())
+            continue;  // memory-only node
+        cpusPerNode.push_back(std::move(cpus));
+        osNodes.push_back(node);
+    }
+
+    if (cpusPerNode.empty()) {
+        std::vector<int> cpus;
+        const unsigned   numCpus = std::thread::hardware_concurrency();
+        for (unsigned cpu = 0; cpu < (numCpus ? numCpus : 1); ++cpu)
+            cpus.push_back(static_cast<int>(cpu));
+        cpusPerNode.push_back(std::move(cpus));
+        osNodes.push_back(0);
+    }
+
+    NumaTopology result(std::move(cpusPerNode));
+    result.d_osNodes   = std::move(osNodes);
+    result.d_simulated = false;
+    return result;
+}
+
+std::vector<int> NumaTopology::parseCpuList(const std::string& cpuList)
+{
+    std::vector<int> result;
+    std::size_t      pos = 0;
+
+    // Trailing whitespace, including the newline, is ignored.
+    std::size_t end = cpuList.find_last_not_of(" \t\n");
+    end             = end == std::string::npos ? 0 : end + 1;
+    const std::string text = cpuList.substr(0, end);
+
+    while (pos < text.size()) {
+        int first;
+        if (!parseInt(text, &pos, &first))
+            return std::vector<int>();
+        int last = first;
+        if (pos < text.size() && text[pos] == '-') {
+            ++pos;
+            if (!parseInt(text, &pos, &last) || last < first)
+                return std::vector<int>();
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+            result.push_back(cpu);
+        if (pos < text.size()) {
+            if (text[pos] != ',')
+                return std::vector<int>();
+            ++pos;
+        }
+    }
+    return result;
+}
+
+NumaTopology::NumaTopology(std::initializer_list<std::vector<int> > cpusPerNode)
+: NumaTopology(std::vector<std::vector<int> >(cpusPerNode))
+{
+}
+
+NumaTopology::NumaTopology(std::vector<std::vector<int> > cpusPerNode)
+: d_cpusPerNode(std::move(cpusPerNode))
+, d_simulated(true)
+{
+    for (std::size_t node = 0; node < d_cpusPerNode.size(); ++node)
+        d_osNodes.push_back(static_cast<int>(node));
+}
+
+std::size_t NumaTopology::numNodes() const
+{
+    return d_cpusPerNode.size();
+}
+
+const std::vector<int>& NumaTopology::cpusOfNode(std::size_t node) const
+{
+    return d_cpusPerNode[node];
+}
+
+int NumaTopology::osNode(std::size_t node) const
+{
+    return d_osNodes[node];
+}
+
+int NumaTopology::nodeOfCpu(int cpu) const
+{
+    for (std::size_t node = 0; node < d_cpusPerNode.size(); ++node) {
+        const std::vector<int>& cpus = d_cpusPerNode[node];
+        if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end())
+            return static_cast<int>(node);
+    }
+    return -1;
+}
+
+bool NumaTopology::isSimulated() const
+{
+    return d_simulated;
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
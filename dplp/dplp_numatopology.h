@@ -0,0 +1,111 @@
+#ifndef INCLUDED_DPLP_NUMATOPOLOGY
+#define INCLUDED_DPLP_NUMATOPOLOGY
+
+//@PURPOSE: Provide a description of the machine's NUMA nodes.
+//
+//@CLASSES:
+//  dplp::NumaTopology: the CPUs belonging to each NUMA node
+//
+//@SEE_ALSO: dplp_numaexecutor
+//
+//@DESCRIPTION: This component provides a single value-semantic class,
+// 'dplp::NumaTopology', which lists the NUMA nodes of a machine and the CPUs
+// that belong to each of them.
+//
+// The topology of the current machine is obtained with
+// 'dplp::NumaTopology::system', which reads the online nodes and their CPUs
+// from '/sys/devices/system/node' on Linux. Nodes without CPUs are omitted and
+// online nodes need not be numbered contiguously, so node indices are not
+// necessarily the operating system's node identifiers (see 'osNode'). If the
+// information is unavailable, 'system' returns a single node containing every
+// CPU.
+//
+// A topology can also be constructed directly from a list of CPU lists. Such
+// a topology is "simulated", meaning it need not describe the current machine.
+// Components that act on a topology, such as 'dplp::NumaExecutor', still group
+// their threads per simulated node but do not pin threads or bind memory. This
+// allows multi-node behavior to be tested on a single-node machine.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Simulate a dual-socket machine
+///- - - - - - - - - - - - - - - - - - - - -
+// A test can describe two nodes of two CPUs each:
+//..
+//  dplp::NumaTopology topology({{0, 1}, {2, 3}});
+//  assert(topology.numNodes() == 2);
+//  assert(topology.nodeOfCpu(3) == 1);
+//  assert(topology.isSimulated());
+//..
+
+#include <cstddef>           // std::size_t
+#include <initializer_list>  // std::initializer_list
+#include <string>
+#include <vector>
+
+namespace dplp {
+
+class NumaTopology {
+    // This class implements a value semantic type listing the CPUs of each
+    // NUMA node of a machine.
+
+    std::vector<std::vector<int> > d_cpusPerNode;
+    std::vector<int>               d_osNodes;  // operating system node ids
+    bool                           d_simulated;
+
+  public:
+    static NumaTopology system();
+        // Return the topology of the current machine.
+
+    static std::vector<int> parseCpuList(const std::string& cpuList);
+        // Return the CPUs listed in the specified 'cpuList', which is in the
+        // Linux "cpulist" format (e.g. '0-3,8,10-11'). Return an empty vector
+        // if 'cpuList' is not well formed.
+
+    NumaTopology(std::initializer_list<std::vector<int> > cpusPerNode);
+    explicit NumaTopology(std::vector<std::vector<int> > cpusPerNode);
+        // Create a simulated 'NumaTopology' object where node 'i' has the CPUs
+        // in the specified 'cpusPerNode[i]'. The behavior is undefined unless
+        // there is at least one node and every node has at least one CPU.
+
+    std::size_t numNodes() const;
+        // Return the number of nodes.
+
+    const std::vector<int>& cpusOfNode(std::size_t node) const;
+        // Return the CPUs of the specified 'node'. The behavior is undefined
+        // unless 'node < numNodes()'.
+
+    int osNode(std::size_t node) const;
+        // Return the operating system's identifier for the specified 'node'.
+        // For a simulated topology this is 'node'. The behavior is undefined
+        // unless 'node < numNodes()'.
+
+    int nodeOfCpu(int cpu) const;
+        // Return the node containing the specified 'cpu' or -1 if no node
+        // contains it.
+
+    bool isSimulated() const;
+        // Return 'true' if this object was constructed directly instead of
+        // being obtained from 'system' and 'false' otherwise.
+};
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
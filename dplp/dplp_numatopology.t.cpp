@@ -0,0 +1,65 @@
+#include <dplp_numatopology.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(dplp_numatopology, parse_cpu_list)
+{
+    EXPECT_EQ(dplp::NumaTopology::parseCpuList("0-3,8,10-11\n"),
+              (std::vector<int>{0, 1, 2, 3, 8, 10, 11}))
+        << "Unexpected parse result.";
+    EXPECT_EQ(dplp::NumaTopology::parseCpuList("5"), (std::vector<int>{5}))
+        << "Unexpected parse result.";
+    EXPECT_TRUE(dplp::NumaTopology::parseCpuList("").empty())
+        << "Empty list not parsed as empty.";
+    EXPECT_TRUE(dplp::NumaTopology::parseCpuList("3-1").empty())
+        << "Malformed list accepted.";
+    EXPECT_TRUE(dplp::NumaTopology::parseCpuList("1,,2").empty())
+        << "Malformed list accepted.";
+}
+
+TEST(dplp_numatopology, simulated)
+{
+    dplp::NumaTopology topology({{0, 1}, {2, 3}});
+    EXPECT_TRUE(topology.isSimulated()) << "Topology not simulated.";
+    EXPECT_EQ(topology.numNodes(), 2u) << "Unexpected number of nodes.";
+    EXPECT_EQ(topology.cpusOfNode(1), (std::vector<int>{2, 3}))
+        << "Unexpected CPUs.";
+    EXPECT_EQ(topology.nodeOfCpu(0), 0) << "Unexpected node.";
+    EXPECT_EQ(topology.nodeOfCpu(3), 1) << "Unexpected node.";
+    EXPECT_EQ(topology.nodeOfCpu(4), -1) << "Unexpected node.";
+    EXPECT_EQ(topology.osNode(1), 1) << "Unexpected OS node.";
+}
+
+TEST(dplp_numatopology, system)
+{
+    dplp::NumaTopology topology = dplp::NumaTopology::system();
+    EXPECT_FALSE(topology.isSimulated()) << "System topology is simulated.";
+    ASSERT_GE(topology.numNodes(), 1u) << "No nodes found.";
+    for (std::size_t node = 0; node < topology.numNodes(); ++node)
+        EXPECT_FALSE(topology.cpusOfNode(node).empty())
+            << "Node without CPUs.";
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
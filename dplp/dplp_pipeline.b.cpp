@@ -0,0 +1,66 @@
+#include <dplp_pipeline.h>
+
+#include <dplp_promise.h>
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+
+// These benchmarks compare a chain of three 'then' calls with the equivalent
+// three-stage pipeline. In both cases the continuations are attached while
+// the source promise is waiting and run when it is fulfilled.
+
+namespace {
+dplp::Promise<int> waitingPromise(std::function<void(int)> *fulfill)
+{
+    return dplp::Promise<int>([fulfill](auto f, auto) { *fulfill = f; });
+}
+}
+
+static void BM_ThenChain(benchmark::State& state)
+{
+    for (auto _ : state) {
+        std::function<void(int)> fulfill;
+        int                      result = 0;
+        waitingPromise(&fulfill)
+            .then([](int i) { return i + 1; })
+            .then([](int i) { return i * 2; })
+            .then([&](int i) { result = i; });
+        fulfill(1);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_ThenChain);
+
+static void BM_Pipeline(benchmark::State& state)
+{
+    for (auto _ : state) {
+        std::function<void(int)> fulfill;
+        int                      result = 0;
+        dplp::Promise<> done = waitingPromise(&fulfill)
+                             | dplp::then([](int i) { return i + 1; })
+                             | dplp::then([](int i) { return i * 2; })
+                             | dplp::then([&](int i) { result = i; });
+        fulfill(1);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_Pipeline);
+
+BENCHMARK_MAIN();
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,307 @@
+#ifndef INCLUDED_DPLP_PIPELINE
+#define INCLUDED_DPLP_PIPELINE
+
+//@PURPOSE: Provide lazily composed continuation pipelines over promises.
+//
+//@CLASSES:
+//  dplp::Pipeline: a promise with statically composed pending continuations
+//  dplp::PipelineStage: a continuation waiting to be composed into a pipeline
+//  dplp::Pipeline_Composed: the composition of two continuations
+//  dplp::Pipeline_Util: functions composing pipeline stages
+//
+//@FREE_FUNCTIONS:
+//  dplp::then: create a pipeline stage
+//  dplp::operator|: append a stage to a promise or pipeline
+//
+//@SEE_ALSO: dplp_promise
+//
+//@DESCRIPTION: This component provides an alternative to chaining
+// 'dplp::Promise::then' calls that composes the continuations at compile time.
+// Each call to 'then' allocates a promise state and stores the continuation
+// in a 'std::function'. For a chain like 'p.then(a).then(b).then(c)', that is
+// three states and three type-erased continuations, although the intermediate
+// promises are never observed.
+//
+// A pipeline is written 'p | dplp::then(a) | dplp::then(b) | dplp::then(c)'.
+// Applying '|' to a promise and a 'dplp::PipelineStage' results in a
+// 'dplp::Pipeline', and applying '|' to a pipeline and a stage results in
+// another pipeline. Nothing is attached to 'p' until the pipeline is converted
+// to a promise, either implicitly or with its 'promise' member function. At
+// that point the stages, fused into a single statically typed function, are
+// passed to one call of 'p.then'. A chain of any length therefore costs one
+// promise state and one type erasure. A pipeline that is destroyed without
+// being converted has no effect.
+//
+// The result of each stage is passed to the next one using the same rules
+// 'dplp::Promise::then' uses to compute the type of its result (see
+// 'dplp_promise'): a stage returning 'void' is followed by a stage taking no
+// arguments, a stage returning 'std::tuple<T...>' is followed by a stage
+// taking 'T...', and a stage returning any other 'T' is followed by a stage
+// taking 'T'. As a result, the pipeline converts to the same promise type as
+// the equivalent chain of 'then' calls.
+//
+// A stage returning a 'dplp::Promise' cannot be fused with the stages after
+// it, since their input is not available until that promise is resolved. The
+// remaining stages, fused with each other, are attached to that promise, with
+// one 'then', when the stage returns it. To that end, a stage appended to a
+// pipeline is composed with the last stage rather than with the composition
+// of all the stages before it.
+//
+// If 'p' is rejected or any stage throws, the resulting promise is rejected
+// and the subsequent stages are skipped.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Parse, validate, and enrich a request
+///- - - - - - - - - - - - - - - - - - - - - - - - -
+// Suppose a request goes through three synchronous stages after it arrives.
+//..
+//  dplp::Promise<Response> response = receiveP()
+//                                   | dplp::then(parse)
+//                                   | dplp::then(validate)
+//                                   | dplp::then(enrich);
+//..
+// Only 'response' has a state of its own. Had we written
+// 'receiveP().then(parse).then(validate).then(enrich)', two more states would
+// have been created and resolved.
+
+#include <dplmrts_anytuple.h>
+#include <dplp_anypromise.h>
+#include <dplp_promise.h>
+
+#include <functional>   // std::invoke
+#include <tuple>        // std::apply
+#include <type_traits>  // std::decay_t, std::is_void
+#include <utility>      // std::declval, std::forward, std::move
+
+namespace dplp {
+
+template <typename Source, typename F>
+class Pipeline;
+
+template <typename F, typename G>
+class Pipeline_Composed {
+    // This class implements a function object that calls 'G' with the result
+    // of calling 'F', according to the rules 'dplp::Promise::then' uses.
+
+    F d_first;
+    G d_second;
+
+  public:
+    Pipeline_Composed(F first, G second);
+        // Create a 'Pipeline_Composed' object calling the specified 'second'
+        // with the result of the specified 'first'.
+
+    template <typename... Args>
+    decltype(auto) operator()(Args&&... args);
+        // Call the first function with the specified 'args' and return the
+        // result of calling the second function with its result.
+
+    template <typename H>
+    auto append(H third) &&;
+        // Return a function object calling the first function, then the
+        // second function, then the specified 'third', where the second and
+        // 'third' functions are composed with each other. This object is left
+        // in a valid but unspecified state.
+};
+
+struct Pipeline_Util {
+    // This 'struct' provides a namespace for functions composing pipeline
+    // stages.
+
+    template <typename F, typename G>
+    static Pipeline_Composed<F, G> append(F first, G second);
+    template <typename F1, typename F2, typename G>
+    static auto append(Pipeline_Composed<F1, F2> first, G second);
+        // Return a function object calling the specified 'second' with the
+        // result of the specified 'first'. If 'first' is itself a
+        // composition, 'second' is composed with its last function instead.
+};
+
+template <typename F>
+class PipelineStage {
+    // This class holds a continuation until it is appended to a pipeline.
+
+    F d_function;
+
+    template <typename Source, typename G>
+    friend class Pipeline;
+
+    template <typename... Types, typename G>
+    friend Pipeline<dplp::Promise<Types...>, G> operator|(
+                                        const dplp::Promise<Types...>& source,
+                                        PipelineStage<G>               stage);
+
+  public:
+    explicit PipelineStage(F function);
+        // Create a 'PipelineStage' object holding the specified 'function'.
+};
+
+template <typename Source, typename F>
+class Pipeline {
+    // This class implements a promise together with a continuation, composed
+    // of one or more stages, that has not been attached to it yet.
+
+    Source d_source;
+    F      d_function;
+
+  public:
+    using PromiseType =
+        decltype(std::declval<const Source&>().then(std::declval<F>()));
+        // The type of promise this pipeline converts to.
+
+    Pipeline(Source source, F function);
+        // Create a 'Pipeline' object that attaches the specified 'function'
+        // to the specified 'source' when it is converted to a promise.
+
+    template <typename G>
+    auto operator|(PipelineStage<G> stage) &&;
+        // Return a pipeline that, in addition to the stages of this one, runs
+        // the specified 'stage' with their result. This object is left in a
+        // valid but unspecified state.
+
+    PromiseType promise() &&;
+    operator PromiseType() &&;
+        // Attach the composed stages to the source promise and return the
+        // resulting promise. This object is left in a valid but unspecified
+        // state.
+};
+
+template <typename F>
+PipelineStage<std::decay_t<F> > then(F&& function);
+    // Return a pipeline stage calling the specified 'function'.
+
+template <typename... Types, typename F>
+Pipeline<dplp::Promise<Types...>, F> operator|(
+                                        const dplp::Promise<Types...>& source,
+                                        PipelineStage<F>               stage);
+    // Return a pipeline attaching the specified 'stage' to the specified
+    // 'source' when it is converted to a promise.
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+template <typename F, typename G>
+Pipeline_Composed<F, G>::Pipeline_Composed(F first, G second)
+: d_first(std::move(first))
+, d_second(std::move(second))
+{
+}
+
+template <typename F, typename G>
+template <typename... Args>
+decltype(auto) Pipeline_Composed<F, G>::operator()(Args&&... args)
+{
+    using R = decltype(std::invoke(d_first, std::forward<Args>(args)...));
+
+    if constexpr (std::is_void<R>::value) {
+        std::invoke(d_first, std::forward<Args>(args)...);
+        return std::invoke(d_second);
+    }
+    else if constexpr (dplmrts::AnyTuple<R>) {
+        return std::apply(d_second,
+                          std::invoke(d_first, std::forward<Args>(args)...));
+    }
+    else if constexpr (dplp::AnyPromise<R>) {
+        // The remaining stages can only run once the promise is resolved.
+        return std::invoke(d_first, std::forward<Args>(args)...)
+            .then(d_second);
+    }
+    else {
+        return std::invoke(d_second,
+                           std::invoke(d_first, std::forward<Args>(args)...));
+    }
+}
+
+template <typename F, typename G>
+template <typename H>
+auto Pipeline_Composed<F, G>::append(H third) &&
+{
+    auto second = Pipeline_Util::append(std::move(d_second), std::move(third));
+    return Pipeline_Composed<F, decltype(second)>(std::move(d_first),
+                                                  std::move(second));
+}
+
+template <typename F, typename G>
+Pipeline_Composed<F, G> Pipeline_Util::append(F first, G second)
+{
+    return Pipeline_Composed<F, G>(std::move(first), std::move(second));
+}
+
+template <typename F1, typename F2, typename G>
+auto Pipeline_Util::append(Pipeline_Composed<F1, F2> first, G second)
+{
+    return std::move(first).append(std::move(second));
+}
+
+template <typename F>
+PipelineStage<F>::PipelineStage(F function)
+: d_function(std::move(function))
+{
+}
+
+template <typename Source, typename F>
+Pipeline<Source, F>::Pipeline(Source source, F function)
+: d_source(std::move(source))
+, d_function(std::move(function))
+{
+}
+
+template <typename Source, typename F>
+template <typename G>
+auto Pipeline<Source, F>::operator|(PipelineStage<G> stage) &&
+{
+    auto function = Pipeline_Util::append(std::move(d_function),
+                                          std::move(stage.d_function));
+    return Pipeline<Source, decltype(function)>(std::move(d_source),
+                                                std::move(function));
+}
+
+template <typename Source, typename F>
+typename Pipeline<Source, F>::PromiseType Pipeline<Source, F>::promise() &&
+{
+    return d_source.then(std::move(d_function));
+}
+
+template <typename Source, typename F>
+Pipeline<Source, F>::operator PromiseType() &&
+{
+    return std::move(*this).promise();
+}
+
+template <typename F>
+PipelineStage<std::decay_t<F> > then(F&& function)
+{
+    return PipelineStage<std::decay_t<F> >(std::forward<F>(function));
+}
+
+template <typename... Types, typename F>
+Pipeline<dplp::Promise<Types...>, F> operator|(
+                                        const dplp::Promise<Types...>& source,
+                                        PipelineStage<F>               stage)
+{
+    return Pipeline<dplp::Promise<Types...>, F>(source,
+                                                std::move(stage.d_function));
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,207 @@
+#include <dplp_pipeline.h>
+
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+namespace {
+dplp::Promise<int> waitingPromise(std::function<void(int)> *fulfill)
+{
+    return dplp::Promise<int>([fulfill](auto f, auto) { *fulfill = f; });
+}
+}
+
+TEST(dplp_pipeline, value_stages)
+{
+    std::function<void(int)> fulfill;
+
+    dplp::Promise<std::string> result = waitingPromise(&fulfill)
+                                      | dplp::then([](int i) { return i + 1; })
+                                      | dplp::then([](int i) { return i * 2; })
+                                      | dplp::then([](int i) {
+                                            return std::to_string(i);
+                                        });
+    std::string value;
+    result.then([&](std::string s) { value = s; });
+    EXPECT_EQ(value, "") << "Pipeline ran before the source was fulfilled.";
+
+    fulfill(3);
+    EXPECT_EQ(value, "8");
+}
+
+TEST(dplp_pipeline, result_types)
+{
+    // The pipeline converts to the same type as the equivalent 'then' chain.
+    dplp::Promise<int> p = dplp::makeFulfilledPromise(1);
+
+    auto tuplePipeline = p | dplp::then([](int i) {
+                             return std::make_tuple(i, std::string("a"));
+                         })
+                         | dplp::then([](int i, std::string s) {
+                               return std::make_tuple(s, i);
+                           });
+    static_assert(std::is_same<decltype(tuplePipeline)::PromiseType,
+                               dplp::Promise<std::string, int> >::value,
+                  "");
+
+    auto voidPipeline = p | dplp::then([](int) {}) | dplp::then([] {});
+    static_assert(std::is_same<decltype(voidPipeline)::PromiseType,
+                               dplp::Promise<> >::value,
+                  "");
+
+    std::string s;
+    int         i = 0;
+    std::move(tuplePipeline).promise().then([&](std::string s2, int i2) {
+        s = s2;
+        i = i2;
+    });
+    EXPECT_EQ(s, "a");
+    EXPECT_EQ(i, 1);
+
+    bool called = false;
+    dplp::Promise<> done = std::move(voidPipeline);
+    done.then([&] { called = true; });
+    EXPECT_TRUE(called);
+}
+
+TEST(dplp_pipeline, promise_stage)
+{
+    std::function<void(int)> fulfillInner;
+
+    int value = 0;
+    dplp::Promise<> result =
+        dplp::makeFulfilledPromise(2)
+        | dplp::then([](int i) { return i + 1; })
+        | dplp::then([&](int) { return waitingPromise(&fulfillInner); })
+        | dplp::then([](int i) { return i * 10; })
+        | dplp::then([&](int i) { value = i; });
+
+    EXPECT_EQ(value, 0);
+    fulfillInner(4);
+    EXPECT_EQ(value, 40);
+}
+
+TEST(dplp_pipeline, rejection)
+{
+    int numCalls = 0;
+
+    bool rejected = false;
+    (dplp::makeRejectedPromise<int>(
+         std::make_exception_ptr(std::runtime_error("source")))
+     | dplp::then([&](int i) { ++numCalls; return i; }))
+        .promise()
+        .then([](int) {}, [&](std::exception_ptr) { rejected = true; });
+    EXPECT_TRUE(rejected);
+    EXPECT_EQ(numCalls, 0);
+
+    rejected = false;
+    (dplp::makeFulfilledPromise(1)
+     | dplp::then([](int) -> int { throw std::runtime_error("stage"); })
+     | dplp::then([&](int i) { ++numCalls; return i; }))
+        .promise()
+        .then([](int) {}, [&](std::exception_ptr) { rejected = true; });
+    EXPECT_TRUE(rejected);
+    EXPECT_EQ(numCalls, 0) << "Stage after a throwing stage was called.";
+}
+
+TEST(dplp_pipeline, lazy)
+{
+    int numCalls = 0;
+    {
+        auto pipeline = dplp::makeFulfilledPromise(1)
+                        | dplp::then([&](int i) { ++numCalls; return i; });
+        (void)pipeline;
+    }
+    EXPECT_EQ(numCalls, 0) << "Unconverted pipeline ran.";
+}
+
+TEST(dplp_pipeline, one_state)
+{
+    // The resource outlives 'source', whose continuation holds the state of
+    // the result.
+    dplp::TestUtil::CountingResource resource;
+    std::function<void(int)>         fulfill;
+    dplp::Promise<int>               source = waitingPromise(&fulfill);
+    {
+        dplp::DefaultResourceGuard guard(&resource);
+        dplp::Promise<int> result = source
+                                  | dplp::then([](int i) { return i + 1; })
+                                  | dplp::then([](int i) { return i + 1; })
+                                  | dplp::then([](int i) { return i + 1; });
+    }
+
+    // Only the result has a state. Note that the continuation list of
+    // 'source' is allocated from the resource 'source' was created with.
+    EXPECT_EQ(resource.numAllocations(), 1);
+}
+
+TEST(dplp_pipeline, one_state_after_promise_stage)
+{
+    // The stages after a promise-returning stage are attached to its promise
+    // with one 'then', however many of them there are.
+    // The resources outlive 'fulfillInner', which holds the states
+    // allocated from them.
+    dplp::TestUtil::CountingResource oneStageResource;
+    dplp::TestUtil::CountingResource threeStageResource;
+    std::function<void(int)>         fulfillInner;
+
+    const auto innerStage = [&](int) { return waitingPromise(&fulfillInner); };
+    const auto increment  = [](int i) { return i + 1; };
+
+    int oneStageValue = 0;
+    {
+        dplp::DefaultResourceGuard guard(&oneStageResource);
+        dplp::Promise<int> result = dplp::makeFulfilledPromise(1)
+                                  | dplp::then(innerStage)
+                                  | dplp::then(increment);
+        result.then([&](int i) { oneStageValue = i; });
+        fulfillInner(1);
+    }
+
+    int threeStageValue = 0;
+    {
+        dplp::DefaultResourceGuard guard(&threeStageResource);
+        dplp::Promise<int> result = dplp::makeFulfilledPromise(1)
+                                  | dplp::then(innerStage)
+                                  | dplp::then(increment)
+                                  | dplp::then(increment)
+                                  | dplp::then(increment);
+        result.then([&](int i) { threeStageValue = i; });
+        fulfillInner(1);
+    }
+
+    EXPECT_EQ(oneStageValue, 2);
+    EXPECT_EQ(threeStageValue, 4);
+    EXPECT_EQ(threeStageResource.numAllocations(),
+              oneStageResource.numAllocations());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,131 @@
+#include <dplp_priorityexecutor.h>
+
+#include <dplp_promise.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// This benchmark measures the latency of short, latency-critical continuation
+// chains while the executor is saturated with background work. The argument
+// selects whether the chains are scheduled at 'e_HIGH' priority (1) or at the
+// same 'e_LOW' priority as the background work (0), which is equivalent to a
+// plain FIFO executor.
+
+namespace {
+using Executor = dplp::PriorityExecutor;
+using Clock    = Executor::Clock;
+
+const int k_NUM_WORKERS      = 2;
+const int k_BACKGROUND_DEPTH = 64;  // background tasks kept queued
+const int k_CHAIN_LENGTH     = 3;
+
+void spin(std::chrono::microseconds duration)
+{
+    const Clock::time_point end = Clock::now() + duration;
+    while (Clock::now() < end) {
+    }
+}
+
+double percentile(std::vector<double> samples, double p)
+{
+    if (samples.empty())
+        return 0;
+    const std::size_t index =
+        std::min(samples.size() - 1,
+                 static_cast<std::size_t>(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+}
+
+static void BM_ChainLatencyUnderLoad(benchmark::State& state)
+{
+    const Executor::Priority priority =
+        state.range(0) ? Executor::e_HIGH : Executor::e_LOW;
+
+    Executor          executor(k_NUM_WORKERS);
+    std::atomic<int>  queued(0);
+    std::atomic<bool> stop(false);
+
+    // Keep the executor saturated with background tasks.
+    std::thread feeder([&] {
+        while (!stop) {
+            if (queued < k_BACKGROUND_DEPTH) {
+                ++queued;
+                executor.post(
+                    [&] {
+                        spin(std::chrono::microseconds(20));
+                        --queued;
+                    },
+                    Executor::e_LOW);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<double> latencies;
+    for (auto _ : state) {
+        std::mutex              mutex;
+        std::condition_variable cv;
+        bool                    done = false;
+
+        const Clock::time_point start = Clock::now();
+
+        dplp::Promise<int> chain = dplp::makeFulfilledPromise(0);
+        for (int i = 0; i < k_CHAIN_LENGTH; ++i)
+            chain = chain.then(
+                executor.schedule([](int value) { return value + 1; },
+                                  priority));
+        chain.then([&](int) {
+            const std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            cv.notify_one();
+        });
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return done; });
+
+        latencies.push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - start)
+                .count());
+    }
+
+    stop = true;
+    feeder.join();
+
+    state.counters["p50_us"] = percentile(latencies, 0.50);
+    state.counters["p99_us"] = percentile(latencies, 0.99);
+}
+BENCHMARK(BM_ChainLatencyUnderLoad)
+    ->ArgName("high")
+    ->Arg(0)
+    ->Arg(1)
+    ->Iterations(2000)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,182 @@
+#include <dplp_priorityexecutor.h>
+
+#include <algorithm>  // std::push_heap, std::pop_heap
+
+namespace dplp {
+namespace {
+
+// The executor and worker index of the current thread if it is a worker of a
+// 'PriorityExecutor' and null otherwise.
+thread_local const PriorityExecutor *currentExecutor = nullptr;
+thread_local std::size_t             currentWorkerIndex = 0;
+}
+
+bool PriorityExecutor::moreUrgent(const Task& lhs, const Task& rhs)
+{
+    if (lhs.d_priority != rhs.d_priority)
+        return lhs.d_priority < rhs.d_priority;
+    if (lhs.d_deadline != rhs.d_deadline)
+        return lhs.d_deadline < rhs.d_deadline;
+    return lhs.d_sequence < rhs.d_sequence;
+}
+
+bool PriorityExecutor::popTask(std::size_t workerIndex, Task *result)
+{
+    // Note that the heap functions put the "greatest" element at the front
+    // so the comparison is reversed.
+    const auto lessUrgent = [](const Task& lhs, const Task& rhs) {
+        return moreUrgent(rhs, lhs);
+    };
+
+    {
+        Worker&                           self = *d_workers[workerIndex];
+        const std::lock_guard<std::mutex> lock(self.d_mutex);
+        if (!self.d_heap.empty()) {
+            std::pop_heap(self.d_heap.begin(), self.d_heap.end(), lessUrgent);
+            *result = std::move(self.d_heap.back());
+            self.d_heap.pop_back();
+            --d_pending;
+            return true;
+        }
+    }
+
+    // Our queue is empty. Find the victim with the most urgent task. Note
+    // that the victim's front may change between this scan and the steal
+    // below, in which case we take whatever is at the front by then.
+    bool        found = false;
+    Task        bestKey;  // only the ordering members are set
+    std::size_t victim = 0;
+    for (std::size_t i = 0; i < d_workers.size(); ++i) {
+        if (i == workerIndex)
+            continue;
+        Worker&                           other = *d_workers[i];
+        const std::lock_guard<std::mutex> lock(other.d_mutex);
+        if (!other.d_heap.empty() &&
+            (!found || moreUrgent(other.d_heap.front(), bestKey))) {
+            bestKey.d_priority = other.d_heap.front().d_priority;
+            bestKey.d_deadline = other.d_heap.front().d_deadline;
+            bestKey.d_sequence = other.d_heap.front().d_sequence;
+            found              = true;
+            victim             = i;
+        }
+    }
+    if (!found)
+        return false;
+
+    Worker&                           other = *d_workers[victim];
+    const std::lock_guard<std::mutex> lock(other.d_mutex);
+    if (other.d_heap.empty())
+        return false;
+    std::pop_heap(other.d_heap.begin(), other.d_heap.end(), lessUrgent);
+    *result = std::move(other.d_heap.back());
+    other.d_heap.pop_back();
+    --d_pending;
+    return true;
+}
+
+void PriorityExecutor::workerMain(std::size_t workerIndex)
+{
+    currentExecutor    = this;
+    currentWorkerIndex = workerIndex;
+
+    Task task;
+    while (true) {
+        if (popTask(workerIndex, &task)) {
+            task.d_function();
+            task.d_function = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(d_wakeupMutex);
+        if (d_stopping && d_pending == 0)
+            break;
+        d_wakeup.wait(lock, [this] { return d_pending != 0 || d_stopping; });
+    }
+
+    currentExecutor = nullptr;
+}
+
+PriorityExecutor::PriorityExecutor(std::size_t numWorkers)
+: d_nextWorker(0)
+, d_nextSequence(0)
+, d_pending(0)
+, d_stopping(false)
+{
+    for (std::size_t i = 0; i < numWorkers; ++i)
+        d_workers.emplace_back(new Worker());
+
+    // Start the threads only after all the workers exist since any thread may
+    // steal from any worker.
+    for (std::size_t i = 0; i < numWorkers; ++i)
+        d_workers[i]->d_thread = std::thread([this, i] { workerMain(i); });
+}
+
+PriorityExecutor::~PriorityExecutor()
+{
+    {
+        const std::lock_guard<std::mutex> lock(d_wakeupMutex);
+        d_stopping = true;
+    }
+    d_wakeup.notify_all();
+    for (auto& worker : d_workers)
+        worker->d_thread.join();
+}
+
+void PriorityExecutor::post(std::function<void()> task, Priority priority)
+{
+    post(std::move(task), Clock::now(), priority);
+}
+
+void PriorityExecutor::post(std::function<void()> task,
+                            Clock::time_point     deadline,
+                            Priority              priority)
+{
+    const std::size_t workerIndex =
+        currentExecutor == this
+            ? currentWorkerIndex
+            : d_nextWorker.fetch_add(1, std::memory_order_relaxed) %
+                  d_workers.size();
+
+    // Note that 'd_pending' changes together with a heap, under its mutex, so
+    // that a worker woken by a non-zero count finds the task rather than
+    // spinning until it is pushed, and that 'd_wakeupMutex' must be acquired
+    // between the increment and notifying, or a worker could check
+    // 'd_pending' and then go to sleep after our notification.
+    Worker& worker = *d_workers[workerIndex];
+    {
+        const std::lock_guard<std::mutex> lock(worker.d_mutex);
+        worker.d_heap.push_back(
+            Task{priority,
+                 deadline,
+                 d_nextSequence.fetch_add(1, std::memory_order_relaxed),
+                 std::move(task)});
+        ++d_pending;
+        std::push_heap(worker.d_heap.begin(),
+                       worker.d_heap.end(),
+                       [](const Task& lhs, const Task& rhs) {
+                           return moreUrgent(rhs, lhs);
+                       });
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(d_wakeupMutex);
+    }
+    d_wakeup.notify_one();
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,279 @@
+#ifndef INCLUDED_DPLP_PRIORITYEXECUTOR
+#define INCLUDED_DPLP_PRIORITYEXECUTOR
+
+//@PURPOSE: Provide an executor that runs continuations by priority/deadline.
+//
+//@CLASSES:
+//  dplp::PriorityExecutor: earliest-deadline-first thread pool
+//
+//@SEE_ALSO: dplp_executorcontinuation, dplp_numaexecutor
+//
+//@DESCRIPTION: This component provides a single class,
+// 'dplp::PriorityExecutor', which is a thread pool that runs its tasks in
+// priority order instead of the first-in-first-out order used when promise
+// continuations are run inline by 'dplp::PromiseStateImpUtil'.
+//
+// Every task is posted with a priority level and a deadline. A task with a
+// more important level always runs before a task with a less important level.
+// Tasks at the same level run earliest-deadline-first. When a task is posted
+// with only a priority level, the time at which it was posted serves as its
+// deadline, so tasks without an explicit deadline run in FIFO order relative
+// to each other.
+//
+// Each worker thread owns a private priority queue. Tasks posted from a worker
+// thread go to that worker's queue and tasks posted from any other thread are
+// distributed round-robin. A worker whose queue is empty steals the most
+// urgent task, across all levels, from the other workers.
+//
+// The 'schedule' member functions adapt a continuation function so that it
+// runs on the executor when passed to 'dplp::Promise::then'. The adapted
+// continuation is a 'dplp::ExecutorContinuation' and so the result type of
+// 'then' follows the same rules as a continuation passed directly to it.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Keep latency-critical continuations ahead of background work
+///- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Suppose a service handles user requests and also refreshes caches in the
+// background using the same threads. We create a single executor for both:
+//..
+//  dplp::PriorityExecutor executor(4);
+//..
+// Background refreshes are scheduled at a low priority:
+//..
+//  refreshP().then(executor.schedule(
+//      [](const Table& table) { rebuildIndex(table); },
+//      dplp::PriorityExecutor::e_LOW));
+//..
+// User requests carry a deadline and are scheduled at high priority so that
+// they are never queued behind the refreshes:
+//..
+//  const auto deadline = dplp::PriorityExecutor::Clock::now() +
+//                        std::chrono::milliseconds(20);
+//  dplp::Promise<Response> response = receiveRequestP().then(
+//      executor.schedule([](const Request& r) { return handle(r); },
+//                        deadline,
+//                        dplp::PriorityExecutor::e_HIGH));
+//..
+
+#include <dplp_executorcontinuation.h>
+
+#include <atomic>              // std::atomic
+#include <chrono>              // std::chrono::steady_clock
+#include <condition_variable>  // std::condition_variable
+#include <cstddef>             // std::size_t
+#include <cstdint>             // std::uint64_t
+#include <functional>          // std::function
+#include <memory>              // std::unique_ptr
+#include <mutex>               // std::mutex
+#include <thread>              // std::thread
+#include <type_traits>         // std::decay_t
+#include <utility>             // std::move
+#include <vector>
+
+namespace dplp {
+
+class PriorityExecutor {
+    // This class implements a fixed-size thread pool that runs tasks most
+    // important priority level first and, within a level, earliest deadline
+    // first. Each worker thread has its own queue and idle workers steal from
+    // the other workers' queues.
+
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Priority {
+        // Priority levels, most important first.
+        e_HIGH,
+        e_NORMAL,
+        e_LOW
+    };
+
+    static constexpr int k_NUM_PRIORITIES = e_LOW + 1;
+
+  private:
+    struct Task {
+        // This is an element of a worker's queue.
+        int                   d_priority;
+        Clock::time_point     d_deadline;
+        std::uint64_t         d_sequence;  // tie breaker, preserves FIFO
+        std::function<void()> d_function;
+    };
+
+    struct Worker {
+        // This is the state of a single worker thread. 'd_heap' is a binary
+        // heap with the most urgent task at its front.
+        std::mutex        d_mutex;
+        std::vector<Task> d_heap;
+        std::thread       d_thread;
+    };
+
+    class Poster {
+        // This class posts tasks to a 'PriorityExecutor' with the priority
+        // and deadline given to 'schedule'.
+
+        PriorityExecutor  *d_executor_p;
+        Priority           d_priority;
+        bool               d_hasDeadline;
+        Clock::time_point  d_deadline;
+
+      public:
+        Poster(PriorityExecutor  *executor,
+               Priority           priority,
+               bool               hasDeadline,
+               Clock::time_point  deadline);
+            // Create a 'Poster' object that posts to the specified 'executor'
+            // with the specified 'priority' and, if the specified
+            // 'hasDeadline' is 'true', the specified 'deadline'.
+
+        void operator()(std::function<void()> task) const;
+            // Post the specified 'task'. If no deadline was given, use the
+            // current time.
+    };
+
+    std::vector<std::unique_ptr<Worker> > d_workers;
+    std::atomic<std::size_t>              d_nextWorker;
+    std::atomic<std::uint64_t>            d_nextSequence;
+
+    // 'd_pending' is the number of tasks in all the queues, and changes only
+    // under the mutex of the queue a task is pushed to or popped from. Idle
+    // workers sleep on 'd_wakeup' until it is non-zero or 'd_stopping' is
+    // set.
+    std::atomic<std::size_t> d_pending;
+    bool                     d_stopping;
+    std::mutex               d_wakeupMutex;
+    std::condition_variable  d_wakeup;
+
+    static bool moreUrgent(const Task& lhs, const Task& rhs);
+        // Return 'true' if the specified 'lhs' should run before the
+        // specified 'rhs' and 'false' otherwise.
+
+    bool popTask(std::size_t workerIndex, Task *result);
+        // Pop the most urgent task of the worker with the specified
+        // 'workerIndex' into the specified 'result' or, if that queue is
+        // empty, steal the most urgent task from the other workers. Return
+        // 'true' if a task was found and 'false' otherwise.
+
+    void workerMain(std::size_t workerIndex);
+        // Run tasks on the current thread as the worker with the specified
+        // 'workerIndex' until 'd_stopping' is set and all queues are empty.
+
+  public:
+    explicit PriorityExecutor(std::size_t numWorkers);
+        // Create a 'PriorityExecutor' object that runs tasks on the specified
+        // 'numWorkers' threads. The behavior is undefined unless
+        // '0 < numWorkers'.
+
+    PriorityExecutor(const PriorityExecutor&) = delete;
+    PriorityExecutor& operator=(const PriorityExecutor&) = delete;
+
+    ~PriorityExecutor();
+        // Run all the posted tasks, including tasks posted while doing so,
+        // and then join the worker threads. The behavior is undefined if this
+        // is called from one of the worker threads.
+
+    void post(std::function<void()> task, Priority priority = e_NORMAL);
+        // Run the specified 'task' on a worker thread at the optionally
+        // specified 'priority' level, using the current time as its deadline.
+
+    void post(std::function<void()> task,
+              Clock::time_point     deadline,
+              Priority              priority = e_NORMAL);
+        // Run the specified 'task' on a worker thread at the optionally
+        // specified 'priority' level and with the specified 'deadline'.
+
+    template <typename F>
+    dplp::ExecutorContinuation<std::decay_t<F>, Poster> schedule(
+                                                         F&&      f,
+                                                         Priority priority);
+    template <typename F>
+    dplp::ExecutorContinuation<std::decay_t<F>, Poster> schedule(
+                                         F&&               f,
+                                         Clock::time_point deadline,
+                                         Priority          priority = e_NORMAL);
+        // Return a continuation function that, when called with arguments
+        // 'args...', posts a task calling the specified 'f' with 'args...'
+        // at the specified 'priority' level and optionally specified
+        // 'deadline', and returns a promise for the result of that call. The
+        // promise is rejected if 'f' throws. If 'deadline' is not specified,
+        // the time the continuation is called is used. See
+        // 'dplp_executorcontinuation' for details.
+        //
+        // The resulting continuation is intended to be passed to
+        // 'dplp::Promise::then'. The executor must outlive all the promises
+        // that have the resulting continuation attached.
+
+    std::size_t numWorkers() const;
+        // Return the number of worker threads.
+};
+
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+
+inline
+PriorityExecutor::Poster::Poster(PriorityExecutor  *executor,
+                                 Priority           priority,
+                                 bool               hasDeadline,
+                                 Clock::time_point  deadline)
+: d_executor_p(executor)
+, d_priority(priority)
+, d_hasDeadline(hasDeadline)
+, d_deadline(deadline)
+{
+}
+
+inline
+void PriorityExecutor::Poster::operator()(std::function<void()> task) const
+{
+    d_executor_p->post(std::move(task),
+                       d_hasDeadline ? d_deadline : Clock::now(),
+                       d_priority);
+}
+
+template <typename F>
+dplp::ExecutorContinuation<std::decay_t<F>, PriorityExecutor::Poster>
+PriorityExecutor::schedule(F&& f, Priority priority)
+{
+    return dplp::ExecutorContinuation<std::decay_t<F>, Poster>(
+        std::forward<F>(f), Poster(this, priority, false, Clock::time_point()));
+}
+
+template <typename F>
+dplp::ExecutorContinuation<std::decay_t<F>, PriorityExecutor::Poster>
+PriorityExecutor::schedule(F&&               f,
+                           Clock::time_point deadline,
+                           Priority          priority)
+{
+    return dplp::ExecutorContinuation<std::decay_t<F>, Poster>(
+        std::forward<F>(f), Poster(this, priority, true, deadline));
+}
+
+inline
+std::size_t PriorityExecutor::numWorkers() const
+{
+    return d_workers.size();
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,190 @@
+#include <dplp_priorityexecutor.h>
+
+#include <dplp_promise.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+class Latch {
+    // A one-shot event that threads can wait on.
+    std::mutex              d_mutex;
+    std::condition_variable d_cv;
+    bool                    d_set = false;
+
+  public:
+    void set()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(d_mutex);
+            d_set = true;
+        }
+        d_cv.notify_all();
+    }
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(d_mutex);
+        d_cv.wait(lock, [this] { return d_set; });
+    }
+};
+}
+
+TEST(dplp_priorityexecutor, priority_order)
+{
+    std::vector<std::string> order;
+    Latch                    blocked;
+    Latch                    release;
+    {
+        dplp::PriorityExecutor executor(1);
+
+        // Keep the only worker busy while the other tasks are queued.
+        executor.post([&] {
+            blocked.set();
+            release.wait();
+        });
+        blocked.wait();
+
+        executor.post([&] { order.push_back("low"); },
+                      dplp::PriorityExecutor::e_LOW);
+        executor.post([&] { order.push_back("normal"); },
+                      dplp::PriorityExecutor::e_NORMAL);
+        executor.post([&] { order.push_back("high"); },
+                      dplp::PriorityExecutor::e_HIGH);
+        release.set();
+    }
+    EXPECT_EQ(order,
+              (std::vector<std::string>{"high", "normal", "low"}))
+        << "Tasks didn't run in priority order.";
+}
+
+TEST(dplp_priorityexecutor, deadline_order)
+{
+    using Clock = dplp::PriorityExecutor::Clock;
+
+    std::vector<int> order;
+    Latch            blocked;
+    Latch            release;
+    {
+        dplp::PriorityExecutor executor(1);
+        executor.post([&] {
+            blocked.set();
+            release.wait();
+        });
+        blocked.wait();
+
+        const Clock::time_point now = Clock::now();
+        executor.post([&] { order.push_back(3); },
+                      now + std::chrono::milliseconds(30));
+        executor.post([&] { order.push_back(1); },
+                      now + std::chrono::milliseconds(10));
+        executor.post([&] { order.push_back(2); },
+                      now + std::chrono::milliseconds(20));
+
+        // A later deadline at a more important level still goes first.
+        executor.post([&] { order.push_back(0); },
+                      now + std::chrono::milliseconds(40),
+                      dplp::PriorityExecutor::e_HIGH);
+        release.set();
+    }
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3}))
+        << "Tasks didn't run earliest-deadline-first.";
+}
+
+TEST(dplp_priorityexecutor, steal)
+{
+    // A task posted from a worker goes to that worker's queue. If that worker
+    // is blocked, the task must be stolen by the other worker.
+    dplp::PriorityExecutor executor(2);
+    Latch                  stolen;
+    Latch                  done;
+    executor.post([&] {
+        executor.post([&] { stolen.set(); });
+        stolen.wait();
+        done.set();
+    });
+    done.wait();
+}
+
+TEST(dplp_priorityexecutor, schedule)
+{
+    dplp::PriorityExecutor executor(2);
+
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    finished = false;
+    int                     result   = 0;
+    std::thread::id         ranOn;
+
+    dplp::Promise<int> p = dplp::makeFulfilledPromise(3).then(
+        executor.schedule(
+            [&](int i) {
+                ranOn = std::this_thread::get_id();
+                return i + 1;
+            },
+            dplp::PriorityExecutor::e_HIGH));
+
+    p.then([&](int i) {
+        const std::lock_guard<std::mutex> lock(mutex);
+        result   = i;
+        finished = true;
+        cv.notify_all();
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return finished; });
+    EXPECT_EQ(result, 4) << "Unexpected value in fulfilled promise.";
+    EXPECT_NE(ranOn, std::this_thread::get_id())
+        << "Continuation didn't run on the executor.";
+}
+
+TEST(dplp_priorityexecutor, schedule_reject)
+{
+    dplp::PriorityExecutor executor(1);
+
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    rejected = false;
+
+    dplp::Promise<> p = dplp::makeFulfilledPromise().then(executor.schedule(
+        []() { throw std::runtime_error("error"); },
+        dplp::PriorityExecutor::Clock::now(),
+        dplp::PriorityExecutor::e_LOW));
+
+    p.then([] { ADD_FAILURE() << "Unexpected fulfillment."; },
+           [&](std::exception_ptr) {
+               const std::lock_guard<std::mutex> lock(mutex);
+               rejected = true;
+               cv.notify_all();
+           });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return rejected; });
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
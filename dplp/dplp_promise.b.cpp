@@ -0,0 +1,71 @@
+#include <dplp_promise.h>
+
+#include <benchmark/benchmark.h>
+
+#include <exception>
+#include <functional>
+#include <stdexcept>
+
+// These benchmarks resolve the head of a chain of 'then' calls without
+// rejected continuations, ending in one that has both, by fulfilling or by
+// rejecting it. The chain's length is the benchmark's argument.
+
+namespace {
+void resolveChain(benchmark::State& state, bool reject)
+{
+    const std::exception_ptr error =
+        std::make_exception_ptr(std::runtime_error("error"));
+
+    for (auto _ : state) {
+        std::function<void(int)>                fulfillHead;
+        std::function<void(std::exception_ptr)> rejectHead;
+        dplp::Promise<int> p([&](auto f, auto r) {
+            fulfillHead = f;
+            rejectHead  = r;
+        });
+        for (int i = 0; i < state.range(0); ++i)
+            p = p.then([](int i) { return i + 1; });
+
+        int result = 0;
+        p.then([&](int i) { result = i; },
+               [&](std::exception_ptr) { result = -1; });
+        p = dplp::makeFulfilledPromise(0);
+
+        if (reject)
+            rejectHead(error);
+        else
+            fulfillHead(0);
+        benchmark::DoNotOptimize(result);
+    }
+}
+}
+
+static void BM_FulfillChain(benchmark::State& state)
+{
+    resolveChain(state, false);
+}
+BENCHMARK(BM_FulfillChain)->Arg(1)->Arg(20);
+
+static void BM_RejectChain(benchmark::State& state)
+{
+    resolveChain(state, true);
+}
+BENCHMARK(BM_RejectChain)->Arg(1)->Arg(20);
+
+BENCHMARK_MAIN();
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
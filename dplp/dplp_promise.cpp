@@ -1,5 +1,18 @@
 #include <dplp_promise.h>
 
+#include <dplm17_variant.h>
+
+#include <string>
+#include <vector>
+
+namespace dplp {
+template class Promise<>;
+template class Promise<int>;
+template class Promise<std::string>;
+template class Promise<std::vector<char> >;
+template class Promise<dplm17::monostate>;
+}
+
 // ----------------------------------------------------------------------------
 // Copyright 2017 Bloomberg Finance L.P.
 //
@@ -16,6 +16,37 @@
 // set once and whether or not it is set is largely hidden by the interface.
 // Promises are a basic building block for asynchronous applications.
 //
+// Inline Results
+// --------------
+// A promise constructed from a resolver keeps its state in shared storage
+// allocated from 'dplp::DefaultResource', since the resolver may complete it
+// later. A promise that is already resolved when it is created, however,
+// holds its result inline and allocates nothing. That is the case for the
+// results of 'makeRejectedPromise', of 'makeFulfilledPromise' with small
+// values (at most two pointers in size and nothrow-movable), and of 'then' on
+// such a promise when the continuation returns a value rather than a promise:
+// the continuation is called synchronously by 'then'. A chain of 'then'
+// calls on a cached value therefore performs no allocations.
+//
+// Recursion
+// ---------
+// Continuations, including those 'then' calls synchronously, are called
+// through 'dplp::Trampoline'. Once a thread is 'dplp::Trampoline::maxDepth()'
+// continuations deep, further ones are queued and run after the outermost
+// continuation returns, so a long synchronous chain uses bounded stack. In
+// that case 'then' on a resolved promise returns a promise with a shared
+// state that is resolved when the queued continuation runs.
+//
+// Explicit Instantiations
+// -----------------------
+// The library contains explicit instantiations of 'dplp::Promise' for the
+// commonly used value types: none, 'int', 'std::string', 'std::vector<char>',
+// and 'dplm17::monostate'. Their non-template members are declared 'extern'
+// here, so other translation units do not instantiate them again. Note that
+// 'then' and the resolving constructor are templates over the continuation or
+// resolver and are still instantiated where they are used. See also
+// 'dplp_promisestate'.
+//
 ///Usage
 ///-----
 // This section illustrates intended use of this component.
@@ -363,19 +394,26 @@
 // 'makeFulfilledPromise' ('makeRejectedPromise') is also provided. Unlike
 // 'makeFulfilledPromise', the template arguments must be supplied.
 
+#include <dplm17_variant.h>
 #include <dplmrts_anytuple.h>
 #include <dplmrts_invocable.h>
 #include <dplp_anypromise.h>
+#include <dplp_defaultresource.h>
 #include <dplp_promisestate.h>
 #include <dplp_resolver.h>
+#include <dplp_trampoline.h>
 
-#include <experimental/tuple>  // std::experimental::apply
-#include <experimental/type_traits>  // std::experimental::is_void_v, std::experimental::is_same_v
-
-#include <exception>    // std::exception_ptr
-#include <functional>   // std::invoke
-#include <tuple>        // std::tuple
-#include <type_traits>  // std::result_of_t
+#include <atomic>           // std::atomic_thread_fence
+#include <cstddef>          // std::nullptr_t
+#include <exception>        // std::exception_ptr
+#include <functional>       // std::invoke
+#include <memory>           // std::allocate_shared, std::shared_ptr
+#include <memory_resource>  // std::pmr::polymorphic_allocator
+#include <string>           // std::string
+#include <tuple>            // std::apply, std::tuple
+#include <type_traits>      // std::invoke_result_t, std::is_same_v
+#include <utility>          // std::as_const, std::forward, std::move
+#include <vector>           // std::vector
 
 namespace dplp {
 
@@ -394,41 +432,114 @@ using Promise_TupleContinuationThenResult =
     typename Promise_TupleContinuationThenResultImp<T>::type;
 
 template <typename T, typename... Types>
-concept bool Promise_FulfilledCont = dplmrts::Invocable<T, Types...>;
+concept Promise_FulfilledCont = dplmrts::Invocable<T, Types...>;
 
 template <typename T, typename... Types>
-concept bool Promise_RejectedCont = dplmrts::Invocable<T, std::exception_ptr>;
+concept Promise_RejectedCont = dplmrts::Invocable<T, std::exception_ptr>;
 
 template <typename T, typename U, typename... Types>
-concept bool                             Promise_Conts =
-    Promise_FulfilledCont<T, Types...>&& Promise_RejectedCont<U, Types...>&&
-                                         std::experimental::is_same_v<std::result_of_t<T(Types...)>,
-                                     std::result_of_t<U(std::exception_ptr)> >;
+concept Promise_Conts =
+    Promise_FulfilledCont<T, Types...> && Promise_RejectedCont<U, Types...> &&
+    std::is_same_v<std::invoke_result_t<T, Types...>,
+                   std::invoke_result_t<U, std::exception_ptr> >;
 
 template <typename T, typename... Types>
-concept bool VoidPromise_FulfilledCont = Promise_FulfilledCont<T, Types...>&&
-             std::experimental::is_void_v<std::result_of_t<T(Types...)> >;
+concept VoidPromise_FulfilledCont =
+    Promise_FulfilledCont<T, Types...> &&
+    std::is_void_v<std::invoke_result_t<T, Types...> >;
 
 template <typename T, typename U, typename... Types>
-concept bool                        Promise_VoidConts =
-    Promise_Conts<T, U, Types...>&& VoidPromise_FulfilledCont<T, Types...>;
+concept Promise_VoidConts =
+    Promise_Conts<T, U, Types...> && VoidPromise_FulfilledCont<T, Types...>;
 
 template <typename T, typename... Types>
-concept bool TuplePromise_FulfilledCont = Promise_FulfilledCont<T, Types...>&&
-             dplmrts::AnyTuple<std::result_of_t<T(Types...)> >;
+concept TuplePromise_FulfilledCont =
+    Promise_FulfilledCont<T, Types...> &&
+    dplmrts::AnyTuple<std::invoke_result_t<T, Types...> >;
 
 template <typename T, typename U, typename... Types>
-concept bool                        Promise_TupleConts =
-    Promise_Conts<T, U, Types...>&& TuplePromise_FulfilledCont<T, Types...>;
+concept Promise_TupleConts =
+    Promise_Conts<T, U, Types...> && TuplePromise_FulfilledCont<T, Types...>;
 
 template <typename T, typename... Types>
-concept bool Promise_PromiseFulfilledCont =
-    Promise_FulfilledCont<T, Types...>&&
-        dplp::AnyPromise<std::result_of_t<T(Types...)> >;
+concept Promise_PromiseFulfilledCont =
+    Promise_FulfilledCont<T, Types...> &&
+    dplp::AnyPromise<std::invoke_result_t<T, Types...> >;
 
 template <typename T, typename U, typename... Types>
-concept bool                        Promise_PromiseConts =
-    Promise_Conts<T, U, Types...>&& Promise_PromiseFulfilledCont<T, Types...>;
+concept Promise_PromiseConts =
+    Promise_Conts<T, U, Types...> && Promise_PromiseFulfilledCont<T, Types...>;
+
+template <typename T, typename... Types>
+concept Promise_TransformCont =
+    // 'Promise_TransformCont' is satisfied by case #4 continuations of a
+    // promise of a single type that return that type.
+    sizeof...(Types) == 1 && Promise_FulfilledCont<T, Types...> &&
+    !dplmrts::AnyTuple<std::invoke_result_t<T, Types...> > &&
+    !dplp::AnyPromise<std::invoke_result_t<T, Types...> > &&
+    std::is_same_v<std::tuple<std::invoke_result_t<T, Types...> >,
+                   std::tuple<Types...> >;
+
+template <typename... Types>
+struct Promise_IsInlineable
+: std::bool_constant<
+      sizeof(std::tuple<Types...>) <= 2 * sizeof(void *) &&
+      std::is_nothrow_move_constructible_v<std::tuple<Types...> > &&
+      std::is_copy_constructible_v<std::tuple<Types...> > > {
+    // This type function determines whether the fulfilled values of a
+    // 'Promise<Types...>' are small enough to be held inline.
+};
+
+template <typename F, typename... Args>
+struct Promise_IsNothrowCont
+: std::bool_constant<
+      std::is_nothrow_invocable_v<F, Args&...> &&
+      !dplp::AnyPromise<std::invoke_result_t<F, Args&...> > &&
+      (std::is_void_v<std::invoke_result_t<F, Args&...> > ||
+       std::is_nothrow_move_constructible_v<
+           std::invoke_result_t<F, Args&...> >)> {
+    // This type function determines whether neither calling a continuation
+    // of type 'F' with lvalues of types 'Args...' nor passing its result on
+    // can throw, so that 'then' need not catch exceptions from it. Note that
+    // a continuation returning a promise is never considered so, as posting
+    // to that promise may allocate.
+};
+
+struct Promise_InvokeUtil {
+    // This utility calls continuations.
+
+    template <typename F, typename... Args>
+    static decltype(auto) invoke(F&& function, Args&&... args);
+        // Call the specified 'function' with the specified 'args' as
+        // 'std::invoke' does and return its result. Pointers to member
+        // functions are called out of line: once such a call is inlined into
+        // the function holding the argument, GCC warns that the branch taken
+        // for virtual functions reads past objects of empty classes.
+
+  private:
+    template <typename F, typename... Args>
+    [[gnu::noinline]] static decltype(auto) invokeMember(F function,
+                                                         Args&&... args);
+        // Call the specified pointer to member 'function' with the specified
+        // 'args' and return its result.
+};
+
+struct Promise_NotInlineable {
+    // This class is the placeholder for the inline values of promises whose
+    // values are not held inline. It is never constructed.
+};
+
+template <typename... Types>
+using Promise_Ready =
+    // 'Promise_Ready' is the type holding the result of a promise that was
+    // resolved when it was created: 'dplm17::monostate' if the promise has a
+    // shared state instead, the values if fulfilled, and the error if
+    // rejected.
+    dplm17::variant<dplm17::monostate,
+                    std::conditional_t<Promise_IsInlineable<Types...>::value,
+                                       std::tuple<Types...>,
+                                       Promise_NotInlineable>,
+                    std::exception_ptr>;
 
 template <typename... Types>
 class Promise {
@@ -442,10 +553,23 @@ class Promise {
     // Promises may be copied. There are no semantic problems with this since
     // they have no mutating members. Well, at least until a 'cancel' operation
     // is implemented anyway.
+    // 'd_data_sp' is null when the result is held in 'd_ready' instead.
     std::shared_ptr<dplp::PromiseState<Types...> > d_data_sp;
+    Promise_Ready<Types...>                        d_ready;
+
+    enum { k_SHARED = 0, k_FULFILLED = 1, k_REJECTED = 2 };
+        // The indices of the alternatives of 'd_ready'.
+
+    // Case #3 of 'then' attaches continuations to the state of the promise
+    // returned by the continuation, which is of a different type.
+    template <typename...>
+    friend class Promise;
+
+    // 'AnyPromiseHandle' erases the type of the state.
+    friend class AnyPromiseHandle;
 
   public:
-    Promise(dplp::Resolver<Types...> resolver);
+    Promise(dplp::Resolver<Types...> auto resolver);
         // Create a new 'Promise' object based on the specified 'resolver'.
         // 'resolver' is called exactly once by this constructor with a
         // 'dplmrts::Invocable<Types...>' (resolve function) as its first and a
@@ -466,50 +590,53 @@ class Promise {
                                Types...>
         Promise<> then(Promise_FulfilledCont fulfilledCont,
                        Promise_RejectedCont  rejectedCont)
-            const;  // Two-argument version of case #1
+            const&;  // Two-argument version of case #1
     template <typename Promise_FulfilledCont>
     requires VoidPromise_FulfilledCont<Promise_FulfilledCont, Types...>
         Promise<> then(Promise_FulfilledCont fulfilledCont)
-            const;  // One-argument version of case #1
+            const&;  // One-argument version of case #1
     template <typename Promise_FulfilledCont, typename Promise_RejectedCont>
     requires Promise_TupleConts<Promise_FulfilledCont,
                                 Promise_RejectedCont,
                                 Types...> auto
     then(Promise_FulfilledCont fulfilledCont,
-         Promise_RejectedCont  rejectedCont) const
-        -> Promise_TupleContinuationThenResult<
-            std::result_of_t<Promise_FulfilledCont(
-                Types...)> >;  // Two-argument version of case #2
+         Promise_RejectedCont  rejectedCont) const&
+        -> Promise_TupleContinuationThenResult<std::invoke_result_t<
+            Promise_FulfilledCont,
+            Types...> >;  // Two-argument version of case #2
     template <typename Promise_FulfilledCont>
     requires TuplePromise_FulfilledCont<Promise_FulfilledCont, Types...> auto
-    then(Promise_FulfilledCont fulfilledCont) const
-        -> Promise_TupleContinuationThenResult<
-            std::result_of_t<Promise_FulfilledCont(
-                Types...)> >;  // One-argument version of case #2
+    then(Promise_FulfilledCont fulfilledCont) const&
+        -> Promise_TupleContinuationThenResult<std::invoke_result_t<
+            Promise_FulfilledCont,
+            Types...> >;  // One-argument version of case #2
     template <typename Promise_FulfilledCont, typename Promise_RejectedCont>
     requires Promise_PromiseConts<Promise_FulfilledCont,
                                   Promise_RejectedCont,
                                   Types...> auto
     then(Promise_FulfilledCont fulfilledCont,
-         Promise_RejectedCont  rejectedCont) const
-        -> std::result_of_t<Promise_FulfilledCont(
-            Types...)>;  // Two-argument version of case #3
+         Promise_RejectedCont  rejectedCont) const&
+        -> std::invoke_result_t<Promise_FulfilledCont,
+                                Types...>;  // Two-argument version of case #3
     template <typename Promise_FulfilledCont>
     requires Promise_PromiseFulfilledCont<Promise_FulfilledCont, Types...> auto
-    then(Promise_FulfilledCont fulfilledCont) const -> std::result_of_t<
-        Promise_FulfilledCont(Types...)>;  // One-argument version of case #3
+    then(Promise_FulfilledCont fulfilledCont) const&
+        -> std::invoke_result_t<Promise_FulfilledCont,
+                                Types...>;  // One-argument version of case #3
     template <typename Promise_FulfilledCont, typename Promise_RejectedCont>
     requires Promise_Conts<Promise_FulfilledCont,
                            Promise_RejectedCont,
                            Types...> auto
     then(Promise_FulfilledCont fulfilledCont,
-         Promise_RejectedCont  rejectedCont) const
-        -> Promise<std::result_of_t<Promise_FulfilledCont(
-            Types...)> >;  // Two-argument version of case #4
+         Promise_RejectedCont  rejectedCont) const&
+        -> Promise<std::invoke_result_t<
+            Promise_FulfilledCont,
+            Types...> >;  // Two-argument version of case #4
     template <typename FC>
     requires Promise_FulfilledCont<FC, Types...> auto
-    then(FC fulfilledCont) const -> Promise<
-        std::result_of_t<FC(Types...)> >;  // One-argument version of case #4
+    then(FC fulfilledCont) const& -> Promise<
+        std::invoke_result_t<FC,
+                             Types...> >;  // One-argument version of case #4
         // Return a new promise that, upon the fulfilment of this promise, will
         // be fulfilled with the result of the specified 'fulfilledCont'
         // function or, upon reject of this promise, will be rejected with the
@@ -523,7 +650,10 @@ class Promise {
         //
         // If either 'fulfilledCont' or 'rejectedCont' throw an exception, the
         // resulting promise will be a rejected promise containing that
-        // exception.
+        // exception. Continuations that are 'noexcept' and do not return
+        // promises, and whose results have non-throwing move constructors,
+        // are called without catching exceptions (see
+        // 'Promise_IsNothrowCont').
         //
         // The return type of 'fulfilledCont' controls the type of promise
         // returned from 'then'. There are the following cases:
@@ -540,6 +670,20 @@ class Promise {
         //    of 'fulfilledCont' is 'T', then the result of this function will
         //    be of type 'Promise<T>'.
 
+    template <typename FC, typename RC>
+    requires Promise_TransformCont<FC, Types...> &&
+             Promise_Conts<FC, RC, Types...> Promise
+             then(FC fulfilledCont, RC rejectedCont) &&;
+    template <typename FC>
+    requires Promise_TransformCont<FC, Types...> Promise
+    then(FC fulfilledCont) &&;
+        // Return the same as 'then(fulfilledCont, rejectedCont)' or
+        // 'then(fulfilledCont)' for a case #4 continuation returning this
+        // promise's type. If this promise is resolved and is the only
+        // reference to its state, that state is reused for the result
+        // instead of allocating another: it is transformed in place by the
+        // continuations and moved into the result.
+
     template <typename... Types2>
     friend Promise<std::decay_t<Types2>...> makeFulfilledPromise(
                                                            Types2&&... values);
@@ -555,27 +699,110 @@ class Promise {
     Promise();
         // Create a new 'promise' object in the waiting state. It is never
         // fulfilled.
+
+    explicit Promise(std::nullptr_t);
+        // Create a new 'promise' object with neither a state nor an inline
+        // result. The behavior is undefined unless one of them is set before
+        // the object is used.
+
+    static std::shared_ptr<dplp::PromiseState<Types...> > makeState();
+        // Return a new promise state in the waiting state allocated from
+        // 'dplp::DefaultResource::get()'.
+
+    template <typename... Values>
+    static Promise makeFulfilled(Values&&... values);
+        // Return a promise fulfilled with the specified 'values', which is
+        // held inline if 'Types...' are inlineable.
+
+    static Promise makeRejected(std::exception_ptr error);
+        // Return a promise, holding its result inline, rejected with the
+        // specified 'error'.
+
+    template <typename F>
+    static Promise resolveWith(F&& function);
+        // Return a promise resolved with the result of calling the specified
+        // 'function' with no arguments, following the rules 'then' applies
+        // to the results of continuations, or rejected with the exception it
+        // throws.
+
+    bool isReusable() const;
+        // Return 'true' if this promise has a state that nothing else refers
+        // to and the current thread may call continuations synchronously,
+        // and 'false' otherwise.
+
+    template <typename Fulfill, typename F>
+    static void fulfillWith(Fulfill& fulfill, F&& function);
+        // Call the specified 'fulfill' with the result of calling the
+        // specified 'function' with no arguments, as 'then' does for
+        // continuations not returning promises: with no arguments if the
+        // result is 'void', with the elements of a tuple, and with the value
+        // otherwise.
+
+    template <typename... Args,
+              typename Cont,
+              typename Fulfill,
+              typename Reject>
+    static auto continuation(Cont cont, Fulfill fulfill, Reject reject);
+        // Return a function taking 'Args...' that calls the specified 'cont'
+        // with them and resolves a promise through the specified 'fulfill'
+        // and 'reject' functions with the result, following the rules of
+        // 'then', or rejects it with the exception 'cont' throws. If
+        // 'Promise_IsNothrowCont<Cont, Args...>' holds, the function is
+        // 'noexcept', catches nothing, and does not hold 'reject'.
+
+    template <typename Result, typename FulfilledCont>
+    Result thenReady(FulfilledCont& fulfilledCont) const;
+    template <typename Result, typename FulfilledCont, typename RejectedCont>
+    Result thenReady(FulfilledCont& fulfilledCont,
+                     RejectedCont&  rejectedCont) const;
+        // Return the result of 'then' with the specified 'fulfilledCont' and
+        // optionally specified 'rejectedCont', called synchronously. The
+        // behavior is undefined unless this promise holds its result inline.
+
+    template <typename FulfilledCont, typename RejectedCont>
+    void postContinuations(FulfilledCont&& fulfilledCont,
+                           RejectedCont&&  rejectedCont) const;
+        // Call the specified 'fulfilledCont' or 'rejectedCont' when this
+        // promise is fulfilled or rejected, or immediately if it holds its
+        // result inline.
 };
 
 // ============================================================================
 //                                 INLINE DEFINITIONS
 // ============================================================================
 
+template <typename F, typename... Args>
+decltype(auto) Promise_InvokeUtil::invoke(F&& function, Args&&... args)
+{
+    if constexpr (std::is_member_function_pointer_v<std::decay_t<F> >) {
+        return invokeMember(function, std::forward<Args>(args)...);
+    }
+    else {
+        return std::invoke(std::forward<F>(function),
+                           std::forward<Args>(args)...);
+    }
+}
+
+template <typename F, typename... Args>
+decltype(auto) Promise_InvokeUtil::invokeMember(F function, Args&&... args)
+{
+    return std::invoke(function, std::forward<Args>(args)...);
+}
+
 template <typename... Types>
-Promise<Types...>::Promise(dplp::Resolver<Types...> resolver)
-: d_data_sp(std::make_shared<PromiseState<Types...> >())
+Promise<Types...>::Promise(dplp::Resolver<Types...> auto resolver)
+: d_data_sp(makeState())
 {
     // Set 'fulfil' to the fulfilment function. Note that it, as well as
-    // reject, keeps its own shared pointer to 'd_data_sp'.
+    // reject, keeps its own shared pointer to 'd_data_sp'. 'reject' is a
+    // forwarder, which 'then' posts as the rejected continuation when it is
+    // given none, so rejections can be forwarded through chains of 'then'.
     auto fulfil = [data_sp = this->d_data_sp](Types... fulfillValues) noexcept
     {
         data_sp->fulfill(std::move(fulfillValues)...);
     };
 
-    auto reject = [data_sp = this->d_data_sp](std::exception_ptr e) noexcept
-    {
-        data_sp->reject(std::move(e));
-    };
+    auto reject = PromiseState<Types...>::forwarder(d_data_sp);
 
     std::invoke(resolver, std::move(fulfil), std::move(reject));
 }
@@ -586,55 +813,35 @@ requires
         Promise_VoidConts<Promise_FulfilledCont, Promise_RejectedCont, Types...>
         Promise<>
         Promise<Types...>::then(Promise_FulfilledCont fulfilledCont,
-                                Promise_RejectedCont  rejectedCont) const
+                                Promise_RejectedCont  rejectedCont) const&
 {
+    if (!d_data_sp && !dplp::Trampoline::isSaturated())
+        return thenReady<Promise<> >(fulfilledCont, rejectedCont);
+
     return Promise<>([
         this,
         fulfilledCont = std::move(fulfilledCont),
         rejectedCont  = std::move(rejectedCont)
     ](auto fulfill, auto reject) mutable {
-        d_data_sp->postContinuations(
-            [ fulfilledCont = std::move(fulfilledCont), fulfill, reject ](
-                Types... t) mutable {
-                try {
-                    std::invoke(std::move(fulfilledCont), t...);
-                    fulfill();
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            },
-            [ rejectedCont = std::move(rejectedCont), fulfill, reject ](
-                std::exception_ptr e) mutable {
-                try {
-                    std::invoke(std::move(rejectedCont), e);
-                    fulfill();
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            });
+        postContinuations(
+            continuation<Types...>(std::move(fulfilledCont), fulfill, reject),
+            continuation<std::exception_ptr>(
+                std::move(rejectedCont), fulfill, reject));
     });
 }
 
 template <typename... Types>
 template <typename Promise_FulfilledCont>
 requires VoidPromise_FulfilledCont<Promise_FulfilledCont, Types...> Promise<>
-Promise<Types...>::then(Promise_FulfilledCont fulfilledCont) const
+Promise<Types...>::then(Promise_FulfilledCont fulfilledCont) const&
 {
+    if (!d_data_sp && !dplp::Trampoline::isSaturated())
+        return thenReady<Promise<> >(fulfilledCont);
+
     return Promise<>([ this, fulfilledCont = std::move(fulfilledCont) ](
         auto fulfill, auto reject) mutable {
-        d_data_sp->postContinuations(
-            [ fulfilledCont = std::move(fulfilledCont), fulfill, reject ](
-                Types... t) mutable {
-                try {
-                    std::invoke(std::move(fulfilledCont), t...);
-                    fulfill();
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            },
+        postContinuations(
+            continuation<Types...>(std::move(fulfilledCont), fulfill, reject),
             reject);
     });
 }
@@ -645,65 +852,45 @@ requires Promise_TupleConts<Promise_FulfilledCont,
                             Promise_RejectedCont,
                             Types...> auto
 Promise<Types...>::then(Promise_FulfilledCont fulfilledCont,
-                        Promise_RejectedCont  rejectedCont) const
+                        Promise_RejectedCont  rejectedCont) const&
     -> Promise_TupleContinuationThenResult<
-        std::result_of_t<Promise_FulfilledCont(Types...)> >
+        std::invoke_result_t<Promise_FulfilledCont, Types...> >
 {
     using Result = Promise_TupleContinuationThenResult<
-        std::result_of_t<Promise_FulfilledCont(Types...)> >;
+        std::invoke_result_t<Promise_FulfilledCont, Types...> >;
+
+    if (!d_data_sp && !dplp::Trampoline::isSaturated())
+        return thenReady<Result>(fulfilledCont, rejectedCont);
 
     return Result([
         this,
         fulfilledCont = std::move(fulfilledCont),
         rejectedCont  = std::move(rejectedCont)
     ](auto fulfill, auto reject) mutable {
-        d_data_sp->postContinuations(
-            [ fulfilledCont = std::move(fulfilledCont), fulfill, reject ](
-                Types... t) mutable {
-                try {
-                    std::experimental::apply(fulfill,
-                                             std::move(fulfilledCont)(t...));
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            },
-            [ rejectedCont = std::move(rejectedCont), fulfill, reject ](
-                std::exception_ptr e) mutable {
-                try {
-                    std::experimental::apply(
-                        fulfill, std::invoke(std::move(rejectedCont), e));
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            });
+        postContinuations(
+            continuation<Types...>(std::move(fulfilledCont), fulfill, reject),
+            continuation<std::exception_ptr>(
+                std::move(rejectedCont), fulfill, reject));
     });
 }
 
 template <typename... Types>
 template <typename Promise_FulfilledCont>
 requires TuplePromise_FulfilledCont<Promise_FulfilledCont, Types...> auto
-Promise<Types...>::then(Promise_FulfilledCont fulfilledCont) const
+Promise<Types...>::then(Promise_FulfilledCont fulfilledCont) const&
     -> Promise_TupleContinuationThenResult<
-        std::result_of_t<Promise_FulfilledCont(Types...)> >
+        std::invoke_result_t<Promise_FulfilledCont, Types...> >
 {
     using Result = Promise_TupleContinuationThenResult<
-        std::result_of_t<Promise_FulfilledCont(Types...)> >;
+        std::invoke_result_t<Promise_FulfilledCont, Types...> >;
+
+    if (!d_data_sp && !dplp::Trampoline::isSaturated())
+        return thenReady<Result>(fulfilledCont);
 
     return Result([ this, fulfilledCont = std::move(fulfilledCont) ](
         auto fulfill, auto reject) mutable {
-        d_data_sp->postContinuations(
-            [ fulfilledCont = std::move(fulfilledCont), fulfill, reject ](
-                Types... t) mutable {
-                try {
-                    std::experimental::apply(fulfill,
-                                             std::move(fulfilledCont)(t...));
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            },
+        postContinuations(
+            continuation<Types...>(std::move(fulfilledCont), fulfill, reject),
             reject);
     });
 }
@@ -714,64 +901,41 @@ requires Promise_PromiseConts<Promise_FulfilledCont,
                               Promise_RejectedCont,
                               Types...> auto
 Promise<Types...>::then(Promise_FulfilledCont fulfilledCont,
-                        Promise_RejectedCont  rejectedCont) const
-    -> std::result_of_t<Promise_FulfilledCont(Types...)>
+                        Promise_RejectedCont  rejectedCont) const&
+    -> std::invoke_result_t<Promise_FulfilledCont, Types...>
 {
-    using Result = std::result_of_t<Promise_FulfilledCont(Types...)>;
+    using Result = std::invoke_result_t<Promise_FulfilledCont, Types...>;
+
+    if (!d_data_sp && !dplp::Trampoline::isSaturated())
+        return thenReady<Result>(fulfilledCont, rejectedCont);
 
     return Result([
         this,
         fulfilledCont = std::move(fulfilledCont),
         rejectedCont  = std::move(rejectedCont)
     ](auto fulfill, auto reject) mutable {
-        d_data_sp->postContinuations(
-            [ fulfilledCont = std::move(fulfilledCont), fulfill, reject ](
-                Types... t) mutable {
-                try {
-                    Result innerPromise =
-                        std::invoke(std::move(fulfilledCont), t...);
-                    innerPromise.d_data_sp->postContinuations(fulfill, reject);
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            },
-            [ rejectedCont = std::move(rejectedCont), fulfill, reject ](
-                std::exception_ptr e) mutable {
-                try {
-                    Result innerPromise =
-                        std::invoke(std::move(rejectedCont), e);
-                    innerPromise.d_data_sp->postContinuations(fulfill, reject);
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            });
+        postContinuations(
+            continuation<Types...>(std::move(fulfilledCont), fulfill, reject),
+            continuation<std::exception_ptr>(
+                std::move(rejectedCont), fulfill, reject));
     });
 }
 
 template <typename... Types>
 template <typename Promise_FulfilledCont>
 requires Promise_PromiseFulfilledCont<Promise_FulfilledCont, Types...> auto
-Promise<Types...>::then(Promise_FulfilledCont fulfilledCont) const
-    -> std::result_of_t<Promise_FulfilledCont(Types...)>
+Promise<Types...>::then(Promise_FulfilledCont fulfilledCont) const&
+    -> std::invoke_result_t<Promise_FulfilledCont, Types...>
 {
-    using Result = std::result_of_t<Promise_FulfilledCont(Types...)>;
+    using Result = std::invoke_result_t<Promise_FulfilledCont, Types...>;
+
+    if (!d_data_sp && !dplp::Trampoline::isSaturated())
+        return thenReady<Result>(fulfilledCont);
 
     return Result([ this, fulfilledCont = std::move(fulfilledCont) ](
         auto fulfill, auto reject) mutable {
-        d_data_sp->postContinuations(
-            [ fulfilledCont = std::move(fulfilledCont), fulfill, reject ](
-                Types... t) mutable {
-                try {
-                    Result innerPromise =
-                        std::invoke(std::move(fulfilledCont), t...);
-                    innerPromise.d_data_sp->postContinuations(fulfill, reject);
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            },
+        postContinuations(
+            continuation<Types...>(std::move(fulfilledCont), fulfill, reject),
             reject);
     });
 }
@@ -781,82 +945,309 @@ template <typename Promise_FulfilledCont, typename Promise_RejectedCont>
 requires
     Promise_Conts<Promise_FulfilledCont, Promise_RejectedCont, Types...> auto
     Promise<Types...>::then(Promise_FulfilledCont fulfilledCont,
-                            Promise_RejectedCont  rejectedCont) const
-    -> Promise<std::result_of_t<Promise_FulfilledCont(Types...)> >
+                            Promise_RejectedCont  rejectedCont) const&
+    -> Promise<std::invoke_result_t<Promise_FulfilledCont, Types...> >
 {
-    using U = std::result_of_t<Promise_FulfilledCont(Types...)>;
+    using U = std::invoke_result_t<Promise_FulfilledCont, Types...>;
+
+    if (!d_data_sp && !dplp::Trampoline::isSaturated())
+        return thenReady<Promise<U> >(fulfilledCont, rejectedCont);
 
     return Promise<U>([
         this,
         fulfilledCont = std::move(fulfilledCont),
         rejectedCont  = std::move(rejectedCont)
     ](auto fulfill, auto reject) mutable {
-        d_data_sp->postContinuations(
-            [ fulfilledCont = std::move(fulfilledCont), fulfill, reject ](
-                Types... t) mutable {
-                try {
-                    fulfill(std::invoke(std::move(fulfilledCont), t...));
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            },
-            [ rejectedCont = std::move(rejectedCont), fulfill, reject ](
-                std::exception_ptr e) mutable {
-                try {
-                    fulfill(std::invoke(std::move(rejectedCont), e));
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            });
+        postContinuations(
+            continuation<Types...>(std::move(fulfilledCont), fulfill, reject),
+            continuation<std::exception_ptr>(
+                std::move(rejectedCont), fulfill, reject));
     });
 }
 
 template <typename... Types>
 template <typename FC> requires Promise_FulfilledCont<FC, Types...> auto
-Promise<Types...>::then(
-            FC fulfilledCont) const -> Promise<std::result_of_t<FC(Types...)> >
+Promise<Types...>::then(FC fulfilledCont) const&
+    -> Promise<std::invoke_result_t<FC, Types...> >
 {
-    using U = std::result_of_t<FC(Types...)>;
+    using U = std::invoke_result_t<FC, Types...>;
+
+    if (!d_data_sp && !dplp::Trampoline::isSaturated())
+        return thenReady<Promise<U> >(fulfilledCont);
 
     return Promise<U>([ this, fulfilledCont = std::move(fulfilledCont) ](
         auto fulfill, auto reject) mutable {
-        d_data_sp->postContinuations(
-            [ fulfilledCont = std::move(fulfilledCont), fulfill, reject ](
-                Types... t) mutable {
-                try {
-                    fulfill(std::invoke(std::move(fulfilledCont), t...));
-                }
-                catch (...) {
-                    reject(std::current_exception());
-                }
-            },
-            [reject](std::exception_ptr e) mutable { reject(e); });
+        postContinuations(
+            continuation<Types...>(std::move(fulfilledCont), fulfill, reject),
+            reject);
     });
 }
 
+template <typename... Types>
+template <typename FC, typename RC>
+requires Promise_TransformCont<FC, Types...> &&
+         Promise_Conts<FC, RC, Types...> Promise<Types...>
+         Promise<Types...>::then(FC fulfilledCont, RC rejectedCont) &&
+{
+    if (isReusable()) {
+        const bool reused = dplp::Trampoline::call([&] {
+            return d_data_sp->transform(std::move(fulfilledCont),
+                                        std::move(rejectedCont));
+        });
+        if (reused)
+            return std::move(*this);
+    }
+    return std::as_const(*this).then(std::move(fulfilledCont),
+                                     std::move(rejectedCont));
+}
+
+template <typename... Types>
+template <typename FC>
+requires Promise_TransformCont<FC, Types...> Promise<Types...>
+Promise<Types...>::then(FC fulfilledCont) &&
+{
+    if (isReusable()) {
+        const bool reused = dplp::Trampoline::call(
+            [&] { return d_data_sp->transform(std::move(fulfilledCont)); });
+        if (reused)
+            return std::move(*this);
+    }
+    return std::as_const(*this).then(std::move(fulfilledCont));
+}
+
 template <typename... Types>
 Promise<Types...>::Promise()
-: d_data_sp(std::make_shared<PromiseState<Types...> >())
+: d_data_sp(makeState())
 {
 }
 
 template <typename... Types>
-Promise<std::decay_t<Types>...> makeFulfilledPromise(Types&&... values)
+Promise<Types...>::Promise(std::nullptr_t)
 {
-    Promise<std::decay_t<Types>...> result;
-    result.d_data_sp->fulfill(std::forward<Types>(values)...);
+}
+
+template <typename... Types>
+std::shared_ptr<dplp::PromiseState<Types...> > Promise<Types...>::makeState()
+{
+    return std::allocate_shared<PromiseState<Types...> >(
+        std::pmr::polymorphic_allocator<PromiseState<Types...> >(
+            dplp::DefaultResource::get()));
+}
+
+template <typename... Types>
+template <typename... Values>
+Promise<Types...> Promise<Types...>::makeFulfilled(Values&&... values)
+{
+    Promise result(nullptr);
+    if constexpr (Promise_IsInlineable<Types...>::value) {
+        result.d_ready.template emplace<k_FULFILLED>(
+            std::forward<Values>(values)...);
+    }
+    else {
+        result.d_data_sp = makeState();
+        result.d_data_sp->fulfill(Types(std::forward<Values>(values))...);
+    }
     return result;
 }
 
 template <typename... Types>
-Promise<Types...> makeRejectedPromise(std::exception_ptr error)
+Promise<Types...> Promise<Types...>::makeRejected(std::exception_ptr error)
 {
-    Promise<Types...> result;
-    result.d_data_sp->reject(std::move(error));
+    Promise result(nullptr);
+    result.d_ready.template emplace<k_REJECTED>(std::move(error));
     return result;
 }
+
+template <typename... Types>
+template <typename F>
+Promise<Types...> Promise<Types...>::resolveWith(F&& function)
+{
+    using R = std::invoke_result_t<F>;
+
+    const auto resolve = [&]() -> Promise {
+        if constexpr (std::is_void_v<R>) {
+            std::invoke(std::forward<F>(function));
+            return makeFulfilled();
+        }
+        else if constexpr (dplmrts::AnyTuple<R>) {
+            return std::apply(
+                [](auto&&... values) {
+                    return makeFulfilled(
+                        std::forward<decltype(values)>(values)...);
+                },
+                std::invoke(std::forward<F>(function)));
+        }
+        else if constexpr (dplp::AnyPromise<R>) {
+            return std::invoke(std::forward<F>(function));
+        }
+        else {
+            return makeFulfilled(std::invoke(std::forward<F>(function)));
+        }
+    };
+
+    // The values of an inlineable promise are moved into place without
+    // allocating, so only 'function' could throw.
+    if constexpr (Promise_IsInlineable<Types...>::value &&
+                  Promise_IsNothrowCont<F>::value) {
+        return resolve();
+    }
+    else {
+        try {
+            return resolve();
+        }
+        catch (...) {
+            return makeRejected(std::current_exception());
+        }
+    }
+}
+
+template <typename... Types>
+bool Promise<Types...>::isReusable() const
+{
+    if (!d_data_sp || d_data_sp.use_count() != 1 ||
+        dplp::Trampoline::isSaturated())
+        return false;
+
+    // The fence makes the writes of the threads that released their
+    // references to the state visible.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+template <typename... Types>
+template <typename Fulfill, typename F>
+void Promise<Types...>::fulfillWith(Fulfill& fulfill, F&& function)
+{
+    using R = std::invoke_result_t<F>;
+
+    if constexpr (std::is_void_v<R>) {
+        std::invoke(std::forward<F>(function));
+        fulfill();
+    }
+    else if constexpr (dplmrts::AnyTuple<R>) {
+        std::apply(fulfill, std::invoke(std::forward<F>(function)));
+    }
+    else {
+        fulfill(std::invoke(std::forward<F>(function)));
+    }
+}
+
+template <typename... Types>
+template <typename... Args, typename Cont, typename Fulfill, typename Reject>
+auto Promise<Types...>::continuation(Cont cont, Fulfill fulfill, Reject reject)
+{
+    if constexpr (Promise_IsNothrowCont<Cont, Args...>::value) {
+        return [ cont = std::move(cont), fulfill = std::move(fulfill) ](
+            Args... args) mutable noexcept {
+            fulfillWith(fulfill, [&] {
+                return Promise_InvokeUtil::invoke(std::move(cont), args...);
+            });
+        };
+    }
+    else {
+        return [
+            cont    = std::move(cont),
+            fulfill = std::move(fulfill),
+            reject  = std::move(reject)
+        ](Args... args) mutable {
+            using R = std::invoke_result_t<Cont, Args&...>;
+
+            try {
+                if constexpr (dplp::AnyPromise<R>) {
+                    Promise_InvokeUtil::invoke(std::move(cont), args...)
+                        .postContinuations(fulfill, reject);
+                }
+                else {
+                    fulfillWith(fulfill, [&] {
+                        return Promise_InvokeUtil::invoke(std::move(cont),
+                                                          args...);
+                    });
+                }
+            }
+            catch (...) {
+                reject(std::current_exception());
+            }
+        };
+    }
+}
+
+template <typename... Types>
+template <typename Result, typename FulfilledCont>
+Result Promise<Types...>::thenReady(FulfilledCont& fulfilledCont) const
+{
+    if constexpr (Promise_IsInlineable<Types...>::value) {
+        if (d_ready.index() == k_FULFILLED) {
+            // The continuation is called with copies of the values, as it
+            // would be by the shared state.
+            auto values = dplm17::get<k_FULFILLED>(d_ready);
+            return dplp::Trampoline::call([&] {
+                return Result::resolveWith([&] {
+                    return std::apply(std::move(fulfilledCont), values);
+                });
+            });
+        }
+    }
+    return Result::makeRejected(dplm17::get<k_REJECTED>(d_ready));
+}
+
+template <typename... Types>
+template <typename Result, typename FulfilledCont, typename RejectedCont>
+Result Promise<Types...>::thenReady(FulfilledCont& fulfilledCont,
+                                    RejectedCont&  rejectedCont) const
+{
+    if (d_ready.index() == k_REJECTED) {
+        const std::exception_ptr& error = dplm17::get<k_REJECTED>(d_ready);
+        return dplp::Trampoline::call([&] {
+            return Result::resolveWith(
+                [&] { return std::invoke(std::move(rejectedCont), error); });
+        });
+    }
+    return thenReady<Result>(fulfilledCont);
+}
+
+template <typename... Types>
+template <typename FulfilledCont, typename RejectedCont>
+void Promise<Types...>::postContinuations(FulfilledCont&& fulfilledCont,
+                                          RejectedCont&&  rejectedCont) const
+{
+    if (d_data_sp) {
+        d_data_sp->postContinuations(
+            std::forward<FulfilledCont>(fulfilledCont),
+            std::forward<RejectedCont>(rejectedCont));
+    }
+    else if (d_ready.index() == k_REJECTED) {
+        dplp::Trampoline::run([
+            f     = std::forward<RejectedCont>(rejectedCont),
+            error = dplm17::get<k_REJECTED>(d_ready)
+        ]() mutable { std::invoke(std::move(f), std::move(error)); });
+    }
+    else if constexpr (Promise_IsInlineable<Types...>::value) {
+        dplp::Trampoline::run([
+            f      = std::forward<FulfilledCont>(fulfilledCont),
+            values = dplm17::get<k_FULFILLED>(d_ready)
+        ]() mutable { std::apply(std::move(f), std::move(values)); });
+    }
+}
+
+template <typename... Types>
+Promise<std::decay_t<Types>...> makeFulfilledPromise(Types&&... values)
+{
+    return Promise<std::decay_t<Types>...>::makeFulfilled(
+        std::forward<Types>(values)...);
+}
+
+template <typename... Types>
+Promise<Types...> makeRejectedPromise(std::exception_ptr error)
+{
+    return Promise<Types...>::makeRejected(std::move(error));
+}
+
+// The following are instantiated in 'dplp_promise.cpp'.
+extern template class Promise<>;
+extern template class Promise<int>;
+extern template class Promise<std::string>;
+extern template class Promise<std::vector<char> >;
+extern template class Promise<dplm17::monostate>;
 }
 
 #endif
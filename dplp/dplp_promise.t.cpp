@@ -3,6 +3,10 @@
 #include <dplm17_variant.h>
 #include <gtest/gtest.h>
 
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <stdexcept>
 #include <string>
 
 TEST(dplp_promise, basic)
@@ -230,7 +234,7 @@ TEST(dplp_promise, invoke)
 
     bool fulfilled = false;
 
-    std::experimental::apply(std::move(&C::f), std::tuple<C>(C()));
+    std::apply(std::move(&C::f), std::tuple<C>(C()));
 
     p.then(&C::f).then([&fulfilled](int i) {
         fulfilled = true;
@@ -239,6 +243,168 @@ TEST(dplp_promise, invoke)
     EXPECT_TRUE(fulfilled) << "Promise wasn't fulfilled.";
 }
 
+TEST(dplp_promise, inline_results)
+{
+    // Promises created resolved hold their results inline and run
+    // continuations synchronously. These cases check that they behave like
+    // promises with a state.
+
+    const int          i = 3;
+    dplp::Promise<int> p = dplp::makeFulfilledPromise(i);
+
+    std::exception_ptr error;
+    p.then([](int) -> int { throw std::runtime_error("test"); })
+        .then([](int i) { ADD_FAILURE() << "Unexpected fulfillment."; },
+              [&](std::exception_ptr e) { error = e; });
+    EXPECT_TRUE(error) << "Exception in continuation wasn't propagated.";
+
+    int result = 0;
+    dplp::makeRejectedPromise<int>(error)
+        .then([](int i) { return i; }, [](std::exception_ptr) { return 7; })
+        .then([&](int i) { result = i; });
+    EXPECT_EQ(result, 7) << "Rejected continuation wasn't called.";
+
+    // A continuation returning a waiting promise defers the rest of the
+    // chain.
+    std::function<void(int)> fulfill;
+    result = 0;
+    p.then([&](int) {
+         return dplp::Promise<int>([&](auto f, auto) { fulfill = f; });
+     }).then([&](int i) { result = i; });
+    EXPECT_EQ(result, 0);
+    fulfill(5);
+    EXPECT_EQ(result, 5);
+
+    // Large values are held in a state, but behave the same way.
+    std::string s;
+    dplp::makeFulfilledPromise(std::string(100, 'a'))
+        .then([](std::string s) { return s.size(); })
+        .then([&](std::size_t n) { s = std::to_string(n); });
+    EXPECT_EQ(s, "100");
+}
+
+TEST(dplp_promise, nothrow_continuations)
+{
+    const auto increment = [](int i) noexcept { return i + 1; };
+    const auto recover   = [](std::exception_ptr) noexcept { return 0; };
+    const auto parse     = [](int i) { return std::to_string(i); };
+
+    static_assert(
+        dplp::Promise_IsNothrowCont<decltype(increment), int>::value);
+    static_assert(
+        dplp::Promise_IsNothrowCont<decltype(recover),
+                                    std::exception_ptr>::value);
+    static_assert(!dplp::Promise_IsNothrowCont<decltype(parse), int>::value);
+    static_assert(!dplp::Promise_IsNothrowCont<
+                  decltype([](int i) noexcept {
+                      return dplp::makeFulfilledPromise(i);
+                  }),
+                  int>::value);
+
+    std::function<void(int)>                fulfill;
+    std::function<void(std::exception_ptr)> reject;
+    const auto resolver = [&](auto f, auto r) {
+        fulfill = f;
+        reject  = r;
+    };
+
+    std::string result;
+    dplp::Promise<int>(resolver)
+        .then(increment)
+        .then(increment, recover)
+        .then(parse)
+        .then([&](std::string s) noexcept { result = std::move(s); });
+    fulfill(1);
+    EXPECT_EQ(result, "3");
+
+    dplp::Promise<int>(resolver)
+        .then(increment)
+        .then(increment, recover)
+        .then(parse)
+        .then([&](std::string s) noexcept { result = std::move(s); });
+    reject(std::make_exception_ptr(std::runtime_error("test")));
+    EXPECT_EQ(result, "0") << "Rejection wasn't recovered from.";
+}
+
+namespace {
+struct Counted {
+    // A value counting the number of times it is copied or moved. Its move
+    // constructor may throw, so promises hold it in a state.
+
+    static int s_numCopies;
+
+    Counted() = default;
+    Counted(const Counted&) { ++s_numCopies; }
+    Counted(Counted&&) { ++s_numCopies; }
+    Counted& operator=(const Counted&) = default;
+    Counted& operator=(Counted&&) = default;
+};
+
+int Counted::s_numCopies = 0;
+}
+
+TEST(dplp_promise, continuation_copies)
+{
+    // Each continuation called directly gets the values by reference, so
+    // the only copies are the ones its by-value parameters make: one by the
+    // continuation 'then' wraps the given one in and, for a waiting state,
+    // one by the 'std::function' holding it.
+
+    std::function<void(Counted)> fulfill;
+    const auto                   resolver = [&](auto f, auto) { fulfill = f; };
+
+    const dplp::Promise<Counted> unobserved(resolver);
+    Counted::s_numCopies = 0;
+    fulfill(Counted());
+    const int numFulfillCopies = Counted::s_numCopies;
+
+    dplp::Promise<Counted> p(resolver);
+    int                    numCalls = 0;
+    for (int i = 0; i < 3; ++i)
+        p.then([&](const Counted&) { ++numCalls; });
+    Counted::s_numCopies = 0;
+    fulfill(Counted());
+    EXPECT_EQ(numCalls, 3);
+    EXPECT_EQ(Counted::s_numCopies, numFulfillCopies + 2 * 3);
+
+    Counted::s_numCopies = 0;
+    p.then([&](const Counted&) { ++numCalls; });
+    EXPECT_EQ(numCalls, 4);
+    EXPECT_EQ(Counted::s_numCopies, 1);
+}
+
+TEST(dplp_promise, rejection_forwarding)
+{
+    // Rejections skip through 'then's without rejected continuations, but
+    // promises that are still referred to are rejected as usual.
+
+    std::function<void(std::exception_ptr)> reject;
+    dplp::Promise<int> head([&](auto, auto r) { reject = r; });
+
+    dplp::Promise<int> p = head;
+    for (int i = 0; i < 10; ++i)
+        p = p.then([](int i) { return i + 1; });
+    const dplp::Promise<std::string> middle =
+        p.then([](int i) { return std::to_string(i); });
+    dplp::Promise<> tail = middle.then([](std::string) {});
+    for (int i = 0; i < 10; ++i)
+        tail = tail.then([] {});
+
+    std::exception_ptr error;
+    tail.then([] { ADD_FAILURE() << "Unexpected fulfillment."; },
+              [&](std::exception_ptr e) { error = e; });
+
+    const std::exception_ptr expected =
+        std::make_exception_ptr(std::runtime_error("test"));
+    reject(expected);
+    EXPECT_EQ(error, expected);
+
+    error = nullptr;
+    middle.then([](std::string) { ADD_FAILURE() << "Fulfilled."; },
+                [&](std::exception_ptr e) { error = e; });
+    EXPECT_EQ(error, expected) << "Referred to promise wasn't rejected.";
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -1,5 +1,151 @@
 #include <dplp_promisestate.h>
 
+#include <dplm17_variant.h>
+#include <dplp_trampoline.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dplp {
+namespace {
+
+class WaiterTask {
+    // This class runs a waiter through 'dplp::Trampoline'. It holds a copy of
+    // the error, as the state may be gone by the time a queued task runs,
+    // and discards the waiter if destroyed without running it.
+
+    PromiseState_Waiter *d_waiter_p;
+    std::exception_ptr   d_error;
+    bool                 d_rejected;
+
+  public:
+    WaiterTask(PromiseState_Waiter *waiter, const std::exception_ptr *error)
+    : d_waiter_p(waiter)
+    , d_error(error ? *error : std::exception_ptr())
+    , d_rejected(error)
+    {
+    }
+
+    WaiterTask(WaiterTask&& other) noexcept
+    : d_waiter_p(std::exchange(other.d_waiter_p, nullptr))
+    , d_error(std::move(other.d_error))
+    , d_rejected(other.d_rejected)
+    {
+    }
+
+    ~WaiterTask()
+    {
+        if (d_waiter_p)
+            d_waiter_p->discard();
+    }
+
+    void operator()()
+    {
+        std::exchange(d_waiter_p, nullptr)
+            ->run(d_rejected ? &d_error : nullptr);
+    }
+};
+
+void runWaiter(PromiseState_Waiter *waiter, const std::exception_ptr *error)
+    // Run the specified 'waiter' with the specified 'error', or queue it if
+    // the current thread is too deep in continuations.
+{
+    dplp::Trampoline::run(WaiterTask(waiter, error));
+}
+
+void runWaiters(std::uintptr_t list, const std::exception_ptr *error)
+    // Run the waiters in the specified 'list', in the order they were
+    // posted, with the specified 'error'. If a continuation throws, the
+    // waiters after it are discarded.
+{
+    // The list is most recent first.
+    PromiseState_Waiter *head = reinterpret_cast<PromiseState_Waiter *>(list);
+    PromiseState_Waiter *reversed = nullptr;
+    while (head) {
+        PromiseState_Waiter *const next = head->d_next_p;
+        head->d_next_p                  = reversed;
+        reversed                        = head;
+        head                            = next;
+    }
+
+    struct Guard {
+        PromiseState_Waiter **d_list_p;
+
+        ~Guard()
+        {
+            while (PromiseState_Waiter *const waiter = *d_list_p) {
+                *d_list_p = waiter->d_next_p;
+                waiter->discard();
+            }
+        }
+    } guard{&reversed};
+
+    while (PromiseState_Waiter *const waiter = reversed) {
+        reversed = waiter->d_next_p;
+        runWaiter(waiter, error);
+    }
+}
+}
+
+PromiseState<>::PromiseState()
+: d_word(0)
+{
+}
+
+PromiseState<>::~PromiseState()
+{
+    const std::uintptr_t word = d_word.load(std::memory_order_acquire);
+    if (word != k_FULFILLED && word != k_REJECTED) {
+        PromiseState_Waiter *waiter =
+            reinterpret_cast<PromiseState_Waiter *>(word);
+        while (waiter) {
+            PromiseState_Waiter *const next = waiter->d_next_p;
+            waiter->discard();
+            waiter = next;
+        }
+    }
+}
+
+void PromiseState<>::post(PromiseState_Waiter *waiter)
+{
+    std::uintptr_t word = d_word.load(std::memory_order_acquire);
+    do {
+        if (word == k_FULFILLED) {
+            runWaiter(waiter, nullptr);
+            return;
+        }
+        if (word == k_REJECTED) {
+            runWaiter(waiter, &d_error);
+            return;
+        }
+        waiter->d_next_p = reinterpret_cast<PromiseState_Waiter *>(word);
+    } while (!d_word.compare_exchange_weak(
+        word,
+        reinterpret_cast<std::uintptr_t>(waiter),
+        std::memory_order_acq_rel,
+        std::memory_order_acquire));
+}
+
+void PromiseState<>::fulfill()
+{
+    runWaiters(d_word.exchange(k_FULFILLED, std::memory_order_acq_rel),
+               nullptr);
+}
+
+void PromiseState<>::reject(std::exception_ptr error)
+{
+    d_error = std::move(error);
+    runWaiters(d_word.exchange(k_REJECTED, std::memory_order_acq_rel),
+               &d_error);
+}
+
+template class PromiseState<int>;
+template class PromiseState<std::string>;
+template class PromiseState<std::vector<char> >;
+template class PromiseState<dplm17::monostate>;
+}
+
 // ----------------------------------------------------------------------------
 // Copyright 2017 Bloomberg Finance L.P.
 //
@@ -5,6 +5,7 @@
 //
 //@CLASSES:
 //  dplp::PromiseState: low-level promise class
+//  dplp::PromiseState_Waiter: posted continuations of a 'PromiseState<>'
 //
 //@DESCRIPTION: This component provides a single class, 'dplp::PromiseState',
 // which represents an asynchronous value, but with very low-level operations.
@@ -27,11 +28,44 @@
 // Thread Safety
 // -------------
 // This class is fully thread safe.
+//
+// Empty Promise State
+// -------------------
+// 'dplp::PromiseState<>', the state of the completion signals that
+// 'dplp::Promise<>' is used for, is specialized to be lock-free and two words
+// in size. Its state is a single atomic word: a tag if it is fulfilled or
+// rejected, and otherwise the head of an intrusive list of posted
+// continuations, which is pushed to with a compare-and-swap and taken with an
+// exchange on resolution. The error of a rejected state is stored next to
+// that word before the tag is published. Each posted continuation pair is
+// allocated from the 'dplp::DefaultResource' current when it is posted.
+// Continuations posted to a state that is already resolved are called without
+// allocating, unless 'dplp::Trampoline' queues them.
+//
+// Explicit Instantiations
+// -----------------------
+// The library contains explicit instantiations of 'dplp::PromiseState' for
+// 'int', 'std::string', 'std::vector<char>', and 'dplm17::monostate' values,
+// which include the state transitions and the state variant's operations.
+// They are declared 'extern' here, so other translation units do not
+// instantiate them again.
 
+#include <dplm17_variant.h>
+#include <dplp_defaultresource.h>
 #include <dplp_promisestateimp.h>
 #include <dplp_promisestateimputil.h>
+#include <dplp_trampoline.h>
 
-#include <utility>  // std::forward, std::move
+#include <atomic>           // std::atomic
+#include <cstdint>          // std::uintptr_t
+#include <exception>        // std::exception_ptr
+#include <functional>       // std::invoke
+#include <memory>           // std::shared_ptr
+#include <memory_resource>  // std::pmr::vector
+#include <string>           // std::string
+#include <type_traits>      // std::decay_t
+#include <utility>          // std::forward, std::move
+#include <vector>           // std::vector
 
 namespace dplp {
 
@@ -43,7 +77,19 @@ class PromiseState {
 
     PromiseStateImp<Types...> d_imp;
 
+    static void rejectState(void *state, std::exception_ptr error);
+    static void releaseRejectedContinuations(
+             void                                                     *state,
+             std::pmr::vector<PromiseStateImpForwarder::RejectedCont> *stack);
+        // Implement the operations of 'forwarder'.
+
   public:
+    static PromiseStateImpForwarder
+    forwarder(std::shared_ptr<PromiseState> state);
+        // Return a rejected continuation that rejects the specified 'state'
+        // and that lets rejections be forwarded through it without locking
+        // when nothing else refers to 'state'.
+
     void fulfill(Types&&... fulfillValues);
         // Move to the "fulfilled" state using the specified 'fulfillValues'.
         // If there are any posted fulfilled continuations, call them with
@@ -61,12 +107,145 @@ class PromiseState {
         // posted continuation. If in the 'fufilled' state, call
         // 'fulfilledCont' with the fulfill values. Finally, if in the rejected
         // state, call 'rejectedCont' with the rejected value.
+
+    bool isResolved();
+        // Return 'true' if this object is in the fulfilled or rejected state,
+        // and 'false' otherwise.
+
+    template <typename FulfilledCont>
+    bool transform(FulfilledCont&& fulfilledCont);
+    template <typename FulfilledCont, typename RejectedCont>
+    bool transform(FulfilledCont&& fulfilledCont, RejectedCont&& rejectedCont);
+        // Resolve this object again, with the result of calling the specified
+        // 'fulfilledCont' with its values if it is fulfilled or, if it is
+        // rejected, of calling the optionally specified 'rejectedCont' with
+        // its error, or with the exception either throws. If 'rejectedCont'
+        // is not specified, a rejected object is left as is. Return 'true' if
+        // this object is fulfilled or rejected, and 'false' otherwise. The
+        // behavior is undefined unless no other thread refers to this object.
+        // See 'PromiseStateImpUtil::transform'.
+};
+
+class PromiseState_Waiter {
+    // This class is the base of the nodes in the list of continuations posted
+    // to a 'PromiseState<>'.
+
+  public:
+    PromiseState_Waiter *d_next_p;
+
+    virtual void run(const std::exception_ptr *error) = 0;
+        // Destroy this object and call its fulfilled continuation if the
+        // specified 'error' is null, or its rejected continuation with
+        // '*error' otherwise.
+
+    virtual void discard() = 0;
+        // Destroy this object without calling its continuations.
+
+  protected:
+    ~PromiseState_Waiter() = default;
+};
+
+template <typename FulfilledCont, typename RejectedCont>
+class PromiseState_WaiterImp
+: public PromiseState_Waiter
+, public dplp::DefaultResourceNode<
+      PromiseState_WaiterImp<FulfilledCont, RejectedCont> > {
+    // This class implements a posted pair of continuations, allocated from
+    // the default resource by 'create'.
+
+    FulfilledCont d_fulfilledCont;
+    RejectedCont  d_rejectedCont;
+
+    friend class dplp::DefaultResourceNode<PromiseState_WaiterImp>;
+
+    template <typename F, typename R>
+    PromiseState_WaiterImp(F&& fulfilledCont, R&& rejectedCont);
+
+  public:
+    void run(const std::exception_ptr *error) override;
+    void discard() override;
+};
+
+template <>
+class PromiseState<> {
+    // This specialization implements a lock-free promise state without
+    // values. See "Empty Promise State" in the component documentation.
+
+    enum : std::uintptr_t { k_FULFILLED = 1, k_REJECTED = 2 };
+        // The values of 'd_word' for resolved states. Any other value is the
+        // head of the list of waiters, which are suitably aligned.
+
+    std::atomic<std::uintptr_t> d_word;
+    std::exception_ptr          d_error;  // set before 'k_REJECTED'
+
+    void post(PromiseState_Waiter *waiter);
+        // Add the specified 'waiter' to the list or, if this state has been
+        // resolved in the meantime, run it.
+
+    static void rejectState(void *state, std::exception_ptr error);
+        // Implement the operation of 'forwarder'.
+
+  public:
+    static PromiseStateImpForwarder
+    forwarder(std::shared_ptr<PromiseState> state);
+        // Return a rejected continuation that rejects the specified 'state'.
+
+    PromiseState();
+        // Create a 'PromiseState' object in the waiting state.
+
+    PromiseState(const PromiseState&) = delete;
+    PromiseState& operator=(const PromiseState&) = delete;
+
+    ~PromiseState();
+        // Destroy this object, discarding any posted continuations.
+
+    void fulfill();
+        // Move to the "fulfilled" state and call the fulfilled continuations
+        // posted so far, in the order they were posted.
+
+    void reject(std::exception_ptr error);
+        // Move to the "rejected" state using the specified 'error' and call
+        // the rejected continuations posted so far, in the order they were
+        // posted.
+
+    template <typename FulfilledCont, typename RejectedCont>
+    void postContinuations(FulfilledCont&& fulfilledCont,
+                           RejectedCont&&  rejectedCont);
+        // Post the specified 'fulfilledCont' and 'rejectedCont'
+        // continuations, or call one of them if already resolved.
+
+    bool isResolved();
+        // Return 'true' if this object is in the fulfilled or rejected state,
+        // and 'false' otherwise.
 };
 
 // ============================================================================
 //                                 INLINE DEFINITIONS
 // ============================================================================
 
+template <typename... Types>
+void PromiseState<Types...>::rejectState(void *state, std::exception_ptr error)
+{
+    static_cast<PromiseState *>(state)->reject(std::move(error));
+}
+
+template <typename... Types>
+void PromiseState<Types...>::releaseRejectedContinuations(
+              void                                                     *state,
+              std::pmr::vector<PromiseStateImpForwarder::RejectedCont> *stack)
+{
+    dplp::PromiseStateImpUtil::releaseRejectedContinuations(
+        &static_cast<PromiseState *>(state)->d_imp, stack);
+}
+
+template <typename... Types>
+PromiseStateImpForwarder
+PromiseState<Types...>::forwarder(std::shared_ptr<PromiseState> state)
+{
+    return PromiseStateImpForwarder{
+        std::move(state), &rejectState, &releaseRejectedContinuations};
+}
+
 template <typename... Types>
 void PromiseState<Types...>::fulfill(Types&&... fulfillValues)
 {
@@ -90,6 +269,111 @@ void PromiseState<Types...>::postContinuations(FulfilledCont&& fulfilledCont,
         std::forward<FulfilledCont>(fulfilledCont),
         std::forward<RejectedCont>(rejectedCont));
 }
+
+template <typename... Types>
+bool PromiseState<Types...>::isResolved()
+{
+    return dplp::PromiseStateImpUtil::isResolved(&d_imp);
+}
+
+template <typename... Types>
+template <typename FulfilledCont>
+bool PromiseState<Types...>::transform(FulfilledCont&& fulfilledCont)
+{
+    return dplp::PromiseStateImpUtil::transform(
+        &d_imp, std::forward<FulfilledCont>(fulfilledCont));
+}
+
+template <typename... Types>
+template <typename FulfilledCont, typename RejectedCont>
+bool PromiseState<Types...>::transform(FulfilledCont&& fulfilledCont,
+                                       RejectedCont&&  rejectedCont)
+{
+    return dplp::PromiseStateImpUtil::transform(
+        &d_imp,
+        std::forward<FulfilledCont>(fulfilledCont),
+        std::forward<RejectedCont>(rejectedCont));
+}
+
+template <typename FulfilledCont, typename RejectedCont>
+template <typename F, typename R>
+PromiseState_WaiterImp<FulfilledCont, RejectedCont>::PromiseState_WaiterImp(
+                                                         F&& fulfilledCont,
+                                                         R&& rejectedCont)
+: d_fulfilledCont(std::forward<F>(fulfilledCont))
+, d_rejectedCont(std::forward<R>(rejectedCont))
+{
+}
+
+template <typename FulfilledCont, typename RejectedCont>
+void PromiseState_WaiterImp<FulfilledCont, RejectedCont>::run(
+                                               const std::exception_ptr *error)
+{
+    if (error)
+        std::invoke(this->take(&PromiseState_WaiterImp::d_rejectedCont),
+                    *error);
+    else
+        std::invoke(this->take(&PromiseState_WaiterImp::d_fulfilledCont));
+}
+
+template <typename FulfilledCont, typename RejectedCont>
+void PromiseState_WaiterImp<FulfilledCont, RejectedCont>::discard()
+{
+    this->destroy();
+}
+
+template <typename FulfilledCont, typename RejectedCont>
+void PromiseState<>::postContinuations(FulfilledCont&& fulfilledCont,
+                                       RejectedCont&&  rejectedCont)
+{
+    const std::uintptr_t word = d_word.load(std::memory_order_acquire);
+    if (word == k_FULFILLED) {
+        dplp::Trampoline::run(
+            [f = std::forward<FulfilledCont>(fulfilledCont)]() mutable {
+                std::invoke(std::move(f));
+            });
+    }
+    else if (word == k_REJECTED) {
+        dplp::Trampoline::run([
+            f     = std::forward<RejectedCont>(rejectedCont),
+            error = d_error
+        ]() mutable { std::invoke(std::move(f), std::move(error)); });
+    }
+    else {
+        post(PromiseState_WaiterImp<std::decay_t<FulfilledCont>,
+                                    std::decay_t<RejectedCont> >::
+                 create(std::forward<FulfilledCont>(fulfilledCont),
+                        std::forward<RejectedCont>(rejectedCont)));
+    }
+}
+
+inline
+void PromiseState<>::rejectState(void *state, std::exception_ptr error)
+{
+    static_cast<PromiseState *>(state)->reject(std::move(error));
+}
+
+inline
+PromiseStateImpForwarder
+PromiseState<>::forwarder(std::shared_ptr<PromiseState> state)
+{
+    // The waiters of this state hold both continuations of a pair, so its
+    // rejected continuations cannot be released on their own.
+    return PromiseStateImpForwarder{std::move(state), &rejectState, nullptr};
+}
+
+inline
+bool PromiseState<>::isResolved()
+{
+    const std::uintptr_t word = d_word.load(std::memory_order_acquire);
+    return word == k_FULFILLED || word == k_REJECTED;
+}
+
+// The following are instantiated in 'dplp_promisestate.cpp'.
+extern template class PromiseState<int>;
+extern template class PromiseState<std::string>;
+extern template class PromiseState<std::vector<char> >;
+extern template class PromiseState<dplm17::monostate>;
 }
 #endif
 
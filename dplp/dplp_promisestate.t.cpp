@@ -0,0 +1,144 @@
+#include <dplp_promisestate.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(dplp_promisestate, empty_size)
+{
+    EXPECT_EQ(sizeof(dplp::PromiseState<>), 2 * sizeof(void *));
+}
+
+TEST(dplp_promisestate, empty_fulfill)
+{
+    dplp::PromiseState<> state;
+    std::vector<int>     calls;
+    EXPECT_FALSE(state.isResolved());
+
+    state.postContinuations([&] { calls.push_back(1); },
+                            [&](std::exception_ptr) { calls.push_back(-1); });
+    state.postContinuations([&] { calls.push_back(2); },
+                            [&](std::exception_ptr) { calls.push_back(-2); });
+    EXPECT_TRUE(calls.empty());
+
+    state.fulfill();
+    EXPECT_TRUE(state.isResolved());
+    EXPECT_EQ(calls, std::vector<int>({1, 2})) << "Not called in order.";
+
+    // Already fulfilled.
+    state.postContinuations([&] { calls.push_back(3); },
+                            [&](std::exception_ptr) { calls.push_back(-3); });
+    EXPECT_EQ(calls, std::vector<int>({1, 2, 3}));
+}
+
+TEST(dplp_promisestate, empty_reject)
+{
+    dplp::PromiseState<> state;
+    std::exception_ptr   error;
+    bool                 fulfilled = false;
+
+    state.postContinuations([&] { fulfilled = true; },
+                            [&](std::exception_ptr e) { error = e; });
+    const std::exception_ptr expected =
+        std::make_exception_ptr(std::runtime_error("error"));
+    state.reject(expected);
+    EXPECT_TRUE(state.isResolved());
+    EXPECT_FALSE(fulfilled);
+    EXPECT_EQ(error, expected);
+
+    // Already rejected.
+    error = nullptr;
+    state.postContinuations([&] { fulfilled = true; },
+                            [&](std::exception_ptr e) { error = e; });
+    EXPECT_EQ(error, expected);
+}
+
+TEST(dplp_promisestate, empty_unresolved_destruction)
+{
+    std::shared_ptr<int> resource = std::make_shared<int>(0);
+    {
+        dplp::PromiseState<> state;
+        state.postContinuations([resource] {}, [](std::exception_ptr) {});
+        EXPECT_EQ(resource.use_count(), 2);
+    }
+    EXPECT_EQ(resource.use_count(), 1) << "Continuation leaked.";
+}
+
+TEST(dplp_promisestate, empty_concurrent)
+{
+    const int k_NUM_POSTERS = 4;
+    const int k_NUM_POSTS   = 1000;
+
+    dplp::PromiseState<> state;
+    std::atomic<int>     numCalls(0);
+    std::atomic<int>     numReady(0);
+
+    std::vector<std::thread> posters;
+    for (int i = 0; i < k_NUM_POSTERS; ++i) {
+        posters.emplace_back([&] {
+            ++numReady;
+            for (int j = 0; j < k_NUM_POSTS; ++j)
+                state.postContinuations([&] { ++numCalls; },
+                                        [](std::exception_ptr) {});
+        });
+    }
+    while (numReady != k_NUM_POSTERS)
+        std::this_thread::yield();
+    state.fulfill();
+    for (std::thread& poster : posters)
+        poster.join();
+
+    EXPECT_EQ(numCalls, k_NUM_POSTERS * k_NUM_POSTS);
+}
+
+TEST(dplp_promisestate, forwarder)
+{
+    auto head  = std::make_shared<dplp::PromiseState<int> >();
+    auto inner = std::make_shared<dplp::PromiseState<int> >();
+    auto held  = std::make_shared<dplp::PromiseState<int> >();
+
+    std::vector<int> calls;
+    inner->postContinuations([](int) {}, [&](std::exception_ptr) {
+        calls.push_back(1);
+    });
+    held->postContinuations([](int) {}, [&](std::exception_ptr) {
+        calls.push_back(2);
+    });
+
+    // 'inner' is referred to only by its forwarder.
+    head->postContinuations(
+        [](int) {},
+        dplp::PromiseState<int>::forwarder(std::move(inner)));
+    head->postContinuations([](int) {},
+                            dplp::PromiseState<int>::forwarder(held));
+
+    head->reject(std::make_exception_ptr(std::runtime_error("error")));
+    EXPECT_EQ(calls, std::vector<int>({1, 2})) << "Not called in order.";
+    EXPECT_TRUE(held->isResolved());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -5,6 +5,7 @@
 //
 //@CLASSES:
 //  dplp::PromiseStateImp: general promise state
+//  dplp::PromiseStateImpForwarder: rejected continuation rejecting a state
 //  dplp::PromiseStateImpFulfilled: fulfilled promise datatype
 //  dplp::PromiseStateImpRejected: rejected promise datatype
 //  dplp::PromiseStateImpWaiting: waiting promise datatype
@@ -21,29 +22,62 @@
 // protect its other data member. Use of this mutex is not enforced in any way.
 // The expectation is that higher-level components will insulate the user from
 // incorect mutex usage.
+//
+// 'dplp::PromiseStateImpForwarder' is the rejected continuation that forwards
+// a rejection to another promise state, whose type it erases. It is what
+// 'dplp::Promise::then' posts when it is given no rejected continuation, and
+// it lets 'dplp::PromiseStateImpUtil::reject' recognize such hops.
 
 #include <dplm17_variant.h>
+#include <dplp_defaultresource.h>
 
-#include <exception>   // std::exception_ptr
-#include <functional>  // std::function
-#include <mutex>       // std::mutex
-#include <tuple>       // std::tuple
-#include <utility>     // std::pair
+#include <exception>        // std::exception_ptr
+#include <functional>       // std::function
+#include <memory>           // std::shared_ptr
+#include <memory_resource>  // std::pmr::vector
+#include <mutex>            // std::mutex
+#include <tuple>            // std::tuple
+#include <utility>          // std::move, std::pair
 #include <vector>
 
 namespace dplp {
 
+struct PromiseStateImpForwarder {
+    // This class is a rejected continuation that rejects a promise state, of
+    // any type, with the error it is called with.
+
+    using RejectedCont = std::function<void(std::exception_ptr)>;
+
+    std::shared_ptr<void> d_state_sp;
+
+    void (*d_reject_p)(void *state, std::exception_ptr error);
+        // Reject 'state' with 'error'.
+
+    void (*d_release_p)(void                          *state,
+                        std::pmr::vector<RejectedCont> *stack);
+        // Push the rejected continuations of 'state' onto 'stack', last
+        // first, and clear its continuations without resolving it. This is
+        // null if 'state' does not support it. The behavior is undefined
+        // unless 'state' is waiting and nothing else refers to it.
+
+    void operator()(std::exception_ptr error) const noexcept;
+        // Reject the state with the specified 'error'.
+};
+
 template <typename... Types>
 struct PromiseStateImpWaiting {
     // This class is a value semantic type that implements the internal state
     // of a promise in the waiting state. The template parameters correspond to
     // the types of the values this promise contains.
 
+    using Continuation = std::pair<std::function<void(Types...)>,
+                                   std::function<void(std::exception_ptr)> >;
+
     // The waiting state includes a list of functions to be called when
-    // fulfilment or rejection occurs.
-    std::vector<std::pair<std::function<void(Types...)>,
-                          std::function<void(std::exception_ptr)> > >
-        d_continuations;
+    // fulfilment or rejection occurs. The list is allocated from the
+    // 'dplp::DefaultResource' of the thread creating the state.
+    std::pmr::vector<Continuation> d_continuations{
+        dplp::DefaultResource::get()};
 };
 
 template <typename... Types>
@@ -77,6 +111,17 @@ struct PromiseStateImp {
 
     std::mutex d_mutex;
 };
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+void PromiseStateImpForwarder::operator()(std::exception_ptr error) const
+    noexcept
+{
+    d_reject_p(d_state_sp.get(), std::move(error));
+}
 }
 
 #endif
@@ -1,5 +1,41 @@
 #include <dplp_promisestateimputil.h>
 
+#include <atomic>
+
+namespace dplp {
+
+void PromiseStateImpUtil::rejectAll(
+            std::pmr::vector<PromiseStateImpForwarder::RejectedCont> *stack,
+            const std::exception_ptr&                                 error)
+{
+    while (!stack->empty()) {
+        PromiseStateImpForwarder::RejectedCont cont = std::move(stack->back());
+        stack->pop_back();
+
+        PromiseStateImpForwarder *const forwarder =
+            cont.target<PromiseStateImpForwarder>();
+        if (forwarder && forwarder->d_release_p &&
+            forwarder->d_state_sp.use_count() == 1) {
+            // The fence makes the writes of the threads that released their
+            // references to the state visible. The state is destroyed, still
+            // waiting, with 'cont'.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            forwarder->d_release_p(forwarder->d_state_sp.get(), stack);
+        }
+        else if (dplp::Trampoline::isSaturated()) {
+            dplp::Trampoline::run(
+                [cont = std::move(cont), error]() mutable {
+                    std::invoke(std::move(cont), std::move(error));
+                });
+        }
+        else {
+            dplp::Trampoline::call(
+                [&] { std::invoke(std::move(cont), error); });
+        }
+    }
+}
+}
+
 // ----------------------------------------------------------------------------
 // Copyright 2017 Bloomberg Finance L.P.
 //
@@ -14,13 +14,34 @@
 // mutex is used and the state transitions follow the normal promise rules
 // (e.g. one cannot transsition from a fulfilled or rejected promised back to a
 // waiting promise)
+//
+// Continuations are called through 'dplp::Trampoline', which queues them
+// instead once the current thread is too deep in continuations. A queued
+// continuation holds copies of the values or error, as the state may be gone
+// by the time it runs.
+//
+// Rejection Forwarding
+// --------------------
+// A 'then' without a rejected continuation posts a
+// 'dplp::PromiseStateImpForwarder', which rejects the promise 'then' returned.
+// In a pipeline of such 'then's, that promise is usually referred to by
+// nothing but the forwarder. 'reject' does not call such forwarders: as no one
+// can observe their state, it takes over that state's rejected continuations
+// instead, without locking it, copying the error into it, or resolving it.
+// A rejection therefore reaches the first stage with a rejected continuation
+// of its own in a loop, at the cost of one lock for the whole chain.
 
-#include <dplm17_variant.h>  // dplm17::get, dplm17::visit
+#include <dplm17_variant.h>  // dplm17::get, dplm17::holds_alternative
 #include <dplm20_overload.h>
 #include <dplp_promisestateimp.h>
+#include <dplp_trampoline.h>
 
-#include <experimental/tuple>  // std::experimental::apply
-#include <mutex>               // std::lock_guard, std::mutex
+#include <cstddef>          // std::byte
+#include <functional>       // std::invoke
+#include <memory_resource>  // std::pmr::monotonic_buffer_resource
+#include <mutex>            // std::lock_guard, std::mutex, std::unique_lock
+#include <tuple>            // std::apply
+#include <utility>          // std::forward, std::move
 
 namespace dplp {
 
@@ -63,6 +84,50 @@ class PromiseStateImpUtil {
     postContinuations(dplp::PromiseStateImp<Types...> *const promiseState,
                       FulfilledCont&&                        fulfilledCont,
                       RejectedCont&&                         rejectedCont);
+
+    template <typename... Types>
+    static void releaseRejectedContinuations(
+          dplp::PromiseStateImp<Types...> *const                promiseState,
+          std::pmr::vector<PromiseStateImpForwarder::RejectedCont> *stack);
+        // Push the 'second' of all the waiting functions of the specified
+        // 'promiseState' onto the specified 'stack', last first, and clear
+        // them without locking the mutex or leaving the waiting state. The
+        // behavior is undefined unless 'promiseState' is in the waiting state
+        // and no other thread refers to it.
+
+    static void
+    rejectAll(std::pmr::vector<PromiseStateImpForwarder::RejectedCont> *stack,
+              const std::exception_ptr&                                 error);
+        // Call the rejected continuations on the specified 'stack', last
+        // first, with the specified 'error'. Rather than calling a forwarder
+        // whose state nothing else refers to, release that state's rejected
+        // continuations onto 'stack'.
+
+    template <typename... Types>
+    static bool
+    isResolved(dplp::PromiseStateImp<Types...> *const promiseState);
+        // Return 'true' if the specified 'promiseState' is in the fulfilled
+        // or rejected state, and 'false' otherwise.
+
+    template <typename FulfilledCont, typename... Types>
+    static bool
+    transform(dplp::PromiseStateImp<Types...> *const promiseState,
+              FulfilledCont&&                        fulfilledCont);
+    template <typename FulfilledCont, typename RejectedCont, typename... Types>
+    static bool
+    transform(dplp::PromiseStateImp<Types...> *const promiseState,
+              FulfilledCont&&                        fulfilledCont,
+              RejectedCont&&                         rejectedCont);
+        // If the specified 'promiseState' is in the fulfilled state, replace
+        // its values with the result of calling the specified
+        // 'fulfilledCont' with them, moved. If it is in the rejected state
+        // and the optionally specified 'rejectedCont' is given, move it to
+        // the fulfilled state with the result of calling 'rejectedCont' with
+        // the error. If either throws, move 'promiseState' to the rejected
+        // state with that exception. Return 'true' if 'promiseState' is in
+        // the fulfilled or rejected state, and 'false' otherwise. The mutex
+        // is not locked. The behavior is undefined unless no other thread
+        // refers to 'promiseState'.
 };
 
 // ============================================================================
@@ -74,31 +139,41 @@ void PromiseStateImpUtil::fulfill(
                       dplp::PromiseStateImp<T...> *const promiseStateInWaiting,
                       V&&...                             fulfillValues)
 {
-    std::vector<std::pair<std::function<void(T...)>,
-                          std::function<void(std::exception_ptr)> > >
-        continuations;
-    {
-        const std::lock_guard<std::mutex> lock(promiseStateInWaiting->d_mutex);
-
-        // Note that we need to delay calling the continuation functions in
-        // case they attempt to add more continuations.
-        continuations = std::move(dplm17::get<PromiseStateImpWaiting<T...> >(
-                                      promiseStateInWaiting->d_state)
-                                      .d_continuations);
-        // Move to the fulfilled state
-        promiseStateInWaiting->d_state = PromiseStateImpFulfilled<T...>{
-            {std::forward<V>(fulfillValues)...}};
-
-        // Note that due to the 'std::forward', we cannot use 'fulfillValues'
-        // after this point.
-    }
+    std::unique_lock<std::mutex> lock(promiseStateInWaiting->d_mutex);
+
+    // Note that we need to delay calling the continuation functions in case
+    // they attempt to add more continuations. The list is move-constructed,
+    // rather than move-assigned, so that it keeps its memory resource instead
+    // of being copied into the default one.
+    auto continuations = std::move(dplm17::get<PromiseStateImpWaiting<T...> >(
+                                       promiseStateInWaiting->d_state)
+                                       .d_continuations);
+    // Move to the fulfilled state
+    promiseStateInWaiting->d_state =
+        PromiseStateImpFulfilled<T...>{{std::forward<V>(fulfillValues)...}};
+
+    // Note that due to the 'std::forward', we cannot use 'fulfillValues'
+    // after this point.
+    lock.unlock();
 
-    // Call all the waiting functions with the fulfill values.
+    // Call all the waiting functions with the fulfill values. They are
+    // passed by reference, and only copied into a continuation that has to
+    // be queued.
     const auto& values = dplm17::get<PromiseStateImpFulfilled<T...> >(
                                                 promiseStateInWaiting->d_state)
                              .d_values;
-    for (auto&& pf : continuations)
-        std::experimental::apply(pf.first, values);
+    for (auto&& pf : continuations) {
+        if (dplp::Trampoline::isSaturated()) {
+            dplp::Trampoline::run(
+                [f = std::move(pf.first), values]() mutable {
+                    std::apply(std::move(f), std::move(values));
+                });
+        }
+        else {
+            dplp::Trampoline::call(
+                [&] { std::apply(std::move(pf.first), values); });
+        }
+    }
 }
 
 template <typename... T>
@@ -106,29 +181,35 @@ void PromiseStateImpUtil::reject(
                       dplp::PromiseStateImp<T...> *const promiseStateInWaiting,
                       std::exception_ptr                 error)
 {
-    std::vector<std::pair<std::function<void(T...)>,
-                          std::function<void(std::exception_ptr)> > >
-        continuations;
-    {
-        const std::lock_guard<std::mutex> lock(promiseStateInWaiting->d_mutex);
-
-        // Note that we need to delay calling the continuation functions in
-        // case
-        // they attempt to add more continuations.
-        continuations = std::move(dplm17::get<PromiseStateImpWaiting<T...> >(
-                                      promiseStateInWaiting->d_state)
-                                      .d_continuations);
-        // Move to the rejected state
-        promiseStateInWaiting->d_state =
-            PromiseStateImpRejected{std::move(error)};
-    }
+    std::unique_lock<std::mutex> lock(promiseStateInWaiting->d_mutex);
+
+    // Note that we need to delay calling the continuation functions in case
+    // they attempt to add more continuations. See 'fulfill' for why the list
+    // is move-constructed.
+    auto continuations = std::move(dplm17::get<PromiseStateImpWaiting<T...> >(
+                                       promiseStateInWaiting->d_state)
+                                       .d_continuations);
+    // Move to the rejected state
+    promiseStateInWaiting->d_state = PromiseStateImpRejected{std::move(error)};
+    lock.unlock();
 
-    // Call all the waiting functions with the fulfill values.
+    // Call all the waiting functions with the error. The fulfilled
+    // continuations are destroyed first, as they refer to the states the
+    // forwarders among the rejected ones do.
     const auto& errorValue =
         dplm17::get<PromiseStateImpRejected>(promiseStateInWaiting->d_state)
             .d_error;
-    for (auto&& pf : continuations)
-        pf.second(errorValue);
+
+    std::byte buffer[8 * sizeof(PromiseStateImpForwarder::RejectedCont)];
+    std::pmr::monotonic_buffer_resource                      resource(
+        buffer, sizeof buffer);
+    std::pmr::vector<PromiseStateImpForwarder::RejectedCont> stack(&resource);
+    stack.reserve(continuations.size());
+    for (auto it = continuations.rbegin(); it != continuations.rend(); ++it)
+        stack.push_back(std::move(it->second));
+    continuations.clear();
+
+    rejectAll(&stack, errorValue);
 }
 
 template <typename FulfilledCont, typename RejectedCont, typename... Types>
@@ -150,19 +231,116 @@ void PromiseStateImpUtil::postContinuations(
                 // 'fulfilledCont'
                 // results in another call that modifies 'promiseState'.
                 lock.unlock();
-                std::experimental::apply(
-                    std::forward<FulfilledCont>(fulfilledCont),
-                    fulfilledState.d_values);
+                if (dplp::Trampoline::isSaturated()) {
+                    dplp::Trampoline::run([
+                        f      = std::forward<FulfilledCont>(fulfilledCont),
+                        values = fulfilledState.d_values
+                    ]() mutable {
+                        std::apply(std::move(f), std::move(values));
+                    });
+                }
+                else {
+                    dplp::Trampoline::call([&] {
+                        std::apply(std::forward<FulfilledCont>(fulfilledCont),
+                                   fulfilledState.d_values);
+                    });
+                }
             },
             [&](const PromiseStateImpRejected& rejectedState) {
                 // Note that we need to unlock the mutex in case 'rejectedCont'
                 // results in another call that modifies 'promiseState'.
                 lock.unlock();
-                std::invoke(std::forward<RejectedCont>(rejectedCont),
-                            rejectedState.d_error);
+                if (dplp::Trampoline::isSaturated()) {
+                    dplp::Trampoline::run([
+                        f     = std::forward<RejectedCont>(rejectedCont),
+                        error = rejectedState.d_error
+                    ]() mutable {
+                        std::invoke(std::move(f), std::move(error));
+                    });
+                }
+                else {
+                    dplp::Trampoline::call([&] {
+                        std::invoke(std::forward<RejectedCont>(rejectedCont),
+                                    rejectedState.d_error);
+                    });
+                }
             }),
         promiseState->d_state);
 }
+
+template <typename... Types>
+void PromiseStateImpUtil::releaseRejectedContinuations(
+          dplp::PromiseStateImp<Types...> *const                promiseState,
+          std::pmr::vector<PromiseStateImpForwarder::RejectedCont> *stack)
+{
+    auto& continuations =
+        dplm17::get<PromiseStateImpWaiting<Types...> >(promiseState->d_state)
+            .d_continuations;
+    for (auto it = continuations.rbegin(); it != continuations.rend(); ++it)
+        stack->push_back(std::move(it->second));
+    continuations.clear();
+}
+
+template <typename... Types>
+bool PromiseStateImpUtil::isResolved(
+                           dplp::PromiseStateImp<Types...> *const promiseState)
+{
+    const std::lock_guard<std::mutex> lock(promiseState->d_mutex);
+    return !dplm17::holds_alternative<PromiseStateImpWaiting<Types...> >(
+        promiseState->d_state);
+}
+
+template <typename FulfilledCont, typename... Types>
+bool PromiseStateImpUtil::transform(
+                          dplp::PromiseStateImp<Types...> *const promiseState,
+                          FulfilledCont&&                        fulfilledCont)
+{
+    // Note that 'dplm17::get_if' takes the variant by reference.
+    auto *const fulfilledState =
+        dplm17::get_if<PromiseStateImpFulfilled<Types...> >(
+            promiseState->d_state);
+    if (!fulfilledState) {
+        return dplm17::holds_alternative<PromiseStateImpRejected>(
+            promiseState->d_state);
+    }
+
+    try {
+        fulfilledState->d_values = std::tuple<Types...>(
+            std::apply(std::forward<FulfilledCont>(fulfilledCont),
+                       std::move(fulfilledState->d_values)));
+    }
+    catch (...) {
+        promiseState->d_state =
+            PromiseStateImpRejected{std::current_exception()};
+    }
+    return true;
+}
+
+template <typename FulfilledCont, typename RejectedCont, typename... Types>
+bool PromiseStateImpUtil::transform(
+                          dplp::PromiseStateImp<Types...> *const promiseState,
+                          FulfilledCont&&                        fulfilledCont,
+                          RejectedCont&&                         rejectedCont)
+{
+    auto *const rejectedState =
+        dplm17::get_if<PromiseStateImpRejected>(promiseState->d_state);
+    if (!rejectedState) {
+        return transform(promiseState,
+                         std::forward<FulfilledCont>(fulfilledCont));
+    }
+
+    try {
+        promiseState->d_state = PromiseStateImpFulfilled<Types...>{
+            std::tuple<Types...>(std::invoke(
+                std::forward<RejectedCont>(rejectedCont),
+                std::move(rejectedState->d_error)))};
+    }
+    catch (...) {
+        promiseState->d_state =
+            PromiseStateImpRejected{std::current_exception()};
+    }
+    return true;
+}
 }
 
 #endif
@@ -0,0 +1,54 @@
+#include <dplp_ratelimiter.h>
+
+#include <dplp_promise.h>
+
+#include <benchmark/benchmark.h>
+
+// These benchmarks measure the cost of 'acquire' when tokens are available,
+// from one thread and from several contending for the same rate limiter,
+// against the cost of creating an already fulfilled promise, which is the
+// least that 'acquire' can cost.
+
+namespace {
+dplp::RateLimiter& limiter()
+    // Return a rate limiter that always has tokens available: it grants a
+    // billion tokens per second, more than can be acquired, from a bucket
+    // holding a second's worth.
+{
+    static dplp::RateLimiter s_limiter(1e9, 1e9);
+    return s_limiter;
+}
+}
+
+static void BM_FulfilledPromise(benchmark::State& state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(dplp::makeFulfilledPromise());
+}
+BENCHMARK(BM_FulfilledPromise);
+
+static void BM_AcquireAvailable(benchmark::State& state)
+{
+    dplp::RateLimiter& rateLimiter = limiter();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(rateLimiter.acquire());
+}
+BENCHMARK(BM_AcquireAvailable)->ThreadRange(1, 4)->UseRealTime();
+
+BENCHMARK_MAIN();
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,261 @@
+#include <dplp_ratelimiter.h>
+
+#include <dplp_defaultresource.h>
+
+#include <algorithm>   // std::max
+#include <cmath>       // std::llround
+#include <exception>   // std::exception_ptr, std::make_exception_ptr
+#include <utility>     // std::move
+
+namespace dplp {
+
+class RateLimiter_Waiter {
+    // This class is the base of the nodes in the queue of waiting permits.
+
+  public:
+    RateLimiter_Waiter *d_next_p = nullptr;
+    std::int64_t        d_due;  // nanoseconds
+
+    explicit RateLimiter_Waiter(std::int64_t due)
+    : d_due(due)
+    {
+    }
+
+    virtual void run(const std::exception_ptr *error) = 0;
+        // Destroy this object and fulfill the permit's promise if the
+        // specified 'error' is null, or reject it with '*error' otherwise.
+
+    virtual void discard() = 0;
+        // Destroy this object without resolving the permit's promise.
+
+  protected:
+    ~RateLimiter_Waiter() = default;
+};
+
+namespace {
+template <typename Fulfill, typename Reject>
+class RateLimiter_WaiterImp
+: public dplp::RateLimiter_Waiter
+, public dplp::DefaultResourceNode<RateLimiter_WaiterImp<Fulfill, Reject> > {
+    // This class implements a waiting permit holding the functions that
+    // resolve its promise, allocated from the default resource by 'create'.
+
+    Fulfill d_fulfill;
+    Reject  d_reject;
+
+    friend class dplp::DefaultResourceNode<RateLimiter_WaiterImp>;
+
+    RateLimiter_WaiterImp(std::int64_t   due,
+                          const Fulfill& fulfill,
+                          const Reject&  reject)
+    : RateLimiter_Waiter(due)
+    , d_fulfill(fulfill)
+    , d_reject(reject)
+    {
+    }
+
+  public:
+    void run(const std::exception_ptr *error) override
+    {
+        if (!error)
+            this->take(&RateLimiter_WaiterImp::d_fulfill)();
+        else
+            this->take(&RateLimiter_WaiterImp::d_reject)(*error);
+    }
+
+    void discard() override
+    {
+        this->destroy();
+    }
+};
+}
+
+RateLimiter::RateLimiter(double      rate,
+                         double      burst,
+                         std::size_t maxQueueLength)
+: d_nsPerToken(1e9 / rate)
+, d_tolerance(std::llround(burst * d_nsPerToken))
+, d_maxQueueLength(maxQueueLength)
+, d_fullAt(0)
+, d_numWaiting(0)
+, d_head_p(nullptr)
+, d_tail_p(nullptr)
+, d_stopping(false)
+{
+}
+
+RateLimiter::~RateLimiter()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_stopping = true;
+    }
+    d_condition.notify_one();
+    if (d_timer.joinable())
+        d_timer.join();
+
+    const std::exception_ptr error = std::make_exception_ptr(
+        dplp::RateLimiterError("dplp::RateLimiter destroyed"));
+    while (d_head_p) {
+        RateLimiter_Waiter *const waiter = d_head_p;
+        d_head_p                         = waiter->d_next_p;
+        waiter->run(&error);
+    }
+}
+
+bool RateLimiter::reserveSlot()
+{
+    std::size_t numWaiting = d_numWaiting.load(std::memory_order_relaxed);
+    do {
+        if (numWaiting >= d_maxQueueLength)
+            return false;
+    } while (!d_numWaiting.compare_exchange_weak(
+        numWaiting, numWaiting + 1, std::memory_order_relaxed));
+    return true;
+}
+
+dplp::Promise<> RateLimiter::wait(std::int64_t due)
+{
+    return dplp::Promise<>([this, due](auto fulfill, auto reject) {
+        RateLimiter_Waiter *const waiter =
+            RateLimiter_WaiterImp<decltype(fulfill), decltype(reject)>::create(
+                due, fulfill, reject);
+
+        bool isHead;
+        {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            if (!d_timer.joinable()) {
+                try {
+                    d_timer = std::thread([this] { runTimer(); });
+                }
+                catch (...) {
+                    waiter->discard();
+                    throw;
+                }
+            }
+
+            // Waiters reserve in due order but may get here out of it.
+            if (!d_tail_p) {
+                d_head_p = d_tail_p = waiter;
+            }
+            else if (d_tail_p->d_due <= due) {
+                d_tail_p->d_next_p = waiter;
+                d_tail_p           = waiter;
+            }
+            else if (due < d_head_p->d_due) {
+                waiter->d_next_p = d_head_p;
+                d_head_p         = waiter;
+            }
+            else {
+                RateLimiter_Waiter *previous = d_head_p;
+                while (previous->d_next_p->d_due <= due)
+                    previous = previous->d_next_p;
+                waiter->d_next_p   = previous->d_next_p;
+                previous->d_next_p = waiter;
+            }
+            isHead = d_head_p == waiter;
+        }
+        if (isHead)
+            d_condition.notify_one();
+    });
+}
+
+void RateLimiter::runTimer()
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+    while (!d_stopping) {
+        if (!d_head_p) {
+            d_condition.wait(lock);
+            continue;
+        }
+
+        const std::int64_t current = now();
+        if (current < d_head_p->d_due) {
+            d_condition.wait_until(
+                lock,
+                std::chrono::steady_clock::time_point(
+                    std::chrono::nanoseconds(d_head_p->d_due)));
+            continue;
+        }
+
+        RateLimiter_Waiter *due    = d_head_p;
+        RateLimiter_Waiter *last   = due;
+        std::size_t         numDue = 1;
+        while (last->d_next_p && last->d_next_p->d_due <= current) {
+            last = last->d_next_p;
+            ++numDue;
+        }
+        d_head_p = last->d_next_p;
+        if (!d_head_p)
+            d_tail_p = nullptr;
+        last->d_next_p = nullptr;
+        d_numWaiting.fetch_sub(numDue, std::memory_order_relaxed);
+
+        // The continuations may acquire again, so the lock is released.
+        lock.unlock();
+        while (due) {
+            RateLimiter_Waiter *const next = due->d_next_p;
+            due->run(nullptr);
+            due = next;
+        }
+        lock.lock();
+    }
+}
+
+dplp::Promise<> RateLimiter::acquire(double cost)
+{
+    const std::int64_t current   = now();
+    const std::int64_t increment = std::llround(cost * d_nsPerToken);
+
+    bool         reserved = false;
+    std::int64_t fullAt   = d_fullAt.load(std::memory_order_relaxed);
+    while (true) {
+        const std::int64_t next = std::max(fullAt, current) + increment;
+        const std::int64_t due  = next - d_tolerance;
+        if (due > current && !reserved) {
+            if (!reserveSlot()) {
+                return dplp::makeRejectedPromise<>(std::make_exception_ptr(
+                    dplp::RateLimiterError("dplp::RateLimiter queue full")));
+            }
+            reserved = true;
+        }
+
+        if (d_fullAt.compare_exchange_weak(
+                fullAt, next, std::memory_order_relaxed)) {
+            if (due > current) {
+                try {
+                    return wait(due);
+                }
+                catch (...) {
+                    // The permit wasn't queued, so its slot is returned. Its
+                    // tokens stay reserved, as later permits may be due
+                    // after them already.
+                    d_numWaiting.fetch_sub(1, std::memory_order_relaxed);
+                    throw;
+                }
+            }
+
+            // Tokens became available after the slot was reserved.
+            if (reserved)
+                d_numWaiting.fetch_sub(1, std::memory_order_relaxed);
+            return dplp::makeFulfilledPromise();
+        }
+    }
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,195 @@
+#ifndef INCLUDED_DPLP_RATELIMITER
+#define INCLUDED_DPLP_RATELIMITER
+
+//@PURPOSE: Provide a token bucket rate limiter whose permits are promises.
+//
+//@CLASSES:
+//  dplp::RateLimiter: token bucket that grants permits as promises
+//  dplp::RateLimiterError: exception for a permit that was not granted
+//
+//@SEE_ALSO: dplp_promise, dplp_asyncscope
+//
+//@DESCRIPTION: This component provides a class, 'dplp::RateLimiter', that
+// throttles calls to a downstream service without blocking a thread.
+// 'acquire(cost)' returns a 'dplp::Promise<>' that is fulfilled once 'cost'
+// tokens can be taken from a bucket refilled at a constant rate and holding
+// at most a configured burst of tokens. The bucket starts full.
+//
+// The bucket is kept as a single atomic word, the time at which it would be
+// full again (the "theoretical arrival time" of the generic cell rate
+// algorithm). Acquiring compares it to the current time and advances it by
+// the cost with one compare-and-swap, so when tokens are available,
+// 'acquire' takes no lock, allocates nothing, and returns a promise that is
+// already fulfilled.
+//
+// When tokens are not available, 'acquire' still reserves them by advancing
+// the word, which yields the time at which the reservation becomes due, and
+// adds a waiting entry to a queue ordered by that time. Because later callers
+// reserve after earlier ones, permits are granted in the order they were
+// requested. A timer thread, started by the first wait, fulfills each promise
+// when it is due. Note that the continuations of such promises therefore run
+// on the timer thread.
+//
+// The queue is a linked list of nodes, each holding the functions resolving
+// a waiting promise and allocated, like the promise's state, from
+// 'dplp::DefaultResource::get()'.
+//
+// The queue length can be bounded. When the bound is reached, 'acquire'
+// returns a promise rejected with a 'dplp::RateLimiterError' without
+// reserving anything, so that callers can shed load instead of letting it
+// queue. Destroying a rate limiter rejects the promises still waiting with a
+// 'dplp::RateLimiterError'.
+//
+// A rate limiter bounds a rate. To bound the number of calls in progress
+// instead, spawn the calls in a 'dplp::AsyncScope' with a concurrency limit.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Throttle calls to a backend
+///- - - - - - - - - - - - - - - - - - -
+// Suppose a backend accepts 100 requests per second, in bursts of up to 10,
+// and callers should fail fast rather than queue behind more than 50 others.
+//..
+//  dplp::RateLimiter limiter(100, 10, 50);
+//
+//  dplp::Promise<Reply> callBackendP(const Request& request)
+//  {
+//      return limiter.acquire().then([request] {
+//          return sendRequestP(request);
+//      });
+//  }
+//..
+
+#include <dplp_promise.h>
+
+#include <atomic>              // std::atomic
+#include <chrono>              // std::chrono::steady_clock
+#include <condition_variable>
+#include <cstddef>             // std::size_t
+#include <cstdint>             // std::int64_t
+#include <mutex>               // std::mutex
+#include <stdexcept>           // std::runtime_error
+#include <thread>
+
+namespace dplp {
+
+class RateLimiterError : public std::runtime_error {
+    // This class is the exception with which a permit that was not granted,
+    // because the queue was full or the rate limiter was destroyed, is
+    // rejected.
+
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+class RateLimiter_Waiter;
+
+class RateLimiter {
+    // This class implements a token bucket rate limiter that grants permits
+    // by fulfilling promises, in the order they were requested.
+
+  public:
+    static constexpr std::size_t k_UNLIMITED = static_cast<std::size_t>(-1);
+        // A maximum queue length meaning "no maximum".
+
+  private:
+    const double       d_nsPerToken;
+    const std::int64_t d_tolerance;  // the burst, in nanoseconds
+    const std::size_t  d_maxQueueLength;
+
+    std::atomic<std::int64_t> d_fullAt;  // nanoseconds of the steady clock
+    std::atomic<std::size_t>  d_numWaiting;
+
+    std::mutex                d_mutex;  // protects the below
+    std::condition_variable   d_condition;
+    dplp::RateLimiter_Waiter *d_head_p;  // earliest due
+    dplp::RateLimiter_Waiter *d_tail_p;
+    bool                      d_stopping;
+    std::thread               d_timer;
+
+    static std::int64_t now();
+        // Return the current time of the steady clock in nanoseconds.
+
+    bool reserveSlot();
+        // Count a waiting permit and return 'true' if the queue is shorter
+        // than its maximum length, and return 'false' otherwise.
+
+    dplp::Promise<> wait(std::int64_t due);
+        // Return a promise fulfilled by the timer thread at the specified
+        // 'due' time.
+
+    void runTimer();
+        // Fulfill the waiting promises as they become due until this object
+        // is being destroyed.
+
+  public:
+    RateLimiter(double      rate,
+                double      burst,
+                std::size_t maxQueueLength = k_UNLIMITED);
+        // Create a 'RateLimiter' object granting the specified 'rate' tokens
+        // per second with a bucket of the specified 'burst' tokens, which
+        // starts full, and queueing at most the optionally specified
+        // 'maxQueueLength' permits at once. The behavior is undefined unless
+        // '0 < rate' and '0 <= burst'.
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    ~RateLimiter();
+        // Reject the promises of the waiting permits with a
+        // 'dplp::RateLimiterError' and destroy this object.
+
+    dplp::Promise<> acquire(double cost = 1);
+        // Return a promise fulfilled once the optionally specified 'cost'
+        // tokens are taken from the bucket, which is already fulfilled if
+        // they are available. If they are not and the queue is at its
+        // maximum length, return a promise rejected with a
+        // 'dplp::RateLimiterError' instead. The behavior is undefined unless
+        // '0 <= cost'. If the permit can't be queued, because memory can't
+        // be allocated or the timer thread can't be started, throw the
+        // error, without counting the permit as waiting. Note that a 'cost'
+        // larger than the burst is granted once the bucket has been in debt
+        // long enough to cover it.
+
+    std::size_t numWaiting() const;
+        // Return the number of permits waiting for tokens.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+std::int64_t RateLimiter::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline
+std::size_t RateLimiter::numWaiting() const
+{
+    return d_numWaiting.load(std::memory_order_relaxed);
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
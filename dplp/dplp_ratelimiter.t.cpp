@@ -0,0 +1,192 @@
+#include <dplp_ratelimiter.h>
+
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+void waitFor(const dplp::Promise<>& p)
+    // Block until the specified 'p' is resolved.
+{
+    while (!dplp::TestUtil::isResolved(p))
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+std::string errorOf(const dplp::Promise<>& p)
+    // Return the error message of the specified 'p', or "" if it is not
+    // rejected.
+{
+    return dplp::TestUtil::errorOf<dplp::RateLimiterError>(p);
+}
+}
+
+TEST(dplp_ratelimiter, burst)
+{
+    // 100 tokens per second, so one every 10ms, and a burst of 3.
+    dplp::RateLimiter limiter(100, 3);
+    const auto        start = Clock::now();
+
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(dplp::TestUtil::isResolved(limiter.acquire())) << i;
+    const dplp::Promise<> fourth = limiter.acquire();
+    EXPECT_FALSE(dplp::TestUtil::isResolved(fourth));
+    EXPECT_EQ(limiter.numWaiting(), 1u);
+
+    waitFor(fourth);
+    EXPECT_EQ(errorOf(fourth), "");
+    EXPECT_GE(Clock::now() - start, std::chrono::milliseconds(9));
+    EXPECT_EQ(limiter.numWaiting(), 0u);
+}
+
+TEST(dplp_ratelimiter, cost)
+{
+    dplp::RateLimiter limiter(1000, 10);
+    const auto        start = Clock::now();
+
+    EXPECT_TRUE(dplp::TestUtil::isResolved(limiter.acquire(10)));
+    const dplp::Promise<> next = limiter.acquire(5);
+    EXPECT_FALSE(dplp::TestUtil::isResolved(next));
+    waitFor(next);
+    EXPECT_GE(Clock::now() - start, std::chrono::microseconds(4500));
+}
+
+TEST(dplp_ratelimiter, fifo)
+{
+    dplp::RateLimiter limiter(1000, 1);
+    EXPECT_TRUE(dplp::TestUtil::isResolved(limiter.acquire()));
+
+    std::mutex                   mutex;
+    std::vector<int>             order;
+    std::vector<dplp::Promise<>> permits;
+    for (int i = 0; i < 5; ++i) {
+        permits.push_back(limiter.acquire().then([&, i] {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(i);
+        }));
+    }
+    EXPECT_EQ(limiter.numWaiting(), 5u);
+    for (const dplp::Promise<>& permit : permits)
+        waitFor(permit);
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+TEST(dplp_ratelimiter, max_queue_length)
+{
+    dplp::Promise<> first  = dplp::makeFulfilledPromise();
+    dplp::Promise<> second = dplp::makeFulfilledPromise();
+    {
+        // One token per second, so nothing becomes due during the test.
+        dplp::RateLimiter limiter(1, 1, 2);
+        EXPECT_TRUE(dplp::TestUtil::isResolved(limiter.acquire()));
+        first  = limiter.acquire();
+        second = limiter.acquire();
+        EXPECT_EQ(limiter.numWaiting(), 2u);
+
+        const dplp::Promise<> rejected = limiter.acquire();
+        EXPECT_EQ(errorOf(rejected), "dplp::RateLimiter queue full");
+        EXPECT_EQ(limiter.numWaiting(), 2u);
+        EXPECT_FALSE(dplp::TestUtil::isResolved(first));
+    }
+    EXPECT_EQ(errorOf(first), "dplp::RateLimiter destroyed");
+    EXPECT_EQ(errorOf(second), "dplp::RateLimiter destroyed");
+
+    // Without a queue, permits are granted immediately or not at all.
+    dplp::RateLimiter limiter(1, 2, 0);
+    EXPECT_TRUE(dplp::TestUtil::isResolved(limiter.acquire()));
+    EXPECT_TRUE(dplp::TestUtil::isResolved(limiter.acquire()));
+    EXPECT_EQ(errorOf(limiter.acquire()), "dplp::RateLimiter queue full");
+}
+
+TEST(dplp_ratelimiter, default_resource)
+{
+    dplp::TestUtil::CountingResource resource;
+    {
+        dplp::DefaultResourceGuard guard(&resource);
+
+        // One token per second, so nothing becomes due during the test.
+        dplp::RateLimiter limiter(1, 1);
+        EXPECT_TRUE(dplp::TestUtil::isResolved(limiter.acquire()));
+
+        int             before  = resource.numAllocations();
+        dplp::Promise<> waiting = limiter.acquire();
+        const int       numWaiterAllocations =
+            resource.numAllocations() - before;
+
+        before = resource.numAllocations();
+        dplp::Promise<>([](auto, auto) {});
+        const int numStateAllocations = resource.numAllocations() - before;
+        EXPECT_EQ(numWaiterAllocations, numStateAllocations + 1)
+            << "The waiter wasn't allocated from the default resource.";
+
+        // The waiter can't be allocated, so the permit isn't queued.
+        resource.setMaxAllocations(resource.numAllocations() + 1);
+        before = resource.numDeallocations();
+        EXPECT_THROW(limiter.acquire(), std::bad_alloc);
+        EXPECT_EQ(limiter.numWaiting(), 1u) << "The slot wasn't returned.";
+        EXPECT_EQ(resource.numDeallocations(), before + 1)
+            << "The state of the failed permit wasn't released.";
+        resource.setMaxAllocations(
+            dplp::TestUtil::CountingResource::k_UNLIMITED);
+    }
+    EXPECT_EQ(resource.numDeallocations(), resource.numAllocations())
+        << "Waiters were leaked.";
+}
+
+TEST(dplp_ratelimiter, threads)
+{
+    const int k_NUM_THREADS  = 4;
+    const int k_NUM_ACQUIRES = 1000;
+
+    // 100000 tokens per second, so the permits take about 40ms.
+    dplp::RateLimiter limiter(100000, 10);
+    std::atomic<int>  numGranted(0);
+    const auto        start = Clock::now();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < k_NUM_THREADS; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < k_NUM_ACQUIRES; ++i)
+                limiter.acquire().then([&] { ++numGranted; });
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    while (numGranted != k_NUM_THREADS * k_NUM_ACQUIRES)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    EXPECT_GE(Clock::now() - start, std::chrono::milliseconds(35));
+    EXPECT_EQ(limiter.numWaiting(), 0u);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,121 @@
+#include <dplp_recyclingresource.h>
+
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+
+#include <benchmark/benchmark.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// These benchmarks measure the cost of creating, resolving, and destroying
+// promises with their state allocated from the global allocator (argument 0)
+// or from a 'dplp::RecyclingResource' (argument 1).
+
+namespace {
+std::pmr::memory_resource *resourceFor(benchmark::State&        state,
+                                       dplp::RecyclingResource *recycler)
+{
+    return state.range(0) ? recycler : std::pmr::new_delete_resource();
+}
+
+void reportStats(benchmark::State&              state,
+                 const dplp::RecyclingResource& recycler)
+{
+    if (state.range(0))
+        state.counters["hit_rate"] = recycler.stats().hitRate();
+}
+}
+
+static void BM_Chain(benchmark::State& state)
+{
+    // A three-stage chain created, resolved, and destroyed on one thread.
+
+    dplp::RecyclingResource    recycler;
+    dplp::DefaultResourceGuard guard(resourceFor(state, &recycler));
+
+    for (auto _ : state) {
+        std::function<void(int)> fulfill;
+        int                      result = 0;
+        {
+            dplp::Promise<int>([&](auto f, auto) { fulfill = f; })
+                .then([](int i) { return i + 1; })
+                .then([&](int i) { result = i; });
+        }
+        fulfill(1);
+        benchmark::DoNotOptimize(result);
+    }
+    reportStats(state, recycler);
+}
+BENCHMARK(BM_Chain)->Arg(0)->Arg(1);
+
+static void BM_CrossThreadRelease(benchmark::State& state)
+{
+    // Promises are created on the benchmark thread and released on a
+    // consumer thread, so every state is freed remotely.
+
+    dplp::RecyclingResource    recycler;
+    dplp::DefaultResourceGuard guard(resourceFor(state, &recycler));
+
+    std::mutex                      mutex;
+    std::condition_variable         cv;
+    std::deque<dplp::Promise<int> > queue;
+    bool                            done = false;
+
+    std::thread consumer([&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [&] { return done || !queue.empty(); });
+            if (queue.empty())
+                return;
+            std::deque<dplp::Promise<int> > batch;
+            batch.swap(queue);
+            lock.unlock();
+            batch.clear();
+            lock.lock();
+        }
+    });
+
+    for (auto _ : state) {
+        dplp::Promise<int> p =
+            dplp::Promise<int>([](auto fulfill, auto) { fulfill(1); })
+                .then([](int i) { return i + 1; });
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(p));
+        }
+        cv.notify_one();
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    cv.notify_one();
+    consumer.join();
+    reportStats(state, recycler);
+}
+BENCHMARK(BM_CrossThreadRelease)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
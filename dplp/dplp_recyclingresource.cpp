@@ -0,0 +1,336 @@
+#include <dplp_recyclingresource.h>
+
+#include <algorithm>  // std::remove_if
+
+namespace dplp {
+namespace {
+
+const std::size_t k_ALIGNMENT   = alignof(std::max_align_t);
+const std::size_t k_NUM_CLASSES = RecyclingResource::k_MAX_BLOCK_SIZE /
+                                  k_ALIGNMENT;
+
+struct alignas(std::max_align_t) BlockHeader {
+    // This struct precedes every recycled block.
+
+    RecyclingResource_ThreadCache *d_owner_p;    // null if not cached
+    std::size_t                    d_sizeClass;
+};
+
+struct FreeBlock {
+    // This struct overlays the payload of a block while it is free.
+
+    FreeBlock *d_next_p;
+};
+
+std::size_t sizeClassOf(std::size_t bytes)
+{
+    return bytes ? (bytes - 1) / k_ALIGNMENT : 0;
+}
+
+std::size_t blockSize(std::size_t sizeClass)
+{
+    return sizeof(BlockHeader) + (sizeClass + 1) * k_ALIGNMENT;
+}
+
+BlockHeader *headerOf(void *p)
+{
+    return static_cast<BlockHeader *>(p) - 1;
+}
+
+void release(std::pmr::memory_resource *upstream, FreeBlock *block)
+{
+    BlockHeader *const header = headerOf(block);
+    upstream->deallocate(header, blockSize(header->d_sizeClass), k_ALIGNMENT);
+}
+
+std::atomic<std::uint64_t> nextResourceId(0);
+}
+
+struct RecyclingResource_ThreadCache {
+    // Only the owning thread accesses the free lists and modifies 'd_hits'
+    // and 'd_misses'. Other threads push onto 'd_remote'.
+
+    FreeBlock   *d_free[k_NUM_CLASSES]    = {};
+    std::size_t  d_numFree[k_NUM_CLASSES] = {};
+
+    std::atomic<FreeBlock *> d_remote{nullptr};
+    std::atomic<bool>        d_abandoned{false};  // owning thread exited
+
+    std::atomic<std::size_t> d_hits{0};
+    std::atomic<std::size_t> d_misses{0};
+    std::atomic<std::size_t> d_remoteFrees{0};
+};
+
+namespace {
+
+thread_local bool t_exiting = false;
+
+struct ThreadCacheEntry {
+    // This struct refers to the cache of the current thread for one resource.
+    // The resource owns the cache, so the cache is destroyed with it.
+
+    std::uint64_t                                d_id;  // the resource's
+    RecyclingResource_ThreadCache               *d_cache_p;
+    std::weak_ptr<RecyclingResource_ThreadCache> d_cache_wp;
+};
+
+struct ThreadCacheList {
+    // This struct holds the caches of the current thread, keyed by resource
+    // id. Ids, unlike addresses, are never reused, so entries of destroyed
+    // resources are merely unreachable until they are pruned.
+
+    std::vector<ThreadCacheEntry>  d_entries;
+    std::uint64_t                  d_lastId      = 0;
+    RecyclingResource_ThreadCache *d_lastCache_p = nullptr;
+
+    void prune()
+        // Remove the entries of destroyed resources.
+    {
+        d_entries.erase(std::remove_if(d_entries.begin(),
+                                       d_entries.end(),
+                                       [](const ThreadCacheEntry& entry) {
+                                           return entry.d_cache_wp.expired();
+                                       }),
+                        d_entries.end());
+    }
+
+    ~ThreadCacheList()
+    {
+        // Note that promises held by other thread-local objects may still be
+        // released after this point, so we make sure they are treated as
+        // remote frees rather than looking up this object again.
+        t_exiting = true;
+        for (ThreadCacheEntry& entry : d_entries) {
+            if (const std::shared_ptr<RecyclingResource_ThreadCache> cache =
+                    entry.d_cache_wp.lock())
+                cache->d_abandoned.store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadCacheList t_caches;
+
+void pushFree(RecyclingResource_ThreadCache *cache,
+              std::size_t                    sizeClass,
+              FreeBlock                     *block)
+{
+    block->d_next_p          = cache->d_free[sizeClass];
+    cache->d_free[sizeClass] = block;
+    ++cache->d_numFree[sizeClass];
+}
+}
+
+RecyclingResource_ThreadCache *RecyclingResource::localCache(bool create)
+{
+    if (t_exiting)
+        return nullptr;
+
+    ThreadCacheList& list = t_caches;
+    if (list.d_lastCache_p && list.d_lastId == d_id)
+        return list.d_lastCache_p;
+
+    for (const ThreadCacheEntry& entry : list.d_entries) {
+        if (entry.d_id == d_id) {
+            list.d_lastId      = d_id;
+            list.d_lastCache_p = entry.d_cache_p;
+            return list.d_lastCache_p;
+        }
+    }
+
+    if (!create)
+        return nullptr;
+
+    // A thread creating caches for a succession of short-lived resources
+    // would otherwise accumulate an entry for each of them.
+    list.prune();
+
+    std::shared_ptr<ThreadCache> cache;
+    {
+        const std::lock_guard<std::mutex> lock(d_mutex);
+
+        // Adopt the cache of an exited thread, if any, so that its free
+        // blocks and any blocks freed to it since are reused.
+        for (auto& candidate : d_caches) {
+            bool abandoned = true;
+            if (candidate->d_abandoned.compare_exchange_strong(
+                    abandoned, false, std::memory_order_acquire)) {
+                cache = candidate;
+                break;
+            }
+        }
+        if (!cache) {
+            cache = std::make_shared<ThreadCache>();
+            d_caches.push_back(cache);
+        }
+    }
+
+    list.d_entries.push_back(ThreadCacheEntry{d_id, cache.get(), cache});
+    list.d_lastId      = d_id;
+    list.d_lastCache_p = cache.get();
+    return list.d_lastCache_p;
+}
+
+void RecyclingResource::releaseBlocks(ThreadCache *cache)
+{
+    for (std::size_t sizeClass = 0; sizeClass < k_NUM_CLASSES; ++sizeClass) {
+        while (FreeBlock *const block = cache->d_free[sizeClass]) {
+            cache->d_free[sizeClass] = block->d_next_p;
+            release(d_upstream_p, block);
+        }
+        cache->d_numFree[sizeClass] = 0;
+    }
+
+    FreeBlock *block = cache->d_remote.exchange(nullptr,
+                                                std::memory_order_acquire);
+    while (block) {
+        FreeBlock *const next = block->d_next_p;
+        release(d_upstream_p, block);
+        block = next;
+    }
+}
+
+void *RecyclingResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (bytes > k_MAX_BLOCK_SIZE || alignment > k_ALIGNMENT) {
+        d_oversized.fetch_add(1, std::memory_order_relaxed);
+        return d_upstream_p->allocate(bytes, alignment);
+    }
+
+    const std::size_t  sizeClass = sizeClassOf(bytes);
+    ThreadCache *const cache     = localCache(true);
+
+    if (cache) {
+        if (!cache->d_free[sizeClass]) {
+            // Move blocks freed by other threads to the free lists. The
+            // exchange takes the whole queue, so there is no ABA problem.
+            FreeBlock *block =
+                cache->d_remote.exchange(nullptr, std::memory_order_acquire);
+            while (block) {
+                FreeBlock *const  next       = block->d_next_p;
+                const std::size_t blockClass = headerOf(block)->d_sizeClass;
+                if (cache->d_numFree[blockClass] < d_maxBlocksPerClass)
+                    pushFree(cache, blockClass, block);
+                else
+                    release(d_upstream_p, block);
+                block = next;
+            }
+        }
+
+        if (FreeBlock *const block = cache->d_free[sizeClass]) {
+            cache->d_free[sizeClass] = block->d_next_p;
+            --cache->d_numFree[sizeClass];
+            cache->d_hits.store(
+                cache->d_hits.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+            return block;
+        }
+
+        cache->d_misses.store(
+            cache->d_misses.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+    }
+    else {
+        d_uncachedMisses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    BlockHeader *const header = static_cast<BlockHeader *>(
+                  d_upstream_p->allocate(blockSize(sizeClass), k_ALIGNMENT));
+    header->d_owner_p   = cache;
+    header->d_sizeClass = sizeClass;
+    return header + 1;
+}
+
+void RecyclingResource::do_deallocate(void        *p,
+                                      std::size_t  bytes,
+                                      std::size_t  alignment)
+{
+    if (bytes > k_MAX_BLOCK_SIZE || alignment > k_ALIGNMENT) {
+        d_upstream_p->deallocate(p, bytes, alignment);
+        return;
+    }
+
+    BlockHeader *const header = headerOf(p);
+    ThreadCache *const owner  = header->d_owner_p;
+    FreeBlock *const   block  = static_cast<FreeBlock *>(p);
+
+    if (!owner) {
+        release(d_upstream_p, block);
+        return;
+    }
+
+    if (owner == localCache(false)) {
+        if (owner->d_numFree[header->d_sizeClass] < d_maxBlocksPerClass)
+            pushFree(owner, header->d_sizeClass, block);
+        else
+            release(d_upstream_p, block);
+        return;
+    }
+
+    // Note that the remote-free queue is not bounded by 'd_maxBlocksPerClass';
+    // the owner trims the excess when it drains the queue into its lists, at
+    // the latest when this resource is destroyed.
+    FreeBlock *head = owner->d_remote.load(std::memory_order_relaxed);
+    do {
+        block->d_next_p = head;
+    } while (!owner->d_remote.compare_exchange_weak(
+        head, block, std::memory_order_release, std::memory_order_relaxed));
+    owner->d_remoteFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool RecyclingResource::do_is_equal(
+                               const std::pmr::memory_resource& other) const
+                                                                       noexcept
+{
+    return this == &other;
+}
+
+RecyclingResource::RecyclingResource(
+                                  std::size_t                maxBlocksPerClass,
+                                  std::pmr::memory_resource *upstream)
+: d_id(++nextResourceId)
+, d_upstream_p(upstream)
+, d_maxBlocksPerClass(maxBlocksPerClass)
+, d_oversized(0)
+, d_uncachedMisses(0)
+{
+}
+
+RecyclingResource::~RecyclingResource()
+{
+    for (auto& cache : d_caches)
+        releaseBlocks(cache.get());
+}
+
+RecyclingResourceStats RecyclingResource::stats() const
+{
+    RecyclingResourceStats result = {};
+    result.d_misses    = d_uncachedMisses.load(std::memory_order_relaxed);
+    result.d_oversized = d_oversized.load(std::memory_order_relaxed);
+
+    const std::lock_guard<std::mutex> lock(d_mutex);
+    for (auto& cache : d_caches) {
+        result.d_hits += cache->d_hits.load(std::memory_order_relaxed);
+        result.d_misses += cache->d_misses.load(std::memory_order_relaxed);
+        result.d_remoteFrees +=
+            cache->d_remoteFrees.load(std::memory_order_relaxed);
+    }
+    result.d_numCaches = d_caches.size();
+    return result;
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
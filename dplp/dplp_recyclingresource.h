@@ -0,0 +1,203 @@
+#ifndef INCLUDED_DPLP_RECYCLINGRESOURCE
+#define INCLUDED_DPLP_RECYCLINGRESOURCE
+
+//@PURPOSE: Provide a memory resource that recycles blocks per thread.
+//
+//@CLASSES:
+//  dplp::RecyclingResource: resource with per-thread, per-size free lists
+//  dplp::RecyclingResourceStats: counters describing recycling effectiveness
+//
+//@SEE_ALSO: dplp_defaultresource
+//
+//@DESCRIPTION: This component provides a thread-safe memory resource,
+// 'dplp::RecyclingResource', intended for the short-lived, fixed-size blocks
+// promises allocate: the shared state of each 'dplp::Promise' and the list of
+// continuations waiting on it. Installing it with 'dplp::DefaultResourceGuard'
+// makes those allocations recycle blocks instead of going to the global
+// allocator. Note that the closures of continuations are recycled only where
+// the resource allocates them: with the state of a 'dplp::Promise<>', but not
+// for promises with values, which hold continuations in 'std::function'
+// objects that allocate large closures from the global heap, nor for the
+// tasks 'dplp::Trampoline' queues.
+//
+// Small blocks are grouped into size classes. Since every instantiation of
+// 'dplp::Promise' allocates states of a single size, each size class in effect
+// serves a handful of promise types. Every thread using the resource gets its
+// own free list for each size class, so allocation and deallocation on the
+// same thread take no locks and perform no atomic read-modify-write
+// operations.
+//
+// A block remembers the thread cache it was allocated from. When it is
+// deallocated on another thread, which is common when a continuation running
+// on an executor releases the last reference to a promise, it is pushed onto
+// that cache's remote-free queue. The owning thread moves the whole queue to
+// its free lists the next time one of them is empty.
+//
+// Each free list holds at most 'maxBlocksPerClass' blocks; blocks beyond that
+// are returned to the upstream resource. Blocks that are larger than
+// 'k_MAX_BLOCK_SIZE' or over-aligned bypass the free lists altogether.
+//
+// When a thread exits, its caches are kept by the resource and handed to the
+// next thread that starts using it, so blocks freed after the owning thread
+// exited are not lost. All cached blocks are returned to the upstream resource
+// when the 'RecyclingResource' is destroyed, which also destroys the caches.
+// Each thread forgets the caches of destroyed resources the next time it
+// creates a cache.
+//
+// The counters returned by 'stats' tell how effective recycling is. See
+// 'dplp::RecyclingResourceStats'.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Recycle promise state on worker threads
+///- - - - - - - - - - - - - - - - - - - - - - - - -
+// Suppose a pool of workers creates and resolves many promises. We install a
+// single 'RecyclingResource' on every worker.
+//..
+//  dplp::RecyclingResource recycler;
+//
+//  auto workerMain = [&] {
+//      dplp::DefaultResourceGuard guard(&recycler);
+//      runTasks();
+//  };
+//..
+// After a while we can check how many allocations were served from the free
+// lists.
+//..
+//  std::cout << "hit rate: " << recycler.stats().hitRate() << std::endl;
+//..
+// Note that 'recycler' must outlive all the promises allocated from it.
+
+#include <atomic>           // std::atomic
+#include <cstddef>          // std::size_t, std::max_align_t
+#include <cstdint>          // std::uint64_t
+#include <memory>           // std::shared_ptr
+#include <memory_resource>  // std::pmr::memory_resource
+#include <mutex>            // std::mutex
+#include <vector>
+
+namespace dplp {
+
+struct RecyclingResource_ThreadCache;
+    // The free lists and remote-free queue of one thread. This is an
+    // implementation detail of 'RecyclingResource'.
+
+struct RecyclingResourceStats {
+    // This class is a value semantic type holding the counters of a
+    // 'RecyclingResource'.
+
+    std::size_t d_hits;         // allocations served from a free list
+    std::size_t d_misses;       // small allocations forwarded upstream
+    std::size_t d_oversized;    // allocations bypassing the free lists
+    std::size_t d_remoteFrees;  // deallocations on a non-owning thread
+    std::size_t d_numCaches;    // thread caches created so far
+
+    double hitRate() const;
+        // Return the fraction of small allocations that were served from a
+        // free list or 0 if there were none.
+};
+
+class RecyclingResource : public std::pmr::memory_resource {
+    // This class implements a thread-safe memory resource that recycles
+    // small blocks through per-thread, per-size-class free lists.
+
+  public:
+    static constexpr std::size_t k_MAX_BLOCK_SIZE = 512;
+        // The largest allocation, in bytes, that is recycled.
+
+  private:
+    using ThreadCache = RecyclingResource_ThreadCache;
+
+    const std::uint64_t        d_id;  // unique across all instances
+    std::pmr::memory_resource *d_upstream_p;
+    const std::size_t          d_maxBlocksPerClass;
+
+    // 'd_mutex' protects 'd_caches', which holds every cache ever created for
+    // this resource, including those of exited threads.
+    mutable std::mutex                         d_mutex;
+    std::vector<std::shared_ptr<ThreadCache> > d_caches;
+
+    // Counters for allocations not attributable to a cache.
+    std::atomic<std::size_t> d_oversized;
+    std::atomic<std::size_t> d_uncachedMisses;
+
+    ThreadCache *localCache(bool create);
+        // Return the current thread's cache for this resource, or null if
+        // there is none and the specified 'create' is 'false' or the thread
+        // is exiting.
+
+    void releaseBlocks(ThreadCache *cache);
+        // Return all the blocks in the free lists and remote-free queue of the
+        // specified 'cache' to the upstream resource.
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void  do_deallocate(void        *p,
+                        std::size_t  bytes,
+                        std::size_t  alignment) override;
+    bool  do_is_equal(const std::pmr::memory_resource& other) const
+                                                             noexcept override;
+
+  public:
+    explicit RecyclingResource(
+        std::size_t                maxBlocksPerClass = 256,
+        std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+        // Create a 'RecyclingResource' object that keeps at most the
+        // optionally specified 'maxBlocksPerClass' free blocks per size class
+        // and thread, and obtains memory from the optionally specified
+        // 'upstream' resource. The behavior is undefined unless 'upstream' is
+        // thread-safe.
+
+    RecyclingResource(const RecyclingResource&) = delete;
+    RecyclingResource& operator=(const RecyclingResource&) = delete;
+
+    ~RecyclingResource();
+        // Return all cached blocks to the upstream resource. The behavior is
+        // undefined if any block allocated from this object has not been
+        // deallocated or if this object is used concurrently.
+
+    RecyclingResourceStats stats() const;
+        // Return the current values of the counters of this object. Note that
+        // the counters are read without synchronizing with the threads using
+        // the resource, so they may be slightly out of date.
+
+    std::pmr::memory_resource *upstream() const;
+        // Return the resource this object obtains memory from.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+double RecyclingResourceStats::hitRate() const
+{
+    const std::size_t total = d_hits + d_misses;
+    return total ? static_cast<double>(d_hits) / total : 0;
+}
+
+inline
+std::pmr::memory_resource *RecyclingResource::upstream() const
+{
+    return d_upstream_p;
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
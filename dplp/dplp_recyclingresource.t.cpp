@@ -0,0 +1,187 @@
+#include <dplp_recyclingresource.h>
+
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+TEST(dplp_recyclingresource, same_thread)
+{
+    dplp::TestUtil::CountingResource upstream;
+    dplp::RecyclingResource          resource(256, &upstream);
+
+    void *const p = resource.allocate(40);
+    resource.deallocate(p, 40);
+    EXPECT_EQ(resource.allocate(40), p) << "Block wasn't recycled.";
+
+    void *const q = resource.allocate(40);
+    EXPECT_NE(q, p) << "Block was handed out twice.";
+
+    // A block of a different size class isn't reused.
+    void *const r = resource.allocate(200);
+    EXPECT_NE(r, p);
+    EXPECT_NE(r, q);
+
+    resource.deallocate(p, 40);
+    resource.deallocate(q, 40);
+    resource.deallocate(r, 200);
+
+    const dplp::RecyclingResourceStats stats = resource.stats();
+    EXPECT_EQ(stats.d_hits, 1u);
+    EXPECT_EQ(stats.d_misses, 3u);
+    EXPECT_EQ(stats.d_remoteFrees, 0u);
+    EXPECT_EQ(stats.d_numCaches, 1u);
+    EXPECT_DOUBLE_EQ(stats.hitRate(), 0.25);
+    EXPECT_EQ(upstream.numAllocations(), 3);
+    EXPECT_EQ(upstream.numDeallocations(), 0)
+        << "Freed blocks weren't kept.";
+}
+
+TEST(dplp_recyclingresource, oversized)
+{
+    dplp::TestUtil::CountingResource upstream;
+    dplp::RecyclingResource          resource(256, &upstream);
+
+    const std::size_t size = dplp::RecyclingResource::k_MAX_BLOCK_SIZE + 1;
+    void *const       p    = resource.allocate(size);
+    resource.deallocate(p, size);
+
+    void *const q = resource.allocate(16, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(q) % 64, 0u)
+        << "Alignment wasn't respected.";
+    resource.deallocate(q, 16, 64);
+
+    const dplp::RecyclingResourceStats stats = resource.stats();
+    EXPECT_EQ(stats.d_oversized, 2u);
+    EXPECT_EQ(stats.d_hits + stats.d_misses, 0u);
+    EXPECT_EQ(upstream.numDeallocations(), 2)
+        << "Oversized blocks were cached.";
+}
+
+TEST(dplp_recyclingresource, max_blocks_per_class)
+{
+    dplp::TestUtil::CountingResource upstream;
+    {
+        dplp::RecyclingResource resource(2, &upstream);
+
+        void *blocks[3];
+        for (void *& block : blocks)
+            block = resource.allocate(64);
+        for (void *block : blocks)
+            resource.deallocate(block, 64);
+        EXPECT_EQ(upstream.numDeallocations(), 1)
+            << "The free list wasn't bounded.";
+    }
+    EXPECT_EQ(upstream.numDeallocations(), upstream.numAllocations())
+        << "Cached blocks weren't released on destruction.";
+}
+
+TEST(dplp_recyclingresource, remote_free)
+{
+    dplp::TestUtil::CountingResource upstream;
+    {
+        dplp::RecyclingResource resource(256, &upstream);
+
+        void *const p = resource.allocate(64);
+        std::thread([&] { resource.deallocate(p, 64); }).join();
+
+        EXPECT_EQ(resource.stats().d_remoteFrees, 1u);
+        EXPECT_EQ(resource.allocate(64), p)
+            << "Remotely freed block wasn't returned to its owner.";
+        resource.deallocate(p, 64);
+
+        // A block freed remotely and never reclaimed by its owner is still
+        // released on destruction.
+        void *const q = resource.allocate(64);
+        std::thread([&] { resource.deallocate(q, 64); }).join();
+    }
+    EXPECT_EQ(upstream.numDeallocations(), upstream.numAllocations())
+        << "Blocks were leaked.";
+}
+
+TEST(dplp_recyclingresource, thread_exit)
+{
+    dplp::RecyclingResource resource;
+
+    void *p = nullptr;
+    std::thread([&] {
+        p = resource.allocate(64);
+        resource.deallocate(p, 64);
+    }).join();
+
+    // The exited thread's cache, and the block in it, is adopted.
+    std::thread([&] {
+        EXPECT_EQ(resource.allocate(64), p);
+        resource.deallocate(p, 64);
+    }).join();
+
+    EXPECT_EQ(resource.stats().d_numCaches, 1u);
+    EXPECT_EQ(resource.stats().d_hits, 1u);
+}
+
+TEST(dplp_recyclingresource, destroyed_resources)
+{
+    dplp::TestUtil::CountingResource upstream;
+
+    // A thread outliving many resources, the last of which it still has a
+    // cache of when it exits.
+    std::thread([&] {
+        for (int i = 0; i < 1000; ++i) {
+            dplp::RecyclingResource resource(256, &upstream);
+            void *const             p = resource.allocate(40);
+            resource.deallocate(p, 40);
+            EXPECT_EQ(resource.allocate(40), p);
+            resource.deallocate(p, 40);
+            EXPECT_EQ(resource.stats().d_numCaches, 1u);
+        }
+    }).join();
+    EXPECT_EQ(upstream.numDeallocations(), upstream.numAllocations())
+        << "Blocks were leaked.";
+}
+
+TEST(dplp_recyclingresource, promise_state)
+{
+    dplp::RecyclingResource resource;
+    {
+        dplp::DefaultResourceGuard guard(&resource);
+
+        for (int i = 0; i < 100; ++i) {
+            int result = 0;
+            dplp::Promise<int>([i](auto fulfill, auto) { fulfill(i); })
+                .then([](int value) { return value + 1; })
+                .then([&](int value) { result = value; });
+            EXPECT_EQ(result, i + 1);
+        }
+    }
+
+    const dplp::RecyclingResourceStats stats = resource.stats();
+    EXPECT_GT(stats.d_hits, 0u);
+    EXPECT_GT(stats.hitRate(), 0.9)
+        << "Promise state isn't being recycled.";
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
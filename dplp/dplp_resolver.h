@@ -34,7 +34,9 @@
 // cause of this behavior is as of yet unknown. As a workaround, we suggest
 // writing 'intResolver' as follows:
 //..
-//  auto intResolver = [](Invocable<int> fulfill, auto reject){ fulfill(3); };
+//  auto intResolver = [](Invocable<int> auto fulfill, auto reject){
+//      fulfill(3);
+//  };
 //..
 // Note that what we did is properly constrain the type of the lambda.
 //
@@ -49,7 +51,7 @@
 // constructor.
 //..
 //  template<typename T>
-//  dplp::Promise<T> makePromise(dplp::Resolver<T> r) {
+//  dplp::Promise<T> makePromise(dplp::Resolver<T> auto r) {
 //    return dplp::Promise<T>(r);
 //  }
 //..
@@ -61,7 +63,7 @@
 
 namespace dplp {
 template <typename F, typename... Types>
-concept bool Resolver =
+concept Resolver =
     // Types that satisfy 'Resolver<Types...>' are callable with their first
     // argument satisfying 'dplmrts::Invocable<Types...>' and their second
     // argument satisfying 'dplmrts::Invocable<std::exception_ptr>'.
@@ -72,7 +74,7 @@ concept bool Resolver =
 // What follows is an alternate definition of the same concept.
 //
 // template <typename F, typename... Types>
-// concept bool Resolver = requires(F f, Types... t)
+// concept Resolver = requires(F f, Types... t)
 // {
 //     f(dplmrts::InvocableArchetype<Types...>(),
 //       dplmrts::InvocableArchetype<std::exception_ptr>());
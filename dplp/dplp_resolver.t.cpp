@@ -7,8 +7,8 @@
 
 TEST(dplp_resolver, basic)
 {
-    auto resolver = [](dplmrts::Invocable<int>                fulfill,
-                       dplmrts::Invocable<std::exception_ptr> reject) {
+    auto resolver = [](dplmrts::Invocable<int> auto                fulfill,
+                       dplmrts::Invocable<std::exception_ptr> auto reject) {
         fulfill(3);
     };
     EXPECT_EQ((dplp::Resolver<decltype(resolver), int>), true)
@@ -21,7 +21,7 @@ TEST(dplp_resolver, basic)
 
 namespace {
 template <typename T>
-dplp::Promise<T> makePromise(dplp::Resolver<T> r)
+dplp::Promise<T> makePromise(dplp::Resolver<T> auto r)
 {
     return dplp::Promise<T>(r);
 }
@@ -30,8 +30,8 @@ dplp::Promise<T> makePromise(dplp::Resolver<T> r)
 TEST(dplp_resolver, example)
 {
     dplp::Promise<int> r = makePromise<int>(
-                             [](dplmrts::Invocable<int>                fulfill,
-               dplmrts::Invocable<std::exception_ptr> reject) { fulfill(3); });
+        [](dplmrts::Invocable<int> auto                fulfill,
+           dplmrts::Invocable<std::exception_ptr> auto reject) { fulfill(3); });
     bool fulfilled = false;
     r.then([&fulfilled](int i) {
         EXPECT_EQ(i, 3);
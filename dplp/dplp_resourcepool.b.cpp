@@ -0,0 +1,54 @@
+#include <dplp_resourcepool.h>
+
+#include <dplp_promise.h>
+
+#include <benchmark/benchmark.h>
+
+// These benchmarks measure the cost of acquiring and releasing an idle
+// resource, from one thread and from several contending for the same pool,
+// against the cost of creating an already fulfilled promise, which is the
+// least that 'acquire' can cost.
+
+namespace {
+dplp::ResourcePool<int>& pool()
+    // Return a pool holding more resources than there are benchmark threads,
+    // so that an acquisition always finds an idle one.
+{
+    static dplp::ResourcePool<int> s_pool(
+        [] { return dplp::makeFulfilledPromise(0); }, 64);
+    return s_pool;
+}
+}
+
+static void BM_FulfilledPromise(benchmark::State& state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(dplp::makeFulfilledPromise(0));
+}
+BENCHMARK(BM_FulfilledPromise);
+
+static void BM_AcquireIdle(benchmark::State& state)
+{
+    dplp::ResourcePool<int>& resourcePool = pool();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(resourcePool.acquire());
+}
+BENCHMARK(BM_AcquireIdle)->ThreadRange(1, 4)->UseRealTime();
+
+BENCHMARK_MAIN();
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,55 @@
+#include <dplp_resourcepool.h>
+
+namespace dplp {
+
+ResourcePool_FreeList::ResourcePool_FreeList(
+                                         std::atomic<std::uint32_t> *links)
+: d_head(k_NONE)
+, d_links_p(links)
+{
+}
+
+void ResourcePool_FreeList::push(std::uint32_t index)
+{
+    std::uint64_t head = d_head.load();
+    std::uint64_t next;
+    do {
+        d_links_p[index].store(static_cast<std::uint32_t>(head),
+                               std::memory_order_relaxed);
+        next = ((head >> 32) + 1) << 32 | index;
+    } while (!d_head.compare_exchange_weak(head, next));
+}
+
+std::uint32_t ResourcePool_FreeList::pop()
+{
+    std::uint64_t head = d_head.load();
+    std::uint64_t next;
+    do {
+        const std::uint32_t index = static_cast<std::uint32_t>(head);
+        if (index == k_NONE)
+            return k_NONE;
+
+        // The link read may be stale if 'index' was popped meanwhile, in
+        // which case the tag has changed and the swap fails.
+        next = ((head >> 32) + 1) << 32 |
+               d_links_p[index].load(std::memory_order_relaxed);
+    } while (!d_head.compare_exchange_weak(head, next));
+    return static_cast<std::uint32_t>(head);
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,824 @@
+#ifndef INCLUDED_DPLP_RESOURCEPOOL
+#define INCLUDED_DPLP_RESOURCEPOOL
+
+//@PURPOSE: Provide a pool of expensive objects leased through promises.
+//
+//@CLASSES:
+//  dplp::ResourcePool: pool whose leases are acquired as promises
+//  dplp::ResourcePool_Lease: shared handle returning a resource to its pool
+//  dplp::ResourcePool_Slot: place of one resource in a pool
+//  dplp::ResourcePool_FreeList: lock-free stack of slot indices
+//  dplp::ResourcePool_Waiter: queued acquisition of a 'ResourcePool'
+//  dplp::ResourcePoolError: exception for a lease that was not granted
+//
+//@SEE_ALSO: dplp_promise, dplp_ratelimiter, dplp_trampoline
+//
+//@DESCRIPTION: This component provides a class template,
+// 'dplp::ResourcePool<R>', that pools objects that are expensive to create,
+// such as connections or parsers, without blocking a thread when all of them
+// are in use. 'acquire' returns a 'dplp::Promise<ResourcePool<R>::Lease>'.
+// A lease is a handle to one resource of the pool, which is returned to the
+// pool when the last copy of the lease is destroyed. Note that the promise
+// returned by 'acquire' holds a copy, so the resource is leased until that
+// promise is destroyed as well.
+//
+// A pool holds at most a fixed number of resources, each in a slot. Slots
+// that hold an idle resource and slots that hold none are kept in two
+// lock-free stacks of slot indices, 'dplp::ResourcePool_FreeList', whose head
+// is a word holding an index and a tag that is incremented by every change,
+// so that a stale compare-and-swap fails. 'acquire' pops an idle slot and
+// returns an already fulfilled promise, so an acquisition that finds an
+// idle resource takes no lock and allocates nothing. The most recently
+// released resource is reused first, which lets the others become idle for
+// long enough to expire.
+//
+// If no resource is idle but a slot is empty, 'acquire' calls the factory
+// given at construction, which returns a 'dplp::Promise<R>', and the lease is
+// granted when that is fulfilled. If the factory's promise is rejected, so
+// is that of 'acquire', and the slot becomes empty again.
+//
+// If every slot is in use, the acquirer is added to a FIFO queue of waiters,
+// which is a linked list of 'dplp::ResourcePool_Waiter' nodes, each holding
+// the functions resolving the acquirer's promise and allocated, like the
+// nodes of 'dplp::PromiseState<>', from 'dplp::DefaultResource::get()'. A
+// released resource is then handed directly to the oldest
+// waiter, whose promise is fulfilled, and its continuations called, by the
+// thread that released it. A waiter is also given the slot of a resource that
+// was invalidated, or whose creation failed, and a new resource is created
+// for it. Destroying the pool rejects the waiters with a
+// 'dplp::ResourcePoolError'. Leases and resources being created keep the
+// internals of the pool alive, so they may outlive it.
+//
+///Idle Expiry
+///-----------
+// A pool may be given a maximum idle duration. A resource found to be idle
+// for longer is destroyed instead of leased, and a new one is created in its
+// slot. As idle resources are reused most recently released first, the ones
+// that expire are seldom found by 'acquire'; 'evictIdle', which an
+// application would call periodically, destroys them.
+//
+// A resource that a lease holder finds to be broken, e.g. a connection that
+// was closed by its peer, can be marked with 'invalidate', which makes the
+// pool destroy it instead of reusing it.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Pool database connections
+///- - - - - - - - - - - - - - - - - - -
+// Suppose 'connectP' opens a connection asynchronously and at most 8 should
+// be open, none of them idle for more than a minute.
+//..
+//  dplp::ResourcePool<Connection> pool(
+//      [] { return connectP("db.example.com"); },
+//      8,
+//      std::chrono::minutes(1));
+//
+//  dplp::Promise<Rows> queryP(const std::string& sql)
+//  {
+//      return pool.acquire().then(
+//          [sql](const dplp::ResourcePool<Connection>::Lease& lease) {
+//              // The lease, and so the connection, is held until the query
+//              // completes.
+//              return lease->queryP(sql).then([lease](Rows rows) {
+//                  return rows;
+//              });
+//          });
+//  }
+//..
+
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+#include <dplp_trampoline.h>
+
+#include <atomic>      // std::atomic
+#include <chrono>      // std::chrono::steady_clock, std::chrono::nanoseconds
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::int64_t, std::uint32_t, std::uint64_t
+#include <exception>   // std::exception_ptr, std::rethrow_exception
+#include <functional>  // std::function
+#include <memory>      // std::shared_ptr, std::unique_ptr
+#include <mutex>       // std::mutex, std::lock_guard
+#include <optional>
+#include <stdexcept>   // std::runtime_error
+#include <utility>     // std::move
+#include <vector>
+
+namespace dplp {
+
+class ResourcePoolError : public std::runtime_error {
+    // This class is the exception with which an acquisition that was not
+    // granted, because the pool was destroyed, is rejected.
+
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+class ResourcePool_FreeList {
+    // This class implements a lock-free stack of indices into an array of
+    // links, which several stacks may share as long as an index is in at
+    // most one of them at a time.
+
+    std::atomic<std::uint64_t>  d_head;  // tag in the high half
+    std::atomic<std::uint32_t> *d_links_p;
+
+  public:
+    static constexpr std::uint32_t k_NONE = 0xFFFFFFFF;
+        // The index returned by 'pop' when the stack is empty.
+
+    explicit ResourcePool_FreeList(std::atomic<std::uint32_t> *links);
+        // Create an empty stack whose indices are linked through the
+        // specified 'links'.
+
+    void push(std::uint32_t index);
+        // Push the specified 'index' onto this stack.
+
+    std::uint32_t pop();
+        // Pop the index on top of this stack and return it, or return
+        // 'k_NONE' if the stack is empty.
+};
+
+template <typename R>
+class ResourcePool_Shared;
+
+template <typename R>
+struct ResourcePool_Slot {
+    // This struct holds one resource of a pool, if the slot is not empty.
+
+    std::optional<R>              d_resource;
+    std::int64_t                  d_idleSince = 0;  // nanoseconds
+    std::atomic<std::uint32_t>    d_numLeases{0};
+    std::atomic<bool>             d_invalid{false};
+    dplp::ResourcePool_Shared<R> *d_pool_p = nullptr;
+    std::uint32_t                 d_index   = 0;
+};
+
+template <typename R>
+class ResourcePool_Lease {
+    // This class implements a shared handle to a resource leased from a
+    // pool, which returns it to the pool when the last copy is destroyed.
+
+    // 'd_slot_sp' shares the ownership of the internals of the pool, so that
+    // a lease fits in a promise without allocating.
+    std::shared_ptr<dplp::ResourcePool_Slot<R> > d_slot_sp;
+
+    template <typename>
+    friend class ResourcePool_Shared;
+
+    ResourcePool_Lease(
+               const std::shared_ptr<dplp::ResourcePool_Shared<R> >& shared,
+               std::uint32_t                                         slot);
+        // Create the first lease of the resource in the specified 'slot' of
+        // the specified 'shared' pool.
+
+  public:
+    ResourcePool_Lease();
+        // Create a lease that refers to no resource.
+
+    ResourcePool_Lease(const ResourcePool_Lease& original);
+    ResourcePool_Lease(ResourcePool_Lease&& original) noexcept;
+        // Create a lease of the same resource as the specified 'original'.
+        // A moved-from lease refers to no resource.
+
+    ~ResourcePool_Lease();
+        // Destroy this lease, which returns the resource to its pool if it
+        // is the last one.
+
+    ResourcePool_Lease& operator=(ResourcePool_Lease other);
+        // Make this lease refer to the resource of the specified 'other'
+        // and return a reference to it.
+
+    R& operator*() const;
+    R *operator->() const;
+        // Return the leased resource. The behavior is undefined unless this
+        // lease refers to a resource.
+
+    void invalidate() const;
+        // Make the pool destroy the leased resource, instead of reusing it,
+        // when it is returned. The behavior is undefined unless this lease
+        // refers to a resource.
+};
+
+template <typename R>
+class ResourcePool_Waiter {
+    // This class is the base of the nodes in the queue of acquirers waiting
+    // for a slot of a pool.
+
+  public:
+    ResourcePool_Waiter *d_next_p = nullptr;
+
+    virtual void run(const dplp::ResourcePool_Lease<R> *lease,
+                     const std::exception_ptr          *error) = 0;
+        // Destroy this object and fulfill the acquirer's promise with
+        // '*lease' if the specified 'lease' is not null, or reject it with
+        // '*error' otherwise.
+
+  protected:
+    ~ResourcePool_Waiter() = default;
+};
+
+template <typename R, typename Fulfill, typename Reject>
+class ResourcePool_WaiterImp
+: public dplp::ResourcePool_Waiter<R>
+, public dplp::DefaultResourceNode<
+      ResourcePool_WaiterImp<R, Fulfill, Reject> > {
+    // This class implements a queued acquisition holding the functions that
+    // resolve its promise, allocated from the default resource by 'create'.
+
+    Fulfill d_fulfill;
+    Reject  d_reject;
+
+    friend class dplp::DefaultResourceNode<ResourcePool_WaiterImp>;
+
+    ResourcePool_WaiterImp(const Fulfill& fulfill, const Reject& reject);
+
+  public:
+    void run(const dplp::ResourcePool_Lease<R> *lease,
+             const std::exception_ptr          *error) override;
+};
+
+template <typename R>
+class ResourcePool_Shared {
+    // This class implements the internals of a pool, which are shared with
+    // its leases and with the resources being created.
+
+  public:
+    typedef dplp::ResourcePool_Lease<R>     Lease;
+    typedef std::function<dplp::Promise<R>()> Factory;
+
+  private:
+    typedef dplp::ResourcePool_Slot<R> Slot;
+
+    typedef dplp::ResourcePool_Waiter<R> Waiter;
+
+    const Factory                                 d_factory;
+    const std::int64_t                            d_maxIdle;  // nanoseconds
+    std::unique_ptr<Slot[]>                       d_slots;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> d_links;
+    dplp::ResourcePool_FreeList                   d_idle;
+    dplp::ResourcePool_FreeList                   d_empty;
+    std::atomic<std::size_t>                      d_numWaiters;
+
+    std::mutex d_mutex;  // protects the below
+    Waiter    *d_head_p;
+    Waiter    *d_tail_p;
+    bool       d_closed;
+
+    typedef std::shared_ptr<ResourcePool_Shared> SharedPtr;
+
+    friend class dplp::ResourcePool_Lease<R>;
+
+    std::int64_t now() const;
+        // Return the current time of the steady clock in nanoseconds, or 0
+        // if resources never expire.
+
+    bool isExpired(std::uint32_t slot, std::int64_t current) const;
+        // Return 'true' if the resource in the specified idle 'slot' has
+        // been idle for too long at the specified 'current' time, and
+        // 'false' otherwise.
+
+    dplp::Promise<Lease> create(const SharedPtr& self, std::uint32_t slot);
+        // Return a promise fulfilled with the first lease of a resource
+        // created by the factory in the specified empty 'slot' of the
+        // specified 'self', or rejected if that fails.
+
+    dplp::Promise<Lease> wait(const SharedPtr& self);
+        // Return a promise fulfilled once a slot is available to the
+        // acquirer, which is queued.
+
+    void drain(const SharedPtr& self);
+        // Give the idle and empty slots to the waiters, oldest first.
+
+    void grant(const SharedPtr& self,
+               Waiter          *waiter,
+               std::uint32_t    slot,
+               bool             isEmpty);
+        // Fulfill the promise of the specified 'waiter' with a lease of the
+        // specified 'slot', creating the resource if the specified 'isEmpty'
+        // is 'true', which destroys the waiter.
+
+    void release(const std::shared_ptr<Slot>& slot);
+        // Return the resource in the specified 'slot', whose last lease is
+        // being destroyed, to the pool.
+
+    void releaseEmpty(const SharedPtr& self, std::uint32_t slot);
+        // Return the specified 'slot', holding no resource, to the pool.
+
+  public:
+    ResourcePool_Shared(Factory                  factory,
+                        std::size_t              maxSize,
+                        std::chrono::nanoseconds maxIdle);
+        // Create the internals of a pool of at most the specified 'maxSize'
+        // resources created by the specified 'factory' and expiring after
+        // the specified 'maxIdle' duration.
+
+    ~ResourcePool_Shared();
+        // Destroy this object and the resources it holds.
+
+    dplp::Promise<Lease> acquire(const SharedPtr& self);
+        // Return a promise fulfilled with a lease of a resource of the
+        // specified 'self', which is this object.
+
+    std::size_t evictIdle(const SharedPtr& self);
+        // Destroy the resources of the specified 'self', which is this
+        // object, that have been idle for too long and return their number.
+
+    void close();
+        // Reject the promises of the waiters.
+
+    std::size_t numWaiting() const;
+        // Return the number of waiting acquirers.
+};
+
+template <typename R>
+class ResourcePool {
+    // This class implements a pool of at most a fixed number of resources
+    // that are created asynchronously and leased through promises.
+
+    std::shared_ptr<dplp::ResourcePool_Shared<R> > d_shared_sp;
+
+  public:
+    typedef dplp::ResourcePool_Lease<R> Lease;
+        // The type of a shared handle to a leased resource.
+
+    typedef std::function<dplp::Promise<R>()> Factory;
+        // The type of the function creating a resource.
+
+    ResourcePool(Factory                  factory,
+                 std::size_t              maxSize,
+                 std::chrono::nanoseconds maxIdle =
+                     std::chrono::nanoseconds::max());
+        // Create a 'ResourcePool' object holding at most the specified
+        // 'maxSize' resources, created when needed by the specified
+        // 'factory', and destroying the ones idle for longer than the
+        // optionally specified 'maxIdle'. The behavior is undefined unless
+        // '0 < maxSize < 0xFFFFFFFF'.
+
+    ResourcePool(const ResourcePool&) = delete;
+    ResourcePool& operator=(const ResourcePool&) = delete;
+
+    ~ResourcePool();
+        // Reject the promises of the waiting acquirers with a
+        // 'dplp::ResourcePoolError' and destroy this object. The resources
+        // are destroyed when they are no longer leased.
+
+    dplp::Promise<Lease> acquire();
+        // Return a promise fulfilled with a lease of an idle resource, of a
+        // newly created one, or of one that is released later if every
+        // resource is leased. If creating the resource fails, the promise is
+        // rejected with the same error.
+
+    std::size_t evictIdle();
+        // Destroy the resources that have been idle for longer than the
+        // maximum idle duration and return their number.
+
+    std::size_t numWaiting() const;
+        // Return the number of acquirers waiting for a resource.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+                          // ------------------------
+                          // class ResourcePool_Lease
+                          // ------------------------
+
+template <typename R>
+ResourcePool_Lease<R>::ResourcePool_Lease(
+               const std::shared_ptr<dplp::ResourcePool_Shared<R> >& shared,
+               std::uint32_t                                         slot)
+: d_slot_sp(shared, &shared->d_slots[slot])
+{
+    d_slot_sp->d_numLeases.store(1, std::memory_order_relaxed);
+}
+
+template <typename R>
+ResourcePool_Lease<R>::ResourcePool_Lease()
+{
+}
+
+template <typename R>
+ResourcePool_Lease<R>::ResourcePool_Lease(const ResourcePool_Lease& original)
+: d_slot_sp(original.d_slot_sp)
+{
+    if (d_slot_sp)
+        d_slot_sp->d_numLeases.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename R>
+ResourcePool_Lease<R>::ResourcePool_Lease(
+                                   ResourcePool_Lease&& original) noexcept
+: d_slot_sp(std::move(original.d_slot_sp))
+{
+}
+
+template <typename R>
+ResourcePool_Lease<R>::~ResourcePool_Lease()
+{
+    if (d_slot_sp &&
+        d_slot_sp->d_numLeases.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        d_slot_sp->d_pool_p->release(d_slot_sp);
+}
+
+template <typename R>
+ResourcePool_Lease<R>& ResourcePool_Lease<R>::operator=(
+                                                      ResourcePool_Lease other)
+{
+    d_slot_sp.swap(other.d_slot_sp);
+    return *this;
+}
+
+template <typename R>
+R& ResourcePool_Lease<R>::operator*() const
+{
+    return *d_slot_sp->d_resource;
+}
+
+template <typename R>
+R *ResourcePool_Lease<R>::operator->() const
+{
+    return &*d_slot_sp->d_resource;
+}
+
+template <typename R>
+void ResourcePool_Lease<R>::invalidate() const
+{
+    d_slot_sp->d_invalid.store(true, std::memory_order_relaxed);
+}
+
+                       // ----------------------------
+                       // class ResourcePool_WaiterImp
+                       // ----------------------------
+
+template <typename R, typename Fulfill, typename Reject>
+ResourcePool_WaiterImp<R, Fulfill, Reject>::ResourcePool_WaiterImp(
+                                                      const Fulfill& fulfill,
+                                                      const Reject&  reject)
+: d_fulfill(fulfill)
+, d_reject(reject)
+{
+}
+
+template <typename R, typename Fulfill, typename Reject>
+void ResourcePool_WaiterImp<R, Fulfill, Reject>::run(
+                                const dplp::ResourcePool_Lease<R> *lease,
+                                const std::exception_ptr          *error)
+{
+    if (lease)
+        this->take(&ResourcePool_WaiterImp::d_fulfill)(*lease);
+    else
+        this->take(&ResourcePool_WaiterImp::d_reject)(*error);
+}
+
+                         // -------------------------
+                         // class ResourcePool_Shared
+                         // -------------------------
+
+template <typename R>
+std::int64_t ResourcePool_Shared<R>::now() const
+{
+    if (d_maxIdle == std::chrono::nanoseconds::max().count())
+        return 0;
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+template <typename R>
+bool ResourcePool_Shared<R>::isExpired(std::uint32_t slot,
+                                       std::int64_t  current) const
+{
+    return current - d_slots[slot].d_idleSince > d_maxIdle;
+}
+
+template <typename R>
+dplp::Promise<typename ResourcePool_Shared<R>::Lease>
+ResourcePool_Shared<R>::create(const SharedPtr& self, std::uint32_t slot)
+{
+    try {
+        return d_factory().then(
+            [self, slot](const R& value) {
+                self->d_slots[slot].d_resource.emplace(value);
+                return Lease(self, slot);
+            },
+            [self, slot](std::exception_ptr error) -> Lease {
+                self->releaseEmpty(self, slot);
+                std::rethrow_exception(error);
+            });
+    }
+    catch (...) {
+        releaseEmpty(self, slot);
+        return dplp::makeRejectedPromise<Lease>(std::current_exception());
+    }
+}
+
+template <typename R>
+dplp::Promise<typename ResourcePool_Shared<R>::Lease>
+ResourcePool_Shared<R>::wait(const SharedPtr& self)
+{
+    return dplp::Promise<Lease>([&](auto fulfill, auto reject) {
+        Waiter *const waiter = dplp::ResourcePool_WaiterImp<
+            R,
+            decltype(fulfill),
+            decltype(reject)>::create(fulfill, reject);
+        bool closed = false;
+        {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            closed = d_closed;
+            if (!closed) {
+                if (d_tail_p)
+                    d_tail_p->d_next_p = waiter;
+                else
+                    d_head_p = waiter;
+                d_tail_p = waiter;
+                d_numWaiters.fetch_add(1);
+            }
+        }
+        if (closed) {
+            const std::exception_ptr error = std::make_exception_ptr(
+                dplp::ResourcePoolError("dplp::ResourcePool destroyed"));
+            waiter->run(nullptr, &error);
+            return;
+        }
+
+        // A slot released since 'acquire' found none may have missed the
+        // waiter just queued; the count and the stacks being sequentially
+        // consistent, either the releaser or this drain finds it.
+        drain(self);
+    });
+}
+
+template <typename R>
+void ResourcePool_Shared<R>::drain(const SharedPtr& self)
+{
+    while (true) {
+        Waiter       *waiter = nullptr;
+        std::uint32_t slot   = dplp::ResourcePool_FreeList::k_NONE;
+        bool          isEmpty = false;
+        {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            if (!d_head_p)
+                return;
+
+            slot = d_idle.pop();
+            if (slot == dplp::ResourcePool_FreeList::k_NONE) {
+                slot = d_empty.pop();
+                if (slot == dplp::ResourcePool_FreeList::k_NONE)
+                    return;
+                isEmpty = true;
+            }
+
+            waiter   = d_head_p;
+            d_head_p = waiter->d_next_p;
+            if (!d_head_p)
+                d_tail_p = nullptr;
+            d_numWaiters.fetch_sub(1);
+        }
+        grant(self, waiter, slot, isEmpty);
+    }
+}
+
+template <typename R>
+void ResourcePool_Shared<R>::grant(const SharedPtr& self,
+                                   Waiter          *waiter,
+                                   std::uint32_t    slot,
+                                   bool             isEmpty)
+{
+    if (!isEmpty && isExpired(slot, now())) {
+        d_slots[slot].d_resource.reset();
+        isEmpty = true;
+    }
+
+    if (isEmpty) {
+        // Exactly one of the continuations runs, and destroys the waiter.
+        try {
+            create(self, slot).then(
+                [waiter](const Lease& lease) { waiter->run(&lease, nullptr); },
+                [waiter](std::exception_ptr error) {
+                    waiter->run(nullptr, &error);
+                });
+        }
+        catch (...) {
+            const std::exception_ptr error = std::current_exception();
+            waiter->run(nullptr, &error);
+        }
+    }
+    else {
+        // The waiter's continuations may release other leases in turn, so
+        // the trampoline bounds the recursion.
+        dplp::Trampoline::run([waiter, lease = Lease(self, slot)] {
+            waiter->run(&lease, nullptr);
+        });
+    }
+}
+
+template <typename R>
+void ResourcePool_Shared<R>::release(const std::shared_ptr<Slot>& slot)
+{
+    const std::uint32_t index = slot->d_index;
+    if (slot->d_invalid.load(std::memory_order_relaxed)) {
+        slot->d_resource.reset();
+        slot->d_invalid.store(false, std::memory_order_relaxed);
+        releaseEmpty(SharedPtr(slot, this), index);
+        return;
+    }
+
+    slot->d_idleSince = now();
+    if (d_numWaiters.load() != 0) {
+        // Hand the resource to the oldest waiter without making it idle.
+        Waiter *waiter = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            if (d_head_p) {
+                waiter   = d_head_p;
+                d_head_p = waiter->d_next_p;
+                if (!d_head_p)
+                    d_tail_p = nullptr;
+                d_numWaiters.fetch_sub(1);
+            }
+        }
+        if (waiter) {
+            grant(SharedPtr(slot, this), waiter, index, false);
+            return;
+        }
+    }
+
+    d_idle.push(index);
+    if (d_numWaiters.load() != 0)
+        drain(SharedPtr(slot, this));
+}
+
+template <typename R>
+void ResourcePool_Shared<R>::releaseEmpty(const SharedPtr& self,
+                                          std::uint32_t    slot)
+{
+    d_empty.push(slot);
+    if (d_numWaiters.load() != 0)
+        drain(self);
+}
+
+template <typename R>
+ResourcePool_Shared<R>::ResourcePool_Shared(Factory                  factory,
+                                            std::size_t              maxSize,
+                                            std::chrono::nanoseconds maxIdle)
+: d_factory(std::move(factory))
+, d_maxIdle(maxIdle.count())
+, d_slots(new Slot[maxSize])
+, d_links(new std::atomic<std::uint32_t>[maxSize])
+, d_idle(d_links.get())
+, d_empty(d_links.get())
+, d_numWaiters(0)
+, d_head_p(nullptr)
+, d_tail_p(nullptr)
+, d_closed(false)
+{
+    for (std::size_t i = maxSize; i-- > 0;) {
+        d_slots[i].d_pool_p = this;
+        d_slots[i].d_index  = static_cast<std::uint32_t>(i);
+        d_empty.push(static_cast<std::uint32_t>(i));
+    }
+}
+
+template <typename R>
+ResourcePool_Shared<R>::~ResourcePool_Shared()
+{
+    close();
+}
+
+template <typename R>
+dplp::Promise<typename ResourcePool_Shared<R>::Lease>
+ResourcePool_Shared<R>::acquire(const SharedPtr& self)
+{
+    std::uint32_t slot = d_idle.pop();
+    if (slot != dplp::ResourcePool_FreeList::k_NONE) {
+        if (!isExpired(slot, now()))
+            return dplp::makeFulfilledPromise(Lease(self, slot));
+
+        d_slots[slot].d_resource.reset();
+        return create(self, slot);
+    }
+
+    slot = d_empty.pop();
+    if (slot != dplp::ResourcePool_FreeList::k_NONE)
+        return create(self, slot);
+
+    return wait(self);
+}
+
+template <typename R>
+std::size_t ResourcePool_Shared<R>::evictIdle(const SharedPtr& self)
+{
+    const std::int64_t         current = now();
+    std::vector<std::uint32_t> kept;
+    std::size_t                numEvicted = 0;
+    for (std::uint32_t slot = d_idle.pop();
+         slot != dplp::ResourcePool_FreeList::k_NONE;
+         slot = d_idle.pop()) {
+        if (isExpired(slot, current)) {
+            d_slots[slot].d_resource.reset();
+            d_empty.push(slot);
+            ++numEvicted;
+        }
+        else {
+            kept.push_back(slot);
+        }
+    }
+
+    // Push the kept slots back so that the most recently released is on top
+    // again.
+    for (std::size_t i = kept.size(); i-- > 0;)
+        d_idle.push(kept[i]);
+
+    // An acquirer that found both stacks empty while they were being scanned
+    // was queued, and its own drain found nothing either.
+    if (d_numWaiters.load() != 0)
+        drain(self);
+    return numEvicted;
+}
+
+template <typename R>
+void ResourcePool_Shared<R>::close()
+{
+    Waiter *waiters = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_closed = true;
+        waiters  = d_head_p;
+        d_head_p = nullptr;
+        d_tail_p = nullptr;
+        d_numWaiters.store(0);
+    }
+
+    const std::exception_ptr error = std::make_exception_ptr(
+        dplp::ResourcePoolError("dplp::ResourcePool destroyed"));
+    while (waiters) {
+        Waiter *const next = waiters->d_next_p;
+        waiters->run(nullptr, &error);
+        waiters = next;
+    }
+}
+
+template <typename R>
+std::size_t ResourcePool_Shared<R>::numWaiting() const
+{
+    return d_numWaiters.load(std::memory_order_relaxed);
+}
+
+                             // ------------------
+                             // class ResourcePool
+                             // ------------------
+
+template <typename R>
+ResourcePool<R>::ResourcePool(Factory                  factory,
+                              std::size_t              maxSize,
+                              std::chrono::nanoseconds maxIdle)
+: d_shared_sp(std::make_shared<dplp::ResourcePool_Shared<R> >(
+      std::move(factory), maxSize, maxIdle))
+{
+}
+
+template <typename R>
+ResourcePool<R>::~ResourcePool()
+{
+    d_shared_sp->close();
+}
+
+template <typename R>
+dplp::Promise<typename ResourcePool<R>::Lease> ResourcePool<R>::acquire()
+{
+    return d_shared_sp->acquire(d_shared_sp);
+}
+
+template <typename R>
+std::size_t ResourcePool<R>::evictIdle()
+{
+    return d_shared_sp->evictIdle(d_shared_sp);
+}
+
+template <typename R>
+std::size_t ResourcePool<R>::numWaiting() const
+{
+    return d_shared_sp->numWaiting();
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,354 @@
+#include <dplp_resourcepool.h>
+
+#include <dplp_defaultresource.h>
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+typedef dplp::ResourcePool<int> Pool;
+
+struct Factory {
+    // A factory creating resources numbered from 1, either immediately or
+    // when 'complete' is called.
+
+    bool                                    d_deferred = false;
+    int                                     d_numCreated = 0;
+    std::vector<std::function<void(int)> >  d_fulfill;
+    std::vector<std::function<void(std::exception_ptr)> > d_reject;
+
+    dplp::Promise<int> operator()()
+    {
+        ++d_numCreated;
+        if (!d_deferred)
+            return dplp::makeFulfilledPromise(d_numCreated);
+
+        return dplp::Promise<int>([this](auto fulfill, auto reject) {
+            d_fulfill.push_back(fulfill);
+            d_reject.push_back(reject);
+        });
+    }
+
+    void complete(std::size_t i)
+    {
+        d_fulfill[i](static_cast<int>(i) + 1);
+    }
+};
+
+template <typename LEASE>
+std::optional<LEASE> leaseOf(const dplp::Promise<LEASE>& p)
+    // Return the lease with which the specified 'p' is fulfilled, or nothing
+    // if it is not.
+{
+    std::optional<LEASE> result;
+    if (!dplp::TestUtil::isResolved(p))
+        return result;
+
+    p.then([&](const LEASE& lease) { result = lease; },
+           [](std::exception_ptr) {});
+    return result;
+}
+
+struct Hooked {
+    // A resource that calls, and clears, a hook when any copy of it is
+    // destroyed.
+
+    int                    d_id;
+    std::function<void()> *d_onDestroy_p;
+
+    ~Hooked()
+    {
+        if (*d_onDestroy_p)
+            std::exchange(*d_onDestroy_p, nullptr)();
+    }
+};
+
+}
+
+TEST(dplp_resourcepool, reuse)
+{
+    Factory factory;
+    Pool    pool(std::ref(factory), 4);
+
+    std::optional<Pool::Lease> lease = leaseOf(pool.acquire());
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(**lease, 1);
+    lease.reset();
+
+    // The idle resource is leased again without creating another.
+    lease = leaseOf(pool.acquire());
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(**lease, 1);
+    EXPECT_EQ(factory.d_numCreated, 1);
+
+    // Copies share the lease.
+    std::optional<Pool::Lease> copy = lease;
+    lease.reset();
+    EXPECT_EQ(**leaseOf(pool.acquire()), 2);
+    EXPECT_EQ(**copy, 1);
+}
+
+TEST(dplp_resourcepool, waiters)
+{
+    Factory factory;
+    Pool    pool(std::ref(factory), 2);
+
+    std::optional<Pool::Lease> a = leaseOf(pool.acquire());
+    std::optional<Pool::Lease> b = leaseOf(pool.acquire());
+    const dplp::Promise<Pool::Lease> first  = pool.acquire();
+    const dplp::Promise<Pool::Lease> second = pool.acquire();
+    EXPECT_FALSE(dplp::AnyPromiseHandle(first).isResolved());
+    EXPECT_EQ(pool.numWaiting(), 2u);
+
+    // A released resource goes to the oldest waiter.
+    b.reset();
+    std::optional<Pool::Lease> c = leaseOf(first);
+    ASSERT_TRUE(c);
+    EXPECT_EQ(**c, 2);
+    EXPECT_FALSE(dplp::AnyPromiseHandle(second).isResolved());
+    EXPECT_EQ(pool.numWaiting(), 1u);
+
+    a.reset();
+    EXPECT_EQ(**leaseOf(second), 1);
+    EXPECT_EQ(pool.numWaiting(), 0u);
+    EXPECT_EQ(factory.d_numCreated, 2);
+}
+
+TEST(dplp_resourcepool, waiter_resource)
+{
+    dplp::TestUtil::CountingResource resource;
+    Factory                          factory;
+    std::optional<Pool>              pool(std::in_place, std::ref(factory), 1);
+    std::optional<Pool::Lease>       lease = leaseOf(pool->acquire());
+
+    std::optional<dplp::Promise<Pool::Lease> > first;
+    std::optional<dplp::Promise<Pool::Lease> > second;
+    {
+        dplp::DefaultResourceGuard guard(&resource);
+        first  = pool->acquire();
+        second = pool->acquire();
+    }
+    EXPECT_GT(resource.numLive(), 0);
+
+    // Granted and rejected waiters are returned to the resource they were
+    // allocated from.
+    lease.reset();
+    EXPECT_EQ(**leaseOf(*first), 1);
+    pool.reset();
+    EXPECT_EQ(dplp::TestUtil::errorOf(*second),
+              "dplp::ResourcePool destroyed");
+    first.reset();
+    second.reset();
+    EXPECT_EQ(resource.numLive(), 0);
+}
+
+TEST(dplp_resourcepool, asynchronous_factory)
+{
+    Factory factory;
+    factory.d_deferred = true;
+    Pool pool(std::ref(factory), 1);
+
+    std::optional<dplp::Promise<Pool::Lease> > first = pool.acquire();
+    const dplp::Promise<Pool::Lease>           second = pool.acquire();
+    EXPECT_FALSE(dplp::AnyPromiseHandle(*first).isResolved());
+    EXPECT_EQ(pool.numWaiting(), 1u);
+
+    factory.complete(0);
+    std::optional<Pool::Lease> lease = leaseOf(*first);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(**lease, 1);
+    EXPECT_FALSE(dplp::AnyPromiseHandle(second).isResolved());
+
+    // The fulfilled promise holds a copy of the lease.
+    lease.reset();
+    EXPECT_FALSE(dplp::AnyPromiseHandle(second).isResolved());
+    first.reset();
+    EXPECT_EQ(**leaseOf(second), 1);
+    EXPECT_EQ(factory.d_numCreated, 1);
+}
+
+TEST(dplp_resourcepool, factory_failure)
+{
+    Factory factory;
+    factory.d_deferred = true;
+    Pool pool(std::ref(factory), 1);
+
+    const dplp::Promise<Pool::Lease> first  = pool.acquire();
+    const dplp::Promise<Pool::Lease> second = pool.acquire();
+    factory.d_reject[0](
+        std::make_exception_ptr(std::runtime_error("connection refused")));
+    EXPECT_EQ(dplp::TestUtil::errorOf(first), "connection refused");
+
+    // The slot of the failed resource is given to the waiter.
+    EXPECT_EQ(factory.d_numCreated, 2);
+    factory.complete(1);
+    EXPECT_EQ(**leaseOf(second), 2);
+
+    // A factory that throws is the same as one that rejects.
+    Pool throwing([]() -> dplp::Promise<int> {
+        throw std::runtime_error("thrown");
+    }, 1);
+    EXPECT_EQ(dplp::TestUtil::errorOf(throwing.acquire()), "thrown");
+    EXPECT_EQ(dplp::TestUtil::errorOf(throwing.acquire()), "thrown");
+}
+
+TEST(dplp_resourcepool, invalidate)
+{
+    Factory factory;
+    Pool    pool(std::ref(factory), 1);
+
+    std::optional<Pool::Lease> lease = leaseOf(pool.acquire());
+    std::optional<dplp::Promise<Pool::Lease> > waiting = pool.acquire();
+    lease->invalidate();
+    lease.reset();
+
+    // The waiter is given a new resource.
+    lease = leaseOf(*waiting);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(**lease, 2);
+    lease.reset();
+    waiting.reset();
+    EXPECT_EQ(**leaseOf(pool.acquire()), 2);
+}
+
+TEST(dplp_resourcepool, idle_expiry)
+{
+    Factory factory;
+    Pool    pool(std::ref(factory), 3, std::chrono::milliseconds(1));
+
+    std::optional<Pool::Lease> a = leaseOf(pool.acquire());
+    std::optional<Pool::Lease> b = leaseOf(pool.acquire());
+    a.reset();
+    b.reset();
+    EXPECT_EQ(pool.evictIdle(), 0u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    std::optional<Pool::Lease> c = leaseOf(pool.acquire());
+    c.reset();
+    EXPECT_EQ(pool.evictIdle(), 1u);
+    EXPECT_EQ(factory.d_numCreated, 3);
+
+    // An expired resource found by 'acquire' is replaced.
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_EQ(**leaseOf(pool.acquire()), 4);
+}
+
+TEST(dplp_resourcepool, acquire_during_eviction)
+{
+    // An acquirer queued while 'evictIdle' holds the idle slots is granted
+    // one of them once they are returned.
+    std::function<void()>        onDestroy;
+    int                          numCreated = 0;
+    dplp::ResourcePool<Hooked>   pool(
+        [&] {
+            ++numCreated;
+            return dplp::makeFulfilledPromise(Hooked{numCreated, &onDestroy});
+        },
+        2,
+        std::chrono::milliseconds(50));
+
+    std::optional<dplp::ResourcePool<Hooked>::Lease> a =
+        leaseOf(pool.acquire());
+    std::optional<dplp::ResourcePool<Hooked>::Lease> b =
+        leaseOf(pool.acquire());
+    a.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    b.reset();
+
+    // The expired resource is destroyed after both idle slots are popped.
+    std::optional<dplp::Promise<dplp::ResourcePool<Hooked>::Lease> > waiting;
+    onDestroy = [&] { waiting = pool.acquire(); };
+    EXPECT_EQ(pool.evictIdle(), 1u);
+    ASSERT_TRUE(waiting);
+
+    std::optional<dplp::ResourcePool<Hooked>::Lease> lease =
+        leaseOf(*waiting);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ((*lease)->d_id, 2);
+    EXPECT_EQ(pool.numWaiting(), 0u);
+    EXPECT_EQ(numCreated, 2);
+}
+
+TEST(dplp_resourcepool, destroyed)
+{
+    Factory                          factory;
+    std::optional<Pool>              pool(std::in_place, std::ref(factory), 1);
+    std::optional<Pool::Lease>       lease = leaseOf(pool->acquire());
+    const dplp::Promise<Pool::Lease> waiting = pool->acquire();
+
+    pool.reset();
+    EXPECT_EQ(dplp::TestUtil::errorOf(waiting),
+              "dplp::ResourcePool destroyed");
+    EXPECT_EQ(**lease, 1);
+}
+
+TEST(dplp_resourcepool, threads)
+{
+    std::atomic<int> numCreated(0);
+    Pool             pool([&] { return dplp::makeFulfilledPromise(
+                                    numCreated.fetch_add(1) + 1); },
+              3);
+
+    std::vector<std::thread> threads;
+    std::atomic<int>         numHeld(0);
+    std::atomic<int>         maxHeld(0);
+    std::atomic<int>         numGranted(0);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10000; ++i) {
+                pool.acquire().then([&](Pool::Lease) {
+                    const int held = numHeld.fetch_add(1) + 1;
+                    int       max  = maxHeld.load();
+                    while (held > max && !maxHeld.compare_exchange_weak(max,
+                                                                        held))
+                        ;
+                    ++numGranted;
+                    numHeld.fetch_sub(1);
+                });
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(numGranted.load(), 40000);
+    EXPECT_LE(maxHeld.load(), 3);
+    EXPECT_LE(numCreated.load(), 3);
+    EXPECT_EQ(pool.numWaiting(), 0u);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,490 @@
+#include <dplp_rpc.h>
+
+#include <cerrno>        // errno, EINTR
+#include <cstring>       // std::memcpy
+#include <exception>     // std::exception, std::exception_ptr
+#include <mutex>         // std::mutex, std::lock_guard
+#include <system_error>  // std::system_error
+#include <utility>       // std::move
+
+#include <sys/socket.h>  // send, MSG_NOSIGNAL
+#include <unistd.h>      // read
+
+namespace dplp {
+namespace {
+
+enum RecordKind : unsigned char {
+    e_CALL      = 1,
+    e_FINISH    = 2,
+    e_FULFILLED = 3,
+    e_REJECTED  = 4
+};
+
+enum ArgumentKind : unsigned char { e_VALUE = 0, e_RESULT = 1 };
+
+class Writer {
+    // This class implements appending the fields of records to a buffer.
+
+    std::string *d_buffer_p;
+
+  public:
+    explicit Writer(std::string *buffer)
+    : d_buffer_p(buffer)
+    {
+    }
+
+    void byte(unsigned char value)
+    {
+        d_buffer_p->push_back(static_cast<char>(value));
+    }
+
+    void u32(std::uint32_t value)
+    {
+        d_buffer_p->append(reinterpret_cast<const char *>(&value),
+                           sizeof(value));
+    }
+
+    void string(std::string_view value)
+    {
+        u32(static_cast<std::uint32_t>(value.size()));
+        d_buffer_p->append(value.data(), value.size());
+    }
+};
+
+class Reader {
+    // This class implements reading the fields of records from a message.
+    // Reading past the end throws 'std::runtime_error'.
+
+    std::string_view d_input;
+
+    void require(std::size_t size) const
+    {
+        if (d_input.size() < size)
+            throw std::runtime_error("malformed RPC message");
+    }
+
+  public:
+    explicit Reader(std::string_view input)
+    : d_input(input)
+    {
+    }
+
+    bool atEnd() const { return d_input.empty(); }
+
+    unsigned char byte()
+    {
+        require(1);
+        const unsigned char result = static_cast<unsigned char>(d_input[0]);
+        d_input.remove_prefix(1);
+        return result;
+    }
+
+    std::uint32_t u32()
+    {
+        std::uint32_t result;
+        require(sizeof(result));
+        std::memcpy(&result, d_input.data(), sizeof(result));
+        d_input.remove_prefix(sizeof(result));
+        return result;
+    }
+
+    std::string string()
+    {
+        const std::uint32_t size = u32();
+        require(size);
+        std::string result(d_input.substr(0, size));
+        d_input.remove_prefix(size);
+        return result;
+    }
+};
+
+void writeMessage(int fd, std::string_view records)
+    // Write to the specified 'fd' a message holding the specified 'records'.
+    // Throw 'std::system_error' on failure.
+{
+    std::string message;
+    Writer(&message).string(records);
+
+    std::string_view remaining = message;
+    while (!remaining.empty()) {
+        // 'MSG_NOSIGNAL' turns a closed peer into 'EPIPE' instead of a
+        // 'SIGPIPE' that would kill the process.
+        const ssize_t n =
+            send(fd, remaining.data(), remaining.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "send");
+        }
+        remaining.remove_prefix(static_cast<std::size_t>(n));
+    }
+}
+
+bool readFully(int fd, char *buffer, std::size_t size)
+    // Read exactly the specified 'size' bytes from the specified 'fd' into
+    // the specified 'buffer'. Return 'false' if the peer closed the
+    // connection before any byte was read, and throw 'std::system_error' on
+    // failure and 'std::runtime_error' if the connection closed midway.
+{
+    std::size_t done = 0;
+    while (done < size) {
+        const ssize_t n = read(fd, buffer + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        if (n == 0) {
+            if (done == 0)
+                return false;
+            throw std::runtime_error("truncated RPC message");
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool readMessage(int fd, std::string *records)
+    // Read a message from the specified 'fd' and load its records into the
+    // specified 'records'. Return 'false' if the peer closed the connection.
+{
+    std::uint32_t size;
+    if (!readFully(fd, reinterpret_cast<char *>(&size), sizeof(size)))
+        return false;
+
+    records->resize(size);
+    if (size != 0 && !readFully(fd, records->data(), size))
+        throw std::runtime_error("truncated RPC message");
+    return true;
+}
+
+std::string messageOf(std::exception_ptr error)
+    // Return the message to send for the specified 'error'.
+{
+    try {
+        std::rethrow_exception(error);
+    }
+    catch (const std::exception& e) {
+        return e.what();
+    }
+    catch (...) {
+        return "unknown error";
+    }
+}
+}
+
+struct RpcClient_Call {
+    // This struct holds the client's view of a call.
+
+    enum State { e_PENDING, e_FULFILLED, e_REJECTED };
+
+    std::uint32_t                           d_id;
+    State                                   d_state;
+    std::string                             d_result;  // value or message
+    std::function<void(std::string)>        d_fulfill;
+    std::function<void(std::exception_ptr)> d_reject;
+};
+
+struct RpcServer_Output {
+    // This struct holds the server's outgoing records. It is shared with the
+    // continuations that send results, which may outlive the server.
+
+    std::mutex  d_mutex;
+    int         d_fd;
+    std::string d_records;
+    bool        d_batching;  // 'true' while a received message is processed
+
+    void send(RecordKind kind, std::uint32_t id, std::string_view payload)
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+
+        Writer writer(&d_records);
+        writer.byte(kind);
+        writer.u32(id);
+        writer.string(payload);
+        if (!d_batching)
+            flush();
+    }
+
+    void flush()
+        // Send the outgoing records. The behavior is undefined unless
+        // 'd_mutex' is locked.
+    {
+        if (d_records.empty())
+            return;
+
+        // A client that went away is not an error for the server, which
+        // finds out when it next reads.
+        try {
+            writeMessage(d_fd, d_records);
+        }
+        catch (const std::system_error&) {
+        }
+        d_records.clear();
+    }
+};
+
+namespace {
+class BatchGuard {
+    // This class implements a guard holding back the results sent through
+    // an 'RpcServer_Output' until it is destroyed, which sends them as one
+    // message.
+
+    RpcServer_Output *d_output_p;
+
+  public:
+    explicit BatchGuard(RpcServer_Output *output)
+    : d_output_p(output)
+    {
+        std::lock_guard<std::mutex> lock(d_output_p->d_mutex);
+        d_output_p->d_batching = true;
+    }
+
+    ~BatchGuard()
+    {
+        std::lock_guard<std::mutex> lock(d_output_p->d_mutex);
+        d_output_p->d_batching = false;
+        d_output_p->flush();
+    }
+};
+}
+
+RpcPromise::RpcPromise(std::shared_ptr<dplp::RpcClient_Call> call,
+                       dplp::Promise<std::string>           promise)
+: d_call_sp(std::move(call))
+, d_promise(std::move(promise))
+{
+}
+
+RpcClient::RpcClient(int fd)
+: d_fd(fd)
+, d_nextId(0)
+{
+}
+
+dplp::RpcPromise RpcClient::call(std::string_view method,
+                                 std::string_view argument)
+{
+    auto call     = std::make_shared<RpcClient_Call>();
+    call->d_id    = d_nextId++;
+    call->d_state = RpcClient_Call::e_PENDING;
+
+    dplp::Promise<std::string> promise([&](auto fulfill, auto reject) {
+        call->d_fulfill = fulfill;
+        call->d_reject  = reject;
+    });
+
+    Writer writer(&d_output);
+    writer.byte(e_CALL);
+    writer.u32(call->d_id);
+    writer.string(method);
+    writer.byte(e_VALUE);
+    writer.string(argument);
+
+    d_pending.emplace(call->d_id, call);
+    return dplp::RpcPromise(std::move(call), std::move(promise));
+}
+
+dplp::RpcPromise RpcClient::call(std::string_view        method,
+                                 const dplp::RpcPromise& argument)
+{
+    const RpcClient_Call& source = *argument.d_call_sp;
+
+    if (source.d_state == RpcClient_Call::e_FULFILLED)
+        return call(method, source.d_result);
+
+    if (source.d_state == RpcClient_Call::e_REJECTED) {
+        // Nothing is sent, so the call needs no id.
+        auto call     = std::make_shared<RpcClient_Call>();
+        call->d_state = RpcClient_Call::e_REJECTED;
+        call->d_result = source.d_result;
+        return dplp::RpcPromise(
+            call,
+            dplp::makeRejectedPromise<std::string>(
+                std::make_exception_ptr(dplp::RpcError(source.d_result))));
+    }
+
+    auto call     = std::make_shared<RpcClient_Call>();
+    call->d_id    = d_nextId++;
+    call->d_state = RpcClient_Call::e_PENDING;
+
+    dplp::Promise<std::string> promise([&](auto fulfill, auto reject) {
+        call->d_fulfill = fulfill;
+        call->d_reject  = reject;
+    });
+
+    Writer writer(&d_output);
+    writer.byte(e_CALL);
+    writer.u32(call->d_id);
+    writer.string(method);
+    writer.byte(e_RESULT);
+    writer.u32(source.d_id);
+
+    d_pending.emplace(call->d_id, call);
+    return dplp::RpcPromise(std::move(call), std::move(promise));
+}
+
+void RpcClient::flush()
+{
+    if (d_output.empty())
+        return;
+
+    writeMessage(d_fd, d_output);
+    d_output.clear();
+}
+
+bool RpcClient::receive()
+{
+    std::string records;
+    if (!readMessage(d_fd, &records))
+        return false;
+
+    Reader reader(records);
+    while (!reader.atEnd()) {
+        const unsigned char kind   = reader.byte();
+        const std::uint32_t id     = reader.u32();
+        std::string         result = reader.string();
+        if (kind != e_FULFILLED && kind != e_REJECTED)
+            throw std::runtime_error("malformed RPC message");
+
+        const CallMap::iterator it = d_pending.find(id);
+        if (it == d_pending.end())
+            throw std::runtime_error("RPC result for an unknown call");
+        const std::shared_ptr<RpcClient_Call> call = std::move(it->second);
+        d_pending.erase(it);
+
+        Writer writer(&d_output);
+        writer.byte(e_FINISH);
+        writer.u32(id);
+
+        // The state is updated before the continuations run so that they can
+        // make calls taking this result as their argument.
+        call->d_result = std::move(result);
+        if (kind == e_FULFILLED) {
+            call->d_state = RpcClient_Call::e_FULFILLED;
+            call->d_fulfill(call->d_result);
+        }
+        else {
+            call->d_state = RpcClient_Call::e_REJECTED;
+            call->d_reject(
+                std::make_exception_ptr(dplp::RpcError(call->d_result)));
+        }
+        call->d_fulfill = nullptr;
+        call->d_reject  = nullptr;
+    }
+    return true;
+}
+
+std::size_t RpcClient::numPending() const
+{
+    return d_pending.size();
+}
+
+RpcServer::RpcServer(int fd)
+: d_fd(fd)
+, d_output_sp(std::make_shared<RpcServer_Output>())
+{
+    d_output_sp->d_fd       = fd;
+    d_output_sp->d_batching = false;
+}
+
+void RpcServer::registerMethod(std::string name, Method method)
+{
+    d_methods[std::move(name)] = std::move(method);
+}
+
+void RpcServer::call(std::uint32_t                     id,
+                     const std::string&                method,
+                     const dplp::Promise<std::string>& argument)
+{
+    dplp::Promise<std::string> result =
+        dplp::makeRejectedPromise<std::string>(std::make_exception_ptr(
+            std::runtime_error("unknown method '" + method + "'")));
+
+    const auto it = d_methods.find(method);
+    if (it != d_methods.end()) {
+        // A method that throws rejects 'result', as does any continuation
+        // passed to 'then'.
+        result = argument.then([function = it->second](std::string value) {
+            return function(value);
+        });
+    }
+
+    result.then(
+        [output = d_output_sp, id](const std::string& value) {
+            output->send(e_FULFILLED, id, value);
+        },
+        [output = d_output_sp, id](std::exception_ptr error) {
+            output->send(e_REJECTED, id, messageOf(error));
+        });
+    d_results.insert_or_assign(id, std::move(result));
+}
+
+bool RpcServer::serveOne()
+{
+    std::string records;
+    if (!readMessage(d_fd, &records))
+        return false;
+
+    BatchGuard batch(d_output_sp.get());
+    Reader     reader(records);
+    while (!reader.atEnd()) {
+        const unsigned char kind = reader.byte();
+        const std::uint32_t id   = reader.u32();
+
+        if (kind == e_FINISH) {
+            d_results.erase(id);
+        }
+        else if (kind == e_CALL) {
+            const std::string method = reader.string();
+            if (reader.byte() == e_VALUE) {
+                call(id, method, dplp::makeFulfilledPromise(reader.string()));
+                continue;
+            }
+
+            const ResultMap::iterator source = d_results.find(reader.u32());
+            if (source == d_results.end()) {
+                call(id,
+                     method,
+                     dplp::makeRejectedPromise<std::string>(
+                         std::make_exception_ptr(std::runtime_error(
+                             "argument is not an unfinished result"))));
+            }
+            else {
+                call(id, method, source->second);
+            }
+        }
+        else {
+            throw std::runtime_error("malformed RPC message");
+        }
+    }
+    return true;
+}
+
+void RpcServer::run()
+{
+    while (serveOne()) {
+    }
+}
+
+std::size_t RpcServer::numResults() const
+{
+    return d_results.size();
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,278 @@
+#ifndef INCLUDED_DPLP_RPC
+#define INCLUDED_DPLP_RPC
+
+//@PURPOSE: Provide a pipelining RPC client and server over a local socket.
+//
+//@CLASSES:
+//  dplp::RpcClient: issues calls whose results are promises
+//  dplp::RpcServer: dispatches calls to registered methods
+//  dplp::RpcPromise: the result of a call, usable as another call's argument
+//  dplp::RpcError: exception for a call that failed on the server
+//
+//@SEE_ALSO: dplp_promise
+//
+//@DESCRIPTION: This component provides a minimal remote procedure call layer
+// for processes on one host connected by a Unix domain stream socket, with
+// promise pipelining: a call can take as its argument the result of an
+// earlier call that has not completed yet. The client ships the whole chain
+// at once and the server feeds each result to the calls depending on it
+// locally, so a chain of calls costs a single round trip instead of one per
+// hop.
+//
+// Methods take and return a 'std::string'; encoding richer types into it is
+// left to the caller. A server method returns a 'dplp::Promise<std::string>',
+// so it may complete asynchronously.
+//
+///Batching
+///--------
+// A client does not write to the socket when a call is made. Calls are
+// queued and 'flush', which an event loop would call once per iteration (or
+// "tick"), sends all of them in one message. Likewise, the server processes
+// each received message as a batch and sends the results that are available
+// by the end of it in one message. Results that become available later are
+// sent as soon as they are.
+//
+///Result Lifetime
+///---------------
+// The server keeps the result of every call so that later calls can refer to
+// it. When the client receives a result, it queues a "finish" record telling
+// the server to release it, which goes out with the next 'flush'. A call
+// made after that whose argument is the finished result sends the value
+// itself instead. If the argument of a call is rejected, the call is rejected
+// with the same error without being sent.
+//
+///Errors
+///------
+// An exception cannot cross processes, so a call that fails on the server,
+// because the method is unknown, throws, or returns a rejected promise, is
+// rejected on the client with a 'dplp::RpcError' holding the error's
+// 'what()' message. A call whose argument is the result of a failed call
+// fails with the same message without the method being called.
+//
+///Wire Format
+///-----------
+// Each message is a 32-bit length followed by that many bytes of records.
+// Integers are in host byte order, as both ends are on the same host. A
+// record is a one-byte kind and a 32-bit call id followed by:
+//
+//: o Call: the method name, and either a value or the id of an earlier call
+//:   whose result is the argument,
+//: o Finish: nothing,
+//: o Fulfilled: the value, and
+//: o Rejected: the error message,
+//
+// where names, values, and messages are a 32-bit length and the bytes.
+//
+///Thread Safety
+///-------------
+// An 'RpcClient' must be used by one thread at a time; the promises it
+// returns are resolved, and their continuations called, by 'receive'. An
+// 'RpcServer' must be used by one thread at a time, but the promises its
+// methods return may be resolved by any thread.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Look up and fetch in one round trip
+///- - - - - - - - - - - - - - - - - - - - - - -
+// Suppose a directory service maps user names to ids and stores a profile per
+// id. The server registers both methods and serves a connected socket.
+//..
+//  dplp::RpcServer server(serverFd);
+//  server.registerMethod("lookup", [&](const std::string& name) {
+//      return dplp::makeFulfilledPromise(directory.idOf(name));
+//  });
+//  server.registerMethod("fetch", [&](const std::string& id) {
+//      return database.loadProfileP(id);
+//  });
+//  std::thread serverThread([&] { server.run(); });
+//..
+// The client fetches a profile by name. Both calls go out in one message,
+// and 'fetch' runs on the server as soon as 'lookup' completes.
+//..
+//  dplp::RpcClient  client(clientFd);
+//  dplp::RpcPromise id      = client.call("lookup", "alice");
+//  dplp::RpcPromise profile = client.call("fetch", id);
+//  client.flush();
+//
+//  profile.then([](const std::string& p) { display(p); });
+//  while (client.numPending() != 0)
+//      client.receive();
+//..
+
+#include <dplp_promise.h>
+
+#include <cstddef>        // std::size_t
+#include <cstdint>        // std::uint32_t
+#include <functional>     // std::function
+#include <memory>         // std::shared_ptr
+#include <stdexcept>      // std::runtime_error
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>        // std::forward
+
+namespace dplp {
+
+class RpcError : public std::runtime_error {
+    // This class is the exception with which a call that failed on the
+    // server is rejected. 'what' returns the server's error message.
+
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+struct RpcClient_Call;
+struct RpcServer_Output;
+
+class RpcPromise {
+    // This class implements the result of a call made with 'RpcClient'. It
+    // is a 'dplp::Promise<std::string>' that the client can also refer to,
+    // without waiting for it, as the argument of another call.
+
+    std::shared_ptr<dplp::RpcClient_Call> d_call_sp;
+    dplp::Promise<std::string>           d_promise;
+
+    friend class RpcClient;
+
+    RpcPromise(std::shared_ptr<dplp::RpcClient_Call> call,
+               dplp::Promise<std::string>           promise);
+
+  public:
+    const dplp::Promise<std::string>& promise() const;
+        // Return the promise for the result of the call.
+
+    template <typename... Conts>
+    auto then(Conts&&... conts) const;
+        // Return 'promise().then(conts...)'.
+};
+
+class RpcClient {
+    // This class implements the client end of a connection. It does not own
+    // the socket.
+
+    typedef std::unordered_map<std::uint32_t,
+                               std::shared_ptr<dplp::RpcClient_Call> >
+        CallMap;
+
+    int           d_fd;
+    std::uint32_t d_nextId;
+    std::string   d_output;   // queued records
+    CallMap       d_pending;  // calls without a result, by id
+
+  public:
+    explicit RpcClient(int fd);
+        // Create a client sending calls on, and receiving results from, the
+        // specified 'fd', a connected Unix domain stream socket.
+
+    RpcClient(const RpcClient&) = delete;
+    RpcClient& operator=(const RpcClient&) = delete;
+
+    dplp::RpcPromise call(std::string_view method, std::string_view argument);
+    dplp::RpcPromise call(std::string_view         method,
+                          const dplp::RpcPromise& argument);
+        // Queue a call of the specified 'method' with the specified
+        // 'argument', or with the result of the call 'argument' refers to,
+        // and return its result. The call is sent by the next 'flush'. The
+        // behavior is undefined unless 'argument', if an 'RpcPromise', was
+        // returned by this client.
+
+    void flush();
+        // Send the queued calls and finish records in one message. Throw
+        // 'std::system_error' if writing fails.
+
+    bool receive();
+        // Block until a message is received and resolve the promises of the
+        // calls whose results it holds. Return 'true' on success and 'false'
+        // if the server closed the connection. Throw 'std::system_error' if
+        // reading fails and 'std::runtime_error' if the message is malformed.
+
+    std::size_t numPending() const;
+        // Return the number of calls made whose results were not received.
+};
+
+class RpcServer {
+    // This class implements the server end of a connection. It does not own
+    // the socket.
+
+  public:
+    typedef std::function<dplp::Promise<std::string>(const std::string&)>
+        Method;
+        // The type of a method, which is called with the argument of a call
+        // and returns its result.
+
+  private:
+    typedef std::unordered_map<std::uint32_t, dplp::Promise<std::string> >
+        ResultMap;
+
+    int                                     d_fd;
+    std::shared_ptr<dplp::RpcServer_Output> d_output_sp;
+    std::unordered_map<std::string, Method> d_methods;
+    ResultMap                               d_results;  // unfinished, by id
+
+    void call(std::uint32_t                     id,
+              const std::string&                method,
+              const dplp::Promise<std::string>& argument);
+        // Call the specified 'method' with the specified 'argument' when it
+        // is fulfilled, keep the result as that of the call with the
+        // specified 'id', and arrange for it to be sent when it is resolved.
+
+  public:
+    explicit RpcServer(int fd);
+        // Create a server receiving calls on, and sending results to, the
+        // specified 'fd', a connected Unix domain stream socket.
+
+    RpcServer(const RpcServer&) = delete;
+    RpcServer& operator=(const RpcServer&) = delete;
+
+    void registerMethod(std::string name, Method method);
+        // Call the specified 'method' for calls to the specified 'name'.
+
+    bool serveOne();
+        // Block until a message is received and process the calls and finish
+        // records in it. Return 'true' on success and 'false' if the client
+        // closed the connection. Throw 'std::system_error' if reading fails
+        // and 'std::runtime_error' if the message is malformed.
+
+    void run();
+        // Call 'serveOne' until the client closes the connection.
+
+    std::size_t numResults() const;
+        // Return the number of call results kept for the client.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+const dplp::Promise<std::string>& RpcPromise::promise() const
+{
+    return d_promise;
+}
+
+template <typename... Conts>
+auto RpcPromise::then(Conts&&... conts) const
+{
+    return d_promise.then(std::forward<Conts>(conts)...);
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,222 @@
+#include <dplp_rpc.h>
+
+#include <dplp_promise.h>
+#include <dplp_testutil.h>
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>  // socketpair
+#include <unistd.h>      // close
+
+namespace {
+class Connection {
+    // This class owns a pair of connected Unix domain stream sockets.
+
+    int d_fds[2];
+
+  public:
+    Connection() { socketpair(AF_UNIX, SOCK_STREAM, 0, d_fds); }
+
+    ~Connection()
+    {
+        close(d_fds[0]);
+        close(d_fds[1]);
+    }
+
+    int clientFd() const { return d_fds[0]; }
+    int serverFd() const { return d_fds[1]; }
+};
+
+dplp::Promise<std::string> fulfilled(std::string value)
+{
+    return dplp::makeFulfilledPromise(std::move(value));
+}
+
+std::string errorOf(const dplp::RpcPromise& p)
+    // Return the message of the 'dplp::RpcError' the specified 'p' is
+    // rejected with, or an empty string if it is not rejected with one.
+{
+    return dplp::TestUtil::errorOf<dplp::RpcError>(p.promise());
+}
+}
+
+TEST(dplp_rpc, call)
+{
+    Connection      connection;
+    dplp::RpcServer server(connection.serverFd());
+    dplp::RpcClient client(connection.clientFd());
+
+    server.registerMethod("upper", [](const std::string& s) {
+        std::string result = s;
+        for (char& c : result)
+            c = static_cast<char>(std::toupper(c));
+        return fulfilled(result);
+    });
+
+    std::string result;
+    client.call("upper", "abc").then([&](std::string s) { result = s; });
+    EXPECT_EQ(client.numPending(), 1u);
+
+    client.flush();
+    ASSERT_TRUE(server.serveOne());
+    ASSERT_TRUE(client.receive());
+    EXPECT_EQ(result, "ABC");
+    EXPECT_EQ(client.numPending(), 0u);
+}
+
+TEST(dplp_rpc, pipelining)
+{
+    Connection      connection;
+    dplp::RpcServer server(connection.serverFd());
+    dplp::RpcClient client(connection.clientFd());
+
+    server.registerMethod("lookup", [](const std::string& name) {
+        return fulfilled(name == "alice" ? "17" : "0");
+    });
+    server.registerMethod("fetch", [](const std::string& id) {
+        return fulfilled("profile " + id);
+    });
+
+    // Both calls go out in one message and their results come back in one.
+    dplp::RpcPromise id      = client.call("lookup", "alice");
+    dplp::RpcPromise profile = client.call("fetch", id);
+    client.flush();
+    ASSERT_TRUE(server.serveOne());
+    ASSERT_TRUE(client.receive());
+    EXPECT_EQ(client.numPending(), 0u);
+
+    std::string result;
+    profile.then([&](std::string s) { result = s; });
+    EXPECT_EQ(result, "profile 17");
+
+    // A call on a result already received sends the value. The finish
+    // records for the first calls go out with it and release their results.
+    EXPECT_EQ(server.numResults(), 2u);
+    dplp::RpcPromise again = client.call("fetch", id);
+    client.flush();
+    ASSERT_TRUE(server.serveOne());
+    EXPECT_EQ(server.numResults(), 1u);
+    ASSERT_TRUE(client.receive());
+    again.then([&](std::string s) { result = s; });
+    EXPECT_EQ(result, "profile 17");
+}
+
+TEST(dplp_rpc, asynchronous_method)
+{
+    Connection      connection;
+    dplp::RpcServer server(connection.serverFd());
+    dplp::RpcClient client(connection.clientFd());
+
+    std::function<void(std::string)> fulfill;
+    server.registerMethod("slow", [&](const std::string&) {
+        return dplp::Promise<std::string>(
+            [&](auto f, auto) { fulfill = f; });
+    });
+    server.registerMethod("twice", [](const std::string& s) {
+        return fulfilled(s + s);
+    });
+
+    // The dependent call runs on the server when the first completes.
+    dplp::RpcPromise slow  = client.call("slow", "");
+    dplp::RpcPromise twice = client.call("twice", slow);
+    client.flush();
+    ASSERT_TRUE(server.serveOne());
+    ASSERT_TRUE(fulfill);
+
+    // The results are sent as each becomes available.
+    std::thread resolver([&] { fulfill("ab"); });
+    while (client.numPending() != 0)
+        ASSERT_TRUE(client.receive());
+    resolver.join();
+
+    std::string result;
+    twice.then([&](std::string s) { result = s; });
+    EXPECT_EQ(result, "abab");
+}
+
+TEST(dplp_rpc, errors)
+{
+    Connection      connection;
+    dplp::RpcServer server(connection.serverFd());
+    dplp::RpcClient client(connection.clientFd());
+
+    int numCalls = 0;
+    server.registerMethod("fail", [](const std::string&) -> dplp::Promise<
+                                                             std::string> {
+        throw std::runtime_error("failed");
+    });
+    server.registerMethod("count", [&](const std::string& s) {
+        ++numCalls;
+        return fulfilled(s);
+    });
+
+    dplp::RpcPromise unknown   = client.call("missing", "");
+    dplp::RpcPromise fail      = client.call("fail", "");
+    dplp::RpcPromise dependent = client.call("count", fail);
+    client.flush();
+    ASSERT_TRUE(server.serveOne());
+    ASSERT_TRUE(client.receive());
+
+    EXPECT_EQ(errorOf(unknown), "unknown method 'missing'");
+    EXPECT_EQ(errorOf(fail), "failed");
+    EXPECT_EQ(errorOf(dependent), "failed");
+    EXPECT_EQ(numCalls, 0);
+
+    // A call on a rejected result is rejected without being sent.
+    dplp::RpcPromise local = client.call("count", fail);
+    EXPECT_EQ(errorOf(local), "failed");
+    EXPECT_EQ(client.numPending(), 0u);
+}
+
+TEST(dplp_rpc, server_thread)
+{
+    Connection      connection;
+    dplp::RpcServer server(connection.serverFd());
+    server.registerMethod("echo", [](const std::string& s) {
+        return fulfilled(s);
+    });
+    std::thread serverThread([&] { server.run(); });
+
+    dplp::RpcClient client(connection.clientFd());
+    int             numReceived = 0;
+    for (int i = 0; i < 100; ++i) {
+        client.call("echo", std::to_string(i)).then([&, i](std::string s) {
+            EXPECT_EQ(s, std::to_string(i));
+            ++numReceived;
+        });
+    }
+    client.flush();
+    while (client.numPending() != 0)
+        ASSERT_TRUE(client.receive());
+    EXPECT_EQ(numReceived, 100);
+
+    shutdown(connection.clientFd(), SHUT_WR);
+    serverThread.join();
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
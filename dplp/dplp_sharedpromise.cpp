@@ -0,0 +1,389 @@
+#include <dplp_sharedpromise.h>
+
+#include <algorithm>     // std::min
+#include <atomic>        // std::atomic
+#include <chrono>        // std::chrono::steady_clock
+#include <cerrno>        // errno
+#include <climits>       // INT_MAX
+#include <cstdint>       // std::uint32_t
+#include <new>           // placement new
+#include <stdexcept>     // std::invalid_argument
+#include <system_error>  // std::system_error
+#include <thread>        // std::thread, std::this_thread::yield
+#include <utility>       // std::move, std::swap
+
+#ifdef __linux__
+#include <linux/futex.h>  // FUTEX_WAIT, FUTEX_WAKE
+#include <sys/mman.h>     // memfd_create, mmap, munmap
+#include <sys/stat.h>     // fstat
+#include <sys/syscall.h>  // SYS_futex
+#include <time.h>         // timespec
+#include <unistd.h>       // close, dup, ftruncate, syscall
+#endif
+
+namespace dplp {
+namespace {
+
+const std::uint32_t k_MAGIC = 0x64706c70;  // "dplp"
+
+// The values of the state word. Resolving goes from 'k_WAITING' through
+// 'k_RESOLVING', while the resolver writes the value or message, to
+// 'k_FULFILLED' or 'k_REJECTED'.
+const std::uint32_t k_WAITING   = 0;
+const std::uint32_t k_RESOLVING = 1;
+const std::uint32_t k_FULFILLED = 2;
+const std::uint32_t k_REJECTED  = 3;
+
+const std::size_t k_MAX_MESSAGE = 256;
+
+struct Header {
+    // This struct is the layout of the start of a segment. It is shared by
+    // processes, so it must not contain pointers.
+
+    std::atomic<std::uint32_t> d_state;       // the futex word
+    std::atomic<std::uint32_t> d_numWaiters;  // processes in 'FUTEX_WAIT'
+    std::uint32_t              d_magic;
+    std::uint32_t              d_valueSize;
+    std::uint32_t              d_valueAlign;
+    std::uint32_t              d_messageSize;
+    char                       d_message[k_MAX_MESSAGE];
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+              "the state word must be usable by several processes");
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "the state word must be a futex word");
+
+std::size_t valueOffset(std::size_t valueAlign)
+{
+    return (sizeof(Header) + valueAlign - 1) / valueAlign * valueAlign;
+}
+
+[[noreturn]] void throwSystemError(int error, const char *what)
+{
+    throw std::system_error(error, std::generic_category(), what);
+}
+
+#ifdef __linux__
+void futexWait(std::atomic<std::uint32_t> *word,
+               std::uint32_t               expected,
+               const timespec             *timeout = nullptr)
+{
+    // The futex is not private because the word is shared by processes. A
+    // spurious or interrupted return, or a timeout, is handled by the
+    // caller's loop.
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, timeout, nullptr, 0);
+}
+
+void futexWakeAll(std::atomic<std::uint32_t> *word)
+{
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+#endif
+}
+
+SharedPromise_Segment::SharedPromise_Segment(int         fd,
+                                             std::size_t valueSize,
+                                             std::size_t valueAlign)
+: d_fd(fd)
+, d_address_p(nullptr)
+, d_size(valueOffset(valueAlign) + valueSize)
+, d_valueOffset(valueOffset(valueAlign))
+, d_watched(false)
+, d_stopping(false)
+, d_watching(false)
+{
+#ifdef __linux__
+    void *const address = mmap(
+        nullptr, d_size, PROT_READ | PROT_WRITE, MAP_SHARED, d_fd, 0);
+    if (address == MAP_FAILED) {
+        const int error = errno;
+        close(d_fd);
+        throwSystemError(error, "mmap");
+    }
+    d_address_p = address;
+#else
+    (void)valueSize;
+    throwSystemError(ENOSYS, "SharedPromise");
+#endif
+}
+
+std::shared_ptr<SharedPromise_Segment> SharedPromise_Segment::create(
+                                                      std::size_t valueSize,
+                                                      std::size_t valueAlign)
+{
+#ifdef __linux__
+    const int fd = memfd_create("dplp_sharedpromise", MFD_CLOEXEC);
+    if (fd < 0)
+        throwSystemError(errno, "memfd_create");
+
+    // A new file reads as zeros, i.e. 'k_WAITING' with no waiters.
+    if (ftruncate(fd, valueOffset(valueAlign) + valueSize) != 0) {
+        const int error = errno;
+        close(fd);
+        throwSystemError(error, "ftruncate");
+    }
+
+    std::shared_ptr<SharedPromise_Segment> result(
+        new SharedPromise_Segment(fd, valueSize, valueAlign));
+    Header *const header = new (result->d_address_p) Header();
+    header->d_magic      = k_MAGIC;
+    header->d_valueSize  = static_cast<std::uint32_t>(valueSize);
+    header->d_valueAlign = static_cast<std::uint32_t>(valueAlign);
+    return result;
+#else
+    (void)valueSize;
+    (void)valueAlign;
+    throwSystemError(ENOSYS, "SharedPromise");
+#endif
+}
+
+std::shared_ptr<SharedPromise_Segment> SharedPromise_Segment::open(
+                                                      int         fd,
+                                                      std::size_t valueSize,
+                                                      std::size_t valueAlign)
+{
+#ifdef __linux__
+    // Check the size before mapping so that a short file does not fault.
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+        throwSystemError(errno, "fstat");
+    if (static_cast<std::size_t>(status.st_size) !=
+        valueOffset(valueAlign) + valueSize)
+        throw std::invalid_argument("not a SharedPromise of this type");
+
+    const int copy = dup(fd);
+    if (copy < 0)
+        throwSystemError(errno, "dup");
+
+    std::shared_ptr<SharedPromise_Segment> result(
+        new SharedPromise_Segment(copy, valueSize, valueAlign));
+    const Header *const header =
+        static_cast<const Header *>(result->d_address_p);
+    if (header->d_magic != k_MAGIC || header->d_valueSize != valueSize ||
+        header->d_valueAlign != valueAlign)
+        throw std::invalid_argument("not a SharedPromise of this type");
+    return result;
+#else
+    (void)fd;
+    (void)valueSize;
+    (void)valueAlign;
+    throwSystemError(ENOSYS, "SharedPromise");
+#endif
+}
+
+SharedPromise_Segment::~SharedPromise_Segment()
+{
+    if (d_watcher.joinable()) {
+        if (d_watcher.get_id() == std::this_thread::get_id()) {
+            // The watcher released the last reference after calling the
+            // continuations, and no longer refers to this object.
+            d_watcher.detach();
+        }
+        else {
+            // Repeat the wake-up in case the watcher checked 'd_stopping'
+            // just before we set it and had not yet slept.
+            d_stopping.store(true);
+            while (d_watching.load()) {
+#ifdef __linux__
+                futexWakeAll(&static_cast<Header *>(d_address_p)->d_state);
+#endif
+                std::this_thread::yield();
+            }
+            d_watcher.join();
+        }
+    }
+
+    // The watcher stopped before the promise was resolved, or was never
+    // started, so the remaining continuations are called now.
+    for (const Continuation& continuation : d_continuations)
+        continuation(*this);
+
+#ifdef __linux__
+    munmap(d_address_p, d_size);
+    close(d_fd);
+#endif
+}
+
+int SharedPromise_Segment::fd() const
+{
+    return d_fd;
+}
+
+void *SharedPromise_Segment::value() const
+{
+    return static_cast<char *>(d_address_p) + d_valueOffset;
+}
+
+bool SharedPromise_Segment::beginResolve()
+{
+    Header *const header   = static_cast<Header *>(d_address_p);
+    std::uint32_t expected = k_WAITING;
+    return header->d_state.compare_exchange_strong(
+        expected, k_RESOLVING, std::memory_order_acquire);
+}
+
+void SharedPromise_Segment::finishFulfill()
+{
+    Header *const header = static_cast<Header *>(d_address_p);
+
+    // The sequentially consistent store and load pair with those in 'wait'
+    // so that either the resolver sees a waiter or the waiter sees the new
+    // state before it sleeps.
+    header->d_state.store(k_FULFILLED);
+#ifdef __linux__
+    if (header->d_numWaiters.load() != 0)
+        futexWakeAll(&header->d_state);
+#endif
+}
+
+void SharedPromise_Segment::finishReject(std::string_view message)
+{
+    Header *const header = static_cast<Header *>(d_address_p);
+
+    const std::size_t size = std::min(message.size(), k_MAX_MESSAGE);
+    std::copy_n(message.data(), size, header->d_message);
+    header->d_messageSize = static_cast<std::uint32_t>(size);
+
+    header->d_state.store(k_REJECTED);
+#ifdef __linux__
+    if (header->d_numWaiters.load() != 0)
+        futexWakeAll(&header->d_state);
+#endif
+}
+
+bool SharedPromise_Segment::isResolved() const
+{
+    const Header *const header = static_cast<const Header *>(d_address_p);
+    return header->d_state.load(std::memory_order_acquire) > k_RESOLVING;
+}
+
+bool SharedPromise_Segment::waitFor(std::chrono::nanoseconds timeout) const
+{
+    Header *const header = static_cast<Header *>(d_address_p);
+
+    if (isResolved())
+        return true;
+
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + timeout;
+    header->d_numWaiters.fetch_add(1);
+    std::uint32_t state;
+    while ((state = header->d_state.load()) <= k_RESOLVING) {
+        const std::chrono::nanoseconds remaining =
+            deadline - std::chrono::steady_clock::now();
+        if (remaining.count() <= 0)
+            break;
+#ifdef __linux__
+        timespec relative;
+        relative.tv_sec  = static_cast<time_t>(remaining.count() / 1000000000);
+        relative.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+        futexWait(&header->d_state, state, &relative);
+#endif
+    }
+    header->d_numWaiters.fetch_sub(1, std::memory_order_relaxed);
+    return state > k_RESOLVING;
+}
+
+bool SharedPromise_Segment::wait() const
+{
+    Header *const header = static_cast<Header *>(d_address_p);
+
+    std::uint32_t state = header->d_state.load(std::memory_order_acquire);
+    if (state <= k_RESOLVING) {
+        header->d_numWaiters.fetch_add(1);
+        while ((state = header->d_state.load()) <= k_RESOLVING) {
+#ifdef __linux__
+            futexWait(&header->d_state, state);
+#endif
+        }
+        header->d_numWaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return state == k_FULFILLED;
+}
+
+std::string SharedPromise_Segment::message() const
+{
+    const Header *const header = static_cast<const Header *>(d_address_p);
+    return std::string(header->d_message, header->d_messageSize);
+}
+
+void SharedPromise_Segment::watch()
+{
+    Header *const header = static_cast<Header *>(d_address_p);
+
+    header->d_numWaiters.fetch_add(1);
+    std::uint32_t state;
+    while ((state = header->d_state.load()) <= k_RESOLVING &&
+           !d_stopping.load()) {
+#ifdef __linux__
+        futexWait(&header->d_state, state);
+#endif
+    }
+    header->d_numWaiters.fetch_sub(1, std::memory_order_relaxed);
+
+    // A continuation may release the last reference to this object, so we
+    // hold one while calling them. If there is none, the destructor is about
+    // to stop this thread and call the continuations itself.
+    std::shared_ptr<SharedPromise_Segment> self;
+    if (state > k_RESOLVING)
+        self = weak_from_this().lock();
+    if (!self) {
+        d_watching.store(false);
+        return;
+    }
+
+    std::vector<Continuation> continuations;
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_watched = true;
+        std::swap(continuations, d_continuations);
+    }
+    d_watching.store(false);
+
+    for (const Continuation& continuation : continuations)
+        continuation(*this);
+
+    // Releasing the continuations, and then 'self', may destroy this object.
+}
+
+void SharedPromise_Segment::notify(Continuation continuation)
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        if (!d_watched) {
+            d_continuations.push_back(std::move(continuation));
+            if (!d_watcher.joinable()) {
+                d_watching.store(true);
+                try {
+                    d_watcher = std::thread(&SharedPromise_Segment::watch,
+                                            this);
+                }
+                catch (...) {
+                    d_watching.store(false);
+                    d_continuations.pop_back();
+                    throw;
+                }
+            }
+            return;
+        }
+    }
+    continuation(*this);
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
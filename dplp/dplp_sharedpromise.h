@@ -0,0 +1,444 @@
+#ifndef INCLUDED_DPLP_SHAREDPROMISE
+#define INCLUDED_DPLP_SHAREDPROMISE
+
+//@PURPOSE: Provide a promise that can be resolved by another process.
+//
+//@CLASSES:
+//  dplp::SharedPromise: promise whose state lives in shared memory
+//  dplp::SharedPromiseError: exception for a promise rejected elsewhere
+//  dplp::SharedPromise_Segment: shared memory holding a promise's state
+//
+//@SEE_ALSO: dplp_promise
+//
+//@DESCRIPTION: This component provides a class template,
+// 'dplp::SharedPromise<T>', for a trivially copyable 'T', whose state is in a
+// shared memory segment so that processes on the same host can hand results
+// to each other without a socket round-trip or serialization.
+//
+// A 'SharedPromise' is created by one process, which creates an anonymous
+// shared memory file (a 'memfd' on Linux) sized for a small header and a 'T'.
+// Other processes obtain the promise either by inheriting it across 'fork' or
+// by receiving the file descriptor (see 'fd'), e.g. over a Unix domain socket
+// with 'SCM_RIGHTS', and passing it to 'SharedPromise::open'.
+//
+// The header holds an atomic state word, which is also the futex word that
+// blocked readers wait on. Any process can resolve the promise once with
+// 'fulfill', which copies the value into the segment, or with 'reject', which
+// copies a message. Exceptions cannot cross address spaces, so a rejection is
+// observed as a 'dplp::SharedPromiseError' holding that message. Resolving
+// wakes the waiting processes with a single futex call, and makes no system
+// call at all when none is waiting. Resolution does not allocate, so it may
+// be done in a child of a multithreaded process before it calls 'exec'.
+//
+// Readers either block with 'wait', which returns a copy of the value, or get
+// a 'dplp::Promise<T>' with 'promise' (or 'then'). Such a promise is created
+// already resolved if the shared promise is; otherwise it is resolved by a
+// watcher thread, started for the segment by the first such call, that waits
+// on the futex word and then resolves every promise obtained meanwhile. Note
+// that the continuations therefore run on that thread.
+//
+// A process that would rather not block indefinitely on a resolver that may
+// have died, e.g. a child process that crashed, uses 'waitFor', which gives
+// up after a timeout.
+//
+// The segment is unmapped and its descriptor closed when the last
+// 'SharedPromise' referring to it in a process is destroyed, which first
+// stops and joins the watcher thread. Promises obtained with 'promise' that
+// are unresolved by then are rejected with a 'dplp::SharedPromiseError'. The
+// memory is released when every process has done so. A process forked while
+// the watcher thread runs does not have that thread, so it must not destroy
+// the last 'SharedPromise' referring to the segment other than by exiting.
+//
+// Shared promises are supported only on Linux. Elsewhere, creating or opening
+// one throws 'std::system_error'.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Receive a result from a child process
+///- - - - - - - - - - - - - - - - - - - - - - - -
+// Suppose a service forks a worker process to compute statistics over a file
+// and wants the result without setting up a pipe.
+//..
+//  struct Stats {
+//      std::size_t d_lines;
+//      std::size_t d_bytes;
+//  };
+//
+//  dplp::SharedPromise<Stats> result;
+//  if (fork() == 0) {
+//      try {
+//          result.fulfill(computeStats(path));
+//      }
+//      catch (const std::exception& e) {
+//          result.reject(e.what());
+//      }
+//      _exit(0);
+//  }
+//
+//  result.then([](Stats stats) { report(stats); },
+//              [](std::exception_ptr error) { log(error); });
+//..
+
+#include <dplp_promise.h>
+
+#include <atomic>       // std::atomic
+#include <chrono>       // std::chrono::nanoseconds
+#include <cstddef>      // std::size_t
+#include <cstring>      // std::memcpy
+#include <exception>    // std::make_exception_ptr
+#include <functional>   // std::function
+#include <memory>       // std::enable_shared_from_this, std::shared_ptr
+#include <mutex>        // std::mutex
+#include <new>          // std::launder
+#include <optional>
+#include <stdexcept>    // std::runtime_error
+#include <string>
+#include <string_view>
+#include <thread>       // std::thread
+#include <type_traits>  // std::is_trivially_copyable_v
+#include <utility>      // std::forward, std::move
+#include <vector>
+
+namespace dplp {
+
+class SharedPromiseError : public std::runtime_error {
+    // This class is the exception with which a shared promise that was
+    // rejected is observed to be rejected. 'what' returns the message
+    // passed to 'reject'.
+
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+class SharedPromise_Segment
+: public std::enable_shared_from_this<SharedPromise_Segment> {
+    // This class implements a mapping of a shared memory file holding the
+    // state of a shared promise and a value of a size and alignment fixed at
+    // creation, and the thread of this process watching for it to be
+    // resolved.
+
+  public:
+    // TYPES
+    typedef std::function<void(const SharedPromise_Segment&)> Continuation;
+        // A function called with the segment once it is resolved or, if it
+        // isn't by then, once it is being destroyed.
+
+  private:
+    int         d_fd;
+    void       *d_address_p;
+    std::size_t d_size;
+    std::size_t d_valueOffset;
+
+    std::mutex                d_mutex;          // guards the members below
+    std::vector<Continuation> d_continuations;  // waiting for the watcher
+    std::thread               d_watcher;
+    bool                      d_watched;        // 'true' once resolved
+    std::atomic<bool>         d_stopping;       // set to stop the watcher
+    std::atomic<bool>         d_watching;       // 'true' until it stops
+
+    void watch();
+        // Wait until the promise is resolved or 'd_stopping' is set, and in
+        // the former case call the continuations. This is the body of the
+        // watcher thread.
+
+    SharedPromise_Segment(int         fd,
+                          std::size_t valueSize,
+                          std::size_t valueAlign);
+        // Map the shared memory file referred to by the specified 'fd',
+        // which this object then owns, for a value of the specified
+        // 'valueSize' and 'valueAlign'. Close 'fd' and throw
+        // 'std::system_error' if it cannot be mapped.
+
+  public:
+    static std::shared_ptr<SharedPromise_Segment> create(
+                                                      std::size_t valueSize,
+                                                      std::size_t valueAlign);
+        // Return a segment in a new shared memory file for a value of the
+        // specified 'valueSize' and 'valueAlign'. Throw 'std::system_error'
+        // if the file cannot be created or mapped.
+
+    static std::shared_ptr<SharedPromise_Segment> open(
+                                                      int         fd,
+                                                      std::size_t valueSize,
+                                                      std::size_t valueAlign);
+        // Return a segment mapping the shared memory file referred to by the
+        // specified 'fd', which is duplicated, for a value of the specified
+        // 'valueSize' and 'valueAlign'. Throw 'std::system_error' if it
+        // cannot be mapped, and 'std::invalid_argument' if it was not created
+        // by 'create' with the same 'valueSize' and 'valueAlign'.
+
+    SharedPromise_Segment(const SharedPromise_Segment&) = delete;
+    SharedPromise_Segment& operator=(const SharedPromise_Segment&) = delete;
+
+    ~SharedPromise_Segment();
+        // Stop and join the watcher thread, call the continuations not yet
+        // called, then unmap the segment and close its file descriptor.
+
+    int fd() const;
+        // Return the file descriptor of the shared memory file.
+
+    void *value() const;
+        // Return the address of the value.
+
+    bool beginResolve();
+        // Return 'true' and give the caller the exclusive right to resolve
+        // the promise if it is unresolved and no other caller has that right,
+        // and return 'false' otherwise.
+
+    void finishFulfill();
+        // Publish the value and wake the waiters. The behavior is undefined
+        // unless the caller obtained the right with 'beginResolve' and wrote
+        // the value.
+
+    void finishReject(std::string_view message);
+        // Store the specified 'message', truncated if it is long, and wake
+        // the waiters. The behavior is undefined unless the caller obtained
+        // the right with 'beginResolve'.
+
+    bool isResolved() const;
+        // Return 'true' if the promise is fulfilled or rejected, and 'false'
+        // otherwise.
+
+    bool wait() const;
+        // Block until the promise is fulfilled or rejected. Return 'true' if
+        // it is fulfilled, and 'false' if it is rejected.
+
+    bool waitFor(std::chrono::nanoseconds timeout) const;
+        // Block until the promise is fulfilled or rejected, or the specified
+        // 'timeout' elapses. Return 'true' if the promise is resolved, and
+        // 'false' otherwise.
+
+    std::string message() const;
+        // Return the rejection message. The behavior is undefined unless the
+        // promise is rejected.
+
+    void notify(Continuation continuation);
+        // Call the specified 'continuation' with this segment on the watcher
+        // thread, which is started if it isn't running, when the promise is
+        // resolved, or immediately if the watcher thread has already seen it
+        // resolved. If this segment is destroyed first, 'continuation' is
+        // called then with the promise possibly unresolved. Throw
+        // 'std::system_error' if the watcher thread cannot be started.
+};
+
+template <typename T>
+class SharedPromise {
+    // This class implements a handle to a promise, resolved once by any
+    // process, whose state and 'T' value are in shared memory.
+
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "SharedPromise requires a trivially copyable type");
+
+    std::shared_ptr<dplp::SharedPromise_Segment> d_segment_sp;
+
+    explicit SharedPromise(
+                       std::shared_ptr<dplp::SharedPromise_Segment> segment);
+
+    static T value(const dplp::SharedPromise_Segment& segment);
+        // Return a copy of the value in the specified 'segment'. The behavior
+        // is undefined unless its promise is fulfilled.
+
+    static dplp::SharedPromiseError error(
+                                   const dplp::SharedPromise_Segment& segment);
+        // Return the error of the promise in the specified 'segment'. The
+        // behavior is undefined unless it is rejected.
+
+  public:
+    SharedPromise();
+        // Create an unresolved promise in a new shared memory file. Throw
+        // 'std::system_error' if it cannot be created.
+
+    static SharedPromise open(int fd);
+        // Return the promise in the shared memory file referred to by the
+        // specified 'fd', which is duplicated, e.g. one received from the
+        // process that created it. Throw 'std::system_error' if it cannot be
+        // mapped and 'std::invalid_argument' if the file is not the state of
+        // a 'SharedPromise<T>'.
+
+    int fd() const;
+        // Return the file descriptor of this promise's shared memory file,
+        // which is closed when the last 'SharedPromise' referring to it in
+        // this process is destroyed.
+
+    bool fulfill(const T& value) const;
+        // Fulfill this promise with a copy of the specified 'value' if it is
+        // unresolved. Return 'true' if this call resolved the promise, and
+        // 'false' otherwise.
+
+    bool reject(std::string_view message) const;
+        // Reject this promise with the specified 'message' if it is
+        // unresolved. Return 'true' if this call resolved the promise, and
+        // 'false' otherwise. Note that long messages are truncated.
+
+    bool isResolved() const;
+        // Return 'true' if this promise is fulfilled or rejected, and 'false'
+        // otherwise.
+
+    T wait() const;
+        // Block until this promise is resolved and return a copy of its value
+        // if it is fulfilled. Throw 'dplp::SharedPromiseError' if it is
+        // rejected.
+
+    std::optional<T> waitFor(std::chrono::nanoseconds timeout) const;
+        // Block until this promise is resolved or the specified 'timeout'
+        // elapses. Return a copy of its value if it is fulfilled, and an
+        // empty 'std::optional' if it is still unresolved. Throw
+        // 'dplp::SharedPromiseError' if it is rejected.
+
+    dplp::Promise<T> promise() const;
+        // Return a promise with the outcome of this one. If this promise is
+        // unresolved, the returned promise is resolved, and its continuations
+        // called, on the segment's watcher thread when this one is resolved,
+        // and rejected with a 'dplp::SharedPromiseError' if the last
+        // 'SharedPromise' referring to this one in this process is destroyed
+        // first. Throw 'std::system_error' if the watcher thread cannot be
+        // started.
+
+    template <typename... Conts>
+    auto then(Conts&&... conts) const;
+        // Return 'promise().then(conts...)'.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+template <typename T>
+SharedPromise<T>::SharedPromise(
+                        std::shared_ptr<dplp::SharedPromise_Segment> segment)
+: d_segment_sp(std::move(segment))
+{
+}
+
+template <typename T>
+SharedPromise<T>::SharedPromise()
+: d_segment_sp(dplp::SharedPromise_Segment::create(sizeof(T), alignof(T)))
+{
+}
+
+template <typename T>
+SharedPromise<T> SharedPromise<T>::open(int fd)
+{
+    return SharedPromise(
+        dplp::SharedPromise_Segment::open(fd, sizeof(T), alignof(T)));
+}
+
+template <typename T>
+int SharedPromise<T>::fd() const
+{
+    return d_segment_sp->fd();
+}
+
+template <typename T>
+bool SharedPromise<T>::fulfill(const T& value) const
+{
+    if (!d_segment_sp->beginResolve())
+        return false;
+
+    std::memcpy(d_segment_sp->value(), &value, sizeof(T));
+    d_segment_sp->finishFulfill();
+    return true;
+}
+
+template <typename T>
+bool SharedPromise<T>::reject(std::string_view message) const
+{
+    if (!d_segment_sp->beginResolve())
+        return false;
+
+    d_segment_sp->finishReject(message);
+    return true;
+}
+
+template <typename T>
+bool SharedPromise<T>::isResolved() const
+{
+    return d_segment_sp->isResolved();
+}
+
+template <typename T>
+T SharedPromise<T>::value(const dplp::SharedPromise_Segment& segment)
+{
+    // 'T' need not be default constructible, so copy into raw storage.
+    alignas(T) unsigned char buffer[sizeof(T)];
+    std::memcpy(buffer, segment.value(), sizeof(T));
+    return *std::launder(reinterpret_cast<T *>(buffer));
+}
+
+template <typename T>
+dplp::SharedPromiseError SharedPromise<T>::error(
+                                    const dplp::SharedPromise_Segment& segment)
+{
+    return dplp::SharedPromiseError(segment.message());
+}
+
+template <typename T>
+T SharedPromise<T>::wait() const
+{
+    if (!d_segment_sp->wait())
+        throw error(*d_segment_sp);
+    return value(*d_segment_sp);
+}
+
+template <typename T>
+std::optional<T> SharedPromise<T>::waitFor(
+                                       std::chrono::nanoseconds timeout) const
+{
+    if (!d_segment_sp->waitFor(timeout))
+        return std::nullopt;
+    return wait();
+}
+
+template <typename T>
+dplp::Promise<T> SharedPromise<T>::promise() const
+{
+    if (d_segment_sp->isResolved()) {
+        if (d_segment_sp->wait())
+            return dplp::makeFulfilledPromise(value(*d_segment_sp));
+        return dplp::makeRejectedPromise<T>(
+            std::make_exception_ptr(error(*d_segment_sp)));
+    }
+
+    // The continuation must not refer to the segment, which is destroyed,
+    // stopping the watcher, when only continuations would refer to it.
+    return dplp::Promise<T>([this](auto fulfill, auto reject) {
+        d_segment_sp->notify(
+            [fulfill, reject](const dplp::SharedPromise_Segment& segment) {
+                if (!segment.isResolved())
+                    reject(std::make_exception_ptr(dplp::SharedPromiseError(
+                        "SharedPromise destroyed before it was resolved")));
+                else if (segment.wait())
+                    fulfill(value(segment));
+                else
+                    reject(std::make_exception_ptr(error(segment)));
+            });
+    });
+}
+
+template <typename T>
+template <typename... Conts>
+auto SharedPromise<T>::then(Conts&&... conts) const
+{
+    return promise().then(std::forward<Conts>(conts)...);
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
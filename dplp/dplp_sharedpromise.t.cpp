@@ -0,0 +1,261 @@
+#include <dplp_sharedpromise.h>
+
+#include <dplp_promise.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>  // waitpid
+#include <unistd.h>    // _exit, close, dup, fork, usleep
+
+namespace {
+struct Point {
+    int    d_x;
+    double d_y;
+};
+
+template <typename F>
+pid_t spawn(F function)
+    // Run the specified 'function' in a child process, which exits when it
+    // returns, and return the child's process id.
+{
+    const pid_t pid = fork();
+    if (pid == 0) {
+        function();
+        _exit(0);
+    }
+    return pid;
+}
+
+void expectSuccess(pid_t pid)
+    // Wait for the child process with the specified 'pid' and expect it to
+    // have exited normally.
+{
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+}
+
+TEST(dplp_sharedpromise, fulfill_across_fork)
+{
+    const dplp::SharedPromise<Point> p;
+    EXPECT_FALSE(p.isResolved());
+
+    const pid_t child = spawn([&] {
+        usleep(20000);
+        p.fulfill(Point{3, 0.5});
+    });
+
+    const Point result = p.wait();
+    EXPECT_EQ(result.d_x, 3);
+    EXPECT_EQ(result.d_y, 0.5);
+    EXPECT_TRUE(p.isResolved());
+    expectSuccess(child);
+}
+
+TEST(dplp_sharedpromise, reject_across_fork)
+{
+    const dplp::SharedPromise<int> p;
+
+    expectSuccess(spawn([&] { p.reject("out of disk"); }));
+
+    EXPECT_TRUE(p.isResolved());
+    try {
+        p.wait();
+        FAIL() << "no exception thrown";
+    }
+    catch (const dplp::SharedPromiseError& e) {
+        EXPECT_EQ(std::string(e.what()), "out of disk");
+    }
+
+    // Long messages are truncated rather than overflowing the segment.
+    const dplp::SharedPromise<int> q;
+    EXPECT_TRUE(q.reject(std::string(1000, 'x')));
+    EXPECT_THROW(q.wait(), dplp::SharedPromiseError);
+}
+
+TEST(dplp_sharedpromise, then)
+{
+    const dplp::SharedPromise<int> p;
+
+    // The continuation is attached before the child resolves the promise.
+    std::promise<int> received;
+    p.then([&](int value) { received.set_value(value); });
+
+    const pid_t child = spawn([&] { p.fulfill(7); });
+
+    std::future<int> future = received.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(10)),
+              std::future_status::ready);
+    EXPECT_EQ(future.get(), 7);
+    expectSuccess(child);
+
+    // Once resolved, continuations are called immediately.
+    int result = 0;
+    p.then([&](int value) { result = value; });
+    EXPECT_EQ(result, 7);
+
+    const dplp::SharedPromise<int> rejected;
+    rejected.reject("error");
+    std::string message;
+    rejected.then([](int) {},
+                  [&](std::exception_ptr error) {
+                      try {
+                          std::rethrow_exception(error);
+                      }
+                      catch (const dplp::SharedPromiseError& e) {
+                          message = e.what();
+                      }
+                  });
+    EXPECT_EQ(message, "error");
+}
+
+TEST(dplp_sharedpromise, one_watcher)
+{
+    const dplp::SharedPromise<int> p;
+
+    // Every continuation records the thread it runs on.
+    std::mutex                   mutex;
+    std::vector<std::thread::id> threads;
+    std::atomic<int>             sum(0);
+    for (int i = 0; i < 100; ++i)
+        p.then([&](int value) {
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                threads.push_back(std::this_thread::get_id());
+            }
+            sum += value;
+        });
+
+    expectSuccess(spawn([&] { p.fulfill(1); }));
+    for (int i = 0; i < 1000 && sum < 100; ++i)
+        usleep(1000);
+    ASSERT_EQ(sum, 100);
+
+    // They all ran on the same watcher thread.
+    const std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(threads.size(), 100u);
+    EXPECT_NE(threads.front(), std::this_thread::get_id());
+    for (const std::thread::id& id : threads)
+        EXPECT_EQ(id, threads.front());
+}
+
+TEST(dplp_sharedpromise, abandoned)
+{
+    std::optional<dplp::Promise<int> > result;
+    {
+        const dplp::SharedPromise<int> p;
+        result = p.promise();
+    }
+
+    // Destroying the last handle joined the watcher, which rejected 'result'.
+    std::string message;
+    result->then([](int) {},
+                 [&](std::exception_ptr error) {
+                     try {
+                         std::rethrow_exception(error);
+                     }
+                     catch (const dplp::SharedPromiseError& e) {
+                         message = e.what();
+                     }
+                 });
+    EXPECT_EQ(message, "SharedPromise destroyed before it was resolved");
+}
+
+TEST(dplp_sharedpromise, last_reference_on_watcher)
+{
+    std::promise<int> received;
+    int               fd = -1;
+    {
+        const dplp::SharedPromise<int> p;
+        fd = dup(p.fd());
+        p.then([&received, p](int value) { received.set_value(value); });
+    }
+
+    // The watcher holds the last reference to the segment of 'p'.
+    dplp::SharedPromise<int>::open(fd).fulfill(4);
+    close(fd);
+
+    std::future<int> future = received.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(10)),
+              std::future_status::ready);
+    EXPECT_EQ(future.get(), 4);
+}
+
+TEST(dplp_sharedpromise, wait_for)
+{
+    // A child that exits without resolving the promise doesn't block the
+    // parent indefinitely.
+    const dplp::SharedPromise<int> p;
+    expectSuccess(spawn([] {}));
+    EXPECT_FALSE(p.waitFor(std::chrono::milliseconds(10)));
+    EXPECT_FALSE(p.isResolved());
+
+    p.fulfill(2);
+    EXPECT_EQ(p.waitFor(std::chrono::milliseconds(10)), 2);
+
+    const dplp::SharedPromise<int> q;
+    const pid_t                    child = spawn([&] {
+        usleep(20000);
+        q.reject("error");
+    });
+    EXPECT_THROW(q.waitFor(std::chrono::seconds(10)),
+                 dplp::SharedPromiseError);
+    expectSuccess(child);
+}
+
+TEST(dplp_sharedpromise, resolve_once)
+{
+    const dplp::SharedPromise<int> p;
+    EXPECT_TRUE(p.fulfill(1));
+    EXPECT_FALSE(p.fulfill(2));
+    EXPECT_FALSE(p.reject("error"));
+    EXPECT_EQ(p.wait(), 1);
+}
+
+TEST(dplp_sharedpromise, open)
+{
+    const dplp::SharedPromise<int> p;
+    const dplp::SharedPromise<int> q = dplp::SharedPromise<int>::open(p.fd());
+    EXPECT_NE(p.fd(), q.fd());
+
+    q.fulfill(5);
+    EXPECT_EQ(p.wait(), 5);
+
+    EXPECT_THROW(dplp::SharedPromise<Point>::open(p.fd()),
+                 std::invalid_argument);
+    EXPECT_THROW(dplp::SharedPromise<int>::open(-1), std::system_error);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
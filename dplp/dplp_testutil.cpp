@@ -0,0 +1,50 @@
+#include <dplp_testutil.h>
+
+#include <new>  // std::bad_alloc
+
+namespace dplp {
+
+void *TestUtil::CountingResource::do_allocate(std::size_t bytes,
+                                              std::size_t alignment)
+{
+    // The limit is checked and the allocation counted in one step, so that
+    // concurrent allocations do not exceed it.
+    int numAllocations = d_numAllocations.load();
+    do {
+        if (numAllocations >= d_maxAllocations.load())
+            throw std::bad_alloc();
+    } while (!d_numAllocations.compare_exchange_weak(numAllocations,
+                                                     numAllocations + 1));
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void TestUtil::CountingResource::do_deallocate(void        *p,
+                                               std::size_t  bytes,
+                                               std::size_t  alignment)
+{
+    ++d_numDeallocations;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool TestUtil::CountingResource::do_is_equal(
+                       const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,233 @@
+#ifndef INCLUDED_DPLP_TESTUTIL
+#define INCLUDED_DPLP_TESTUTIL
+
+//@PURPOSE: Provide utilities for testing components that return promises.
+//
+//@CLASSES:
+//  dplp::TestUtil: namespace for test helpers inspecting promises
+//  dplp::TestUtil::CountingResource: memory resource counting allocations
+//  dplp::TestUtil::Pending: promise with its resolving functions
+//
+//@SEE_ALSO: dplp_anypromisehandle
+//
+//@DESCRIPTION: This component provides a utility class, 'dplp::TestUtil',
+// with functions that the test drivers of this package use to inspect the
+// outcome of a promise of any type without blocking. It also provides
+// 'dplp::TestUtil::CountingResource', a thread-safe memory resource that
+// counts its allocations and can be made to fail after a number of them, and
+// 'dplp::TestUtil::Pending', a promise together with the functions that
+// resolve it. This component is built into the separate 'dplp_testutil'
+// library, which only the test drivers link with, rather than into 'dplp'.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Check the rejection of a promise
+///- - - - - - - - - - - - - - - - - - - - - -
+// Suppose that a test expects an operation to fail with a message.
+//..
+//  EXPECT_EQ(dplp::TestUtil::errorOf(connectP("bad host")),
+//            "unknown host");
+//..
+//
+///Example 2: Count the allocations of an operation
+///- - - - - - - - - - - - - - - - - - - - - - - -
+// Suppose that a test expects a call to allocate one promise state from the
+// default resource and to free it once the promise is released.
+//..
+//  dplp::TestUtil::CountingResource resource;
+//  {
+//      dplp::DefaultResourceGuard guard(&resource);
+//      dplp::TestUtil::Pending<int> pending;
+//
+//      const int before = resource.numAllocations();
+//      dplp::Promise<int> result = pending.d_promise.then(increment);
+//      EXPECT_EQ(resource.numAllocations(), before + 1);
+//  }
+//  EXPECT_EQ(resource.numLive(), 0);
+//..
+
+#include <dplp_anypromisehandle.h>
+#include <dplp_promise.h>
+
+#include <atomic>           // std::atomic
+#include <climits>          // INT_MAX
+#include <cstddef>          // std::size_t
+#include <exception>        // std::exception, std::exception_ptr
+#include <functional>       // std::function
+#include <memory_resource>  // std::pmr::memory_resource
+#include <string>
+
+namespace dplp {
+
+struct TestUtil {
+    // This struct provides a namespace for functions inspecting promises in
+    // test drivers, and for the classes below.
+
+    class CountingResource;
+
+    template <typename... Types>
+    struct Pending;
+
+    static bool isResolved(const dplp::AnyPromiseHandle& promise);
+        // Return 'true' if the specified 'promise' is fulfilled or rejected,
+        // and 'false' otherwise.
+
+    template <typename EXCEPTION = std::exception>
+    static std::string errorOf(const dplp::AnyPromiseHandle& promise);
+        // Return the message of the 'EXCEPTION' the specified 'promise' is
+        // rejected with, or an empty string if it is not resolved, is
+        // fulfilled, or is rejected with another exception.
+};
+
+class TestUtil::CountingResource : public std::pmr::memory_resource {
+    // This class implements a thread-safe memory resource that counts its
+    // allocations and deallocations, which it forwards to
+    // 'std::pmr::new_delete_resource()'. An allocation beyond the limit set
+    // with 'setMaxAllocations' throws 'std::bad_alloc' and is not counted.
+
+    std::atomic<int> d_numAllocations;
+    std::atomic<int> d_numDeallocations;
+    std::atomic<int> d_maxAllocations;
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+    void do_deallocate(void        *p,
+                       std::size_t  bytes,
+                       std::size_t  alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const
+                                                             noexcept override;
+
+  public:
+    static constexpr int k_UNLIMITED = INT_MAX;
+        // A limit meaning "no limit".
+
+    CountingResource();
+        // Create a 'CountingResource' object without a limit.
+
+    void setMaxAllocations(int maxAllocations);
+        // Make allocations fail once the specified 'maxAllocations' have been
+        // made, counting the ones already made. Pass 'k_UNLIMITED' to remove
+        // the limit.
+
+    int numAllocations() const;
+        // Return the number of allocations made.
+
+    int numDeallocations() const;
+        // Return the number of deallocations made.
+
+    int numLive() const;
+        // Return the number of allocations that have not been deallocated.
+};
+
+template <typename... Types>
+struct TestUtil::Pending {
+    // This struct holds a promise and the functions resolving it.
+
+    std::function<void(Types...)>           d_fulfill;
+    std::function<void(std::exception_ptr)> d_reject;
+    dplp::Promise<Types...>                 d_promise;
+
+    Pending();
+        // Create a 'Pending' object whose promise is resolved by calling
+        // 'd_fulfill' or 'd_reject'.
+
+    Pending(const Pending&) = delete;
+    Pending& operator=(const Pending&) = delete;
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+inline
+bool TestUtil::isResolved(const dplp::AnyPromiseHandle& promise)
+{
+    return promise.isResolved();
+}
+
+template <typename EXCEPTION>
+std::string TestUtil::errorOf(const dplp::AnyPromiseHandle& promise)
+{
+    std::string result;
+    if (!promise.isResolved())
+        return result;
+
+    promise.then([] {},
+                 [&](std::exception_ptr error) {
+                     try {
+                         std::rethrow_exception(error);
+                     }
+                     catch (const EXCEPTION& e) {
+                         result = e.what();
+                     }
+                     catch (...) {
+                     }
+                 });
+    return result;
+}
+
+inline
+TestUtil::CountingResource::CountingResource()
+: d_numAllocations(0)
+, d_numDeallocations(0)
+, d_maxAllocations(k_UNLIMITED)
+{
+}
+
+inline
+void TestUtil::CountingResource::setMaxAllocations(int maxAllocations)
+{
+    d_maxAllocations.store(maxAllocations);
+}
+
+inline
+int TestUtil::CountingResource::numAllocations() const
+{
+    return d_numAllocations.load();
+}
+
+inline
+int TestUtil::CountingResource::numDeallocations() const
+{
+    return d_numDeallocations.load();
+}
+
+inline
+int TestUtil::CountingResource::numLive() const
+{
+    // Deallocations are loaded first so that a concurrent pair of calls does
+    // not make the result negative.
+    const int numDeallocations = d_numDeallocations.load();
+    return d_numAllocations.load() - numDeallocations;
+}
+
+template <typename... Types>
+TestUtil::Pending<Types...>::Pending()
+: d_promise([this](auto fulfill, auto reject) {
+    d_fulfill = fulfill;
+    d_reject  = reject;
+})
+{
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,94 @@
+#include <dplp_testutil.h>
+
+#include <dplp_promise.h>
+#include <gtest/gtest.h>
+
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+TEST(dplp_testutil, errorOf)
+{
+    const std::exception_ptr error =
+        std::make_exception_ptr(std::invalid_argument("bad"));
+
+    EXPECT_EQ(dplp::TestUtil::errorOf(dplp::makeRejectedPromise<int>(error)),
+              "bad");
+    EXPECT_EQ(dplp::TestUtil::errorOf(dplp::makeFulfilledPromise(1)), "");
+
+    // Only an exception of the given type is reported.
+    EXPECT_EQ(dplp::TestUtil::errorOf<std::invalid_argument>(
+                  dplp::makeRejectedPromise<>(error)),
+              "bad");
+    EXPECT_EQ(dplp::TestUtil::errorOf<std::out_of_range>(
+                  dplp::makeRejectedPromise<>(error)),
+              "");
+
+    // A pending promise has no error yet.
+    const dplp::Promise<int> pending([](auto, auto) {});
+    EXPECT_EQ(dplp::TestUtil::errorOf(pending), "");
+}
+
+TEST(dplp_testutil, isResolved)
+{
+    dplp::TestUtil::Pending<int> pending;
+    EXPECT_FALSE(dplp::TestUtil::isResolved(pending.d_promise));
+    pending.d_fulfill(1);
+    EXPECT_TRUE(dplp::TestUtil::isResolved(pending.d_promise));
+
+    dplp::TestUtil::Pending<> rejected;
+    rejected.d_reject(std::make_exception_ptr(std::runtime_error("error")));
+    EXPECT_TRUE(dplp::TestUtil::isResolved(rejected.d_promise));
+    EXPECT_EQ(dplp::TestUtil::errorOf(rejected.d_promise), "error");
+}
+
+TEST(dplp_testutil, CountingResource)
+{
+    dplp::TestUtil::CountingResource resource;
+
+    void *const p = resource.allocate(16);
+    void *const q = resource.allocate(32);
+    EXPECT_EQ(resource.numAllocations(), 2);
+    EXPECT_EQ(resource.numLive(), 2);
+
+    resource.deallocate(p, 16);
+    EXPECT_EQ(resource.numDeallocations(), 1);
+    EXPECT_EQ(resource.numLive(), 1);
+
+    // Allocations fail once the limit is reached, and are not counted.
+    resource.setMaxAllocations(3);
+    void *const r = resource.allocate(8);
+    EXPECT_THROW((void)resource.allocate(8), std::bad_alloc);
+    EXPECT_EQ(resource.numAllocations(), 3);
+
+    resource.setMaxAllocations(dplp::TestUtil::CountingResource::k_UNLIMITED);
+    resource.deallocate(resource.allocate(8), 8);
+    resource.deallocate(q, 32);
+    resource.deallocate(r, 8);
+    EXPECT_EQ(resource.numAllocations(), 4);
+    EXPECT_EQ(resource.numLive(), 0);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,102 @@
+#include <dplp_trampoline.h>
+
+#include <atomic>
+#include <cassert>  // assert
+#include <memory>
+
+namespace dplp {
+namespace {
+
+std::atomic<std::size_t> maxDepthValue(64);
+
+struct ThreadState {
+    std::size_t      d_depth  = 0;
+    Trampoline_Task *d_head_p = nullptr;
+    Trampoline_Task *d_tail_p = nullptr;
+
+    ~ThreadState()
+    {
+        // Tasks are only queued beneath an outermost continuation, which runs
+        // them all before it returns or throws.
+        assert(!d_head_p && "continuation left queued at thread exit");
+    }
+};
+
+thread_local ThreadState threadState;
+}
+
+std::size_t Trampoline::maxDepth()
+{
+    return maxDepthValue.load(std::memory_order_relaxed);
+}
+
+void Trampoline::setMaxDepth(std::size_t depth)
+{
+    maxDepthValue.store(depth, std::memory_order_relaxed);
+}
+
+bool Trampoline::isSaturated()
+{
+    return threadState.d_depth >=
+           maxDepthValue.load(std::memory_order_relaxed);
+}
+
+bool Trampoline::enter()
+{
+    return threadState.d_depth++ == 0;
+}
+
+void Trampoline::leave()
+{
+    --threadState.d_depth;
+}
+
+void Trampoline::enqueue(Trampoline_Task *task)
+{
+    ThreadState& state = threadState;
+    if (state.d_tail_p)
+        state.d_tail_p->d_next_p = task;
+    else
+        state.d_head_p = task;
+    state.d_tail_p = task;
+}
+
+std::exception_ptr Trampoline::drain() noexcept
+{
+    ThreadState&       state = threadState;
+    std::exception_ptr result;
+    while (Trampoline_Task *const head = state.d_head_p) {
+        state.d_head_p = head->d_next_p;
+        if (!state.d_head_p)
+            state.d_tail_p = nullptr;
+
+        const std::unique_ptr<Trampoline_Task> task(head);
+        ++state.d_depth;
+        try {
+            task->run();
+        }
+        catch (...) {
+            if (!result)
+                result = std::current_exception();
+        }
+        --state.d_depth;
+    }
+    return result;
+}
+}
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
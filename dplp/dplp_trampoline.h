@@ -0,0 +1,238 @@
+#ifndef INCLUDED_DPLP_TRAMPOLINE
+#define INCLUDED_DPLP_TRAMPOLINE
+
+//@PURPOSE: Provide a per-thread trampoline bounding continuation recursion.
+//
+//@CLASSES:
+//  dplp::Trampoline: calls or queues continuations on the current thread
+//  dplp::Trampoline_Task: a queued continuation
+//
+//@SEE_ALSO: dplp_promise, dplp_promisestate
+//
+//@DESCRIPTION: This component provides a utility class, 'dplp::Trampoline',
+// through which promises call their continuations. Continuations are called
+// synchronously: fulfilling a promise calls the continuations of its 'then's,
+// which fulfill the promises those returned, and so on, each one a frame
+// deeper on the stack. A long chain of promises that are already resolved,
+// such as a recursive read loop whose messages are already buffered, would
+// grow the stack without limit.
+//
+// 'Trampoline' counts the continuations being called on each thread. While
+// that depth is below 'Trampoline::maxDepth()', a continuation is called
+// directly. Beyond it, the continuation is moved onto a queue private to the
+// thread instead, which the outermost continuation's caller runs, in order,
+// after that continuation returns. Stack usage is thereby bounded without
+// handing continuations to an executor. A continuation that is queued runs
+// after the call that would have called it returns; the promise returned by
+// 'then' on a resolved promise may, for example, still be waiting when
+// 'then' returns from deep inside a chain.
+//
+// The maximum depth is shared by all threads and is 64 by default. If a
+// continuation throws, the continuations queued beneath it still run before
+// the exception leaves the outermost continuation, so no continuation is left
+// queued when the thread exits. If several throw, the first exception
+// propagates and the others are discarded.
+//
+// Queuing a continuation allocates a task for it. Since continuations are
+// queued by 'noexcept' functions that fulfill promises, that allocation does
+// not throw: if it fails, the continuation is called directly, deeper on the
+// stack than the limit.
+//
+///Usage
+///-----
+// This section illustrates intended use of this component.
+//
+///Example 1: Echo buffered messages
+///- - - - - - - - - - - - - - - - -
+// Suppose a server echoes messages with a recursive loop, and that 'readP'
+// returns promises that are already fulfilled while messages are buffered.
+//..
+//  dplp::Promise<> echoServer()
+//  {
+//      return readP().then([](std::string message) {
+//          return sendP(message).then([] { return echoServer(); });
+//      });
+//  }
+//..
+// However many messages are buffered, the stack holds at most
+// 'dplp::Trampoline::maxDepth()' iterations of the loop. A program that
+// resolves deep chains on small stacks can lower the limit at startup.
+//..
+//  dplp::Trampoline::setMaxDepth(16);
+//..
+
+#include <cstddef>      // std::size_t
+#include <exception>    // std::exception_ptr, std::uncaught_exceptions
+#include <functional>   // std::invoke
+#include <new>          // std::nothrow
+#include <type_traits>  // std::decay_t, std::invoke_result_t
+#include <utility>      // std::forward, std::move
+
+namespace dplp {
+
+class Trampoline_Task {
+    // This class is the base of the continuations queued on a thread.
+
+  public:
+    Trampoline_Task *d_next_p = nullptr;
+
+    virtual ~Trampoline_Task() = default;
+
+    virtual void run() = 0;
+        // Call the continuation.
+};
+
+template <typename F>
+class Trampoline_TaskImp : public Trampoline_Task {
+    // This class implements a queued continuation of type 'F'.
+
+    F d_function;
+
+  public:
+    template <typename G>
+    explicit Trampoline_TaskImp(G&& function);
+
+    void run() override;
+};
+
+struct Trampoline {
+    // This utility calls continuations on the current thread, or queues them
+    // once the thread is 'maxDepth()' continuations deep.
+
+    static std::size_t maxDepth();
+        // Return the number of nested continuations a thread calls before it
+        // queues further ones.
+
+    static void setMaxDepth(std::size_t depth);
+        // Make the specified 'depth' the number of nested continuations a
+        // thread calls before it queues further ones. The behavior is
+        // undefined unless '0 < depth'.
+
+    static bool isSaturated();
+        // Return 'true' if a continuation passed to 'run' on the current
+        // thread would be queued, and 'false' otherwise.
+
+    template <typename F>
+    static std::invoke_result_t<F> call(F&& function);
+        // Call the specified 'function' as a continuation, whatever the
+        // current depth, and return its result. If it is the outermost
+        // continuation of this thread, run the queued continuations before
+        // returning.
+
+    template <typename F>
+    static void run(F&& function);
+        // Call the specified 'function' as if by 'call' or, if this thread is
+        // saturated, queue a copy of it.
+
+  private:
+    static bool enter();
+        // Increment the depth of the current thread and return 'true' if it
+        // was zero.
+
+    static void leave();
+        // Decrement the depth of the current thread.
+
+    static void enqueue(Trampoline_Task *task);
+        // Queue the specified 'task' on the current thread and take ownership
+        // of it.
+
+    static std::exception_ptr drain() noexcept;
+        // Run and destroy the queued tasks of the current thread, including
+        // the ones queued meanwhile, and return the first exception one of
+        // them threw, if any.
+};
+
+// ============================================================================
+//                                 INLINE DEFINITIONS
+// ============================================================================
+
+template <typename F>
+template <typename G>
+Trampoline_TaskImp<F>::Trampoline_TaskImp(G&& function)
+: d_function(std::forward<G>(function))
+{
+}
+
+template <typename F>
+void Trampoline_TaskImp<F>::run()
+{
+    std::invoke(std::move(d_function));
+}
+
+template <typename F>
+std::invoke_result_t<F> Trampoline::call(F&& function)
+{
+    struct Frame {
+        const bool d_outermost     = Trampoline::enter();
+        const int  d_numExceptions =
+            d_outermost ? std::uncaught_exceptions() : 0;
+
+        ~Frame()
+        {
+            Trampoline::leave();
+
+            // If 'function' throws, the queued tasks run before its exception
+            // propagates, and theirs are discarded.
+            if (d_outermost && std::uncaught_exceptions() > d_numExceptions)
+                Trampoline::drain();
+        }
+    };
+
+    bool outermost;
+    if constexpr (std::is_void_v<std::invoke_result_t<F> >) {
+        {
+            const Frame frame;
+            outermost = frame.d_outermost;
+            std::invoke(std::forward<F>(function));
+        }
+        if (outermost) {
+            if (const std::exception_ptr error = drain())
+                std::rethrow_exception(error);
+        }
+    }
+    else {
+        std::invoke_result_t<F> result = [&] {
+            const Frame frame;
+            outermost = frame.d_outermost;
+            return std::invoke(std::forward<F>(function));
+        }();
+        if (outermost) {
+            if (const std::exception_ptr error = drain())
+                std::rethrow_exception(error);
+        }
+        return result;
+    }
+}
+
+template <typename F>
+void Trampoline::run(F&& function)
+{
+    if (isSaturated()) {
+        if (Trampoline_Task *const task =
+                new (std::nothrow) Trampoline_TaskImp<std::decay_t<F> >(
+                    std::forward<F>(function))) {
+            enqueue(task);
+            return;
+        }
+    }
+    call(std::forward<F>(function));
+}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,183 @@
+#include <dplp_trampoline.h>
+
+#include <dplp_promise.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+class MaxDepthGuard {
+    // This class sets the trampoline's maximum depth for a scope.
+
+    std::size_t d_previous;
+
+  public:
+    explicit MaxDepthGuard(std::size_t depth)
+    : d_previous(dplp::Trampoline::maxDepth())
+    {
+        dplp::Trampoline::setMaxDepth(depth);
+    }
+
+    ~MaxDepthGuard() { dplp::Trampoline::setMaxDepth(d_previous); }
+};
+
+dplp::Promise<int> countDown(int n)
+{
+    return dplp::makeFulfilledPromise(n).then([](int i) {
+        return i == 0 ? dplp::makeFulfilledPromise(0) : countDown(i - 1);
+    });
+}
+}
+
+TEST(dplp_trampoline, call)
+{
+    EXPECT_FALSE(dplp::Trampoline::isSaturated());
+    EXPECT_EQ(dplp::Trampoline::call([] { return 3; }), 3);
+
+    bool called = false;
+    dplp::Trampoline::run([&] { called = true; });
+    EXPECT_TRUE(called) << "Not called synchronously below the limit.";
+}
+
+TEST(dplp_trampoline, queue)
+{
+    const MaxDepthGuard guard(2);
+    std::vector<int>    calls;
+
+    dplp::Trampoline::run([&] {
+        dplp::Trampoline::run([&] {
+            EXPECT_TRUE(dplp::Trampoline::isSaturated());
+            dplp::Trampoline::run([&] { calls.push_back(3); });
+            dplp::Trampoline::run([&] { calls.push_back(4); });
+            calls.push_back(2);
+        });
+        calls.push_back(1);
+    });
+    EXPECT_EQ(calls, std::vector<int>({2, 1, 3, 4}));
+    EXPECT_FALSE(dplp::Trampoline::isSaturated());
+}
+
+TEST(dplp_trampoline, move_only)
+{
+    const MaxDepthGuard guard(1);
+    int                 value = 0;
+
+    dplp::Trampoline::run([&] {
+        dplp::Trampoline::run(
+            [&, p = std::make_unique<int>(7)] { value = *p; });
+        EXPECT_EQ(value, 0);
+    });
+    EXPECT_EQ(value, 7);
+}
+
+TEST(dplp_trampoline, throwing)
+{
+    const MaxDepthGuard guard(1);
+    std::vector<int>    calls;
+
+    // The continuations queued beneath one that throws run before the
+    // exception propagates.
+    EXPECT_THROW(dplp::Trampoline::run([&] {
+                     dplp::Trampoline::run([&] { calls.push_back(1); });
+                     throw std::runtime_error("thrown");
+                 }),
+                 std::runtime_error);
+    EXPECT_EQ(calls, std::vector<int>({1}));
+    EXPECT_FALSE(dplp::Trampoline::isSaturated());
+
+    // A queued continuation that throws doesn't keep the ones after it from
+    // running, and the first exception propagates.
+    calls.clear();
+    try {
+        dplp::Trampoline::run([&] {
+            dplp::Trampoline::run([] { throw 1; });
+            dplp::Trampoline::run([&] { calls.push_back(2); });
+            dplp::Trampoline::run([] { throw 3; });
+        });
+        ADD_FAILURE() << "No exception thrown.";
+    }
+    catch (int i) {
+        EXPECT_EQ(i, 1);
+    }
+    EXPECT_EQ(calls, std::vector<int>({2}));
+}
+
+TEST(dplp_trampoline, thread_exit)
+{
+    // Nothing is left queued for the thread's exit to discard.
+    const MaxDepthGuard guard(1);
+    bool                called = false;
+    std::thread([&] {
+        try {
+            dplp::Trampoline::run([&] {
+                dplp::Trampoline::run([&] { called = true; });
+                throw std::runtime_error("thrown");
+            });
+        }
+        catch (const std::runtime_error&) {
+        }
+    }).join();
+    EXPECT_TRUE(called);
+}
+
+TEST(dplp_trampoline, deep_state_chain)
+{
+    const int k_LENGTH = 100000;
+
+    std::function<void(int)> fulfill;
+    dplp::Promise<int>       p([&](auto f, auto) { fulfill = f; });
+    for (int i = 0; i < k_LENGTH; ++i)
+        p = p.then([](int i) { return i + 1; });
+
+    int result = -1;
+    p.then([&](int i) { result = i; });
+    fulfill(0);
+    EXPECT_EQ(result, k_LENGTH);
+}
+
+TEST(dplp_trampoline, deep_ready_chain)
+{
+    int result = -1;
+    countDown(100000).then([&](int i) { result = i; });
+    EXPECT_EQ(result, 0);
+}
+
+TEST(dplp_trampoline, deep_empty_chain)
+{
+    const int k_LENGTH = 100000;
+
+    std::function<void()> fulfill;
+    dplp::Promise<>       p([&](auto f, auto) { fulfill = f; });
+    int                   count = 0;
+    for (int i = 0; i < k_LENGTH; ++i)
+        p = p.then([&] { ++count; });
+
+    fulfill();
+    EXPECT_EQ(count, k_LENGTH);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+// ----------------------------------------------------------------------------
+// Copyright 2017 Bloomberg Finance L.P.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------- END-OF-FILE ----------------------------------
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Compare dpl benchmark results across build configurations.
+
+Each configuration directory is one written by the 'dpl_benchmark' target,
+i.e. '<DPL_BENCHMARK_DIR>/<DPL_CONFIGURATION_NAME>', and holds a Google
+Benchmark JSON file per benchmark executable. The first directory is the
+baseline. For every benchmark, the report shows its mean real time in each
+configuration and the speedup relative to the baseline.
+
+Usage:
+    dpl_benchreport.py [--stat mean|median] BASELINE_DIR OTHER_DIR...
+
+Example:
+    dpl_benchreport.py build/benchmarks/Release \\
+                       build-lto/benchmarks/Release-lto \\
+                       build-pgo/benchmarks/Release-lto-pgouse
+"""
+
+import argparse
+import json
+import os
+import sys
+
+_TO_NS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+
+
+def load_configuration(directory, stat):
+    """Return a map from benchmark name to its real time, in nanoseconds, for
+    the specified statistic of the runs in the specified directory.
+    """
+    results = {}
+    for filename in sorted(os.listdir(directory)):
+        if not filename.endswith('.json'):
+            continue
+        executable = filename[:-len('.json')]
+        with open(os.path.join(directory, filename)) as f:
+            data = json.load(f)
+        for bench in data.get('benchmarks', []):
+            if bench.get('run_type') == 'aggregate':
+                if bench.get('aggregate_name') != stat:
+                    continue
+                name = bench['run_name']
+            else:
+                name = bench['name']
+            scale = _TO_NS[bench.get('time_unit', 'ns')]
+            results[executable + ':' + name] = bench['real_time'] * scale
+    return results
+
+
+def format_time(ns):
+    if ns is None:
+        return '-'
+    for unit, scale in (('s', 1e9), ('ms', 1e6), ('us', 1e3)):
+        if ns >= scale:
+            return '%.3g %s' % (ns / scale, unit)
+    return '%.3g ns' % ns
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+        description='Compare dpl benchmark results across configurations.')
+    parser.add_argument('--stat', default='mean', choices=['mean', 'median'],
+                        help='aggregate to compare when runs were repeated')
+    parser.add_argument('directories', nargs='+', metavar='DIR',
+                        help='configuration directories, baseline first')
+    args = parser.parse_args(argv)
+
+    names = [os.path.basename(os.path.normpath(d)) for d in args.directories]
+    configurations = [load_configuration(d, args.stat)
+                      for d in args.directories]
+
+    benchmarks = sorted(set().union(*configurations))
+    if not benchmarks:
+        print('no benchmark results found', file=sys.stderr)
+        return 1
+
+    header = ['benchmark'] + names
+    rows = []
+    for bench in benchmarks:
+        baseline = configurations[0].get(bench)
+        row = [bench, format_time(baseline)]
+        for configuration in configurations[1:]:
+            time = configuration.get(bench)
+            cell = format_time(time)
+            if time and baseline:
+                cell += ' (%.2fx)' % (baseline / time)
+            row.append(cell)
+        rows.append(row)
+
+    widths = [max(len(r[i]) for r in [header] + rows)
+              for i in range(len(header))]
+    for row in [header, ['-' * w for w in widths]] + rows:
+        print('  '.join(cell.ljust(w) for cell, w in zip(row, widths))
+              .rstrip())
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
+
+# -----------------------------------------------------------------------------
+# Copyright 2017 Bloomberg Finance L.P.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ----------------------------- END-OF-FILE -----------------------------------
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Measure the compile time and size of large 'dplm20::overload' visitors.
+
+For each overload set size N, this script generates a translation unit that
+builds a visitor of N lambdas with 'dplm20::overload', checks its 'sizeof'
+with a 'static_assert', and visits an N-alternative 'dplm17::variant' with
+it. It compiles the translation unit and reports the compile time. Half of
+the lambdas capture a pointer, so the expected size is 'N / 2' pointers; the
+build fails if empty lambdas start taking up space again.
+
+Pass '--baseline DIR' to also compile against another copy of
+'dplm20_overload.h' (e.g. from an older revision) and report the ratio.
+
+Usage:
+    dpl_overloadcompiletime.py [--cxx CXX] [--sizes 8,16,...] [--baseline DIR]
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+_TEMPLATE = '''\
+#include <dplm17_variant.h>
+#include <dplm20_overload.h>
+
+template <int I>
+struct Message {{
+    int d_value;
+}};
+
+using MessageVariant = dplm17::variant<{alternatives}>;
+
+int visit(const MessageVariant& message, int *counter)
+{{
+    auto visitor = dplm20::overload({lambdas});
+    static_assert(sizeof(visitor) == {size}, "unexpected visitor size");
+    return dplm17::visit(visitor, message);
+}}
+'''
+
+
+def generate(n):
+    alternatives = ', '.join('Message<%d>' % i for i in range(n))
+    lambdas = []
+    for i in range(n):
+        capture = 'counter' if i % 2 else ''
+        body = '++*counter; ' if i % 2 else ''
+        lambdas.append('[%s](const Message<%d>& m) { %sreturn m.d_value; }'
+                       % (capture, i, body))
+    size = 'sizeof(int *) * %d' % (n // 2) if n > 1 else '1'
+    return _TEMPLATE.format(alternatives=alternatives,
+                            lambdas=',\n        '.join(lambdas),
+                            size=size)
+
+
+def compile_time(cxx, flags, overload_dir, source):
+    command = [cxx] + flags + [
+        '-I' + overload_dir,
+        '-I' + os.path.join(_ROOT, 'dplm17'),
+        '-c', source, '-o', os.devnull]
+    start = time.monotonic()
+    result = subprocess.run(command, stderr=subprocess.PIPE,
+                            universal_newlines=True)
+    elapsed = time.monotonic() - start
+    if result.returncode != 0:
+        sys.stderr.write(result.stderr)
+        return None
+    return elapsed
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+        description='Measure compile time of large dplm20::overload sets.')
+    parser.add_argument('--cxx', default=os.environ.get('CXX', 'c++'))
+    parser.add_argument('--flags', default='-std=c++20 -O2',
+                        help='compiler flags (default: %(default)s)')
+    parser.add_argument('--sizes', default='8,16,32,64,128',
+                        help='comma-separated overload set sizes')
+    parser.add_argument('--baseline', metavar='DIR',
+                        help='directory with a baseline dplm20_overload.h')
+    args = parser.parse_args(argv)
+
+    flags = args.flags.split()
+    current = os.path.join(_ROOT, 'dplm20')
+    failed = False
+
+    header = '%6s  %10s' % ('N', 'current')
+    if args.baseline:
+        header += '  %10s  %7s' % ('baseline', 'ratio')
+    print(header)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        for n in (int(s) for s in args.sizes.split(',')):
+            source = os.path.join(tmp, 'overload%d.cpp' % n)
+            with open(source, 'w') as f:
+                f.write(generate(n))
+
+            seconds = compile_time(args.cxx, flags, current, source)
+            failed = failed or seconds is None
+            line = '%6d  %10s' % (
+                n, '%.2f s' % seconds if seconds is not None else 'FAILED')
+            if args.baseline:
+                base = compile_time(args.cxx, flags, args.baseline, source)
+                line += '  %10s' % ('%.2f s' % base if base else 'FAILED')
+                if base and seconds:
+                    line += '  %6.2fx' % (base / seconds)
+            print(line)
+            sys.stdout.flush()
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
+
+# -----------------------------------------------------------------------------
+# Copyright 2017 Bloomberg Finance L.P.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ----------------------------- END-OF-FILE -----------------------------------